@@ -0,0 +1,127 @@
+#ifndef ADFGVX_CODEC_H
+#define ADFGVX_CODEC_H
+
+#include <stddef.h> // Para size_t
+
+// Codec Polybius compartilhado pelos modulos de cifragem e decifragem.
+// A matriz `square` e o vetor `symbols` sao definidos uma unica vez em adfgvx_codec.c;
+// a partir deles sao geradas tabelas de 256 entradas que trocam as buscas lineares
+// por um acesso direto por byte.
+
+// Numero de simbolos ADFGVX (lado da matriz Polybius).
+#define ADFGVX_SYMBOL_COUNT 6
+
+// Valor sentinela das tabelas para bytes que nao pertencem a matriz / aos simbolos.
+#define ADFGVX_CODEC_INVALID 0xFF
+
+// Numero de bytes de entrada que os modulos de cifragem codificam de cada vez com
+// adfgvx_encode_symbols (o buffer de saida correspondente tem o dobro do tamanho).
+#define ADFGVX_ENCODE_BLOCK_SIZE 4096
+
+/**
+ * @brief Implementacoes disponiveis do kernel de codificacao (adfgvx_encode_symbols).
+ */
+typedef enum
+{
+    ADFGVX_KERNEL_SCALAR = 0, // Consulta a tabela byte a byte; referencia exata.
+    ADFGVX_KERNEL_SSSE3,      // 16 bytes por iteracao (pshufb).
+    ADFGVX_KERNEL_AVX2        // 32 bytes por iteracao (vpshufb).
+} adfgvx_encode_kernel;
+
+/**
+ * @brief Tabela de cifragem: para cada byte, o par {simbolo da linha, simbolo da coluna}.
+ * Bytes fora da matriz Polybius tem o par {0, 0}.
+ * Valida apenas depois de adfgvx_codec_init().
+ */
+extern char adfgvx_encode_table[256][2];
+
+/**
+ * @brief Tabela de decifragem: para cada byte, o indice (0..5) do simbolo ADFGVX,
+ * ou ADFGVX_CODEC_INVALID se o byte nao for um simbolo.
+ * Valida apenas depois de adfgvx_codec_init().
+ */
+extern unsigned char adfgvx_symbol_value[256];
+
+/**
+ * @brief Celulas da matriz Polybius em ordem linha a linha (square[i][j] == cells[i * 6 + j]).
+ */
+extern const char adfgvx_square_cells[ADFGVX_SYMBOL_COUNT * ADFGVX_SYMBOL_COUNT];
+
+/**
+ * @brief Vetor com os simbolos 'A', 'D', 'F', 'G', 'V', 'X'.
+ */
+extern const char adfgvx_symbols[ADFGVX_SYMBOL_COUNT];
+
+/**
+ * @brief Gera as tabelas de cifragem e decifragem a partir de `square` e `symbols`.
+ * Pode ser chamada varias vezes, inclusive de threads diferentes ao mesmo tempo; apenas a
+ * primeira chamada faz o trabalho (pthread_once) e as demais esperam ela terminar.
+ * As funcoes publicas de cifragem e decifragem ja a chamam.
+ */
+void adfgvx_codec_init(void);
+
+/**
+ * @brief Codifica um bloco de texto na sequencia de simbolos ADFGVX (dois por caractere
+ * valido), descartando os caracteres fora da matriz. E a etapa de substituicao da cifra,
+ * antes da distribuicao nas colunas.
+ * Usa o kernel selecionado por adfgvx_codec_init (o mais rapido suportado pela CPU);
+ * todos produzem exatamente a mesma saida que o kernel escalar.
+ *
+ * @param input Texto de entrada (nao precisa ser terminado em nulo).
+ * @param length Numero de bytes em input.
+ * @param symbols Saida; deve ter espaco para 2 * length simbolos.
+ * @return size_t Numero de simbolos escritos.
+ */
+size_t adfgvx_encode_symbols(const char *input, size_t length, char *symbols);
+
+/**
+ * @brief Escolhe o kernel usado por adfgvx_encode_symbols (para testes e medicoes).
+ *
+ * @param kernel Kernel desejado.
+ * @return int 0 em caso de sucesso, 1 se a CPU ou o compilador nao suportam o kernel
+ * (o kernel atual e mantido).
+ */
+int adfgvx_codec_select_kernel(adfgvx_encode_kernel kernel);
+
+/**
+ * @brief Retorna o kernel usado atualmente por adfgvx_encode_symbols.
+ */
+adfgvx_encode_kernel adfgvx_codec_active_kernel(void);
+
+/**
+ * @brief Obtem os simbolos ADFGVX de um caractere em O(1).
+ *
+ * @param c Caractere a ser cifrado.
+ * @param row Ponteiro para armazenar o simbolo da linha.
+ * @param col Ponteiro para armazenar o simbolo da coluna.
+ * @return int Retorna 1 se o caractere pertence a matriz, 0 caso contrario.
+ */
+static inline int adfgvx_encode_char(char c, char *row, char *col)
+{
+    const char *pair = adfgvx_encode_table[(unsigned char)c];
+
+    *row = pair[0];
+    *col = pair[1];
+    return pair[0] != 0;
+}
+
+/**
+ * @brief Decodifica um par de simbolos ADFGVX em O(1).
+ *
+ * @param row_symbol Simbolo da linha.
+ * @param col_symbol Simbolo da coluna.
+ * @return int O caractere da matriz (0..255), ou -1 se algum dos simbolos for invalido.
+ */
+static inline int adfgvx_decode_pair(char row_symbol, char col_symbol)
+{
+    unsigned char row = adfgvx_symbol_value[(unsigned char)row_symbol];
+    unsigned char col = adfgvx_symbol_value[(unsigned char)col_symbol];
+
+    if ((row | col) & 0x80) // O sentinela e o unico valor com o bit alto ligado.
+    {
+        return -1;
+    }
+    return (unsigned char)adfgvx_square_cells[row * ADFGVX_SYMBOL_COUNT + col];
+}
+
+#endif // ADFGVX_CODEC_H
@@ -0,0 +1,260 @@
+#ifndef ADFGVX_CONTAINER_H
+#define ADFGVX_CONTAINER_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+#include "adfgvx_key.h"  // Para adfgvx_key_ctx e adfgvx_batch_item
+#include "thread_pool.h" // Para thread_pool
+
+// Formato em blocos ("container") do texto cifrado. Todos os inteiros sao little-endian:
+//
+//   cabecalho (24 bytes): "ADFGVXC1", key_length (u32), reservado (u32, 0), block_size (u64)
+//   blocos:               cada bloco e um texto cifrado ADFGVX independente (simbolos ASCII)
+//                         de block_size caracteres da mensagem (o ultimo pode ser menor)
+//   indice:               por bloco, offset no arquivo (u64) e caracteres da mensagem (u64)
+//   rodape (32 bytes):    message_length (u64), block_count (u64), offset do indice (u64), "ADFGVXCE"
+//
+// Como cada bloco e transposto sozinho, os blocos podem ser cifrados e decifrados em
+// paralelo, e o caractere N da mensagem esta no bloco N / block_size. O rodape fica no fim
+// do arquivo: um arquivo truncado perde o rodape (ou deixa de bater com o indice), o que e
+// detectado na abertura sem decifrar nada.
+
+#define ADFGVX_CONTAINER_MAGIC "ADFGVXC1"
+#define ADFGVX_CONTAINER_END_MAGIC "ADFGVXCE"
+#define ADFGVX_CONTAINER_HEADER_SIZE 24
+#define ADFGVX_CONTAINER_INDEX_ENTRY_SIZE 16
+#define ADFGVX_CONTAINER_FOOTER_SIZE 32
+
+/**
+ * @brief Destino dos bytes produzidos pelos contextos de fluxo do container (ex: o buffer
+ * de um bloco do pipeline do modo filtro).
+ *
+ * @return int 0 em caso de sucesso, diferente de 0 se os bytes nao puderem ser gravados.
+ */
+typedef int (*adfgvx_container_sink)(void *user, const char *data, size_t length);
+
+/**
+ * @brief Contexto de escrita de um container (init / update / final).
+ *
+ * A mensagem e entregue em blocos de qualquer tamanho; os caracteres validos sao
+ * acumulados ate completar um lote de blocos, que e cifrado (um bloco por item de
+ * cipher_adfgvx_batch, dividido entre as threads do pool) e escrito em ordem. A memoria
+ * usada depende apenas de block_size e do numero de threads, nao do tamanho da mensagem.
+ * Os campos sao geridos pelas funcoes adfgvx_container_writer_*; o chamador pode ler
+ * message_length e block_count.
+ */
+typedef struct
+{
+    adfgvx_container_sink sink;          // Destino dos bytes do container.
+    void *sink_user;
+    FILE *output;                        // Arquivo de saida (NULL com adfgvx_container_writer_init_sink).
+    const adfgvx_key_ctx *key_ctx;
+    thread_pool *pool;
+    size_t block_size;                   // Caracteres da mensagem por bloco.
+    size_t batch_blocks;                 // Blocos cifrados de cada vez.
+    char *pending;                       // Caracteres validos ainda nao cifrados (batch_blocks * block_size).
+    size_t pending_length;
+    char *encrypted;                     // Saida do lote (o dobro de pending).
+    adfgvx_batch_item *items;            // Um item por bloco do lote.
+    unsigned long long *index;           // Pares (offset, caracteres) de cada bloco escrito.
+    size_t index_capacity;               // Capacidade de index, em blocos.
+    unsigned long long offset;           // Posicao do proximo byte escrito.
+    unsigned long long message_length;   // Caracteres validos recebidos ate agora.
+    size_t block_count;                  // Blocos escritos ate agora.
+    int status;                          // Primeiro erro ocorrido (0 se nenhum).
+} adfgvx_container_writer;
+
+/**
+ * @brief Inicializa a escrita de um container e escreve o cabecalho.
+ *
+ * @param writer Contexto a ser inicializado.
+ * @param output Arquivo de saida (aberto para escrita em modo binario).
+ * @param key_ctx Contexto de chave; deve continuar valido ate final.
+ * @param block_size Caracteres da mensagem por bloco (> 0; ADFGVX_CONTAINER_BLOCK_SIZE e o padrao das ferramentas).
+ * @param pool Pool de threads que cifra os blocos de cada lote; NULL cifra na thread chamadora.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria,
+ * 3 se houver erro de escrita.
+ */
+int adfgvx_container_writer_init(adfgvx_container_writer *writer,
+                                 FILE *output,
+                                 const adfgvx_key_ctx *key_ctx,
+                                 size_t block_size,
+                                 thread_pool *pool);
+
+/**
+ * @brief Como adfgvx_container_writer_init, mas entrega os bytes do container (cabecalho,
+ * blocos, indice e rodape, nesta ordem) a sink em vez de grava-los num arquivo. Nada e
+ * relido: o container pode ir para um pipe (modo filtro).
+ *
+ * @return int Mesmos codigos de adfgvx_container_writer_init (3 se sink falhar).
+ */
+int adfgvx_container_writer_init_sink(adfgvx_container_writer *writer,
+                                      adfgvx_container_sink sink,
+                                      void *sink_user,
+                                      const adfgvx_key_ctx *key_ctx,
+                                      size_t block_size,
+                                      thread_pool *pool);
+
+/**
+ * @brief Acrescenta mais um bloco da mensagem. Caracteres fora da matriz Polybius
+ * (incluindo quebras de linha) sao ignorados, como em cipher_adfgvx.
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria, 3 se houver erro de escrita.
+ */
+int adfgvx_container_writer_update(adfgvx_container_writer *writer, const char *chunk, size_t length);
+
+/**
+ * @brief Cifra os caracteres pendentes, escreve o indice e o rodape e libera os recursos
+ * do contexto (o arquivo de saida nao e fechado). Deve ser chamada sempre apos um init bem
+ * sucedido; depois de um erro em update apenas libera os recursos e devolve o erro.
+ *
+ * @return int 0 em caso de sucesso, ou o codigo do primeiro erro (2 ou 3).
+ */
+int adfgvx_container_writer_final(adfgvx_container_writer *writer);
+
+/**
+ * @brief Posicao e tamanho de um bloco do container.
+ */
+typedef struct
+{
+    size_t offset; // Posicao do bloco no arquivo.
+    size_t length; // Caracteres da mensagem no bloco (o bloco tem o dobro de simbolos).
+} adfgvx_container_block;
+
+/**
+ * @brief Container aberto para leitura: metadados do cabecalho e do rodape e o indice.
+ */
+typedef struct
+{
+    FILE *input;
+    int key_length;                 // Comprimento da chave usada na cifragem.
+    size_t block_size;              // Caracteres da mensagem por bloco.
+    size_t message_length;          // Caracteres da mensagem (soma dos blocos).
+    size_t block_count;
+    adfgvx_container_block *blocks; // Indice, na ordem da mensagem.
+} adfgvx_container;
+
+/**
+ * @brief Abre um container: le o cabecalho, o rodape e o indice e confere que sao
+ * consistentes entre si e com o tamanho do arquivo (nenhum bloco e lido ou decifrado).
+ *
+ * @param container Container a ser preenchido.
+ * @param input Arquivo aberto para leitura em modo binario; deve continuar aberto ate
+ * adfgvx_container_close.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria
+ * ou houver erro de leitura, 3 se o arquivo nao for um container, 4 se o container estiver
+ * truncado ou corrompido (rodape ausente ou indice inconsistente).
+ */
+int adfgvx_container_open(adfgvx_container *container, FILE *input);
+
+/**
+ * @brief Decifra um unico bloco, lendo do arquivo apenas os seus simbolos (acesso aleatorio).
+ *
+ * @param container Container aberto por adfgvx_container_open.
+ * @param key_ctx Contexto de chave com o mesmo key_length do container.
+ * @param block Indice do bloco (0 .. block_count - 1).
+ * @param output Buffer de saida; deve ter pelo menos blocks[block].length bytes.
+ * @param output_capacity Tamanho de output, em bytes.
+ * @param output_length Saida: caracteres escritos.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria
+ * ou houver erro de leitura, 3 se o bloco tiver simbolos invalidos.
+ */
+int adfgvx_container_decrypt_block(const adfgvx_container *container,
+                                   const adfgvx_key_ctx *key_ctx,
+                                   size_t block,
+                                   char *output,
+                                   size_t output_capacity,
+                                   size_t *output_length);
+
+/**
+ * @brief Decifra o container inteiro e escreve a mensagem em output.
+ * Os blocos sao lidos em lotes pela thread chamadora, decifrados em paralelo pelas
+ * threads do pool (decipher_adfgvx_batch) e escritos em ordem.
+ *
+ * @param pool Pool de threads; NULL decifra na thread chamadora.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria
+ * ou houver erro de leitura, 3 se algum bloco tiver simbolos invalidos, 4 se houver erro de escrita.
+ */
+int adfgvx_container_decrypt(const adfgvx_container *container,
+                             const adfgvx_key_ctx *key_ctx,
+                             FILE *output,
+                             thread_pool *pool);
+
+/**
+ * @brief Libera o indice de um container (o arquivo nao e fechado).
+ */
+void adfgvx_container_close(adfgvx_container *container);
+
+/**
+ * @brief Contexto de leitura sequencial de um container (init / update / final), para
+ * decifrar um container recebido por um pipe, sem acesso aleatorio.
+ *
+ * O container e entregue em pedacos de qualquer tamanho. Os blocos cheios sao acumulados
+ * em lotes, decifrados (um bloco por item de decipher_adfgvx_batch, dividido entre as
+ * threads do pool) e entregues a sink em ordem. A area dos blocos so tem os simbolos
+ * ADFGVX; o primeiro byte diferente (o indice comeca pelo offset 24, e um container vazio
+ * pelo rodape, com message_length 0) marca o ultimo bloco, e o indice e o rodape sao
+ * conferidos contra os blocos recebidos em final. Como a mensagem e entregue antes do
+ * rodape, um container truncado so e detectado no fim, depois dos blocos completos.
+ * Os campos sao geridos pelas funcoes adfgvx_container_reader_*; o chamador pode ler
+ * message_length e block_count.
+ */
+typedef struct
+{
+    adfgvx_container_sink sink;
+    void *sink_user;
+    const adfgvx_key_ctx *key_ctx;
+    thread_pool *pool;
+    unsigned char header[ADFGVX_CONTAINER_HEADER_SIZE];
+    size_t header_length;                // Bytes do cabecalho recebidos ate agora.
+    size_t block_size;                   // Caracteres da mensagem por bloco (do cabecalho).
+    size_t batch_blocks;                 // Blocos decifrados de cada vez.
+    char *encrypted;                     // Simbolos do lote atual (2 * batch_blocks * block_size).
+    size_t encrypted_length;
+    char *decrypted;                     // Saida do lote.
+    adfgvx_batch_item *items;            // Um item por bloco do lote.
+    unsigned char *tail;                 // Indice e rodape.
+    size_t tail_length;
+    size_t tail_capacity;
+    int in_tail;                         // 1 depois do fim da area dos blocos.
+    unsigned long long message_length;   // Caracteres decifrados ate agora.
+    size_t block_count;                  // Blocos decifrados ate agora.
+    int status;                          // Primeiro erro ocorrido (0 se nenhum).
+} adfgvx_container_reader;
+
+/**
+ * @brief Inicializa a leitura sequencial de um container.
+ *
+ * @param reader Contexto a ser inicializado.
+ * @param sink Destino da mensagem decifrada.
+ * @param sink_user Repassado a sink.
+ * @param key_ctx Contexto de chave (o comprimento deve ser o do container); valido ate final.
+ * @param pool Pool de threads que decifra os blocos de cada lote; NULL decifra na thread chamadora.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos.
+ */
+int adfgvx_container_reader_init(adfgvx_container_reader *reader,
+                                 adfgvx_container_sink sink,
+                                 void *sink_user,
+                                 const adfgvx_key_ctx *key_ctx,
+                                 thread_pool *pool);
+
+/**
+ * @brief Acrescenta mais um pedaco do container.
+ *
+ * @return int 0 em caso de sucesso, 1 se o container usar uma chave de outro comprimento,
+ * 2 se faltar memoria, 3 se nao for um container, 4 se estiver corrompido (incluindo
+ * simbolos invalidos), 5 se sink falhar.
+ */
+int adfgvx_container_reader_update(adfgvx_container_reader *reader, const char *chunk, size_t length);
+
+/**
+ * @brief Decifra o ultimo lote, confere o indice e o rodape e libera os recursos do
+ * contexto. Deve ser chamada sempre apos um init bem sucedido.
+ *
+ * @return int 0 em caso de sucesso, ou o codigo do primeiro erro (como em update; 3 se a
+ * entrada terminar antes do cabecalho, 4 se o container estiver truncado).
+ */
+int adfgvx_container_reader_final(adfgvx_container_reader *reader);
+
+#endif // ADFGVX_CONTAINER_H
@@ -1,26 +1,229 @@
-#ifndef ADFGVX_CORE_H
-#define ADFGVX_CORE_H
-
-#include "cipher_config.h" // Para MAX_MESSAGE_LENGTH
-
-/**
- * @brief Aplica a cifra ADFGVX: codifica os simbolos e faz a transposicao das colunas.
- * Esta  a funo pblica principal do mdulo de cifra.
- *
- * @param key A chave usada na transposicao (array de caracteres, string terminada em nulo).
- * @param key_length Comprimento real da chave (numero de caracteres na chave).
- * @param message Mensagem de entrada (string terminada em nulo).
- * @param encoded_symbol_matrix Matriz onde os simbolos codificados serao armazenados.
- * A primeira dimensao DEVE corresponder a key_length.
- * A segunda dimensao  MAX_MESSAGE_LENGTH.
- * @param symbols_per_column Vetor (com tamanho baseado em MAX_KEY_LENGTH ou key_length)
- * para armazenar a contagem de elementos em cada coluna.
- * Deve ser inicializado com zeros pelo chamador.
- */
-void cipher_adfgvx(char key[],
-                   int key_length,
-                   char message[],
-                   char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH],
-                   int symbols_per_column[]);
-
-#endif // ADFGVX_CORE_H
+#ifndef ADFGVX_CORE_H
+#define ADFGVX_CORE_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+#include "cipher_config.h" // Para MAX_MESSAGE_LENGTH
+#include "adfgvx_key.h"     // Para adfgvx_key_ctx e adfgvx_batch_item
+#include "adfgvx_workspace.h" // Para adfgvx_workspace
+#include "thread_pool.h"    // Para thread_pool
+
+/**
+ * @brief Aplica a cifra ADFGVX: codifica os simbolos e faz a transposicao das colunas.
+ * Esta é a função pública principal do módulo de cifra.
+ *
+ * A transposicao nao move as colunas: a matriz fica na ordem original da chave e
+ * column_order indica a ordem em que as colunas devem ser lidas para formar o texto
+ * cifrado (coluna column_order[0] primeiro, depois column_order[1], ...).
+ *
+ * @param key A chave usada na transposicao (array de caracteres, string terminada em nulo).
+ * @param key_length Comprimento real da chave (numero de caracteres na chave).
+ * @param message Mensagem de entrada (string terminada em nulo).
+ * @param encoded_symbol_matrix Matriz onde os simbolos codificados serao armazenados.
+ * A primeira dimensao DEVE corresponder a key_length.
+ * A segunda dimensao é MAX_MESSAGE_LENGTH.
+ * @param symbols_per_column Vetor (com tamanho baseado em MAX_KEY_LENGTH ou key_length)
+ * para armazenar a contagem de elementos em cada coluna (na ordem original da chave).
+ * Deve ser inicializado com zeros pelo chamador.
+ * @param column_order Vetor com key_length posicoes que recebe a ordem de leitura das colunas.
+ */
+void cipher_adfgvx(char key[],
+                   int key_length,
+                   char message[],
+                   char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH],
+                   int symbols_per_column[],
+                   int column_order[]);
+
+/**
+ * @brief Calcula o comprimento do texto cifrado de uma mensagem: dois simbolos por
+ * caractere presente na matriz Polybius (os demais sao ignorados pela cifra).
+ * Usada para dimensionar a saida de cipher_adfgvx_linear.
+ *
+ * @param message Mensagem de entrada (nao precisa ser terminada em nulo).
+ * @param message_length Numero de bytes em message.
+ * @return size_t Numero de simbolos do texto cifrado.
+ */
+size_t cipher_adfgvx_output_length(const char message[], size_t message_length);
+
+/**
+ * @brief Cifra a mensagem diretamente num buffer linear, em uma unica passagem e sem
+ * matriz intermediaria.
+ *
+ * A posicao final de cada simbolo no texto cifrado e calculada a partir do seu indice,
+ * da ordem das colunas e do comprimento total (ver adfgvx_key_column_starts), e o
+ * simbolo e gravado diretamente nela. O resultado e identico ao de cipher_adfgvx
+ * seguido da leitura das colunas na ordem de column_order.
+ *
+ * @param key A chave usada na transposicao.
+ * @param key_length Comprimento da chave (entre 1 e MAX_KEY_LENGTH - 1).
+ * @param message Mensagem de entrada (nao precisa ser terminada em nulo).
+ * @param message_length Numero de bytes em message.
+ * @param output Buffer de saida; o texto cifrado NAO e terminado em nulo.
+ * @param output_capacity Tamanho de output, em bytes.
+ * @param output_length Recebe o numero de simbolos escritos em output.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos,
+ * 2 se output_capacity for menor que cipher_adfgvx_output_length(message, message_length),
+ * 3 se faltar memoria (so com chaves de mais de ADFGVX_KEY_STACK_COLUMNS colunas; as
+ * mais curtas usam uma arena fixa na pilha e nao alocam nada).
+ */
+int cipher_adfgvx_linear(const char key[],
+                         int key_length,
+                         const char message[],
+                         size_t message_length,
+                         char output[],
+                         size_t output_capacity,
+                         size_t *output_length);
+
+/**
+ * @brief Versao de cipher_adfgvx_linear sobre um contexto de chave pre-calculado:
+ * a ordem das colunas nao e recalculada a cada mensagem.
+ *
+ * @param key_ctx Contexto inicializado por adfgvx_key_ctx_init (apenas lido).
+ * @return int Mesmos codigos de cipher_adfgvx_linear.
+ */
+int cipher_adfgvx_linear_ctx(const adfgvx_key_ctx *key_ctx,
+                             const char message[],
+                             size_t message_length,
+                             char output[],
+                             size_t output_capacity,
+                             size_t *output_length);
+
+/**
+ * @brief Versao de cipher_adfgvx_linear que usa uma arena do chamador para a agenda da
+ * chave e as tabelas de colunas: depois que a arena tem o tamanho da maior chave usada,
+ * as chamadas nao alocam nem zeram memoria (adequado a muitas mensagens curtas, cada uma
+ * com a sua chave). O que a chamada reserva na arena e devolvido antes de retornar.
+ *
+ * @param ws Arena (adfgvx_workspace_init); no modo fixo precisa de pelo menos
+ * ADFGVX_WORKSPACE_KEY_BYTES(key_length) bytes livres.
+ * @return int Mesmos codigos de cipher_adfgvx_linear (3 se nao couber na arena).
+ */
+int cipher_adfgvx_ws(adfgvx_workspace *ws,
+                     const char key[],
+                     int key_length,
+                     const char message[],
+                     size_t message_length,
+                     char output[],
+                     size_t output_capacity,
+                     size_t *output_length);
+
+/**
+ * @brief Cifra um lote de mensagens com a mesma chave.
+ * Para cada item, input e cifrado em output (como em cipher_adfgvx_linear_ctx) e
+ * output_length e status sao preenchidos. O contexto de chave nao e alterado, entao
+ * varias threads podem processar lotes diferentes com o mesmo contexto.
+ *
+ * @param key_ctx Contexto inicializado por adfgvx_key_ctx_init.
+ * @param items Vetor de itens do lote.
+ * @param count Numero de itens.
+ * @return size_t Numero de itens com status diferente de 0.
+ */
+size_t cipher_adfgvx_batch(const adfgvx_key_ctx *key_ctx, adfgvx_batch_item items[], size_t count);
+
+/**
+ * @brief Versao de cipher_adfgvx_linear_ctx que divide uma mensagem grande entre as
+ * threads de um pool.
+ *
+ * A mensagem e dividida em trechos; numa primeira fase cada thread conta os simbolos
+ * dos seus trechos, o que da o indice global do primeiro simbolo de cada um, e numa
+ * segunda fase cada trecho e codificado e espalhado direto nas suas posicoes finais
+ * (que nao se sobrepoem entre trechos). O resultado e identico ao da versao linear.
+ *
+ * @param pool Pool de threads; com NULL, um pool de uma thread ou mensagens menores que
+ * parallel_threshold, a mensagem e cifrada por cipher_adfgvx_linear_ctx na thread chamadora.
+ * @param parallel_threshold Tamanho minimo (em bytes) da mensagem para usar o pool
+ * (ADFGVX_PARALLEL_THRESHOLD e o valor padrao das ferramentas).
+ * @return int Mesmos codigos de cipher_adfgvx_linear.
+ */
+int cipher_adfgvx_parallel(const adfgvx_key_ctx *key_ctx,
+                           const char message[],
+                           size_t message_length,
+                           char output[],
+                           size_t output_capacity,
+                           size_t *output_length,
+                           thread_pool *pool,
+                           size_t parallel_threshold);
+
+/**
+ * @brief Cifra com varias chaves de transposicao aplicadas em sequencia (rodadas, ex: a
+ * dupla transposicao): a substituicao Polybius uma vez e, depois, a transposicao com
+ * keys[0], a do resultado com keys[1], e assim por diante.
+ *
+ * As rodadas sao compostas num unico mapa (adfgvx_rounds_map). Com periodo de ate
+ * ADFGVX_ROUNDS_MAX_PERIOD, cada simbolo e gravado direto na sua posicao final, numa unica
+ * passagem: a transposicao de uma chave de P colunas (kernels e ladrilhos), com o custo de
+ * uma rodada. Acima disso, cada rodada e uma passagem (kernels e ladrilhos da sua chave),
+ * alternando entre output e um buffer auxiliar de total_symbols bytes.
+ * Com uma rodada, o resultado e identico ao de cipher_adfgvx_linear_ctx.
+ *
+ * @param keys Contextos inicializados por adfgvx_key_ctx_init, na ordem das rodadas.
+ * @param round_count Numero de rodadas (entre 1 e ADFGVX_MAX_ROUNDS).
+ * @return int Mesmos codigos de cipher_adfgvx_linear (3 se faltar memoria para o mapa ou
+ * para o buffer auxiliar).
+ */
+int cipher_adfgvx_rounds(const adfgvx_key_ctx keys[],
+                         int round_count,
+                         const char message[],
+                         size_t message_length,
+                         char output[],
+                         size_t output_capacity,
+                         size_t *output_length);
+
+/**
+ * @brief Contexto da cifragem em fluxo (init / update / final).
+ *
+ * Permite cifrar mensagens de qualquer tamanho entregues em blocos. Cada coluna da
+ * transposicao e acumulada num buffer de ADFGVX_STREAM_BUFFER_SIZE bytes e despejada
+ * num arquivo temporario quando enche, de modo que a memoria usada depende apenas de
+ * key_length e nao do tamanho da mensagem.
+ * Os campos sao geridos pelas funcoes adfgvx_cipher_stream_*; o chamador pode apenas
+ * ler symbol_count (tamanho do texto cifrado produzido por final).
+ */
+typedef struct
+{
+    int key_length;
+    int column_order[ADFGVX_STREAM_MAX_KEY_LENGTH];      // column_order[i] = coluna original na i-esima posicao alfabetica.
+    FILE *column_spill[ADFGVX_STREAM_MAX_KEY_LENGTH];    // Arquivos temporarios com os simbolos de cada coluna.
+    char *column_buffer;                                 // key_length buffers de ADFGVX_STREAM_BUFFER_SIZE bytes.
+    size_t column_buffered[ADFGVX_STREAM_MAX_KEY_LENGTH]; // Bytes pendentes no buffer de cada coluna.
+    unsigned long long symbol_count;       // Total de simbolos ADFGVX gerados ate agora.
+    int next_column;                       // Coluna que recebe o proximo simbolo (symbol_count % key_length).
+} adfgvx_cipher_stream;
+
+/**
+ * @brief Inicializa um contexto de cifragem em fluxo.
+ *
+ * @param ctx Contexto a ser inicializado.
+ * @param key A chave usada na transposicao.
+ * @param key_length Comprimento da chave (entre 1 e ADFGVX_STREAM_MAX_KEY_LENGTH).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos,
+ * 2 se faltar memoria ou nao for possivel criar os arquivos temporarios.
+ */
+int adfgvx_cipher_stream_init(adfgvx_cipher_stream *ctx, const char key[], int key_length);
+
+/**
+ * @brief Cifra mais um bloco da mensagem.
+ * O bloco nao precisa ser terminado em nulo; caracteres fora da matriz Polybius
+ * (incluindo quebras de linha) sao ignorados, como em cipher_adfgvx.
+ *
+ * @param ctx Contexto inicializado por adfgvx_cipher_stream_init.
+ * @param chunk Bloco de entrada.
+ * @param length Numero de bytes em chunk.
+ * @return int 0 em caso de sucesso, 1 se erro ao escrever nos arquivos temporarios.
+ */
+int adfgvx_cipher_stream_update(adfgvx_cipher_stream *ctx, const char *chunk, size_t length);
+
+/**
+ * @brief Conclui a cifragem, escrevendo o texto cifrado completo em output,
+ * coluna a coluna na ordem alfabetica da chave, e libera os recursos do contexto.
+ * Deve ser chamada sempre apos um init bem sucedido, mesmo depois de um erro em update;
+ * com output NULL apenas libera os recursos.
+ *
+ * @param ctx Contexto a ser finalizado.
+ * @param output Arquivo de saida do texto cifrado (ou NULL).
+ * @return int 0 em caso de sucesso, 1 se erro de leitura ou escrita.
+ */
+int adfgvx_cipher_stream_final(adfgvx_cipher_stream *ctx, FILE *output);
+
+#endif // ADFGVX_CORE_H
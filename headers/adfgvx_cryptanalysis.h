@@ -0,0 +1,215 @@
+#ifndef ADFGVX_CRYPTANALYSIS_H
+#define ADFGVX_CRYPTANALYSIS_H
+
+#include <stddef.h> // Para size_t
+
+#include "cipher_config.h" // Para ADFGVX_KEY_SEARCH_PREFIX
+#include "adfgvx_codec.h"  // Para ADFGVX_SYMBOL_COUNT
+#include "adfgvx_key.h"    // Para adfgvx_key_ctx
+#include "thread_pool.h"   // Para thread_pool
+
+// Numero de caracteres do alfabeto do texto plano (as celulas da matriz Polybius).
+#define ADFGVX_ALPHABET_SIZE (ADFGVX_SYMBOL_COUNT * ADFGVX_SYMBOL_COUNT)
+
+// Maximo de candidatos guardados por uma busca.
+#define ADFGVX_MAX_CANDIDATES 64
+
+// Maior comprimento de chave das buscas. A cifra aceita chaves bem maiores, mas a busca
+// exaustiva ja e inviavel muito antes disso (16! ordens) e os candidatos guardam a ordem
+// das colunas em vetores fixos.
+#define ADFGVX_SEARCH_MAX_KEY_LENGTH 16
+
+// Numero de trigramas e de quadrigramas possiveis sobre o alfabeto.
+#define ADFGVX_TRIGRAM_COUNT (ADFGVX_ALPHABET_SIZE * ADFGVX_ALPHABET_SIZE * ADFGVX_ALPHABET_SIZE)
+#define ADFGVX_QUADGRAM_COUNT (ADFGVX_TRIGRAM_COUNT * ADFGVX_ALPHABET_SIZE)
+
+/**
+ * @brief Modelo estatistico de trigramas do texto plano, usado para pontuar candidatos.
+ *
+ * Os trigramas sao contados sobre o texto de treino depois de descartar os caracteres
+ * fora da matriz Polybius (como faz a cifra), de modo que o modelo descreve exatamente o
+ * tipo de texto produzido pela decifragem. O modelo ocupa cerca de 190 KB e, depois de
+ * construido, e apenas lido (pode ser compartilhado entre threads).
+ */
+typedef struct
+{
+    float log_probability[ADFGVX_TRIGRAM_COUNT]; // log10 da probabilidade de cada trigrama.
+    float floor;                                  // Valor usado para trigramas nunca vistos.
+    unsigned long long trigram_total;             // Trigramas contados no texto de treino.
+} adfgvx_ngram_model;
+
+/**
+ * @brief Modelo de quadrigramas do texto plano, usado pelo solucionador da matriz Polybius.
+ * Mesmas regras de adfgvx_ngram_model; ocupa cerca de 6,7 MB (alocar no heap).
+ */
+typedef struct
+{
+    float log_probability[ADFGVX_QUADGRAM_COUNT]; // log10 da probabilidade de cada quadrigrama.
+    float floor;                                   // Valor usado para quadrigramas nunca vistos.
+    unsigned long long quadgram_total;             // Quadrigramas contados no texto de treino.
+} adfgvx_quadgram_model;
+
+/**
+ * @brief Texto de treino embutido (portugues sem acentos), usado quando nenhum corpus
+ * e fornecido.
+ */
+extern const char adfgvx_default_corpus[];
+
+/**
+ * @brief Constroi o modelo de trigramas a partir de um texto de treino.
+ *
+ * @param model Modelo a ser preenchido.
+ * @param text Texto de treino (nao precisa ser terminado em nulo); minusculas sao
+ * convertidas e os demais caracteres fora da matriz sao ignorados.
+ * @param length Numero de bytes em text.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos ou o texto nao
+ * tiver nenhum trigrama valido.
+ */
+int adfgvx_ngram_model_build(adfgvx_ngram_model *model, const char *text, size_t length);
+
+/**
+ * @brief Constroi o modelo de quadrigramas a partir de um texto de treino
+ * (mesmas regras e codigos de retorno de adfgvx_ngram_model_build).
+ */
+int adfgvx_quadgram_model_build(adfgvx_quadgram_model *model, const char *text, size_t length);
+
+/**
+ * @brief Pontua um texto plano: media do log10 da probabilidade dos seus trigramas.
+ * Quanto maior (mais proxima de zero), mais o texto se parece com o texto de treino.
+ *
+ * @param model Modelo construido por adfgvx_ngram_model_build.
+ * @param text Texto decifrado (apenas caracteres da matriz Polybius).
+ * @param length Numero de bytes em text.
+ * @return double Pontuacao media por trigrama (model->floor se length < 3).
+ */
+double adfgvx_ngram_score(const adfgvx_ngram_model *model, const char *text, size_t length);
+
+/**
+ * @brief Candidato a chave de transposicao encontrado por uma busca.
+ */
+typedef struct
+{
+    double score;                     // Pontuacao do texto decifrado completo (adfgvx_ngram_score).
+    double prefix_score;              // Pontuacao do prefixo usado no corte antecipado.
+    int key_length;
+    int column_order[ADFGVX_SEARCH_MAX_KEY_LENGTH]; // Ordem das colunas (como em adfgvx_key_ctx).
+    char key[ADFGVX_SEARCH_MAX_KEY_LENGTH + 1];     // Chave equivalente (ou a palavra do dicionario), terminada em nulo.
+} adfgvx_key_candidate;
+
+/**
+ * @brief Parametros comuns das buscas de chave.
+ */
+typedef struct
+{
+    const char *ciphertext;          // Texto cifrado (apenas simbolos ADFGVX).
+    size_t ciphertext_length;        // Numero de simbolos (par).
+    const adfgvx_ngram_model *model;
+    size_t prefix_pairs;             // Caracteres decifrados e pontuados antes da decifragem completa.
+    double abort_margin;             // Corte antecipado: descarta o candidato se a pontuacao do
+                                     // prefixo ficar abaixo da pontuacao do pior candidato guardado menos esta margem.
+    thread_pool *pool;               // Pool de threads (NULL = thread chamadora).
+} adfgvx_key_search;
+
+/**
+ * @brief Contadores de uma busca.
+ */
+typedef struct
+{
+    unsigned long long tested;  // Candidatos avaliados (prefixo decifrado e pontuado).
+    unsigned long long aborted; // Candidatos descartados pelo corte antecipado.
+} adfgvx_key_search_stats;
+
+/**
+ * @brief Busca exaustiva: avalia todas as ordens de colunas (key_length! por comprimento)
+ * para cada comprimento de chave entre min_key_length e max_key_length.
+ *
+ * As permutacoes de cada comprimento sao divididas em faixas (pelo seu indice na ordem
+ * lexicografica) entre as threads do pool; cada thread guarda os seus melhores candidatos
+ * e as listas sao combinadas no fim.
+ *
+ * @param search Parametros da busca.
+ * @param min_key_length Menor comprimento de chave (>= 1).
+ * @param max_key_length Maior comprimento de chave (<= ADFGVX_SEARCH_MAX_KEY_LENGTH).
+ * @param best Saida: melhores candidatos, do melhor para o pior (ordens repetidas sao ignoradas).
+ * @param best_count Capacidade de best (no maximo ADFGVX_MAX_CANDIDATES).
+ * @param stats Se nao for NULL, recebe os contadores da busca.
+ * @return size_t Numero de candidatos gravados em best (0 se os parametros forem invalidos).
+ */
+size_t adfgvx_search_column_orders(const adfgvx_key_search *search,
+                                   int min_key_length,
+                                   int max_key_length,
+                                   adfgvx_key_candidate best[],
+                                   size_t best_count,
+                                   adfgvx_key_search_stats *stats);
+
+/**
+ * @brief Busca por dicionario: avalia a ordem de colunas de cada palavra da lista
+ * (palavras vazias ou com mais de ADFGVX_SEARCH_MAX_KEY_LENGTH caracteres sao ignoradas).
+ *
+ * @param words Palavras candidatas (terminadas em nulo).
+ * @param word_count Numero de palavras.
+ * @return size_t Numero de candidatos gravados em best.
+ */
+size_t adfgvx_search_wordlist(const adfgvx_key_search *search,
+                              const char *const words[],
+                              size_t word_count,
+                              adfgvx_key_candidate best[],
+                              size_t best_count,
+                              adfgvx_key_search_stats *stats);
+
+/**
+ * @brief Parametros do solucionador da matriz Polybius desconhecida.
+ */
+typedef struct
+{
+    const char *ciphertext;              // Texto cifrado (apenas simbolos ADFGVX).
+    size_t ciphertext_length;            // Numero de simbolos (par).
+    const adfgvx_key_ctx *key_ctx;       // Transposicao conhecida (ou encontrada por busca).
+    const adfgvx_quadgram_model *model;
+    int restarts;                        // Reinicios independentes do recozimento.
+    unsigned long long iterations;       // Trocas avaliadas por reinicio.
+    double temperature;                  // Temperatura inicial, por 1000 caracteres do texto.
+    unsigned int seed;                   // Semente do gerador de cada reinicio (seed + indice).
+    thread_pool *pool;                   // Pool de threads (NULL = thread chamadora).
+} adfgvx_square_search;
+
+/**
+ * @brief Matriz Polybius encontrada pelo solucionador.
+ */
+typedef struct
+{
+    char square[ADFGVX_ALPHABET_SIZE]; // Caractere de cada celula, linha a linha (como adfgvx_square_cells).
+    double score;                      // Media do log10 por quadrigrama do texto decifrado.
+} adfgvx_square_solution;
+
+/**
+ * @brief Contadores do solucionador.
+ */
+typedef struct
+{
+    unsigned long long evaluations; // Trocas avaliadas (soma de todos os reinicios).
+    unsigned long long accepted;    // Trocas aceitas.
+    int restarts;                   // Reinicios executados.
+} adfgvx_square_search_stats;
+
+/**
+ * @brief Recupera a matriz Polybius de um texto cifrado com transposicao conhecida, por
+ * recozimento simulado (simulated annealing) com pontuacao por quadrigramas.
+ *
+ * A transposicao e desfeita uma vez, obtendo a celula (par de simbolos) de cada caractere
+ * do texto plano; o solucionador procura a atribuicao dos caracteres do alfabeto as 36
+ * celulas. Cada passo troca o conteudo de duas celulas e recalcula apenas os quadrigramas
+ * que contem posicoes dessas celulas. Os reinicios sao divididos entre as threads do pool
+ * e compartilham a melhor solucao encontrada ate o momento: metade deles parte dela, com
+ * algumas trocas aleatorias, em vez de uma atribuicao aleatoria.
+ * Os caracteres da matriz sao os mesmos de adfgvx_square_cells, em outra ordem.
+ *
+ * @param search Parametros do solucionador.
+ * @param best Saida: melhor matriz encontrada.
+ * @param stats Se nao for NULL, recebe os contadores.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos (ou o texto tiver
+ * menos de 4 caracteres), 2 se faltar memoria, 3 se o texto cifrado tiver simbolos invalidos.
+ */
+int adfgvx_solve_square(const adfgvx_square_search *search, adfgvx_square_solution *best, adfgvx_square_search_stats *stats);
+
+#endif // ADFGVX_CRYPTANALYSIS_H
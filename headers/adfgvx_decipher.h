@@ -1,24 +1,243 @@
-#ifndef ADFGVX_DECIPHER_H
-#define ADFGVX_DECIPHER_H
-
-// cipher_config.h  includo por adfgvx_decipher.c ou main,
-// mas no  estritamente necessrio aqui se MAX_MESSAGE_LENGTH no estiver no prottipo.
-// No entanto, a funo decipher_adfgvx implicitamente depende de MAX_MESSAGE_LENGTH
-// para o tamanho do buffer de sada esperado.
-
-/**
- * @brief Funo principal para decodificar a cifra ADFGVX.
- *
- * Executa a sequncia de etapas para decifrar o texto cifrado.
- * A lgica desta funo e suas auxiliares  baseada no cdigo fornecido pelo utilizador.
- *
- * @param encrypted_text Texto cifrado (string terminada em nulo).
- * @param key Chave de cifra (string terminada em nulo).
- * @param key_length Comprimento da chave.
- * @param output Buffer onde a mensagem decodificada ser armazenada (deve ser grande o suficiente,
- * tipicamente MAX_MESSAGE_LENGTH conforme definido em cipher_config.h).
- * A funo garante a terminao nula do buffer de sada.
- */
-void decipher_adfgvx(char *encrypted_text, char *key, int key_length, char *output);
-
-#endif // ADFGVX_DECIPHER_H
+#ifndef ADFGVX_DECIPHER_H
+#define ADFGVX_DECIPHER_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+#include "cipher_config.h" // Para ADFGVX_STREAM_MAX_KEY_LENGTH e ADFGVX_STREAM_BUFFER_SIZE
+#include "adfgvx_key.h"     // Para adfgvx_key_ctx e adfgvx_batch_item
+#include "adfgvx_workspace.h" // Para adfgvx_workspace
+#include "thread_pool.h"    // Para thread_pool
+
+/**
+ * @brief Função principal para decodificar a cifra ADFGVX.
+ *
+ * Executa a sequência de etapas para decifrar o texto cifrado.
+ * Implementada sobre decipher_adfgvx_direct, com capacidade de saída MAX_MESSAGE_LENGTH - 1.
+ *
+ * @param encrypted_text Texto cifrado (string terminada em nulo).
+ * @param key Chave de cifra (string terminada em nulo).
+ * @param key_length Comprimento da chave.
+ * @param output Buffer onde a mensagem decodificada será armazenada (deve ser grande o suficiente,
+ * tipicamente MAX_MESSAGE_LENGTH conforme definido em cipher_config.h).
+ * A função garante a terminação nula do buffer de saída.
+ */
+void decipher_adfgvx(char *encrypted_text, char *key, int key_length, char *output);
+
+/**
+ * @brief Decifra por coleta direta: calcula a posicao de cada simbolo no texto cifrado e
+ * decodifica os pares diretamente em output, em uma unica passagem.
+ *
+ * Nao usa matriz de colunas nem sequencia intermediaria de simbolos; a memoria extra e
+ * constante (um contador por coluna da chave). O texto cifrado pode ter qualquer tamanho.
+ *
+ * @param encrypted_text Texto cifrado (nao precisa ser terminado em nulo).
+ * @param encrypted_length Numero de simbolos em encrypted_text.
+ * @param key Chave de cifra.
+ * @param key_length Comprimento da chave (entre 1 e MAX_KEY_LENGTH - 1).
+ * @param output Buffer de saida; a mensagem NAO e terminada em nulo.
+ * @param output_capacity Tamanho de output (a mensagem completa tem encrypted_length / 2 bytes).
+ * @param output_length Recebe o numero de caracteres escritos em output.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos,
+ * 2 se output_capacity for insuficiente (output recebe os primeiros output_capacity caracteres),
+ * 3 se o texto cifrado for invalido (numero impar de simbolos, ou um par invalido; neste caso
+ * output recebe os caracteres decodificados antes dele), 4 se faltar memoria (so com chaves
+ * de mais de ADFGVX_KEY_STACK_COLUMNS colunas; as mais curtas usam uma arena fixa na pilha
+ * e nao alocam nada).
+ */
+int decipher_adfgvx_direct(const char *encrypted_text,
+                           size_t encrypted_length,
+                           const char *key,
+                           int key_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length);
+
+/**
+ * @brief Versao de decipher_adfgvx_direct sobre um contexto de chave pre-calculado.
+ *
+ * @param key_ctx Contexto inicializado por adfgvx_key_ctx_init (apenas lido).
+ * @return int Mesmos codigos de decipher_adfgvx_direct.
+ */
+int decipher_adfgvx_direct_ctx(const adfgvx_key_ctx *key_ctx,
+                               const char *encrypted_text,
+                               size_t encrypted_length,
+                               char *output,
+                               size_t output_capacity,
+                               size_t *output_length);
+
+/**
+ * @brief Versao de decipher_adfgvx_direct que usa uma arena do chamador para a agenda da
+ * chave e o inicio das colunas, como cipher_adfgvx_ws: com a arena ja dimensionada, a
+ * chamada nao aloca nem zera memoria.
+ *
+ * @param ws Arena (adfgvx_workspace_init); no modo fixo precisa de pelo menos
+ * ADFGVX_WORKSPACE_KEY_BYTES(key_length) bytes livres.
+ * @return int Mesmos codigos de decipher_adfgvx_direct (4 se nao couber na arena).
+ */
+int decipher_adfgvx_ws(adfgvx_workspace *ws,
+                       const char *encrypted_text,
+                       size_t encrypted_length,
+                       const char *key,
+                       int key_length,
+                       char *output,
+                       size_t output_capacity,
+                       size_t *output_length);
+
+/**
+ * @brief Decifra apenas o trecho offset .. offset + length - 1 da mensagem (acesso aleatorio).
+ *
+ * O caractere p da mensagem e o par de simbolos 2p e 2p + 1, cujas posicoes no texto
+ * cifrado sao calculaveis a partir da ordem das colunas e do comprimento total; assim
+ * so os 2 * length simbolos do trecho sao lidos e o custo e O(length), nao O(arquivo).
+ * Com um arquivo mapeado (map_input_file), so as paginas desses simbolos sao lidas do disco.
+ *
+ * @param key_ctx Contexto inicializado por adfgvx_key_ctx_init (apenas lido).
+ * @param encrypted_text Texto cifrado completo.
+ * @param encrypted_length Numero de simbolos do texto cifrado completo.
+ * @param offset Posicao do primeiro caractere do trecho (no maximo encrypted_length / 2).
+ * @param length Caracteres do trecho; o trecho termina no fim da mensagem.
+ * @param output Buffer de saida; recebe o trecho a partir de output[0], sem terminador nulo.
+ * @param output_capacity Tamanho de output.
+ * @param output_length Recebe o numero de caracteres escritos em output.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos (incluindo um numero
+ * impar de simbolos ou offset depois do fim), 2 se output_capacity for insuficiente (output
+ * recebe o inicio do trecho), 3 se houver um par invalido no trecho (output recebe os
+ * caracteres decodificados antes dele), 4 se faltar memoria (como em decipher_adfgvx_direct).
+ */
+int decipher_adfgvx_range_ctx(const adfgvx_key_ctx *key_ctx,
+                              const char *encrypted_text,
+                              size_t encrypted_length,
+                              size_t offset,
+                              size_t length,
+                              char *output,
+                              size_t output_capacity,
+                              size_t *output_length);
+
+/**
+ * @brief Versao de decipher_adfgvx_range_ctx que le o texto cifrado de um arquivo aberto
+ * por leituras posicionadas (read_file_at): em cada coluna, os simbolos do trecho sao uma
+ * faixa contigua, entao bastam key_length leituras de cerca de 2 * length / key_length bytes.
+ *
+ * @param encrypted_file Arquivo cifrado, aberto em modo binario para leitura.
+ * @param encrypted_length Numero de simbolos do texto cifrado (sem a quebra de linha final).
+ * @return int Mesmos codigos de decipher_adfgvx_range_ctx, ou 4 se erro de leitura ou de memoria.
+ */
+int decipher_adfgvx_file_range(const adfgvx_key_ctx *key_ctx,
+                               FILE *encrypted_file,
+                               size_t encrypted_length,
+                               size_t offset,
+                               size_t length,
+                               char *output,
+                               size_t output_capacity,
+                               size_t *output_length);
+
+/**
+ * @brief Decifra um lote de textos cifrados com a mesma chave.
+ * Para cada item, input e decifrado em output (como em decipher_adfgvx_direct_ctx) e
+ * output_length e status sao preenchidos. O contexto de chave nao e alterado.
+ *
+ * @param key_ctx Contexto inicializado por adfgvx_key_ctx_init.
+ * @param items Vetor de itens do lote.
+ * @param count Numero de itens.
+ * @return size_t Numero de itens com status diferente de 0.
+ */
+size_t decipher_adfgvx_batch(const adfgvx_key_ctx *key_ctx, adfgvx_batch_item items[], size_t count);
+
+/**
+ * @brief Versao de decipher_adfgvx_direct_ctx que divide um texto cifrado grande entre
+ * as threads de um pool: cada tarefa decodifica uma faixa contigua de pares, calculando
+ * sozinha as posicoes de leitura de cada coluna, e grava direto na sua faixa de output.
+ * O resultado (saida e codigo de retorno) e identico ao da versao sequencial; em caso
+ * de par invalido, output_length para no primeiro deles.
+ *
+ * @param pool Pool de threads; com NULL, um pool de uma thread ou textos menores que
+ * parallel_threshold, a decifragem e feita por decipher_adfgvx_direct_ctx na thread chamadora.
+ * @param parallel_threshold Tamanho minimo (em simbolos) do texto cifrado para usar o pool.
+ * @return int Mesmos codigos de decipher_adfgvx_direct.
+ */
+int decipher_adfgvx_parallel(const adfgvx_key_ctx *key_ctx,
+                             const char *encrypted_text,
+                             size_t encrypted_length,
+                             char *output,
+                             size_t output_capacity,
+                             size_t *output_length,
+                             thread_pool *pool,
+                             size_t parallel_threshold);
+
+/**
+ * @brief Decifra um texto cifrado por cipher_adfgvx_rounds (varias chaves de transposicao
+ * aplicadas em sequencia), com as mesmas chaves na mesma ordem.
+ *
+ * Com periodo de ate ADFGVX_ROUNDS_MAX_PERIOD, o mapa das rodadas (adfgvx_rounds_map) da
+ * a posicao de cada simbolo no texto cifrado, e os pares sao coletados e decodificados numa
+ * unica passagem (a coleta direta de uma chave de P colunas). Acima disso, as rodadas sao
+ * desfeitas uma a uma, da ultima para a segunda, entre dois buffers auxiliares do tamanho
+ * do texto cifrado (um, com duas rodadas), e a primeira pela coleta dos pares. Com uma
+ * rodada, o resultado e identico ao de decipher_adfgvx_direct_ctx.
+ *
+ * @param keys Contextos inicializados por adfgvx_key_ctx_init, na ordem das rodadas.
+ * @param round_count Numero de rodadas (entre 1 e ADFGVX_MAX_ROUNDS).
+ * @return int Mesmos codigos de decipher_adfgvx_direct (4 se faltar memoria para o mapa ou
+ * para os buffers auxiliares).
+ */
+int decipher_adfgvx_rounds(const adfgvx_key_ctx keys[],
+                           int round_count,
+                           const char *encrypted_text,
+                           size_t encrypted_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length);
+
+/**
+ * @brief Contexto da decifragem em fluxo (init / update / final).
+ *
+ * O texto cifrado e a concatenacao das colunas, e o comprimento de cada coluna so e
+ * conhecido no fim; por isso update apenas guarda os blocos num arquivo temporario e
+ * final le as colunas em paralelo, com um buffer de ADFGVX_STREAM_BUFFER_SIZE bytes
+ * por coluna. A memoria usada depende de key_length e nao do tamanho do texto.
+ * Os campos sao internos; use apenas as funcoes adfgvx_decipher_stream_*.
+ */
+typedef struct
+{
+    int key_length;
+    int column_order[ADFGVX_STREAM_MAX_KEY_LENGTH]; // column_order[i] = coluna original na i-esima posicao alfabetica.
+    FILE *spill;                                    // Simbolos recebidos ate agora.
+    unsigned long long symbol_count;                // Total de simbolos recebidos.
+} adfgvx_decipher_stream;
+
+/**
+ * @brief Inicializa um contexto de decifragem em fluxo.
+ *
+ * @param ctx Contexto a ser inicializado.
+ * @param key Chave de cifra.
+ * @param key_length Comprimento da chave (entre 1 e ADFGVX_STREAM_MAX_KEY_LENGTH).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos,
+ * 2 se nao for possivel criar o arquivo temporario.
+ */
+int adfgvx_decipher_stream_init(adfgvx_decipher_stream *ctx, const char *key, int key_length);
+
+/**
+ * @brief Acrescenta mais um bloco do texto cifrado.
+ * Quebras de linha ('\r' e '\n') sao ignoradas, para aceitar arquivos terminados em nova linha.
+ *
+ * @param ctx Contexto inicializado por adfgvx_decipher_stream_init.
+ * @param chunk Bloco de entrada (nao precisa ser terminado em nulo).
+ * @param length Numero de bytes em chunk.
+ * @return int 0 em caso de sucesso, 1 se erro ao escrever no arquivo temporario.
+ */
+int adfgvx_decipher_stream_update(adfgvx_decipher_stream *ctx, const char *chunk, size_t length);
+
+/**
+ * @brief Conclui a decifragem, escrevendo a mensagem em output, e libera os recursos.
+ * Deve ser chamada sempre apos um init bem sucedido; com output NULL apenas libera os recursos.
+ * Como em decipher_adfgvx, a decodificacao para no primeiro par de simbolos invalido.
+ *
+ * @param ctx Contexto a ser finalizado.
+ * @param output Arquivo de saida da mensagem decifrada (ou NULL).
+ * @return int 0 em caso de sucesso, 1 se erro de leitura, escrita ou memoria,
+ * 2 se o texto cifrado for invalido (numero impar de simbolos ou par invalido).
+ */
+int adfgvx_decipher_stream_final(adfgvx_decipher_stream *ctx, FILE *output);
+
+#endif // ADFGVX_DECIPHER_H
@@ -0,0 +1,73 @@
+#ifndef ADFGVX_FUZZ_H
+#define ADFGVX_FUZZ_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+#include "thread_pool.h" // Para thread_pool
+
+// Harness diferencial da cifra ADFGVX.
+//
+// Cada caso e uma sequencia de bytes (gerada por adfgvx_fuzz_generate ou vinda do
+// libFuzzer) que descreve uma chave, uma mensagem e as variacoes do caso. O caso e cifrado
+// pela implementacao de referencia congelada (adfgvx_reference) e por todas as outras
+// (cipher_adfgvx_linear, _ctx, _ws, _batch, _parallel, a matriz original, cada kernel do
+// codec, a transposicao generica no lugar da especializada, o fluxo e o container), e o texto cifrado e decifrado da mesma forma nos dois
+// sentidos (decipher_adfgvx_direct, _ctx, _ws, _batch, _parallel, decipher_adfgvx, os
+// trechos de decipher_adfgvx_range_ctx e _file_range, o fluxo e o container). As rodadas
+// (cipher_adfgvx_rounds e decipher_adfgvx_rounds, com 2 a ADFGVX_MAX_ROUNDS chaves) sao
+// comparadas com a referencia seguida de uma transposicao simples por chave seguinte. A
+// saida e o codigo de retorno de cada uma devem ser identicos aos da referencia. A ida e
+// volta da propria referencia tambem e conferida (a mensagem sem os caracteres fora da matriz).
+//
+// Formato do caso (bytes ausentes no fim valem 0, entao qualquer sequencia e um caso):
+//   0     modo: bits 0-1 tipo da mensagem (0 bytes sem alteracao, 1 so caracteres da
+//         matriz, 2 caracteres da matriz e alguns bytes invalidos, 3 texto com quebras de
+//         linha e minusculas); bits 2-3 alteracao do texto cifrado antes da decifragem
+//         (0 nenhuma, 1 troca um simbolo pelo byte 7, 2 remove o ultimo simbolo, 3 corta
+//         o fim); bit 4 saidas com capacidade menor que a necessaria
+//   1, 2  comprimento da chave (u16): com o bit 15 desligado, 1 + (valor % 64); ligado,
+//         1 + ((valor & 0x7FFF) % (MAX_KEY_LENGTH - 1))
+//   3, 4  tamanho dos blocos entregues aos contextos de fluxo (1 + u16) e, pelo byte 4,
+//         dos blocos do container (1 + byte % 100)
+//   5..7  semente das posicoes (simbolo alterado, inicio e tamanho do trecho) e das
+//         chaves das rodadas seguintes a primeira
+//   8..   a chave (comprimento acima, limitado aos bytes disponiveis) e depois a mensagem
+
+#define ADFGVX_FUZZ_HEADER_SIZE 8
+
+/**
+ * @brief Contadores acumulados por adfgvx_fuzz_run_case.
+ */
+typedef struct
+{
+    unsigned long long cases;       // Casos executados.
+    unsigned long long comparisons; // Saidas comparadas com a referencia.
+    unsigned long long mismatches;  // Saidas diferentes da referencia.
+} adfgvx_fuzz_stats;
+
+/**
+ * @brief Gera um caso aleatorio, com chaves de varios comprimentos (inclusive as longas e
+ * com caracteres repetidos) e mensagens de comprimentos proximos dos multiplos da chave.
+ *
+ * @param state Estado do gerador pseudoaleatorio (diferente de 0; e atualizado).
+ * @param max_message_length Maior mensagem gerada, em bytes.
+ * @param data Saida; deve ter ADFGVX_FUZZ_HEADER_SIZE + MAX_KEY_LENGTH + max_message_length bytes.
+ * @return size_t Tamanho do caso em data.
+ */
+size_t adfgvx_fuzz_generate(unsigned int *state, size_t max_message_length, unsigned char *data);
+
+/**
+ * @brief Executa um caso e compara todas as implementacoes com a referencia.
+ *
+ * @param data Bytes do caso (qualquer tamanho).
+ * @param size Numero de bytes em data.
+ * @param pool Pool das versoes paralelas (com NULL elas nao sao comparadas).
+ * @param report Recebe uma linha por divergencia (pode ser NULL).
+ * @param stats Contadores acumulados (pode ser NULL).
+ * @return int 0 se todas as saidas forem iguais as da referencia, 1 se alguma divergir,
+ * 2 se faltar memoria ou nao for possivel criar os arquivos temporarios.
+ */
+int adfgvx_fuzz_run_case(const unsigned char *data, size_t size, thread_pool *pool, FILE *report, adfgvx_fuzz_stats *stats);
+
+#endif // ADFGVX_FUZZ_H
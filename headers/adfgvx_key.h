@@ -0,0 +1,202 @@
+#ifndef ADFGVX_KEY_H
+#define ADFGVX_KEY_H
+
+#include <stddef.h> // Para size_t
+
+#include "cipher_config.h"    // Para MAX_KEY_LENGTH e ADFGVX_MAX_ROUNDS
+#include "adfgvx_workspace.h" // Para adfgvx_workspace
+
+/**
+ * @brief Calcula a ordem das colunas da transposicao a partir da chave.
+ *
+ * A transposicao depende apenas da ordem alfabetica dos caracteres da chave. A ordenacao
+ * e estavel: em caracteres repetidos, a coluna mais a esquerda vem primeiro (o mesmo
+ * resultado do Bubble Sort usado originalmente pela cifragem e pela decifragem).
+ * Chaves curtas (ate 16 colunas) usam insercao, sem tabela auxiliar a zerar; as maiores,
+ * uma ordenacao por contagem sobre os 256 valores de char, O(key_length), o que mantem
+ * barato o preparo de chaves com milhares de colunas.
+ * Nenhum dado da mensagem e movido; a permutacao e usada como indirecao na leitura.
+ *
+ * @param key A chave usada na transposicao.
+ * @param key_length Comprimento da chave.
+ * @param column_order Saida com key_length posicoes:
+ * column_order[i] = indice original da i-esima coluna na ordem alfabetica da chave.
+ */
+void adfgvx_key_column_order(const char key[], int key_length, int column_order[]);
+
+/**
+ * @brief Calcula onde cada coluna comeca no texto cifrado linear.
+ *
+ * Com N simbolos e k colunas, a coluna original c tem N / k + (c < N % k ? 1 : 0)
+ * simbolos e as colunas aparecem no texto cifrado na ordem de column_order. Assim, o
+ * simbolo de indice i (linha i / k, coluna i % k) fica na posicao
+ * column_start[i % k] + i / k do texto cifrado.
+ *
+ * @param column_order Ordem das colunas, de adfgvx_key_column_order.
+ * @param key_length Comprimento da chave.
+ * @param total_symbols Numero total de simbolos ADFGVX (N).
+ * @param column_start Saida com key_length posicoes, indexada pela coluna original.
+ */
+void adfgvx_key_column_starts(const int column_order[], int key_length, size_t total_symbols, size_t column_start[]);
+
+// Numero de colunas ate o qual as tabelas por mensagem (ex: o inicio de cada coluna) ficam
+// na pilha; chaves mais longas usam um bloco do heap do tamanho exato (adfgvx_key_scratch).
+#define ADFGVX_KEY_STACK_COLUMNS 32
+
+/**
+ * @brief Contexto de chave (key schedule) pre-calculado, para cifrar ou decifrar muitas
+ * mensagens com a mesma chave.
+ *
+ * Guarda a ordem das colunas e a ordem inversa num unico bloco do heap com 2 * key_length
+ * inteiros, de modo que o contexto ocupa o mesmo espaco para qualquer chave e o custo por
+ * mensagem das tabelas de colunas e O(key_length). adfgvx_key_ctx_init tambem inicializa
+ * as tabelas do codec. Depois de inicializado o contexto nao e mais alterado: pode ser
+ * compartilhado entre threads sem sincronizacao. Deve ser liberado com adfgvx_key_ctx_free
+ * (e nao deve ser copiado por valor: a copia compartilharia o bloco). Com
+ * adfgvx_key_ctx_init_ws o bloco fica numa arena e vale ate ela ser devolvida.
+ */
+typedef struct
+{
+    int key_length;
+    int *column_order; // column_order[i] = coluna original na i-esima posicao alfabetica.
+    int *column_rank;  // Ordem inversa: column_rank[column_order[i]] == i (no mesmo bloco).
+    int owns_tables;   // 1 se o bloco e do heap (liberado por adfgvx_key_ctx_free), 0 se e de uma arena.
+} adfgvx_key_ctx;
+
+/**
+ * @brief Item de um lote processado pelas funcoes *_batch sobre um contexto de chave.
+ * O chamador preenche a entrada e o buffer de saida; a funcao preenche output_length e status.
+ */
+typedef struct
+{
+    const char *input;      // Mensagem (ou texto cifrado) de entrada; nao precisa de terminador nulo.
+    size_t input_length;    // Numero de bytes em input.
+    char *output;           // Buffer de saida (sem terminador nulo).
+    size_t output_capacity; // Tamanho de output, em bytes.
+    size_t output_length;   // Saida: bytes escritos em output.
+    int status;             // Saida: mesmo codigo de retorno da funcao individual correspondente.
+} adfgvx_batch_item;
+
+/**
+ * @brief Inicializa um contexto de chave.
+ *
+ * @param ctx Contexto a ser inicializado.
+ * @param key A chave usada na transposicao.
+ * @param key_length Comprimento da chave (entre 1 e MAX_KEY_LENGTH - 1).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria.
+ */
+int adfgvx_key_ctx_init(adfgvx_key_ctx *ctx, const char key[], int key_length);
+
+/**
+ * @brief Versao de adfgvx_key_ctx_init que reserva o bloco do contexto numa arena, sem
+ * alocar (o contexto vale ate a arena ser devolvida; adfgvx_key_ctx_free nao faz nada).
+ *
+ * @param ws Arena com pelo menos 2 * key_length inteiros livres.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se nao couber na arena.
+ */
+int adfgvx_key_ctx_init_ws(adfgvx_key_ctx *ctx, const char key[], int key_length, adfgvx_workspace *ws);
+
+/**
+ * @brief Inicializa um contexto de chave diretamente a partir de uma ordem de colunas.
+ * A transposicao so depende da ordem alfabetica da chave; esta funcao permite percorrer
+ * as ordens possiveis (ex: na recuperacao de chave) sem construir uma chave para cada uma.
+ *
+ * @param ctx Contexto a ser inicializado.
+ * @param column_order Permutacao de 0 .. key_length - 1 (column_order[i] = coluna original
+ * na i-esima posicao do texto cifrado).
+ * @param key_length Comprimento da chave (entre 1 e MAX_KEY_LENGTH - 1).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos ou column_order
+ * nao for uma permutacao, 2 se faltar memoria.
+ */
+int adfgvx_key_ctx_init_order(adfgvx_key_ctx *ctx, const int column_order[], int key_length);
+
+/**
+ * @brief Versao de adfgvx_key_ctx_init_order que reserva o bloco do contexto numa arena
+ * (como adfgvx_key_ctx_init_ws).
+ */
+int adfgvx_key_ctx_init_order_ws(adfgvx_key_ctx *ctx, const int column_order[], int key_length, adfgvx_workspace *ws);
+
+/**
+ * @brief Libera o bloco de um contexto de chave (pode ser chamada mais de uma vez, e
+ * tambem depois de um init que falhou).
+ */
+void adfgvx_key_ctx_free(adfgvx_key_ctx *ctx);
+
+/**
+ * @brief Versao de adfgvx_key_column_starts sobre um contexto de chave.
+ */
+void adfgvx_key_ctx_column_starts(const adfgvx_key_ctx *ctx, size_t total_symbols, size_t column_start[]);
+
+/**
+ * @brief Composicao de varias transposicoes aplicadas em sequencia (rodadas, ex: a dupla
+ * transposicao) para uma mensagem de total_symbols simbolos.
+ *
+ * A rodada r le como entrada a saida da rodada r - 1 e a transpoe com a sua chave. Cada
+ * rodada e uma permutacao que so depende da chave e de total_symbols (o inicio de cada
+ * coluna, adfgvx_key_column_starts); o mapa guarda essas tabelas, um unico bloco do heap com
+ * a soma dos comprimentos das chaves, e calcula a posicao final de qualquer simbolo passando
+ * pelas rodadas de uma vez.
+ *
+ * A composicao e periodica: com P = k1 * k2 * ... (o produto dos comprimentos das chaves),
+ * o simbolo i + P vai para a posicao seguinte a do simbolo i. As rodadas equivalem entao a
+ * uma unica transposicao de P colunas virtuais, a coluna j comecando na posicao final do
+ * simbolo j (numa mensagem de menos de P simbolos, basta uma coluna virtual por simbolo).
+ * Se P <= ADFGVX_ROUNDS_MAX_PERIOD, o mapa guarda esses inicios (period_start) e as funcoes
+ * *_rounds usam a mesma transposicao (kernels e ladrilhos) de uma chave de P colunas, com o
+ * custo de uma so rodada. Acima disso, elas fazem uma passagem por rodada com o inicio das
+ * colunas de cada chave (column_start).
+ */
+typedef struct
+{
+    int round_count;
+    int key_length[ADFGVX_MAX_ROUNDS];
+    size_t total_symbols;
+    size_t *column_start[ADFGVX_MAX_ROUNDS]; // Inicio das colunas de cada rodada (column_start[0] e o bloco).
+    int period;                              // Colunas virtuais, ou 0 se P passar de ADFGVX_ROUNDS_MAX_PERIOD.
+    size_t *period_start;                    // Inicio das P colunas virtuais (no mesmo bloco), ou NULL.
+} adfgvx_rounds_map;
+
+/**
+ * @brief Prepara o mapa das rodadas para total_symbols simbolos.
+ *
+ * @param map Mapa a ser inicializado (liberado com adfgvx_rounds_map_free).
+ * @param keys Contextos das chaves, na ordem das rodadas (podem ser liberados depois).
+ * @param round_count Numero de rodadas (entre 1 e ADFGVX_MAX_ROUNDS).
+ * @param total_symbols Numero total de simbolos ADFGVX (N).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria.
+ */
+int adfgvx_rounds_map_init(adfgvx_rounds_map *map, const adfgvx_key_ctx keys[], int round_count, size_t total_symbols);
+
+/**
+ * @brief Calcula a posicao final, no texto cifrado, dos simbolos first_symbol ..
+ * first_symbol + count - 1 da sequencia original.
+ * Na primeira rodada a coluna e a linha avancam sem divisao; nas seguintes, chaves de ate
+ * 8 colunas usam divisores constantes (multiplicacoes) e as mais longas, uma divisao.
+ * Usada para preparar period_start.
+ *
+ * @param positions Saida com count posicoes.
+ */
+void adfgvx_rounds_map_positions(const adfgvx_rounds_map *map, size_t first_symbol, size_t count, size_t positions[]);
+
+/**
+ * @brief Libera o bloco do mapa (pode ser chamada mais de uma vez, e depois de um init que falhou).
+ */
+void adfgvx_rounds_map_free(adfgvx_rounds_map *map);
+
+/**
+ * @brief Obtem uma area de trabalho de length posicoes para as tabelas por mensagem:
+ * stack_buffer, se couber, ou um bloco do heap do tamanho exato.
+ *
+ * @param stack_buffer Vetor do chamador (normalmente na pilha).
+ * @param stack_length Numero de posicoes de stack_buffer.
+ * @param length Numero de posicoes necessarias (ex: key_length).
+ * @return size_t* A area de trabalho, ou NULL se faltar memoria.
+ */
+size_t *adfgvx_key_scratch(size_t stack_buffer[], size_t stack_length, size_t length);
+
+/**
+ * @brief Libera uma area obtida por adfgvx_key_scratch (nao faz nada se for stack_buffer).
+ */
+void adfgvx_key_scratch_free(size_t *scratch, const size_t stack_buffer[]);
+
+#endif // ADFGVX_KEY_H
@@ -0,0 +1,123 @@
+#ifndef ADFGVX_PACKED_H
+#define ADFGVX_PACKED_H
+
+#include <stddef.h> // Para size_t
+
+#include "adfgvx_key.h" // Para adfgvx_key_ctx
+
+// Formato compacto do texto cifrado (--packed): 3 bits por simbolo em vez de um byte ASCII.
+//
+// Cada simbolo ADFGVX vale o seu indice em adfgvx_symbols (A = 0, D = 1, ..., X = 5); o
+// simbolo i ocupa os bits 3 * i .. 3 * i + 2 da sequencia, contados a partir do bit menos
+// significativo do primeiro byte (8 simbolos a cada 3 bytes). Os valores 6 e 7 nao sao
+// simbolos: ADFGVX_PACKED_INVALID marca um simbolo invalido, que a decifragem rejeita como
+// rejeitaria o byte ASCII. O texto cifrado ocupa 3/8 do ASCII (62,5% a menos). No arquivo,
+// todos os inteiros sao little-endian:
+//
+//   cabecalho (16 bytes): "ADFGVXP3", symbol_count (u64)
+//   simbolos:             adfgvx_packed_size(symbol_count) bytes (bits de sobra zerados)
+//
+// A cifragem e a decifragem trabalham direto no formato compacto: a transposicao grava e
+// le os 3 bits de cada simbolo na sua posicao final, sem texto cifrado ASCII intermediario.
+// O ASCII continua sendo o formato padrao de troca; adfgvx_pack_symbols e
+// adfgvx_unpack_symbols convertem entre os dois.
+
+#define ADFGVX_PACKED_MAGIC "ADFGVXP3"
+#define ADFGVX_PACKED_HEADER_SIZE 16
+
+// Bits por simbolo e valor gravado para um simbolo invalido.
+#define ADFGVX_PACKED_BITS 3
+#define ADFGVX_PACKED_INVALID 7
+
+/**
+ * @brief Bytes ocupados por symbol_count simbolos compactados (sem o cabecalho).
+ */
+size_t adfgvx_packed_size(size_t symbol_count);
+
+/**
+ * @brief Compacta simbolos ASCII (interchange -> formato compacto).
+ * Bytes que nao sao simbolos ADFGVX sao gravados como ADFGVX_PACKED_INVALID.
+ *
+ * @param symbols Simbolos ASCII.
+ * @param symbol_count Numero de simbolos.
+ * @param packed Saida com adfgvx_packed_size(symbol_count) bytes.
+ * @return int 0 se todos os simbolos forem validos, 1 se algum for invalido.
+ */
+int adfgvx_pack_symbols(const char *symbols, size_t symbol_count, unsigned char *packed);
+
+/**
+ * @brief Expande simbolos compactados para ASCII (formato compacto -> interchange).
+ * Valores que nao sao simbolos (6 e 7) viram '?'.
+ *
+ * @param packed Simbolos compactados.
+ * @param symbol_count Numero de simbolos.
+ * @param symbols Saida com symbol_count bytes (nao terminada em nulo).
+ * @return int 0 se todos os valores forem simbolos, 1 se algum for invalido.
+ */
+int adfgvx_unpack_symbols(const unsigned char *packed, size_t symbol_count, char *symbols);
+
+/**
+ * @brief Cifra a mensagem direto no formato compacto.
+ *
+ * A substituicao e feita em blocos (adfgvx_encode_symbols) e cada simbolo e gravado, com 3
+ * bits, na sua posicao final no texto cifrado, como em cipher_adfgvx_linear_ctx. O
+ * resultado e identico a adfgvx_pack_symbols aplicada a saida de cipher_adfgvx_linear_ctx.
+ *
+ * @param key_ctx Contexto da chave.
+ * @param message Mensagem de entrada (nao precisa ser terminada em nulo).
+ * @param message_length Numero de bytes em message.
+ * @param output Saida; os bytes sao zerados antes de receber os simbolos.
+ * @param output_capacity Tamanho de output, em bytes.
+ * @param symbol_count Recebe o numero de simbolos cifrados.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se output_capacity
+ * for menor que adfgvx_packed_size(cipher_adfgvx_output_length(message, message_length)),
+ * 3 se faltar memoria (so com chaves de mais de ADFGVX_KEY_STACK_COLUMNS colunas).
+ */
+int adfgvx_packed_encrypt(const adfgvx_key_ctx *key_ctx,
+                          const char message[],
+                          size_t message_length,
+                          unsigned char output[],
+                          size_t output_capacity,
+                          size_t *symbol_count);
+
+/**
+ * @brief Decifra um texto cifrado no formato compacto por coleta direta, como
+ * decipher_adfgvx_direct_ctx: os 3 bits de cada simbolo sao lidos na sua posicao e os
+ * pares decodificados direto em output.
+ *
+ * @param key_ctx Contexto da chave.
+ * @param packed Simbolos compactados (adfgvx_packed_size(symbol_count) bytes).
+ * @param symbol_count Numero de simbolos.
+ * @param output Buffer de saida; a mensagem NAO e terminada em nulo.
+ * @param output_capacity Tamanho de output (a mensagem completa tem symbol_count / 2 bytes).
+ * @param output_length Recebe o numero de caracteres escritos em output.
+ * @return int Mesmos codigos de decipher_adfgvx_direct_ctx (3 para um numero impar de
+ * simbolos ou um simbolo invalido).
+ */
+int adfgvx_packed_decrypt(const adfgvx_key_ctx *key_ctx,
+                          const unsigned char *packed,
+                          size_t symbol_count,
+                          char *output,
+                          size_t output_capacity,
+                          size_t *output_length);
+
+/**
+ * @brief Grava o cabecalho de um arquivo compacto.
+ *
+ * @param header Saida com ADFGVX_PACKED_HEADER_SIZE bytes.
+ * @param symbol_count Numero de simbolos do texto cifrado.
+ */
+void adfgvx_packed_write_header(unsigned char header[ADFGVX_PACKED_HEADER_SIZE], size_t symbol_count);
+
+/**
+ * @brief Confere o cabecalho de um arquivo compacto e o seu tamanho.
+ *
+ * @param data Conteudo do arquivo.
+ * @param length Tamanho do arquivo, em bytes.
+ * @param symbol_count Recebe o numero de simbolos.
+ * @return int 0 em caso de sucesso, 1 se o arquivo nao estiver no formato compacto,
+ * 2 se o tamanho nao corresponder ao cabecalho (ex: arquivo truncado).
+ */
+int adfgvx_packed_read_header(const unsigned char *data, size_t length, size_t *symbol_count);
+
+#endif // ADFGVX_PACKED_H
@@ -0,0 +1,80 @@
+#ifndef ADFGVX_PIPELINE_H
+#define ADFGVX_PIPELINE_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+// Pipeline de tres estagios para o modo filtro (entrada padrao -> saida padrao).
+//
+// Uma thread le blocos de block_size bytes da entrada, a thread chamadora os processa
+// (cifragem ou decifragem, com o pool de threads da propria funcao de processamento) e
+// outra thread escreve a saida de cada bloco, na ordem. Os blocos circulam por um anel de
+// queue_depth posicoes: enquanto o bloco n e processado, o n + 1 ja esta sendo lido e o
+// n - 1 escrito, e a vazao fica limitada pelo estagio mais lento. Com queue_depth = 3 cada
+// estagio tem um bloco; posicoes a mais absorvem variacoes de velocidade entre eles. A
+// memoria usada e cerca de queue_depth * (block_size + saida de um bloco).
+
+/**
+ * @brief Saida de um bloco, preenchida pelo estagio de processamento. O buffer de cada
+ * posicao do anel e reaproveitado entre os blocos e so cresce quando necessario.
+ */
+typedef struct
+{
+    char *data;
+    size_t length;
+    size_t capacity;
+} adfgvx_pipeline_buffer;
+
+/**
+ * @brief Acrescenta length bytes ao fim de buffer, aumentando-o se preciso.
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+int adfgvx_pipeline_buffer_append(adfgvx_pipeline_buffer *buffer, const char *data, size_t length);
+
+/**
+ * @brief Estagio de processamento, chamado na thread chamadora para cada bloco, na ordem.
+ *
+ * @param user Ponteiro repassado sem alteracao por adfgvx_pipeline_run.
+ * @param input Bytes lidos (ate block_size; o ultimo bloco pode ser menor ou vazio).
+ * @param length Numero de bytes em input.
+ * @param last Diferente de 0 no ultimo bloco (fim da entrada).
+ * @param output Saida do bloco, vazia na chamada (adfgvx_pipeline_buffer_append).
+ * @return int 0 em caso de sucesso, ou um codigo de erro (que interrompe o pipeline).
+ */
+typedef int (*adfgvx_pipeline_stage)(void *user, const char *input, size_t length, int last, adfgvx_pipeline_buffer *output);
+
+/**
+ * @brief Contadores preenchidos por adfgvx_pipeline_run.
+ */
+typedef struct
+{
+    unsigned long long input_bytes;  // Bytes lidos da entrada.
+    unsigned long long output_bytes; // Bytes escritos na saida.
+    unsigned long long blocks;       // Blocos processados.
+    int stage_status;                // Codigo devolvido pelo estagio de processamento (0 se nenhum erro).
+} adfgvx_pipeline_stats;
+
+/**
+ * @brief Executa o pipeline ate o fim da entrada (ou ate o primeiro erro).
+ *
+ * @param input Arquivo de entrada (ex: stdin, em modo binario).
+ * @param output Arquivo de saida (ex: stdout, em modo binario); e esvaziado (fflush) no fim.
+ * @param block_size Bytes lidos por bloco (> 0).
+ * @param queue_depth Blocos em transito entre os estagios (>= 2).
+ * @param stage Estagio de processamento.
+ * @param user Repassado a stage.
+ * @param stats Se nao for NULL, recebe os contadores.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria
+ * (ou a criacao das threads falhar), 3 se houver erro de leitura, 4 se houver erro de escrita,
+ * 5 se o estagio de processamento falhar (o codigo dele fica em stats->stage_status).
+ */
+int adfgvx_pipeline_run(FILE *input,
+                        FILE *output,
+                        size_t block_size,
+                        size_t queue_depth,
+                        adfgvx_pipeline_stage stage,
+                        void *user,
+                        adfgvx_pipeline_stats *stats);
+
+#endif // ADFGVX_PIPELINE_H
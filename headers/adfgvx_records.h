@@ -0,0 +1,57 @@
+#ifndef ADFGVX_RECORDS_H
+#define ADFGVX_RECORDS_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+#include "adfgvx_key.h"  // Para adfgvx_key_ctx
+#include "thread_pool.h" // Para thread_pool
+
+/**
+ * @brief Sentido do processamento de um arquivo de registros.
+ */
+typedef enum
+{
+    ADFGVX_RECORDS_ENCRYPT = 0, // Cada linha e uma mensagem a cifrar (cipher_adfgvx_batch).
+    ADFGVX_RECORDS_DECRYPT      // Cada linha e um texto cifrado (decipher_adfgvx_batch).
+} adfgvx_records_mode;
+
+/**
+ * @brief Contadores preenchidos por adfgvx_process_records.
+ */
+typedef struct
+{
+    unsigned long long records;      // Linhas (registros) processadas.
+    unsigned long long failed;       // Registros com status diferente de 0 (saida vazia).
+    unsigned long long input_bytes;  // Bytes lidos, incluindo as quebras de linha.
+    unsigned long long output_bytes; // Bytes escritos, incluindo as quebras de linha.
+} adfgvx_records_stats;
+
+/**
+ * @brief Processa um arquivo em que cada linha e um registro independente e escreve uma
+ * linha de saida por registro, na mesma ordem.
+ *
+ * As linhas sao lidas em blocos de ate ADFGVX_RECORD_BLOCK_SIZE bytes; os registros de
+ * cada bloco sao divididos entre as threads do pool (cada thread processa um trecho
+ * contiguo com cipher_adfgvx_batch / decipher_adfgvx_batch) e as saidas sao escritas
+ * em ordem antes do proximo bloco. Quebras "\n" e "\r\n" sao aceitas; a saida usa "\n".
+ * Registros que falham (ex: texto cifrado invalido) geram uma linha vazia, para que a
+ * linha i da saida continue correspondendo a linha i da entrada.
+ *
+ * @param input Arquivo de entrada (aberto para leitura, de preferencia em modo binario).
+ * @param output Arquivo de saida (aberto para escrita).
+ * @param key_ctx Contexto de chave inicializado por adfgvx_key_ctx_init.
+ * @param mode ADFGVX_RECORDS_ENCRYPT ou ADFGVX_RECORDS_DECRYPT.
+ * @param pool Pool de threads; NULL processa tudo na thread chamadora.
+ * @param stats Se nao for NULL, recebe os contadores do processamento.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria,
+ * 3 se houver erro de leitura ou escrita.
+ */
+int adfgvx_process_records(FILE *input,
+                           FILE *output,
+                           const adfgvx_key_ctx *key_ctx,
+                           adfgvx_records_mode mode,
+                           thread_pool *pool,
+                           adfgvx_records_stats *stats);
+
+#endif // ADFGVX_RECORDS_H
@@ -0,0 +1,67 @@
+#ifndef ADFGVX_REFERENCE_H
+#define ADFGVX_REFERENCE_H
+
+#include <stddef.h> // Para size_t
+
+// Implementacao de referencia da cifra ADFGVX, CONGELADA.
+//
+// Reproduz o algoritmo original, passo a passo e sem otimizacoes: busca linear na matriz
+// Polybius, ordenacao da chave por Bubble Sort, distribuicao dos simbolos nas colunas e
+// leitura das colunas na ordem alfabetica (e o caminho inverso na decifragem). Nao usa o
+// codec, o contexto de chave nem nenhum outro modulo, para que um erro numa otimizacao
+// (kernels vetoriais, espalhamento direto, threads, formatos em blocos) nao se repita na
+// referencia. O harness diferencial (adfgvx_fuzz) compara todas as outras implementacoes
+// com estas duas funcoes, byte a byte.
+//
+// Este arquivo nao deve ser otimizado nem reaproveitar codigo dos outros modulos: uma
+// mudanca aqui muda o que o harness considera correto.
+
+/**
+ * @brief Cifra a mensagem pelo algoritmo original.
+ * Mesmo contrato de cipher_adfgvx_linear: caracteres fora da matriz sao ignorados e o texto
+ * cifrado nao e terminado em nulo.
+ *
+ * @param key A chave usada na transposicao.
+ * @param key_length Comprimento da chave (entre 1 e MAX_KEY_LENGTH - 1).
+ * @param message Mensagem de entrada (nao precisa ser terminada em nulo).
+ * @param message_length Numero de bytes em message.
+ * @param output Buffer de saida.
+ * @param output_capacity Tamanho de output, em bytes.
+ * @param output_length Recebe o numero de simbolos escritos em output.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se output_capacity
+ * for insuficiente (nada e escrito), 3 se faltar memoria.
+ */
+int adfgvx_reference_cipher(const char key[],
+                            int key_length,
+                            const char message[],
+                            size_t message_length,
+                            char output[],
+                            size_t output_capacity,
+                            size_t *output_length);
+
+/**
+ * @brief Decifra o texto cifrado pelo algoritmo original.
+ * Mesmo contrato de decipher_adfgvx_direct: a decodificacao para no primeiro par invalido
+ * e a mensagem nao e terminada em nulo.
+ *
+ * @param encrypted_text Texto cifrado (nao precisa ser terminado em nulo).
+ * @param encrypted_length Numero de simbolos em encrypted_text.
+ * @param key Chave de cifra.
+ * @param key_length Comprimento da chave (entre 1 e MAX_KEY_LENGTH - 1).
+ * @param output Buffer de saida.
+ * @param output_capacity Tamanho de output.
+ * @param output_length Recebe o numero de caracteres escritos em output.
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se output_capacity
+ * for insuficiente (output recebe os primeiros output_capacity caracteres), 3 se o texto
+ * cifrado for invalido (numero impar de simbolos, ou um par invalido; output recebe os
+ * caracteres decodificados antes dele), 4 se faltar memoria.
+ */
+int adfgvx_reference_decipher(const char *encrypted_text,
+                              size_t encrypted_length,
+                              const char key[],
+                              int key_length,
+                              char *output,
+                              size_t output_capacity,
+                              size_t *output_length);
+
+#endif // ADFGVX_REFERENCE_H
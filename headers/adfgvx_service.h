@@ -0,0 +1,164 @@
+#ifndef ADFGVX_SERVICE_H
+#define ADFGVX_SERVICE_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+#include <signal.h> // Para sig_atomic_t
+
+// Servico local de cifragem num socket UNIX (adfgvx_cipher_tool --serve CAMINHO).
+//
+// Em vez de criar um processo, ler a chave de um arquivo e preparar tudo a cada mensagem,
+// os clientes mantem uma conexao aberta e enviam requisicoes num protocolo binario. O
+// servico guarda a agenda de cada chave usada recentemente (adfgvx_key_ctx, num cache de
+// ADFGVX_SERVICE_KEY_CACHE chaves) e junta as requisicoes que chegam ao mesmo tempo, de
+// todas as conexoes, em lotes de ate batch_size, divididos entre as threads do pool.
+//
+// Protocolo: cada requisicao e cada resposta comecam com um cabecalho de
+// ADFGVX_SERVICE_HEADER_SIZE bytes (inteiros little-endian):
+//   0  1 byte   versao (ADFGVX_SERVICE_VERSION)
+//   1  1 byte   operacao (ADFGVX_SERVICE_ENCRYPT, _DECRYPT ou _STATS)
+//   2  2 bytes  status (0 na requisicao; ADFGVX_SERVICE_STATUS_* na resposta)
+//   4  4 bytes  identificador escolhido pelo cliente (repetido na resposta)
+//   8  4 bytes  comprimento da chave (0 na resposta e em _STATS)
+//  12  4 bytes  comprimento do conteudo
+// seguido da chave e do conteudo (mensagem ou texto cifrado; na resposta, o resultado).
+// Uma conexao pode enviar varias requisicoes sem esperar as respostas; elas voltam na
+// mesma ordem. _STATS devolve, em JSON, os histogramas de latencia de cada operacao
+// (do fim da leitura da requisicao ao fim da escrita da resposta), o tamanho medio dos
+// lotes e os acertos do cache de chaves. Um cabecalho invalido recebe uma resposta com
+// ADFGVX_SERVICE_STATUS_BAD_REQUEST e a conexao e encerrada.
+//
+// Cada conexao tem uma thread de leitura e uma de escrita: um cliente que nao le as suas
+// respostas so para a propria conexao, que deixa de ser lida depois de
+// ADFGVX_SERVICE_CONNECTION_REQUESTS requisicoes (ou ADFGVX_SERVICE_CONNECTION_BYTES bytes)
+// sem resposta escrita. Disponivel apenas onde ha sockets UNIX (nao no Windows).
+
+#define ADFGVX_SERVICE_VERSION 1
+#define ADFGVX_SERVICE_HEADER_SIZE 16
+
+// Operacoes.
+#define ADFGVX_SERVICE_ENCRYPT 1
+#define ADFGVX_SERVICE_DECRYPT 2
+#define ADFGVX_SERVICE_STATS 3
+
+// Status das respostas. Uma falha da cifragem ou da decifragem devolve
+// ADFGVX_SERVICE_STATUS_CIPHER + o codigo de cipher_adfgvx_linear / decipher_adfgvx_direct.
+#define ADFGVX_SERVICE_STATUS_OK 0
+#define ADFGVX_SERVICE_STATUS_BAD_REQUEST 1 // Versao, operacao ou comprimentos invalidos.
+#define ADFGVX_SERVICE_STATUS_NO_MEMORY 2
+#define ADFGVX_SERVICE_STATUS_CIPHER 10
+
+/**
+ * @brief Configuracao do servico.
+ */
+typedef struct
+{
+    const char *socket_path; // Caminho do socket (um socket antigo no mesmo caminho e removido).
+    int thread_count;        // Threads que processam os lotes (1 = apenas a thread do lote).
+    size_t batch_size;       // Maximo de requisicoes por lote (>= 1).
+    unsigned int batch_wait_us; // Espera por mais requisicoes antes de fechar um lote incompleto (0 = nao espera).
+    size_t max_payload;      // Maior conteudo aceito numa requisicao, em bytes.
+} adfgvx_service_config;
+
+/**
+ * @brief Servico aberto por adfgvx_service_open. Os campos sao internos.
+ */
+typedef struct adfgvx_service adfgvx_service;
+
+/**
+ * @brief Cria o socket, comeca a escutar e inicia a thread dos lotes. As conexoes so sao
+ * aceitas dentro de adfgvx_service_run, mas os clientes ja podem conectar ao retornar.
+ *
+ * @param service Recebe o servico.
+ * @param config Configuracao (copiada).
+ * @return int 0 em caso de sucesso, 1 se a configuracao for invalida, 2 se faltar memoria
+ * (ou a criacao das threads falhar), 3 se o socket nao puder ser criado, 4 se a plataforma
+ * nao tiver sockets UNIX.
+ */
+int adfgvx_service_open(adfgvx_service **service, const adfgvx_service_config *config);
+
+/**
+ * @brief Aceita conexoes ate *stop ficar diferente de 0 (ex: num tratador de sinal) ou ate
+ * adfgvx_service_stop; entao deixa de ler as conexoes, responde as requisicoes ja
+ * recebidas e retorna. Respostas que os clientes nao lerem em ADFGVX_SERVICE_DRAIN_MS sao
+ * descartadas.
+ *
+ * @param stop Sinalizador verificado a cada ADFGVX_SERVICE_POLL_MS (pode ser NULL).
+ * @return int 0 em caso de sucesso, 3 se a espera por conexoes falhar.
+ */
+int adfgvx_service_run(adfgvx_service *service, const volatile sig_atomic_t *stop);
+
+/**
+ * @brief Pede o fim de adfgvx_service_run (pode ser chamada de outra thread).
+ */
+void adfgvx_service_stop(adfgvx_service *service);
+
+/**
+ * @brief Grava as estatisticas (o mesmo JSON de ADFGVX_SERVICE_STATS) em output.
+ * Deve ser chamada fora de adfgvx_service_run.
+ */
+void adfgvx_service_write_stats(adfgvx_service *service, FILE *output);
+
+/**
+ * @brief Fecha o socket, remove o caminho e libera o servico. Aceita NULL.
+ */
+void adfgvx_service_close(adfgvx_service *service);
+
+/**
+ * @brief Cliente: conecta ao servico.
+ *
+ * @param fd Recebe o descritor da conexao.
+ * @return int 0 em caso de sucesso, 1 se o caminho for invalido, 3 se a conexao falhar.
+ */
+int adfgvx_service_connect(const char *socket_path, int *fd);
+
+/**
+ * @brief Cliente: envia uma requisicao (sem esperar a resposta).
+ *
+ * @param key Chave (key_length caracteres; NULL e 0 em ADFGVX_SERVICE_STATS).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 3 se houver erro de escrita.
+ */
+int adfgvx_service_send(int fd,
+                        int op,
+                        unsigned int id,
+                        const char *key,
+                        int key_length,
+                        const char *payload,
+                        size_t payload_length);
+
+/**
+ * @brief Cliente: le a proxima resposta.
+ *
+ * @param id Recebe o identificador da requisicao respondida (pode ser NULL).
+ * @param status Recebe o status da resposta.
+ * @param output Buffer do resultado (sem terminador nulo).
+ * @param output_capacity Tamanho de output.
+ * @param output_length Recebe o tamanho do resultado.
+ * @return int 0 em caso de sucesso, 3 se houver erro de leitura (ou a conexao fechar),
+ * 4 se a resposta for invalida ou maior que output_capacity (o resultado e descartado).
+ */
+int adfgvx_service_receive(int fd, unsigned int *id, int *status, char *output, size_t output_capacity, size_t *output_length);
+
+/**
+ * @brief Cliente: adfgvx_service_send seguida de adfgvx_service_receive.
+ *
+ * @return int Os codigos de adfgvx_service_send / adfgvx_service_receive (o resultado da
+ * operacao fica em status).
+ */
+int adfgvx_service_request(int fd,
+                           int op,
+                           const char *key,
+                           int key_length,
+                           const char *payload,
+                           size_t payload_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length,
+                           int *status);
+
+/**
+ * @brief Cliente: fecha a conexao.
+ */
+void adfgvx_service_disconnect(int fd);
+
+#endif // ADFGVX_SERVICE_H
@@ -0,0 +1,114 @@
+#ifndef ADFGVX_STATS_H
+#define ADFGVX_STATS_H
+
+#include <stdio.h> // Para FILE
+
+// Instrumentacao por estagio (--stats das ferramentas).
+//
+// Os pontos de medicao ficam nos caminhos quentes (leitura, agenda da chave, contagem,
+// substituicao, transposicao, decodificacao e escrita) e acumulam, por estagio, o tempo
+// (contador de ciclos da CPU, ou clock_gettime onde nao houver), os bytes processados e o
+// numero de chamadas. Enquanto adfgvx_stats_enable() nao for chamada, cada ponto custa
+// apenas um teste de uma variavel global. Compilado com -DADFGVX_STATS=0, os pontos
+// desaparecem do codigo.
+
+// 1 para compilar os pontos de medicao; 0 para remove-los (ex: -DADFGVX_STATS=0).
+#ifndef ADFGVX_STATS
+#define ADFGVX_STATS 1
+#endif
+
+// Bytes processados por um estagio entre duas amostras do pico de memoria do processo
+// (cada amostra e uma chamada ao sistema; a primeira chamada de cada estagio tambem e amostrada).
+#define ADFGVX_STATS_MEMORY_SAMPLE_BYTES (1024 * 1024)
+
+typedef enum
+{
+    ADFGVX_STAGE_READ = 0,  // Leitura da entrada (read_file, read_file_in_chunks, map_input_file, ...).
+    ADFGVX_STAGE_KEY,       // Agenda da chave (ordem das colunas de adfgvx_key_ctx).
+    ADFGVX_STAGE_SCAN,      // Contagem dos simbolos (cipher_adfgvx_output_length).
+    ADFGVX_STAGE_ENCODE,    // Substituicao Polybius (adfgvx_encode_symbols, polybius_encode_to_columns).
+    ADFGVX_STAGE_TRANSPOSE, // Transposicao (espalhamento nas colunas, ordem das colunas).
+    ADFGVX_STAGE_DECODE,    // Decifragem: coleta dos simbolos e decodificacao dos pares, juntas.
+    ADFGVX_STAGE_WRITE,     // Escrita da saida (write_*, close_mapped_file, final dos fluxos).
+    ADFGVX_STAGE_COUNT
+} adfgvx_stage;
+
+// Diferente de 0 entre adfgvx_stats_enable() e adfgvx_stats_disable().
+extern int adfgvx_stats_enabled;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h> // Para __rdtsc
+#define adfgvx_stats_ticks() ((unsigned long long)__rdtsc())
+#else
+/**
+ * @brief Relogio dos pontos de medicao sem contador de ciclos: clock_gettime, em ns.
+ */
+unsigned long long adfgvx_stats_clock(void);
+#define adfgvx_stats_ticks() adfgvx_stats_clock()
+#endif
+
+/**
+ * @brief Acumula uma medicao no estagio (seguro entre threads).
+ *
+ * @param stage Estagio medido.
+ * @param ticks Duracao, em unidades de adfgvx_stats_ticks().
+ * @param bytes Bytes processados pelo estagio nesta medicao.
+ */
+void adfgvx_stats_add(adfgvx_stage stage, unsigned long long ticks, unsigned long long bytes);
+
+#if ADFGVX_STATS
+// Inicia uma medicao: declara start com o instante atual (0 se a medicao estiver desligada).
+#define ADFGVX_STATS_BEGIN(start) \
+    unsigned long long start = adfgvx_stats_enabled ? adfgvx_stats_ticks() : 0
+// Encerra a medicao iniciada em start e a atribui ao estagio.
+#define ADFGVX_STATS_END(stage, start, bytes)                                         \
+    do                                                                                \
+    {                                                                                 \
+        if (adfgvx_stats_enabled)                                                     \
+        {                                                                             \
+            adfgvx_stats_add((stage), adfgvx_stats_ticks() - (start), (bytes));       \
+        }                                                                             \
+    } while (0)
+// Atribui o tempo desde start ao estagio e reinicia start (estagios consecutivos).
+#define ADFGVX_STATS_NEXT(stage, start, bytes)                                        \
+    do                                                                                \
+    {                                                                                 \
+        if (adfgvx_stats_enabled)                                                     \
+        {                                                                             \
+            unsigned long long adfgvx_stats_now = adfgvx_stats_ticks();               \
+            adfgvx_stats_add((stage), adfgvx_stats_now - (start), (bytes));           \
+            (start) = adfgvx_stats_now;                                               \
+        }                                                                             \
+    } while (0)
+// Reinicia a medicao em start (depois de um trecho que nao pertence ao estagio).
+#define ADFGVX_STATS_RESTART(start) ((start) = adfgvx_stats_enabled ? adfgvx_stats_ticks() : 0)
+#else
+#define ADFGVX_STATS_BEGIN(start)
+// sizeof nao avalia bytes, mas conta como uso das variaveis que so servem a medicao.
+#define ADFGVX_STATS_END(stage, start, bytes) ((void)sizeof(bytes))
+#define ADFGVX_STATS_NEXT(stage, start, bytes) ((void)sizeof(bytes))
+#define ADFGVX_STATS_RESTART(start) ((void)0)
+#endif
+
+/**
+ * @brief Zera os contadores e liga a medicao (a partir daqui conta o tempo total).
+ */
+void adfgvx_stats_enable(void);
+
+/**
+ * @brief Desliga a medicao; os contadores ficam disponiveis para adfgvx_stats_write.
+ */
+void adfgvx_stats_disable(void);
+
+/**
+ * @brief Grava, para cada estagio, as chamadas, o tempo (e a fracao do tempo total), os
+ * bytes, a vazao em MB/s e o pico de memoria do processo observado no estagio.
+ * Com varias threads, o tempo de um estagio e a soma do tempo de todas as threads.
+ *
+ * @param output Arquivo de saida.
+ * @param json Diferente de 0 para gravar em JSON; 0 para uma tabela de texto.
+ * @return int 0 em caso de sucesso, 1 se a escrita falhar.
+ */
+int adfgvx_stats_write(FILE *output, int json);
+
+#endif // ADFGVX_STATS_H
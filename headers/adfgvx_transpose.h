@@ -0,0 +1,145 @@
+#ifndef ADFGVX_TRANSPOSE_H
+#define ADFGVX_TRANSPOSE_H
+
+#include <stddef.h> // Para size_t
+
+// Kernels da transposicao especializados por comprimento de chave.
+//
+// Na cifragem, o simbolo i vai para a coluna i % k, na linha i / k; na decifragem, o
+// caminho e o inverso. O laco generico (scatter_symbols em adfgvx_core.c, gather_pairs em
+// adfgvx_decipher.c) avanca um cursor de coluna por simbolo e le/grava o cursor de cada
+// coluna na memoria, porque k so e conhecido em tempo de execucao. Para as chaves curtas,
+// as mais comuns, este modulo gera por macro um kernel para cada k de 1 a
+// ADFGVX_TRANSPOSE_MAX_SPECIALIZED: ele processa linhas inteiras, com o laco das colunas
+// desenrolado, os inicios das colunas em registradores e os indices calculados sem divisao.
+// A tabela de despacho e consultada uma vez por chamada; as chaves mais longas, e as
+// linhas incompletas do inicio e do fim de cada trecho, continuam no laco generico.
+
+// Maior comprimento de chave com kernel especializado.
+#define ADFGVX_TRANSPOSE_MAX_SPECIALIZED 8
+
+/**
+ * @brief Espalha row_count linhas completas de simbolos (k simbolos por linha, a partir da
+ * coluna 0) nas colunas do texto cifrado: symbols[r * k + c] vai para
+ * output[next_position[c] + r]. Ao final, next_position[c] foi avancado de row_count.
+ */
+typedef void (*adfgvx_scatter_rows_fn)(size_t next_position[], const char *symbols, size_t row_count, char *output);
+
+/**
+ * @brief Coleta e decodifica block_count blocos de k pares (duas linhas completas de k
+ * simbolos cada, a partir da coluna 0) do texto cifrado para output.
+ * Retorna o numero de pares decodificados: menor que block_count * k se um par invalido
+ * for encontrado (a decodificacao para nele e next_position fica indefinido). Caso
+ * contrario, next_position[c] foi avancado de 2 * block_count.
+ */
+typedef size_t (*adfgvx_gather_rows_fn)(size_t next_position[], const char *encrypted_text, size_t block_count, char *output);
+
+/**
+ * @brief Kernels especializados de um comprimento de chave.
+ */
+typedef struct
+{
+    int key_length;
+    adfgvx_scatter_rows_fn scatter_rows;
+    adfgvx_gather_rows_fn gather_rows;
+} adfgvx_transpose_kernels;
+
+// Transposicao por ladrilhos (tiles), para as chaves sem kernel especializado.
+//
+// Com uma chave longa, o laco generico grava (ou le) cada simbolo numa coluna diferente:
+// k fluxos intercalados, em paginas diferentes quando a mensagem e grande, que perdem a
+// cache e a TLB a cada simbolo. Os ladrilhos trocam o percurso: um bloco de
+// ADFGVX_TILE_ROWS linhas inteiras fica na cache em ordem de linha e cada coluna e gravada
+// (ou lida) de uma vez, ADFGVX_TILE_ROWS bytes seguidos, enquanto as leituras com passo k
+// ficam nas poucas linhas de cache do ladrilho. Quando o texto cifrado passa de
+// adfgvx_transpose_stream_threshold() bytes (o tamanho da cache de ultimo nivel), a
+// cifragem grava as colunas com instrucoes nao temporais (x86), sem trazer para a cache
+// linhas que nao serao relidas.
+
+// Linhas por ladrilho: cada coluna recebe uma linha de cache (64 bytes) por ladrilho.
+#define ADFGVX_TILE_ROWS 64
+
+// Linhas por ladrilho com gravacao nao temporal: so as linhas de cache inteiras de cada
+// coluna sao gravadas assim, e 256 linhas garantem ao menos 3 por coluna.
+#define ADFGVX_TILE_STREAM_ROWS 256
+
+/**
+ * @brief Espalha row_count linhas completas de key_length simbolos (a partir da coluna 0)
+ * nas colunas do texto cifrado, ladrilho por ladrilho (de ADFGVX_TILE_ROWS linhas, ou
+ * ADFGVX_TILE_STREAM_ROWS com streaming), como adfgvx_scatter_rows_fn.
+ *
+ * @param streaming Diferente de 0 para gravar com instrucoes nao temporais, quando a CPU
+ * as tiver (senao, e ignorado).
+ */
+void adfgvx_transpose_scatter_tiles(int key_length,
+                                    size_t next_position[],
+                                    const char *symbols,
+                                    size_t row_count,
+                                    char *output,
+                                    int streaming);
+
+/**
+ * @brief Le row_count linhas completas (a partir da coluna 0) do texto cifrado para tile,
+ * em ordem de linha: tile[r * tile_pitch + c] = encrypted_text[next_position[c] + r].
+ * Ao final, next_position[c] foi avancado de row_count.
+ *
+ * @param tile_pitch Distancia entre as linhas do ladrilho (adfgvx_transpose_tile_pitch).
+ * @param tile Saida com row_count * tile_pitch bytes.
+ */
+void adfgvx_transpose_gather_tile(int key_length,
+                                  size_t next_position[],
+                                  const char *encrypted_text,
+                                  size_t row_count,
+                                  size_t tile_pitch,
+                                  char *tile);
+
+/**
+ * @brief Distancia entre as linhas de um ladrilho de leitura: key_length arredondado para
+ * um numero impar de linhas de cache. Com key_length multiplo de uma potencia de 2 (ex:
+ * 1024), as ADFGVX_TILE_ROWS linhas de uma coluna cairiam em poucos conjuntos da cache L1
+ * e se expulsariam a cada coluna; com um numero impar de linhas de cache, cada linha do
+ * ladrilho cai num conjunto diferente.
+ */
+size_t adfgvx_transpose_tile_pitch(int key_length);
+
+/**
+ * @brief Tamanho do texto cifrado, em bytes, a partir do qual a cifragem usa gravacao nao
+ * temporal: o tamanho da cache de ultimo nivel, quando o sistema o informa, ou
+ * ADFGVX_TRANSPOSE_STREAM_THRESHOLD. Calculado uma unica vez; pode ser chamada de qualquer thread.
+ */
+size_t adfgvx_transpose_stream_threshold(void);
+
+/**
+ * @brief Liga ou desliga os ladrilhos (para testes e medicoes). Ligados por padrao.
+ */
+void adfgvx_transpose_select_tiled(int enabled);
+
+/**
+ * @brief Retorna 1 se os ladrilhos estiverem ligados, 0 caso contrario.
+ */
+int adfgvx_transpose_tiled_enabled(void);
+
+/**
+ * @brief Consulta a tabela de despacho.
+ *
+ * @param key_length Comprimento da chave.
+ * @return const adfgvx_transpose_kernels* Kernels especializados para key_length, ou NULL
+ * se nao houver (chave mais longa que ADFGVX_TRANSPOSE_MAX_SPECIALIZED, ou kernels
+ * desligados por adfgvx_transpose_select_specialized): o chamador usa o laco generico.
+ */
+const adfgvx_transpose_kernels *adfgvx_transpose_kernels_for(int key_length);
+
+/**
+ * @brief Liga ou desliga os kernels especializados (para testes e medicoes). Ligados por padrao.
+ *
+ * @param enabled Diferente de 0 para usar os kernels especializados; 0 para usar sempre o
+ * laco generico.
+ */
+void adfgvx_transpose_select_specialized(int enabled);
+
+/**
+ * @brief Retorna 1 se os kernels especializados estiverem ligados, 0 caso contrario.
+ */
+int adfgvx_transpose_specialized_enabled(void);
+
+#endif // ADFGVX_TRANSPOSE_H
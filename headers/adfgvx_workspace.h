@@ -0,0 +1,87 @@
+#ifndef ADFGVX_WORKSPACE_H
+#define ADFGVX_WORKSPACE_H
+
+#include <stddef.h> // Para size_t
+
+// Area de trabalho (arena) reutilizavel para as chamadas de uma so vez da cifra.
+//
+// Cada chamada de cipher_adfgvx_ws / decipher_adfgvx_ws precisa de algumas tabelas do
+// tamanho da chave (ordem das colunas, ordem inversa e inicio de cada coluna). Em vez de
+// alocar e liberar essas tabelas a cada chamada, elas sao reservadas em sequencia numa
+// arena do chamador e devolvidas de uma vez ao fim da chamada (mark / release). Nada e
+// zerado: toda posicao lida foi escrita antes pela propria chamada.
+//
+// Dois modos:
+//   - heap:  a arena e alocada por adfgvx_workspace_init e cresce (adfgvx_workspace_reserve)
+//            se preciso, quando estiver vazia; depois da primeira chamada com a maior
+//            chave nao aloca mais.
+//   - fixo:  a arena e um buffer do chamador (ex: estatico ou na pilha) e nunca cresce;
+//            uma chamada que nao caiba nele falha com o codigo de falta de memoria.
+//            ADFGVX_WORKSPACE_KEY_BYTES(k) da o tamanho que basta para chaves de ate k colunas.
+
+// Alinhamento de cada bloco reservado na arena.
+#define ADFGVX_WORKSPACE_ALIGN 16
+
+// Bytes que bastam para uma chamada com uma chave de k colunas: contexto de chave
+// (2 * k inteiros) e inicio das colunas (k size_t), mais o alinhamento de cada bloco.
+#define ADFGVX_WORKSPACE_KEY_BYTES(k) \
+    (2 * (size_t)(k) * sizeof(int) + (size_t)(k) * sizeof(size_t) + 3 * ADFGVX_WORKSPACE_ALIGN)
+
+/**
+ * @brief Arena de trabalho. Os campos sao internos; use apenas as funcoes adfgvx_workspace_*.
+ * Uma arena nao deve ser usada por duas threads ao mesmo tempo (use uma por thread).
+ */
+typedef struct
+{
+    unsigned char *base; // Inicio da arena.
+    size_t capacity;     // Bytes em base.
+    size_t used;         // Bytes reservados ate agora.
+    size_t peak;         // Maior valor de used desde a inicializacao.
+    int fixed;           // 1 se base pertence ao chamador (a arena nunca cresce).
+} adfgvx_workspace;
+
+/**
+ * @brief Inicializa uma arena.
+ *
+ * @param ws Arena a ser inicializada.
+ * @param buffer Buffer do chamador (modo fixo), ou NULL para uma arena no heap.
+ * @param size Tamanho de buffer, ou capacidade inicial da arena no heap (pode ser 0).
+ * @return int 0 em caso de sucesso, 1 se os parametros forem invalidos, 2 se faltar memoria.
+ */
+int adfgvx_workspace_init(adfgvx_workspace *ws, void *buffer, size_t size);
+
+/**
+ * @brief Garante size bytes livres na arena (incluindo o alinhamento dos blocos que serao
+ * reservados, ex: ADFGVX_WORKSPACE_KEY_BYTES). No modo heap, uma arena vazia e realocada
+ * se for pequena; com blocos ja reservados ela nao se move (os ponteiros entregues
+ * continuam validos) e a funcao falha.
+ *
+ * @return int 0 em caso de sucesso, 1 se nao couber (modo fixo, ou arena em uso),
+ * 2 se faltar memoria.
+ */
+int adfgvx_workspace_reserve(adfgvx_workspace *ws, size_t size);
+
+/**
+ * @brief Reserva size bytes alinhados a ADFGVX_WORKSPACE_ALIGN. O conteudo NAO e zerado.
+ * Nunca aloca: a capacidade vem de adfgvx_workspace_init / adfgvx_workspace_reserve.
+ *
+ * @return void* O bloco, ou NULL se nao couber.
+ */
+void *adfgvx_workspace_alloc(adfgvx_workspace *ws, size_t size);
+
+/**
+ * @brief Posicao atual da arena, para devolver depois com adfgvx_workspace_release.
+ */
+size_t adfgvx_workspace_mark(const adfgvx_workspace *ws);
+
+/**
+ * @brief Devolve tudo o que foi reservado depois de mark (os blocos deixam de ser validos).
+ */
+void adfgvx_workspace_release(adfgvx_workspace *ws, size_t mark);
+
+/**
+ * @brief Libera a arena do heap (no modo fixo, apenas a esvazia).
+ */
+void adfgvx_workspace_free(adfgvx_workspace *ws);
+
+#endif // ADFGVX_WORKSPACE_H
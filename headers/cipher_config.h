@@ -4,8 +4,86 @@
 // Define o comprimento máximo da mensagem a ser lida.
 #define MAX_MESSAGE_LENGTH 2560
 
-// Define o comprimento máximo da chave (8 caracteres + 1 para o terminador nulo '\0').
-#define MAX_KEY_LENGTH 9
+// Define o comprimento máximo da chave (4096 caracteres + 1 para o terminador nulo '\0').
+// As tabelas da chave ficam no heap (adfgvx_key_ctx); ver também ADFGVX_KEY_STACK_COLUMNS.
+#define MAX_KEY_LENGTH 4097
+
+// Maior numero de chaves de transposicao aplicadas em sequencia (rodadas, ex: a dupla
+// transposicao com --round-key); as rodadas sao compostas num unico mapa (adfgvx_rounds_map).
+#define ADFGVX_MAX_ROUNDS 8
+
+// Maior periodo (produto dos comprimentos das chaves) com que as rodadas viram uma unica
+// transposicao de colunas virtuais (adfgvx_rounds_map). Cada coluna virtual custa uma
+// posicao no mapa e ADFGVX_TILE_ROWS bytes no ladrilho (18 MiB no maximo). Acima dele, as
+// rodadas sao feitas uma a uma (uma passagem por chave), com buffers auxiliares do tamanho
+// do texto cifrado (um na cifragem, dois na decifragem).
+#define ADFGVX_ROUNDS_MAX_PERIOD (1 << 18)
+
+// Tamanho (em bytes) do buffer em memoria de cada coluna nos contextos de fluxo
+// (streaming). O consumo de memoria da cifragem em fluxo e key_length * este valor.
+#define ADFGVX_STREAM_BUFFER_SIZE 65536
+
+// Maior chave aceita pelos contextos de fluxo, que mantem um buffer (e, na cifragem, um
+// arquivo temporario) por coluna. Com chaves maiores as ferramentas usam o caminho em memoria.
+#define ADFGVX_STREAM_MAX_KEY_LENGTH 64
+
+// Tamanho (em bytes) dos blocos lidos dos arquivos de entrada pelas ferramentas.
+#define ADFGVX_IO_CHUNK_SIZE (1024 * 1024)
+
+// Tamanho minimo (em bytes) de uma mensagem para que as ferramentas a dividam entre
+// varias threads (--threads); abaixo disso o custo de sincronizacao nao compensa.
+#define ADFGVX_PARALLEL_THRESHOLD (4 * 1024 * 1024)
+
+// Numero de trechos por thread nas versoes paralelas (equilibra a carga entre as threads).
+#define ADFGVX_PARALLEL_CHUNKS_PER_THREAD 4
+
+// Tamanho (em bytes) do texto cifrado a partir do qual a transposicao por ladrilhos grava
+// sem passar pela cache, quando o sistema nao informa o tamanho da cache de ultimo nivel.
+#define ADFGVX_TRANSPOSE_STREAM_THRESHOLD (32 * 1024 * 1024)
+
+// Tamanho (em bytes) dos blocos de linhas lidos no modo de registros (--lines);
+// cresce automaticamente se uma unica linha for maior.
+#define ADFGVX_RECORD_BLOCK_SIZE (4 * 1024 * 1024)
+
+// Caracteres da mensagem por bloco no formato em blocos (--container). Cada bloco e
+// transposto de forma independente; a memoria da escrita e da leitura e cerca de
+// 3 * este valor por thread.
+#define ADFGVX_CONTAINER_BLOCK_SIZE (1024 * 1024)
+
+// Modo filtro (-e / -d): bytes lidos por bloco do pipeline e blocos em transito entre os
+// estagios de leitura, cifragem e escrita (com 3, cada estagio trabalha num bloco).
+#define ADFGVX_PIPELINE_BLOCK_SIZE (1024 * 1024)
+#define ADFGVX_PIPELINE_QUEUE_DEPTH 4
+
+// Servico local (--serve): maximo de requisicoes por lote, espera por mais requisicoes
+// antes de fechar um lote incompleto (0: o lote leva o que ja estiver na fila, entao so
+// junta as requisicoes que chegam enquanto o lote anterior e processado), chaves com a
+// agenda guardada, maior conteudo aceito por requisicao e intervalo em que o servico
+// verifica se deve parar.
+#define ADFGVX_SERVICE_BATCH_SIZE 64
+#define ADFGVX_SERVICE_BATCH_WAIT_US 0
+#define ADFGVX_SERVICE_KEY_CACHE 64
+#define ADFGVX_SERVICE_MAX_PAYLOAD (64 * 1024 * 1024)
+#define ADFGVX_SERVICE_POLL_MS 100
+
+// Requisicoes e bytes (conteudo e espaco da resposta) sem resposta escrita por conexao:
+// acima disso a conexao deixa de ser lida ate o cliente ler respostas (uma requisicao
+// sozinha passa mesmo acima do limite de bytes). Ao parar, o servico espera ate
+// ADFGVX_SERVICE_DRAIN_MS os clientes lerem as respostas pendentes.
+#define ADFGVX_SERVICE_CONNECTION_REQUESTS 64
+#define ADFGVX_SERVICE_CONNECTION_BYTES (64 * 1024 * 1024)
+#define ADFGVX_SERVICE_DRAIN_MS 1000
+
+// Recuperacao de chave: caracteres decifrados e pontuados antes de decifrar um candidato
+// inteiro, e margem (em log10 por trigrama) abaixo do pior candidato guardado a partir da
+// qual o candidato e descartado sem a decifragem completa.
+#define ADFGVX_KEY_SEARCH_PREFIX 120
+#define ADFGVX_KEY_SEARCH_ABORT_MARGIN 0.1
+
+// Solucionador da matriz Polybius: trocas avaliadas por reinicio e temperatura inicial do
+// recozimento (em log10, por 1000 caracteres do texto).
+#define ADFGVX_SQUARE_SEARCH_ITERATIONS 200000
+#define ADFGVX_SQUARE_SEARCH_TEMPERATURE 10.0
 
 // Nomes de arquivo padrão.
 #define DEFAULT_KEY_FILE "./key.txt"
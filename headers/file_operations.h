@@ -1,40 +1,186 @@
-#ifndef FILE_OPERATIONS_H
-#define FILE_OPERATIONS_H
-
-#include "cipher_config.h" // Para MAX_MESSAGE_LENGTH
-
-/**
- * @brief Le o conteudo de um arquivo em um buffer.
- * Remove o caractere de nova linha ('\n' ou '\r\n') se presente no final.
- *
- * @param filename Caminho para o arquivo a ser lido.
- * @param buffer Buffer onde o conteudo sera armazenado.
- * @param max_length Tamanho maximo permitido do buffer (incluindo espaco para '\0').
- * @return int 0 em caso de sucesso, 1 se erro ao abrir o arquivo, 2 se fgets falhar ou ler nada.
- */
-int read_file(const char *filename, char *buffer, int max_length);
-
-/**
- * @brief Escreve a matriz de simbolos cifrados em um arquivo.
- *
- * @param filename Caminho para o arquivo onde a saida sera escrita.
- * @param key_length Comprimento da chave (que corresponde ao numero de colunas na matriz).
- * @param encoded_symbol_matrix Matriz [key_length][MAX_MESSAGE_LENGTH] contendo os simbolos cifrados.
- * @param symbols_per_column Vetor indicando quantos simbolos validos existem em cada coluna da matriz.
- * @return int 0 em caso de sucesso, 1 se erro ao abrir ou escrever no arquivo.
- */
-int write_encrypted_data_to_file(const char *filename,
-                                 int key_length,
-                                 char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH],
-                                 int symbols_per_column[]);
-
-/**
- * @brief Escreve uma string de texto plano (como a mensagem decifrada) em um arquivo.
- *
- * @param filename Caminho para o arquivo onde o texto sera escrito.
- * @param plaintext_message String contendo a mensagem a ser escrita.
- * @return int 0 em caso de sucesso, 1 se erro ao abrir ou escrever no arquivo.
- */
-int write_plaintext_to_file(const char *filename, const char *plaintext_message);
-
-#endif // FILE_OPERATIONS_H
+#ifndef FILE_OPERATIONS_H
+#define FILE_OPERATIONS_H
+
+#include <stdio.h>  // Para FILE
+#include <stddef.h> // Para size_t
+
+#include "cipher_config.h" // Para MAX_MESSAGE_LENGTH
+
+/**
+ * @brief Le o conteudo de um arquivo em um buffer.
+ * Remove o caractere de nova linha ('\n' ou '\r\n') se presente no final.
+ *
+ * @param filename Caminho para o arquivo a ser lido.
+ * @param buffer Buffer onde o conteudo sera armazenado.
+ * @param max_length Tamanho maximo permitido do buffer (incluindo espaco para '\0').
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir o arquivo, 2 se fgets falhar ou ler nada.
+ */
+int read_file(const char *filename, char *buffer, int max_length);
+
+/**
+ * @brief Escreve a matriz de simbolos cifrados em um arquivo.
+ *
+ * @param filename Caminho para o arquivo onde a saida sera escrita.
+ * @param key_length Comprimento da chave (que corresponde ao numero de colunas na matriz).
+ * @param encoded_symbol_matrix Matriz [key_length][MAX_MESSAGE_LENGTH] contendo os simbolos cifrados.
+ * @param symbols_per_column Vetor indicando quantos simbolos validos existem em cada coluna da matriz.
+ * @param column_order Ordem de leitura das colunas, como produzida por cipher_adfgvx.
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir ou escrever no arquivo.
+ */
+int write_encrypted_data_to_file(const char *filename,
+                                 int key_length,
+                                 char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH],
+                                 int symbols_per_column[],
+                                 int column_order[]);
+
+/**
+ * @brief Escreve uma string de texto plano (como a mensagem decifrada) em um arquivo.
+ *
+ * @param filename Caminho para o arquivo onde o texto sera escrito.
+ * @param plaintext_message String contendo a mensagem a ser escrita.
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir ou escrever no arquivo.
+ */
+int write_plaintext_to_file(const char *filename, const char *plaintext_message);
+
+/**
+ * @brief Funcao chamada para cada bloco lido por read_file_in_chunks.
+ *
+ * @param user Ponteiro repassado sem alteracao por read_file_in_chunks.
+ * @param chunk Bloco lido (nao terminado em nulo).
+ * @param length Numero de bytes em chunk.
+ * @return int 0 para continuar a leitura, diferente de 0 para interrompe-la.
+ */
+typedef int (*chunk_consumer)(void *user, const char *chunk, size_t length);
+
+/**
+ * @brief Le um arquivo inteiro, de qualquer tamanho, em blocos de chunk_size bytes,
+ * entregando cada bloco a consumer. Diferente de read_file, nao para na primeira
+ * linha nem trunca o conteudo.
+ *
+ * @param filename Caminho para o arquivo a ser lido.
+ * @param chunk_size Tamanho maximo de cada bloco (ex: ADFGVX_IO_CHUNK_SIZE).
+ * @param consumer Funcao chamada para cada bloco.
+ * @param user Ponteiro repassado a consumer.
+ * @param total_read Se nao for NULL, recebe o numero total de bytes lidos.
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir o arquivo, 2 se erro de leitura
+ * ou de memoria, 3 se consumer interromper a leitura.
+ */
+int read_file_in_chunks(const char *filename,
+                        size_t chunk_size,
+                        chunk_consumer consumer,
+                        void *user,
+                        unsigned long long *total_read);
+
+/**
+ * @brief Le um arquivo inteiro para um buffer alocado com malloc (usado pelos modos
+ * paralelos, que precisam da mensagem completa em memoria).
+ *
+ * @param filename Caminho para o arquivo a ser lido.
+ * @param buffer Recebe o buffer alocado (liberar com free); nao e terminado em nulo.
+ * @param length Recebe o numero de bytes lidos.
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir o arquivo, 2 se erro de leitura
+ * ou de memoria.
+ */
+int read_whole_file(const char *filename, char **buffer, size_t *length);
+
+/**
+ * @brief Grava length bytes de data num arquivo (modo binario, sem acrescentar nada).
+ *
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir o arquivo, 2 se erro de escrita.
+ */
+int write_buffer_to_file(const char *filename, const char *data, size_t length);
+
+// 1 se map_input_file / map_output_file usam mmap (sistemas POSIX); 0 se usam a
+// alternativa com buffers em memoria e leituras/escritas em blocos grandes.
+// Pode ser forcado na compilacao (ex: -DFILE_OPERATIONS_HAVE_MMAP=0).
+#ifndef FILE_OPERATIONS_HAVE_MMAP
+#ifdef _WIN32
+#define FILE_OPERATIONS_HAVE_MMAP 0
+#else
+#define FILE_OPERATIONS_HAVE_MMAP 1
+#endif
+#endif
+
+/**
+ * @brief Arquivo acessado diretamente como um bloco de memoria.
+ * O chamador le (ou escreve) data[0 .. length - 1]; os demais campos sao geridos por
+ * map_input_file, map_output_file e close_mapped_file.
+ */
+typedef struct
+{
+    char *data;     // Conteudo do arquivo (NULL se length == 0).
+    size_t length;  // Tamanho do mapeamento, em bytes.
+    int writable;   // 1 para arquivos de saida.
+    int mapped;     // 1 se data aponta para paginas mapeadas; 0 se para um buffer alocado.
+    int fd;         // Descritor do arquivo mapeado (-1 se nao houver).
+    FILE *stream;   // Arquivo de saida da alternativa sem mmap (NULL se nao houver).
+} mapped_file;
+
+/**
+ * @brief Mapeia um arquivo de entrada inteiro para leitura, sem copia-lo.
+ * Sem mmap (ou se o arquivo nao puder ser mapeado, ex: um pipe), o arquivo e lido para
+ * um buffer com read_whole_file.
+ *
+ * @param filename Caminho para o arquivo a ser lido.
+ * @param file Recebe o mapeamento; liberar com close_mapped_file.
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir o arquivo, 2 se erro de leitura,
+ * de mapeamento ou de memoria.
+ */
+int map_input_file(const char *filename, mapped_file *file);
+
+/**
+ * @brief Cria (ou trunca) um arquivo de saida com length bytes e o mapeia para escrita,
+ * para que o resultado seja gravado diretamente nas paginas do arquivo.
+ * Sem mmap, data aponta para um buffer alocado que e gravado por close_mapped_file.
+ *
+ * @param filename Caminho para o arquivo a ser escrito.
+ * @param length Tamanho maximo da saida (ex: o comprimento conhecido do texto cifrado).
+ * @param file Recebe o mapeamento; liberar com close_mapped_file.
+ * @return int 0 em caso de sucesso, 1 se erro ao criar o arquivo, 2 se erro ao
+ * dimensiona-lo, mapea-lo ou alocar o buffer.
+ */
+int map_output_file(const char *filename, size_t length, mapped_file *file);
+
+/**
+ * @brief Libera um mapeamento. Para arquivos de saida, o arquivo fica com final_length
+ * bytes (no maximo o length do mapeamento); para arquivos de entrada, final_length e ignorado.
+ *
+ * @return int 0 em caso de sucesso, 2 se a escrita ou o ajuste do tamanho falhar.
+ */
+int close_mapped_file(mapped_file *file, size_t final_length);
+
+/**
+ * @brief Retorna o tamanho de um arquivo aberto, sem mudar a posicao de leitura.
+ *
+ * @return int 0 em caso de sucesso, 2 se o tamanho nao puder ser obtido.
+ */
+int get_file_size(FILE *stream, size_t *size);
+
+/**
+ * @brief Leitura posicionada: le length bytes a partir de offset (pread nos sistemas
+ * POSIX; fseek + fread no Windows), para acessar trechos de um arquivo grande sem le-lo
+ * inteiro.
+ *
+ * @return int 0 em caso de sucesso, 2 se erro de leitura ou se o arquivo terminar antes
+ * de length bytes.
+ */
+int read_file_at(FILE *stream, size_t offset, char *buffer, size_t length);
+
+/**
+ * @brief Le a primeira linha de um descritor de arquivo ja aberto (ex: a chave recebida
+ * por um pipe no modo filtro, --key-fd), como read_file: sem o '\n' ou '\r\n' do fim.
+ * O descritor nao e fechado; nada alem da primeira linha e consumido.
+ *
+ * @return int 0 em caso de sucesso, 1 se erro de leitura, 2 se nada for lido.
+ */
+int read_line_from_fd(int fd, char *buffer, int max_length);
+
+/**
+ * @brief Coloca stream em modo binario (no Windows, stdin e stdout abrem em modo texto e
+ * converteriam "\r\n"; nos outros sistemas nao faz nada).
+ *
+ * @return int 0 em caso de sucesso, 1 se o modo nao puder ser mudado.
+ */
+int set_binary_mode(FILE *stream);
+
+#endif // FILE_OPERATIONS_H
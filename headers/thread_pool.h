@@ -0,0 +1,52 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stddef.h> // Para size_t
+
+/**
+ * @brief Pool de threads (pthreads) reutilizavel.
+ * As threads sao criadas uma vez e ficam esperando trabalho; cada chamada a
+ * thread_pool_run distribui um conjunto de tarefas entre elas e a thread chamadora.
+ */
+typedef struct thread_pool thread_pool;
+
+/**
+ * @brief Funcao executada para cada tarefa de thread_pool_run.
+ *
+ * @param user Ponteiro repassado sem alteracao por thread_pool_run.
+ * @param task_index Indice da tarefa (0 .. task_count - 1).
+ */
+typedef void (*thread_pool_task)(void *user, size_t task_index);
+
+/**
+ * @brief Cria um pool com thread_count threads no total (a thread chamadora conta como uma;
+ * sao criadas thread_count - 1 threads auxiliares).
+ *
+ * @param thread_count Numero de threads; valores menores que 1 sao tratados como 1.
+ * @return thread_pool* O pool, ou NULL se faltar memoria ou a criacao das threads falhar.
+ */
+thread_pool *thread_pool_create(int thread_count);
+
+/**
+ * @brief Executa task para cada indice de 0 a task_count - 1, distribuindo as tarefas
+ * entre as threads do pool, e retorna apenas quando todas terminarem.
+ * Nao deve ser chamada ao mesmo tempo por duas threads com o mesmo pool.
+ */
+void thread_pool_run(thread_pool *pool, size_t task_count, thread_pool_task task, void *user);
+
+/**
+ * @brief Retorna o numero total de threads do pool (incluindo a chamadora).
+ */
+int thread_pool_size(const thread_pool *pool);
+
+/**
+ * @brief Encerra as threads auxiliares e libera o pool. Aceita NULL.
+ */
+void thread_pool_destroy(thread_pool *pool);
+
+/**
+ * @brief Retorna o numero de processadores disponiveis (pelo menos 1).
+ */
+int thread_pool_cpu_count(void);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,334 @@
+#include "adfgvx_codec.h"
+#include <pthread.h> // Para pthread_once
+#include <string.h>  // Para memset
+
+// Os kernels vetoriais so existem em x86 com GCC/Clang (atributo target e
+// __builtin_cpu_supports); nas demais plataformas fica apenas o kernel escalar.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADFGVX_CODEC_X86_SIMD 1
+#include <immintrin.h>
+#else
+#define ADFGVX_CODEC_X86_SIMD 0
+#endif
+
+// Constantes da cifra ADFGVX: definicao unica, usada pela cifragem e pela decifragem.
+
+const char adfgvx_symbols[ADFGVX_SYMBOL_COUNT] = {'A', 'D', 'F', 'G', 'V', 'X'};
+const char adfgvx_square_cells[ADFGVX_SYMBOL_COUNT * ADFGVX_SYMBOL_COUNT] = {
+    'A', 'B', 'C', 'D', 'E', 'F',
+    'G', 'H', 'I', 'J', 'K', 'L',
+    'M', 'N', 'O', 'P', 'Q', 'R',
+    'S', 'T', 'U', 'V', 'W', 'X',
+    'Y', 'Z', ' ', ',', '.', '1',
+    '2', '3', '4', '5', '6', '7'};
+
+char adfgvx_encode_table[256][2];
+unsigned char adfgvx_symbol_value[256];
+
+static pthread_once_t codec_once = PTHREAD_ONCE_INIT;
+static adfgvx_encode_kernel active_kernel = ADFGVX_KERNEL_SCALAR;
+
+#if ADFGVX_CODEC_X86_SIMD
+// Tabelas dos kernels vetoriais, geradas em adfgvx_codec_init.
+//
+// nibble_table[h][l] descreve o caractere (h << 4) | l: 0 se ele nao pertence a matriz,
+// ou 0x40 | (linha << 3) | coluna. Cada linha da tabela e consultada com pshufb usando o
+// nibble baixo; so os nibbles altos que tem algum caractere valido sao percorridos.
+static unsigned char nibble_table[8][16];
+static int active_nibbles[8];
+static int active_nibble_count = 0;
+static int simd_usable = 0; // 0 se a matriz tiver bytes >= 0x80 (fora do alcance das tabelas).
+
+// pack_table[m] e a mascara de pshufb que junta a esquerda os pares (16 bits) validos
+// de um vetor de 8 pares, sendo m a mascara de validade desses 8 pares.
+static unsigned char pack_table[256][16];
+#endif
+
+/**
+ * @brief Kernel escalar: referencia exata para os kernels vetoriais.
+ */
+static size_t encode_symbols_scalar(const char *input, size_t length, char *symbols)
+{
+    size_t produced = 0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        const char *pair = adfgvx_encode_table[(unsigned char)input[i]];
+
+        if (pair[0] != 0)
+        {
+            symbols[produced] = pair[0];
+            symbols[produced + 1] = pair[1];
+            produced += 2;
+        }
+    }
+    return produced;
+}
+
+#if ADFGVX_CODEC_X86_SIMD
+/**
+ * @brief Junta a esquerda os pares validos de 8 pares e os grava em out.
+ * Grava sempre 16 bytes; retorna quantos deles sao validos.
+ */
+__attribute__((target("ssse3")))
+static size_t store_packed_pairs(char *out, __m128i pairs, unsigned mask)
+{
+    __m128i shuffle = _mm_loadu_si128((const __m128i *)pack_table[mask]);
+
+    _mm_storeu_si128((__m128i *)out, _mm_shuffle_epi8(pairs, shuffle));
+    return 2 * (size_t)__builtin_popcount(mask);
+}
+
+/**
+ * @brief Kernel SSSE3: 16 bytes de entrada por iteracao.
+ *
+ * As gravacoes de 16 bytes de store_packed_pairs nunca passam de 2 * length: antes de
+ * cada grupo de 8 pares, no maximo 2 * (bytes ja lidos) simbolos foram produzidos.
+ */
+__attribute__((target("ssse3")))
+static size_t encode_symbols_ssse3(const char *input, size_t length, char *symbols)
+{
+    const __m128i low_nibble = _mm_set1_epi8(0x0F);
+    const __m128i three_bits = _mm_set1_epi8(0x07);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i symbol_lookup = _mm_setr_epi8(adfgvx_symbols[0], adfgvx_symbols[1], adfgvx_symbols[2],
+                                                adfgvx_symbols[3], adfgvx_symbols[4], adfgvx_symbols[5],
+                                                0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t produced = 0;
+    size_t i = 0;
+
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i bytes = _mm_loadu_si128((const __m128i *)(input + i));
+        __m128i lo = _mm_and_si128(bytes, low_nibble);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(bytes, 4), low_nibble);
+        __m128i cells = zero;
+
+        for (int n = 0; n < active_nibble_count; n++)
+        {
+            int h = active_nibbles[n];
+            __m128i table = _mm_loadu_si128((const __m128i *)nibble_table[h]);
+            __m128i match = _mm_cmpeq_epi8(hi, _mm_set1_epi8((char)h));
+
+            cells = _mm_or_si128(cells, _mm_and_si128(match, _mm_shuffle_epi8(table, lo)));
+        }
+
+        unsigned valid = ~(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(cells, zero)) & 0xFFFF;
+        __m128i row = _mm_shuffle_epi8(symbol_lookup, _mm_and_si128(_mm_srli_epi16(cells, 3), three_bits));
+        __m128i col = _mm_shuffle_epi8(symbol_lookup, _mm_and_si128(cells, three_bits));
+
+        produced += store_packed_pairs(symbols + produced, _mm_unpacklo_epi8(row, col), valid & 0xFF);
+        produced += store_packed_pairs(symbols + produced, _mm_unpackhi_epi8(row, col), valid >> 8);
+    }
+
+    return produced + encode_symbols_scalar(input + i, length - i, symbols + produced);
+}
+
+/**
+ * @brief Kernel AVX2: 32 bytes de entrada por iteracao.
+ * vpshufb e os unpack trabalham por metade de 128 bits, por isso os quatro grupos de
+ * 8 pares sao gravados na ordem lo[0], hi[0], lo[1], hi[1].
+ */
+__attribute__((target("avx2")))
+static size_t encode_symbols_avx2(const char *input, size_t length, char *symbols)
+{
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    const __m256i three_bits = _mm256_set1_epi8(0x07);
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i symbol_lookup = _mm256_setr_epi8(adfgvx_symbols[0], adfgvx_symbols[1], adfgvx_symbols[2],
+                                                   adfgvx_symbols[3], adfgvx_symbols[4], adfgvx_symbols[5],
+                                                   0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                   adfgvx_symbols[0], adfgvx_symbols[1], adfgvx_symbols[2],
+                                                   adfgvx_symbols[3], adfgvx_symbols[4], adfgvx_symbols[5],
+                                                   0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    size_t produced = 0;
+    size_t i = 0;
+
+    for (; i + 32 <= length; i += 32)
+    {
+        __m256i bytes = _mm256_loadu_si256((const __m256i *)(input + i));
+        __m256i lo = _mm256_and_si256(bytes, low_nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), low_nibble);
+        __m256i cells = zero;
+
+        for (int n = 0; n < active_nibble_count; n++)
+        {
+            int h = active_nibbles[n];
+            __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)nibble_table[h]));
+            __m256i match = _mm256_cmpeq_epi8(hi, _mm256_set1_epi8((char)h));
+
+            cells = _mm256_or_si256(cells, _mm256_and_si256(match, _mm256_shuffle_epi8(table, lo)));
+        }
+
+        unsigned valid = ~(unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(cells, zero));
+        __m256i row = _mm256_shuffle_epi8(symbol_lookup, _mm256_and_si256(_mm256_srli_epi16(cells, 3), three_bits));
+        __m256i col = _mm256_shuffle_epi8(symbol_lookup, _mm256_and_si256(cells, three_bits));
+        __m256i pairs_lo = _mm256_unpacklo_epi8(row, col);
+        __m256i pairs_hi = _mm256_unpackhi_epi8(row, col);
+
+        produced += store_packed_pairs(symbols + produced, _mm256_castsi256_si128(pairs_lo), valid & 0xFF);
+        produced += store_packed_pairs(symbols + produced, _mm256_castsi256_si128(pairs_hi), (valid >> 8) & 0xFF);
+        produced += store_packed_pairs(symbols + produced, _mm256_extracti128_si256(pairs_lo, 1), (valid >> 16) & 0xFF);
+        produced += store_packed_pairs(symbols + produced, _mm256_extracti128_si256(pairs_hi, 1), valid >> 24);
+    }
+
+    return produced + encode_symbols_ssse3(input + i, length - i, symbols + produced);
+}
+
+/**
+ * @brief Gera as tabelas dos kernels vetoriais a partir da tabela de cifragem.
+ */
+static void build_simd_tables(void)
+{
+    memset(nibble_table, 0, sizeof(nibble_table));
+    active_nibble_count = 0;
+    simd_usable = 1;
+
+    for (int i = 0; i < ADFGVX_SYMBOL_COUNT * ADFGVX_SYMBOL_COUNT; i++)
+    {
+        if ((unsigned char)adfgvx_square_cells[i] >= 0x80 || adfgvx_square_cells[i] == 0)
+        {
+            simd_usable = 0;
+        }
+    }
+
+    for (int c = 1; c < 0x80; c++)
+    {
+        if (adfgvx_encode_table[c][0] != 0)
+        {
+            unsigned row = adfgvx_symbol_value[(unsigned char)adfgvx_encode_table[c][0]];
+            unsigned col = adfgvx_symbol_value[(unsigned char)adfgvx_encode_table[c][1]];
+
+            nibble_table[c >> 4][c & 0x0F] = (unsigned char)(0x40 | (row << 3) | col);
+        }
+    }
+
+    for (int h = 0; h < 8; h++)
+    {
+        for (int l = 0; l < 16; l++)
+        {
+            if (nibble_table[h][l] != 0)
+            {
+                active_nibbles[active_nibble_count++] = h;
+                break;
+            }
+        }
+    }
+
+    for (int mask = 0; mask < 256; mask++)
+    {
+        int out = 0;
+
+        memset(pack_table[mask], 0x80, 16); // pshufb grava zero nas posicoes com o bit alto.
+        for (int pair = 0; pair < 8; pair++)
+        {
+            if (mask & (1 << pair))
+            {
+                pack_table[mask][out++] = (unsigned char)(2 * pair);
+                pack_table[mask][out++] = (unsigned char)(2 * pair + 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Indica se a CPU e as tabelas permitem usar o kernel.
+ */
+static int kernel_supported(adfgvx_encode_kernel kernel)
+{
+    __builtin_cpu_init();
+    switch (kernel)
+    {
+    case ADFGVX_KERNEL_SCALAR:
+        return 1;
+    case ADFGVX_KERNEL_SSSE3:
+        return simd_usable && __builtin_cpu_supports("ssse3");
+    case ADFGVX_KERNEL_AVX2:
+        return simd_usable && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("ssse3");
+    }
+    return 0;
+}
+#else
+static int kernel_supported(adfgvx_encode_kernel kernel)
+{
+    return kernel == ADFGVX_KERNEL_SCALAR;
+}
+#endif
+
+static void build_codec(void)
+{
+    memset(adfgvx_encode_table, 0, sizeof(adfgvx_encode_table));
+    memset(adfgvx_symbol_value, ADFGVX_CODEC_INVALID, sizeof(adfgvx_symbol_value));
+
+    for (int i = 0; i < ADFGVX_SYMBOL_COUNT; i++)
+    {
+        adfgvx_symbol_value[(unsigned char)adfgvx_symbols[i]] = (unsigned char)i;
+
+        for (int j = 0; j < ADFGVX_SYMBOL_COUNT; j++)
+        {
+            unsigned char c = (unsigned char)adfgvx_square_cells[i * ADFGVX_SYMBOL_COUNT + j];
+
+            // Se um caractere aparecesse duas vezes, a busca linear antiga ficaria com a
+            // primeira ocorrencia; a tabela faz o mesmo.
+            if (adfgvx_encode_table[c][0] == 0)
+            {
+                adfgvx_encode_table[c][0] = adfgvx_symbols[i];
+                adfgvx_encode_table[c][1] = adfgvx_symbols[j];
+            }
+        }
+    }
+
+#if ADFGVX_CODEC_X86_SIMD
+    build_simd_tables();
+#endif
+
+    // Seleciona o kernel mais rapido suportado.
+    active_kernel = ADFGVX_KERNEL_SCALAR;
+    if (kernel_supported(ADFGVX_KERNEL_AVX2))
+    {
+        active_kernel = ADFGVX_KERNEL_AVX2;
+    }
+    else if (kernel_supported(ADFGVX_KERNEL_SSSE3))
+    {
+        active_kernel = ADFGVX_KERNEL_SSSE3;
+    }
+}
+
+void adfgvx_codec_init(void)
+{
+    // As funcoes de cifragem chamam esta funcao de varias threads ao mesmo tempo; o
+    // pthread_once garante que as tabelas sao montadas uma vez e vistas completas por todas.
+    pthread_once(&codec_once, build_codec);
+}
+
+int adfgvx_codec_select_kernel(adfgvx_encode_kernel kernel)
+{
+    adfgvx_codec_init();
+    if (!kernel_supported(kernel))
+    {
+        return 1;
+    }
+    active_kernel = kernel;
+    return 0;
+}
+
+adfgvx_encode_kernel adfgvx_codec_active_kernel(void)
+{
+    adfgvx_codec_init();
+    return active_kernel;
+}
+
+size_t adfgvx_encode_symbols(const char *input, size_t length, char *symbols)
+{
+    switch (active_kernel)
+    {
+#if ADFGVX_CODEC_X86_SIMD
+    case ADFGVX_KERNEL_AVX2:
+        return encode_symbols_avx2(input, length, symbols);
+    case ADFGVX_KERNEL_SSSE3:
+        return encode_symbols_ssse3(input, length, symbols);
+#endif
+    default:
+        return encode_symbols_scalar(input, length, symbols);
+    }
+}
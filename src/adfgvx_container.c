@@ -0,0 +1,743 @@
+#include "adfgvx_container.h"
+#include "adfgvx_codec.h"     // Para adfgvx_encode_char e adfgvx_symbol_value
+#include "adfgvx_core.h"      // Para cipher_adfgvx_batch
+#include "adfgvx_decipher.h"  // Para decipher_adfgvx_direct_ctx e decipher_adfgvx_batch
+#include "file_operations.h"  // Para get_file_size e read_file_at
+#include "adfgvx_stats.h"      // Para a medicao da escrita (--stats)
+#include <stdlib.h>           // Para malloc, realloc e free
+#include <string.h>           // Para memcmp e memcpy
+
+/**
+ * @brief Grava value em little-endian nos bytes bytes de buffer.
+ * (Funcao auxiliar estatica)
+ */
+static void put_le(unsigned char *buffer, unsigned long long value, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+    {
+        buffer[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/**
+ * @brief Le um inteiro little-endian de bytes bytes de buffer.
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long long get_le(const unsigned char *buffer, int bytes)
+{
+    unsigned long long value = 0;
+
+    for (int i = bytes - 1; i >= 0; i--)
+    {
+        value = (value << 8) | buffer[i];
+    }
+    return value;
+}
+
+/**
+ * @brief Destino padrao do contexto de escrita: grava os bytes no arquivo de saida.
+ * (Funcao auxiliar estatica, usada como adfgvx_container_sink)
+ */
+static int file_sink(void *user, const char *data, size_t length)
+{
+    ADFGVX_STATS_BEGIN(stage_start);
+    int status = fwrite(data, 1, length, (FILE *)user) == length ? 0 : 1;
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, length);
+    return status;
+}
+
+/**
+ * @brief Estado compartilhado pelas tarefas que cifram ou decifram os blocos de um lote.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    const adfgvx_key_ctx *key_ctx;
+    adfgvx_batch_item *items;
+    int decrypt;
+} container_job;
+
+/**
+ * @brief Cifra ou decifra um bloco do lote.
+ * (Funcao auxiliar estatica, executada pelas threads do pool)
+ */
+static void container_task(void *user, size_t task)
+{
+    container_job *job = user;
+
+    if (job->decrypt)
+    {
+        decipher_adfgvx_batch(job->key_ctx, job->items + task, 1);
+    }
+    else
+    {
+        cipher_adfgvx_batch(job->key_ctx, job->items + task, 1);
+    }
+}
+
+/**
+ * @brief Processa os count blocos de um lote, em paralelo se houver pool.
+ * (Funcao auxiliar estatica)
+ */
+static void run_batch(const adfgvx_key_ctx *key_ctx, adfgvx_batch_item *items, size_t count, int decrypt, thread_pool *pool)
+{
+    container_job job;
+
+    job.key_ctx = key_ctx;
+    job.items = items;
+    job.decrypt = decrypt;
+    if (thread_pool_size(pool) > 1 && count > 1)
+    {
+        thread_pool_run(pool, count, container_task, &job);
+        return;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        container_task(&job, i);
+    }
+}
+
+/**
+ * @brief Cifra os caracteres pendentes (blocos de block_size, o ultimo pode ser menor),
+ * escreve os blocos em ordem e os acrescenta ao indice.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria, 3 se houver erro de escrita.
+ */
+static int flush_pending(adfgvx_container_writer *writer)
+{
+    size_t count = (writer->pending_length + writer->block_size - 1) / writer->block_size;
+
+    if (count == 0)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t first = i * writer->block_size;
+        size_t length = writer->pending_length - first < writer->block_size ? writer->pending_length - first : writer->block_size;
+
+        writer->items[i].input = writer->pending + first;
+        writer->items[i].input_length = length;
+        writer->items[i].output = writer->encrypted + 2 * first;
+        writer->items[i].output_capacity = 2 * length;
+        writer->items[i].output_length = 0;
+        writer->items[i].status = 0;
+    }
+    run_batch(writer->key_ctx, writer->items, count, 0, writer->pool);
+
+    if (writer->block_count + count > writer->index_capacity)
+    {
+        size_t capacity = writer->index_capacity * 2;
+        while (capacity < writer->block_count + count)
+        {
+            capacity *= 2;
+        }
+        unsigned long long *index = realloc(writer->index, capacity * 2 * sizeof(unsigned long long));
+        if (index == NULL)
+        {
+            return 2;
+        }
+        writer->index = index;
+        writer->index_capacity = capacity;
+    }
+
+    for (size_t i = 0; i < count; i++)
+    {
+        adfgvx_batch_item *item = &writer->items[i];
+
+        if (item->status != 0 || writer->sink(writer->sink_user, item->output, item->output_length) != 0)
+        {
+            return 3;
+        }
+        writer->index[2 * writer->block_count] = writer->offset;
+        writer->index[2 * writer->block_count + 1] = item->input_length;
+        writer->block_count++;
+        writer->offset += item->output_length;
+    }
+    writer->pending_length = 0;
+    return 0;
+}
+
+/**
+ * @brief Libera os buffers de um contexto de escrita.
+ * (Funcao auxiliar estatica)
+ */
+static void free_writer(adfgvx_container_writer *writer)
+{
+    free(writer->pending);
+    free(writer->encrypted);
+    free(writer->items);
+    free(writer->index);
+    writer->pending = NULL;
+    writer->encrypted = NULL;
+    writer->items = NULL;
+    writer->index = NULL;
+}
+
+int adfgvx_container_writer_init(adfgvx_container_writer *writer,
+                                 FILE *output,
+                                 const adfgvx_key_ctx *key_ctx,
+                                 size_t block_size,
+                                 thread_pool *pool)
+{
+    if (!writer || !output)
+    {
+        return 1;
+    }
+    int status = adfgvx_container_writer_init_sink(writer, file_sink, output, key_ctx, block_size, pool);
+    writer->output = output;
+    return status;
+}
+
+int adfgvx_container_writer_init_sink(adfgvx_container_writer *writer,
+                                      adfgvx_container_sink sink,
+                                      void *sink_user,
+                                      const adfgvx_key_ctx *key_ctx,
+                                      size_t block_size,
+                                      thread_pool *pool)
+{
+    unsigned char header[ADFGVX_CONTAINER_HEADER_SIZE];
+
+    if (!writer || !sink || !key_ctx || block_size == 0)
+    {
+        return 1;
+    }
+
+    writer->sink = sink;
+    writer->sink_user = sink_user;
+    writer->output = NULL;
+    writer->key_ctx = key_ctx;
+    writer->pool = pool;
+    writer->block_size = block_size;
+    writer->batch_blocks = thread_pool_size(pool) > 1 ? (size_t)thread_pool_size(pool) : 1;
+    writer->pending_length = 0;
+    writer->index_capacity = 64;
+    writer->offset = ADFGVX_CONTAINER_HEADER_SIZE;
+    writer->message_length = 0;
+    writer->block_count = 0;
+    writer->status = 0;
+    writer->pending = malloc(writer->batch_blocks * block_size);
+    writer->encrypted = malloc(2 * writer->batch_blocks * block_size);
+    writer->items = malloc(writer->batch_blocks * sizeof(adfgvx_batch_item));
+    writer->index = malloc(writer->index_capacity * 2 * sizeof(unsigned long long));
+    if (!writer->pending || !writer->encrypted || !writer->items || !writer->index)
+    {
+        free_writer(writer);
+        return 2;
+    }
+    adfgvx_codec_init();
+
+    memcpy(header, ADFGVX_CONTAINER_MAGIC, 8);
+    put_le(header + 8, (unsigned long long)key_ctx->key_length, 4);
+    put_le(header + 12, 0, 4);
+    put_le(header + 16, block_size, 8);
+    if (sink(sink_user, (const char *)header, sizeof(header)) != 0)
+    {
+        free_writer(writer);
+        return 3;
+    }
+    return 0;
+}
+
+int adfgvx_container_writer_update(adfgvx_container_writer *writer, const char *chunk, size_t length)
+{
+    size_t capacity = writer->batch_blocks * writer->block_size;
+    char row, col;
+
+    for (size_t i = 0; i < length && writer->status == 0; i++)
+    {
+        if (!adfgvx_encode_char(chunk[i], &row, &col))
+        {
+            continue; // Fora da matriz: ignorado, como na cifragem.
+        }
+        writer->pending[writer->pending_length++] = chunk[i];
+        writer->message_length++;
+        if (writer->pending_length == capacity)
+        {
+            writer->status = flush_pending(writer);
+        }
+    }
+    return writer->status;
+}
+
+int adfgvx_container_writer_final(adfgvx_container_writer *writer)
+{
+    unsigned char entry[ADFGVX_CONTAINER_INDEX_ENTRY_SIZE];
+    unsigned char footer[ADFGVX_CONTAINER_FOOTER_SIZE];
+    unsigned long long index_offset;
+
+    if (writer->status == 0)
+    {
+        writer->status = flush_pending(writer);
+    }
+
+    index_offset = writer->offset;
+    for (size_t i = 0; i < writer->block_count && writer->status == 0; i++)
+    {
+        put_le(entry, writer->index[2 * i], 8);
+        put_le(entry + 8, writer->index[2 * i + 1], 8);
+        if (writer->sink(writer->sink_user, (const char *)entry, sizeof(entry)) != 0)
+        {
+            writer->status = 3;
+        }
+    }
+    if (writer->status == 0)
+    {
+        put_le(footer, writer->message_length, 8);
+        put_le(footer + 8, writer->block_count, 8);
+        put_le(footer + 16, index_offset, 8);
+        memcpy(footer + 24, ADFGVX_CONTAINER_END_MAGIC, 8);
+        if (writer->sink(writer->sink_user, (const char *)footer, sizeof(footer)) != 0 ||
+            (writer->output != NULL && fflush(writer->output) != 0))
+        {
+            writer->status = 3;
+        }
+    }
+
+    free_writer(writer);
+    return writer->status;
+}
+
+/**
+ * @brief Converte um campo de 64 bits do arquivo para size_t.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se o valor nao couber em size_t.
+ */
+static int to_size(unsigned long long value, size_t *result)
+{
+    if (value > (size_t)-1)
+    {
+        return 1;
+    }
+    *result = (size_t)value;
+    return 0;
+}
+
+int adfgvx_container_open(adfgvx_container *container, FILE *input)
+{
+    unsigned char header[ADFGVX_CONTAINER_HEADER_SIZE];
+    unsigned char footer[ADFGVX_CONTAINER_FOOTER_SIZE];
+    size_t file_size = 0, index_offset = 0, expected = ADFGVX_CONTAINER_HEADER_SIZE, total = 0;
+    unsigned long long key_length;
+
+    if (!container || !input)
+    {
+        return 1;
+    }
+    container->input = input;
+    container->blocks = NULL;
+    container->block_count = 0;
+    if (get_file_size(input, &file_size) != 0)
+    {
+        return 2;
+    }
+
+    // Cabecalho: identifica o formato.
+    if (file_size < sizeof(header) || read_file_at(input, 0, (char *)header, sizeof(header)) != 0 ||
+        memcmp(header, ADFGVX_CONTAINER_MAGIC, 8) != 0)
+    {
+        return 3;
+    }
+    key_length = get_le(header + 8, 4);
+    if (key_length == 0 || key_length >= MAX_KEY_LENGTH || to_size(get_le(header + 16, 8), &container->block_size) != 0 ||
+        container->block_size == 0)
+    {
+        return 4;
+    }
+    container->key_length = (int)key_length;
+
+    // Rodape: ausente se o arquivo foi truncado.
+    if (file_size < sizeof(header) + sizeof(footer) ||
+        read_file_at(input, file_size - sizeof(footer), (char *)footer, sizeof(footer)) != 0 ||
+        memcmp(footer + 24, ADFGVX_CONTAINER_END_MAGIC, 8) != 0 ||
+        to_size(get_le(footer, 8), &container->message_length) != 0 ||
+        to_size(get_le(footer + 8, 8), &container->block_count) != 0 ||
+        to_size(get_le(footer + 16, 8), &index_offset) != 0 ||
+        index_offset < sizeof(header) || index_offset > file_size - sizeof(footer) ||
+        container->block_count != (file_size - sizeof(footer) - index_offset) / ADFGVX_CONTAINER_INDEX_ENTRY_SIZE ||
+        (file_size - sizeof(footer) - index_offset) % ADFGVX_CONTAINER_INDEX_ENTRY_SIZE != 0)
+    {
+        container->block_count = 0;
+        return 4;
+    }
+
+    // Indice: os blocos devem ser contiguos, cheios (exceto o ultimo) e terminar no indice.
+    size_t index_size = container->block_count * ADFGVX_CONTAINER_INDEX_ENTRY_SIZE;
+    unsigned char *index = malloc(index_size > 0 ? index_size : 1);
+    container->blocks = malloc((container->block_count > 0 ? container->block_count : 1) * sizeof(adfgvx_container_block));
+    if (!index || !container->blocks || (index_size > 0 && read_file_at(input, index_offset, (char *)index, index_size) != 0))
+    {
+        free(index);
+        adfgvx_container_close(container);
+        return 2;
+    }
+    for (size_t i = 0; i < container->block_count; i++)
+    {
+        adfgvx_container_block *block = &container->blocks[i];
+        int last = i + 1 == container->block_count;
+
+        if (to_size(get_le(index + i * ADFGVX_CONTAINER_INDEX_ENTRY_SIZE, 8), &block->offset) != 0 ||
+            to_size(get_le(index + i * ADFGVX_CONTAINER_INDEX_ENTRY_SIZE + 8, 8), &block->length) != 0 ||
+            block->offset != expected || block->length == 0 || block->length > container->block_size ||
+            (!last && block->length != container->block_size) || block->length > (index_offset - expected) / 2)
+        {
+            free(index);
+            adfgvx_container_close(container);
+            return 4;
+        }
+        expected += 2 * block->length;
+        total += block->length;
+    }
+    free(index);
+    if (expected != index_offset || total != container->message_length)
+    {
+        adfgvx_container_close(container);
+        return 4;
+    }
+    return 0;
+}
+
+int adfgvx_container_decrypt_block(const adfgvx_container *container,
+                                   const adfgvx_key_ctx *key_ctx,
+                                   size_t block,
+                                   char *output,
+                                   size_t output_capacity,
+                                   size_t *output_length)
+{
+    if (!container || !key_ctx || !output || !output_length || block >= container->block_count ||
+        key_ctx->key_length != container->key_length || output_capacity < container->blocks[block].length)
+    {
+        return 1;
+    }
+
+    size_t symbols = 2 * container->blocks[block].length;
+    char *encrypted = malloc(symbols);
+    if (encrypted == NULL)
+    {
+        return 2;
+    }
+    if (read_file_at(container->input, container->blocks[block].offset, encrypted, symbols) != 0)
+    {
+        free(encrypted);
+        return 2;
+    }
+    int status = decipher_adfgvx_direct_ctx(key_ctx, encrypted, symbols, output, output_capacity, output_length);
+    free(encrypted);
+    return status == 0 ? 0 : 3;
+}
+
+int adfgvx_container_decrypt(const adfgvx_container *container,
+                             const adfgvx_key_ctx *key_ctx,
+                             FILE *output,
+                             thread_pool *pool)
+{
+    if (!container || !key_ctx || !output || key_ctx->key_length != container->key_length)
+    {
+        return 1;
+    }
+
+    size_t batch_blocks = thread_pool_size(pool) > 1 ? (size_t)thread_pool_size(pool) : 1;
+    if (batch_blocks > container->block_count)
+    {
+        batch_blocks = container->block_count > 0 ? container->block_count : 1;
+    }
+    char *encrypted = malloc(2 * batch_blocks * container->block_size);
+    char *decrypted = malloc(batch_blocks * container->block_size);
+    adfgvx_batch_item *items = malloc(batch_blocks * sizeof(adfgvx_batch_item));
+    int status = !encrypted || !decrypted || !items ? 2 : 0;
+
+    for (size_t first = 0; first < container->block_count && status == 0; first += batch_blocks)
+    {
+        size_t count = container->block_count - first < batch_blocks ? container->block_count - first : batch_blocks;
+
+        // Leitura em ordem pela thread chamadora; as threads so decifram.
+        for (size_t i = 0; i < count && status == 0; i++)
+        {
+            const adfgvx_container_block *block = &container->blocks[first + i];
+            char *symbols = encrypted + 2 * i * container->block_size;
+
+            items[i].input = symbols;
+            items[i].input_length = 2 * block->length;
+            items[i].output = decrypted + i * container->block_size;
+            items[i].output_capacity = block->length;
+            items[i].output_length = 0;
+            items[i].status = 0;
+            if (read_file_at(container->input, block->offset, symbols, items[i].input_length) != 0)
+            {
+                status = 2;
+            }
+        }
+        if (status != 0)
+        {
+            break;
+        }
+        run_batch(key_ctx, items, count, 1, pool);
+
+        ADFGVX_STATS_BEGIN(stage_start);
+        unsigned long long written = 0;
+        for (size_t i = 0; i < count && status == 0; i++)
+        {
+            if (items[i].status != 0)
+            {
+                status = 3;
+            }
+            else if (fwrite(items[i].output, 1, items[i].output_length, output) != items[i].output_length)
+            {
+                status = 4;
+            }
+            written += items[i].output_length;
+        }
+        ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, written);
+    }
+    if (status == 0 && fflush(output) != 0)
+    {
+        status = 4;
+    }
+
+    free(items);
+    free(decrypted);
+    free(encrypted);
+    return status;
+}
+
+void adfgvx_container_close(adfgvx_container *container)
+{
+    if (container != NULL)
+    {
+        free(container->blocks);
+        container->blocks = NULL;
+        container->block_count = 0;
+    }
+}
+
+int adfgvx_container_reader_init(adfgvx_container_reader *reader,
+                                 adfgvx_container_sink sink,
+                                 void *sink_user,
+                                 const adfgvx_key_ctx *key_ctx,
+                                 thread_pool *pool)
+{
+    if (!reader || !sink || !key_ctx)
+    {
+        return 1;
+    }
+    memset(reader, 0, sizeof(*reader));
+    reader->sink = sink;
+    reader->sink_user = sink_user;
+    reader->key_ctx = key_ctx;
+    reader->pool = pool;
+    reader->batch_blocks = thread_pool_size(pool) > 1 ? (size_t)thread_pool_size(pool) : 1;
+    return 0;
+}
+
+/**
+ * @brief Confere o cabecalho completo e aloca os buffers do lote.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, ou o codigo de erro de adfgvx_container_reader_update.
+ */
+static int start_reader(adfgvx_container_reader *reader)
+{
+    if (memcmp(reader->header, ADFGVX_CONTAINER_MAGIC, 8) != 0)
+    {
+        return 3;
+    }
+    if (to_size(get_le(reader->header + 16, 8), &reader->block_size) != 0 || reader->block_size == 0 ||
+        reader->block_size > (size_t)-1 / (2 * reader->batch_blocks))
+    {
+        return 4;
+    }
+    if (get_le(reader->header + 8, 4) != (unsigned long long)reader->key_ctx->key_length)
+    {
+        return 1;
+    }
+
+    reader->encrypted = malloc(2 * reader->batch_blocks * reader->block_size);
+    reader->decrypted = malloc(reader->batch_blocks * reader->block_size);
+    reader->items = malloc(reader->batch_blocks * sizeof(adfgvx_batch_item));
+    if (!reader->encrypted || !reader->decrypted || !reader->items)
+    {
+        return 2;
+    }
+    adfgvx_codec_init();
+    return 0;
+}
+
+/**
+ * @brief Decifra os simbolos acumulados (blocos de 2 * block_size, o ultimo pode ser
+ * menor) e entrega a mensagem a sink, em ordem.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 4 se algum bloco for invalido, 5 se sink falhar.
+ */
+static int flush_reader(adfgvx_container_reader *reader)
+{
+    size_t block_symbols = 2 * reader->block_size;
+    size_t count = (reader->encrypted_length + block_symbols - 1) / block_symbols;
+
+    if (reader->encrypted_length % 2 != 0)
+    {
+        return 4;
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t first = i * block_symbols;
+        size_t length = reader->encrypted_length - first < block_symbols ? reader->encrypted_length - first : block_symbols;
+
+        reader->items[i].input = reader->encrypted + first;
+        reader->items[i].input_length = length;
+        reader->items[i].output = reader->decrypted + i * reader->block_size;
+        reader->items[i].output_capacity = length / 2;
+        reader->items[i].output_length = 0;
+        reader->items[i].status = 0;
+    }
+    run_batch(reader->key_ctx, reader->items, count, 1, reader->pool);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        adfgvx_batch_item *item = &reader->items[i];
+
+        if (item->status != 0)
+        {
+            return 4;
+        }
+        if (reader->sink(reader->sink_user, item->output, item->output_length) != 0)
+        {
+            return 5;
+        }
+        reader->message_length += item->output_length;
+        reader->block_count++;
+    }
+    reader->encrypted_length = 0;
+    return 0;
+}
+
+/**
+ * @brief Guarda bytes do indice e do rodape.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria, 4 se houver mais bytes do que
+ * o indice e o rodape podem ter.
+ */
+static int append_tail(adfgvx_container_reader *reader, const char *data, size_t length)
+{
+    size_t limit = reader->block_count * ADFGVX_CONTAINER_INDEX_ENTRY_SIZE + ADFGVX_CONTAINER_FOOTER_SIZE;
+
+    if (length > limit - reader->tail_length)
+    {
+        return 4;
+    }
+    if (reader->tail_capacity < limit)
+    {
+        unsigned char *tail = realloc(reader->tail, limit);
+        if (tail == NULL)
+        {
+            return 2;
+        }
+        reader->tail = tail;
+        reader->tail_capacity = limit;
+    }
+    memcpy(reader->tail + reader->tail_length, data, length);
+    reader->tail_length += length;
+    return 0;
+}
+
+int adfgvx_container_reader_update(adfgvx_container_reader *reader, const char *chunk, size_t length)
+{
+    size_t batch_symbols = 2 * reader->batch_blocks * reader->block_size;
+    size_t i = 0;
+
+    while (i < length && reader->status == 0)
+    {
+        if (reader->header_length < ADFGVX_CONTAINER_HEADER_SIZE)
+        {
+            reader->header[reader->header_length++] = (unsigned char)chunk[i++];
+            if (reader->header_length == ADFGVX_CONTAINER_HEADER_SIZE)
+            {
+                reader->status = start_reader(reader);
+                batch_symbols = 2 * reader->batch_blocks * reader->block_size;
+            }
+        }
+        else if (reader->in_tail)
+        {
+            reader->status = append_tail(reader, chunk + i, length - i);
+            i = length;
+        }
+        else
+        {
+            // Area dos blocos: copia os simbolos ate encher o lote ou achar o indice.
+            size_t start = i;
+            while (i < length && reader->encrypted_length + (i - start) < batch_symbols &&
+                   adfgvx_symbol_value[(unsigned char)chunk[i]] != ADFGVX_CODEC_INVALID)
+            {
+                i++;
+            }
+            memcpy(reader->encrypted + reader->encrypted_length, chunk + start, i - start);
+            reader->encrypted_length += i - start;
+            if (reader->encrypted_length == batch_symbols)
+            {
+                reader->status = flush_reader(reader);
+            }
+            else if (i < length)
+            {
+                reader->in_tail = 1;
+                reader->status = flush_reader(reader);
+            }
+        }
+    }
+    return reader->status;
+}
+
+int adfgvx_container_reader_final(adfgvx_container_reader *reader)
+{
+    if (reader->status == 0 && reader->header_length < ADFGVX_CONTAINER_HEADER_SIZE)
+    {
+        reader->status = 3;
+    }
+    if (reader->status == 0 && !reader->in_tail)
+    {
+        reader->status = 4; // A entrada terminou na area dos blocos: sem indice nem rodape.
+    }
+
+    // Indice e rodape: devem descrever exatamente os blocos recebidos.
+    size_t index_size = reader->block_count * ADFGVX_CONTAINER_INDEX_ENTRY_SIZE;
+    unsigned long long offset = ADFGVX_CONTAINER_HEADER_SIZE;
+    unsigned long long total = 0;
+    if (reader->status == 0 && reader->tail_length != index_size + ADFGVX_CONTAINER_FOOTER_SIZE)
+    {
+        reader->status = 4;
+    }
+    for (size_t i = 0; i < reader->block_count && reader->status == 0; i++)
+    {
+        const unsigned char *entry = reader->tail + i * ADFGVX_CONTAINER_INDEX_ENTRY_SIZE;
+        unsigned long long block_length = get_le(entry + 8, 8);
+
+        if (get_le(entry, 8) != offset || block_length == 0 || block_length > reader->block_size ||
+            (i + 1 < reader->block_count && block_length != reader->block_size))
+        {
+            reader->status = 4;
+        }
+        offset += 2 * block_length;
+        total += block_length;
+    }
+    if (reader->status == 0)
+    {
+        const unsigned char *footer = reader->tail + index_size;
+        if (memcmp(footer + 24, ADFGVX_CONTAINER_END_MAGIC, 8) != 0 || get_le(footer, 8) != reader->message_length ||
+            get_le(footer + 8, 8) != reader->block_count || get_le(footer + 16, 8) != offset || total != reader->message_length)
+        {
+            reader->status = 4;
+        }
+    }
+
+    free(reader->encrypted);
+    free(reader->decrypted);
+    free(reader->items);
+    free(reader->tail);
+    reader->encrypted = NULL;
+    reader->decrypted = NULL;
+    reader->items = NULL;
+    reader->tail = NULL;
+    return reader->status;
+}
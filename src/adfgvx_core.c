@@ -1,153 +1,706 @@
-#include "adfgvx_core.h"
-#include <string.h> // Necessário para strlen, se usado (embora key_length seja passado)
-#include <stdio.h>  // Para debugging ou perror, se necessário (geralmente evitado em módulos core)
-
-// Constantes da cifra ADFGVX, encapsuladas neste módulo.
-
-static const char symbols[6] = {'A', 'D', 'F', 'G', 'V', 'X'};
-static const char square[6][6] = {
-    {'A', 'B', 'C', 'D', 'E', 'F'},
-    {'G', 'H', 'I', 'J', 'K', 'L'},
-    {'M', 'N', 'O', 'P', 'Q', 'R'},
-    {'S', 'T', 'U', 'V', 'W', 'X'},
-    {'Y', 'Z', ' ', ',', '.', '1'},
-    {'2', '3', '4', '5', '6', '7'}};
-
-/**
- * @brief Encontra os simbolos ADFGVX correspondentes a um caractere.
- * Função auxiliar estática, interna a este módulo.
- *
- * @param c Caractere a ser cifrado.
- * @param row Ponteiro para armazenar o simbolo da linha.
- * @param col Ponteiro para armazenar o simbolo da coluna.
- * @return int Retorna 1 se o caractere foi encontrado, 0 caso contrario.
- */
-static int get_adfgvx_symbols(char c, char *row, char *col)
-{
-    for (int i = 0; i < 6; i++)
-    {
-        for (int j = 0; j < 6; j++)
-        {
-            if (square[i][j] == c)
-            {
-                *row = symbols[i];
-                *col = symbols[j];
-                return 1;
-            }
-        }
-    }
-    return 0;
-}
-
-/**
- * @brief Insere um simbolo ADFGVX na matriz de colunas.
- * Função auxiliar estática, interna a este módulo.
- *
- * @param key_length Comprimento da chave.
- * @param symbol Simbolo a ser inserido (row ou col).
- * @param symbol_count Contador global de simbolos (sera incrementado).
- * @param encoded_symbol_matrix Matriz de saida contendo os simbolos organizados por coluna.
- * @param symbols_per_column Vetor com a quantidade de simbolos por coluna (sera atualizado).
- */
-static void insert_symbol_to_column(int key_length, char symbol, int *symbol_count, char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[])
-{
-    int col_index = (*symbol_count) % key_length;
-    int write_pos = symbols_per_column[col_index];
-
-    encoded_symbol_matrix[col_index][write_pos] = symbol;
-    symbols_per_column[col_index]++;
-    (*symbol_count)++;
-}
-
-/**
- * @brief Converte a mensagem em colunas de simbolos ADFGVX para cifra por transposicao.
- * Função auxiliar estática, interna a este módulo.
- *
- * @param key_length Comprimento da chave.
- * @param message Mensagem original a ser cifrada.
- * @param encoded_symbol_matrix Matriz onde os simbolos cifrados serao armazenados por coluna.
- * @param symbols_per_column Vetor que armazena o numero de elementos em cada coluna.
- * Este vetor deve ser zerado pelo chamador antes desta função.
- */
-static void polybius_encode_to_columns(int key_length, char message[], char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[])
-{
-    int i;
-    int current_symbol_count = 0; 
-
-    for (i = 0; message[i] != '\0'; i++)
-    {
-        char r_symbol, c_symbol; // Nomes de variáveis locais para clareza
-
-        if (!get_adfgvx_symbols(message[i], &r_symbol, &c_symbol))
-        {
-            //Caracteres nao encontrados são ignorados
-            continue;
-        }
-
-        insert_symbol_to_column(key_length, r_symbol, &current_symbol_count, encoded_symbol_matrix, symbols_per_column);
-        insert_symbol_to_column(key_length, c_symbol, &current_symbol_count, encoded_symbol_matrix, symbols_per_column);
-    }
-}
-
-/**
- * @brief Reorganiza as colunas da matriz com base na ordem alfabetica da chave.
- * Função auxiliar estática, interna a este módulo.
- *
- * @param key A chave usada na transposicao (array de caracteres).
- * @param key_length Comprimento da chave.
- * @param encoded_symbol_matrix Matriz com os dados cifrados por colunas.
- * @param symbols_per_column Vetor com o numero de elementos em cada coluna.
- */
-static void transpose_columns_by_key_order(char key[], int key_length, char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[])
-{
-    int i, j, k;
-   
-    char sorted_key_chars[key_length]; // Não precisa de +1 se não for usada como string com funções de string.h
-    int temp_s_count; // Renomeado de temp_count
-
-    // Copia a chave original para sorted_key_chars para ordenação
-    for (i = 0; i < key_length; i++)
-    {
-        sorted_key_chars[i] = key[i];
-    }
-
-    // Ordenacao da chave (Bubble Sort) e reorganizacao simultanea das colunas da matriz
-    // e dos contadores em symbols_per_column.
-    for (i = 0; i < key_length - 1; i++)
-    {
-        for (j = 0; j < key_length - i - 1; j++)
-        {
-            if (sorted_key_chars[j] > sorted_key_chars[j + 1])
-            {
-                // Troca os caracteres na copia da chave que esta sendo ordenada
-                char temp_char = sorted_key_chars[j];
-                sorted_key_chars[j] = sorted_key_chars[j + 1];
-                sorted_key_chars[j + 1] = temp_char;
-
-                // Troca as colunas correspondentes na encoded_symbol_matrix.
-                // A troca é feita para a coluna inteira (até MAX_MESSAGE_LENGTH).
-                // A leitura posterior será limitada por symbols_per_column.
-                for (k = 0; k < MAX_MESSAGE_LENGTH; k++)
-                {
-                    char temp_matrix_char = encoded_symbol_matrix[j][k];
-                    encoded_symbol_matrix[j][k] = encoded_symbol_matrix[j + 1][k];
-                    encoded_symbol_matrix[j + 1][k] = temp_matrix_char;
-                }
-
-                // Troca os contadores de simbolos para as colunas correspondentes
-                temp_s_count = symbols_per_column[j];
-                symbols_per_column[j] = symbols_per_column[j + 1];
-                symbols_per_column[j + 1] = temp_s_count;
-            }
-        }
-    }
-}
-
-// Implementação da função pública
-void cipher_adfgvx(char key[], int key_length, char message[], char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[])
-{
-    // É responsabilidade do chamador (main) garantir que symbols_per_column
-    // esteja inicializado com zeros antes de chamar esta função.
-    polybius_encode_to_columns(key_length, message, encoded_symbol_matrix, symbols_per_column);
-    transpose_columns_by_key_order(key, key_length, encoded_symbol_matrix, symbols_per_column);
-}
+#include "adfgvx_core.h"
+#include "adfgvx_codec.h"
+#include "adfgvx_key.h"
+#include "adfgvx_stats.h"
+#include "adfgvx_transpose.h"
+#include <string.h> // Necessário para strlen, se usado (embora key_length seja passado)
+#include <stdio.h>  // Para debugging ou perror, se necessário (geralmente evitado em módulos core)
+#include <stdlib.h> // Para malloc e free (contexto de fluxo)
+
+// As constantes da cifra ADFGVX (square e symbols) ficam no codec compartilhado,
+// que tambem fornece a substituicao em blocos (adfgvx_encode_symbols).
+
+/**
+ * @brief Insere um simbolo ADFGVX na matriz de colunas.
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * @param key_length Comprimento da chave.
+ * @param symbol Simbolo a ser inserido (row ou col).
+ * @param col_index Coluna que recebe o simbolo (avancada para a proxima, sem divisao).
+ * @param encoded_symbol_matrix Matriz de saida contendo os simbolos organizados por coluna.
+ * @param symbols_per_column Vetor com a quantidade de simbolos por coluna (sera atualizado).
+ */
+static void insert_symbol_to_column(int key_length, char symbol, int *col_index, char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[])
+{
+    int col = *col_index;
+    int write_pos = symbols_per_column[col];
+
+    encoded_symbol_matrix[col][write_pos] = symbol;
+    symbols_per_column[col]++;
+    *col_index = (col + 1 == key_length) ? 0 : col + 1;
+}
+
+/**
+ * @brief Converte a mensagem em colunas de simbolos ADFGVX para cifra por transposicao.
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * @param key_length Comprimento da chave.
+ * @param message Mensagem original a ser cifrada.
+ * @param encoded_symbol_matrix Matriz onde os simbolos cifrados serao armazenados por coluna.
+ * @param symbols_per_column Vetor que armazena o numero de elementos em cada coluna.
+ * Este vetor deve ser zerado pelo chamador antes desta função.
+ */
+static void polybius_encode_to_columns(int key_length, char message[], char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[])
+{
+    int current_column = 0;
+    size_t message_length = strlen(message);
+    char block_symbols[2 * ADFGVX_ENCODE_BLOCK_SIZE];
+
+    // A substituicao e feita em blocos pelo kernel do codec (vetorial quando a CPU permite),
+    // que ja descarta os caracteres nao encontrados na matriz.
+    ADFGVX_STATS_BEGIN(stage_start);
+    for (size_t start = 0; start < message_length; start += ADFGVX_ENCODE_BLOCK_SIZE)
+    {
+        size_t block_length = message_length - start < ADFGVX_ENCODE_BLOCK_SIZE ? message_length - start : ADFGVX_ENCODE_BLOCK_SIZE;
+        size_t produced = adfgvx_encode_symbols(message + start, block_length, block_symbols);
+
+        for (size_t i = 0; i < produced; i++)
+        {
+            insert_symbol_to_column(key_length, block_symbols[i], &current_column, encoded_symbol_matrix, symbols_per_column);
+        }
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_ENCODE, stage_start, message_length);
+}
+
+/**
+ * @brief Determina a ordem de leitura das colunas com base na ordem alfabetica da chave.
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * Antes, a chave era ordenada por Bubble Sort e, a cada troca, duas colunas inteiras
+ * (MAX_MESSAGE_LENGTH bytes cada) eram trocadas na matriz. Agora apenas a permutacao
+ * estavel das colunas e calculada, uma vez; a matriz e symbols_per_column ficam na
+ * ordem original e quem linearizar o texto cifrado le as colunas atraves de column_order.
+ *
+ * @param key A chave usada na transposicao (array de caracteres).
+ * @param key_length Comprimento da chave.
+ * @param column_order Saida: column_order[i] = coluna da matriz a ser lida na posicao i.
+ */
+static void transpose_columns_by_key_order(char key[], int key_length, int column_order[])
+{
+    ADFGVX_STATS_BEGIN(stage_start);
+    adfgvx_key_column_order(key, key_length, column_order);
+    ADFGVX_STATS_END(ADFGVX_STAGE_TRANSPOSE, stage_start, (unsigned long long)key_length);
+}
+
+// Implementação da função pública
+void cipher_adfgvx(char key[], int key_length, char message[], char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH], int symbols_per_column[], int column_order[])
+{
+    // É responsabilidade do chamador (main) garantir que symbols_per_column
+    // esteja inicializado com zeros antes de chamar esta função.
+    adfgvx_codec_init();
+    polybius_encode_to_columns(key_length, message, encoded_symbol_matrix, symbols_per_column);
+    transpose_columns_by_key_order(key, key_length, column_order);
+}
+
+size_t cipher_adfgvx_output_length(const char message[], size_t message_length)
+{
+    size_t valid = 0;
+
+    adfgvx_codec_init();
+    ADFGVX_STATS_BEGIN(stage_start);
+    for (size_t i = 0; i < message_length; i++)
+    {
+        valid += adfgvx_encode_table[(unsigned char)message[i]][0] != 0;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_SCAN, stage_start, message_length);
+    return 2 * valid;
+}
+
+/**
+ * @brief Codifica um trecho da mensagem e espalha cada simbolo direto na sua posicao
+ * final do texto cifrado: o simbolo i pertence a coluna i % key_length e ocupa a
+ * linha i / key_length.
+ * As linhas inteiras vao para o kernel especializado da chave ou, nas chaves longas, para
+ * a transposicao por ladrilhos (adfgvx_transpose_scatter_tiles). Quando um bloco
+ * codificado nao completa um ladrilho (ADFGVX_TILE_ROWS linhas, ou ADFGVX_TILE_STREAM_ROWS
+ * com streaming), os simbolos se acumulam num buffer do heap ate completa-lo (sem memoria,
+ * os ladrilhos sao os blocos).
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * @param key_length Comprimento da chave.
+ * @param next_position Entrada: inicio de cada coluna original no texto cifrado
+ * (adfgvx_key_ctx_column_starts). E usado como cursor de escrita de cada coluna (alterado).
+ * @param first_symbol Indice global do primeiro simbolo gerado pelo trecho.
+ * @param message Trecho da mensagem.
+ * @param message_length Numero de bytes no trecho.
+ * @param output Texto cifrado completo.
+ * @param streaming Diferente de 0 para os ladrilhos gravarem sem passar pela cache.
+ */
+static void scatter_symbols(int key_length,
+                            size_t next_position[],
+                            size_t first_symbol,
+                            const char message[],
+                            size_t message_length,
+                            char output[],
+                            int streaming)
+{
+    int col = (int)(first_symbol % (size_t)key_length);
+    size_t row = first_symbol / (size_t)key_length;
+
+    // As colunas anteriores a col ja receberam o simbolo da linha atual.
+    for (int c = 0; c < key_length; c++)
+    {
+        next_position[c] += row + (c < col);
+    }
+
+    // Kernel especializado para o comprimento da chave ou ladrilhos (nenhum: o laco generico).
+    const adfgvx_transpose_kernels *kernels = adfgvx_transpose_kernels_for(key_length);
+    int tiled = kernels == NULL && adfgvx_transpose_tiled_enabled();
+    size_t tile_symbols = (size_t)(streaming ? ADFGVX_TILE_STREAM_ROWS : ADFGVX_TILE_ROWS) * (size_t)key_length;
+    char block_symbols[2 * ADFGVX_ENCODE_BLOCK_SIZE];
+    char *tile_buffer = NULL;
+    if (tiled && tile_symbols > sizeof(block_symbols) && 2 * message_length >= tile_symbols)
+    {
+        tile_buffer = malloc(tile_symbols + sizeof(block_symbols));
+    }
+    char *symbols = tile_buffer != NULL ? tile_buffer : block_symbols;
+    size_t pending = 0; // Simbolos acumulados no buffer do ladrilho.
+
+    ADFGVX_STATS_BEGIN(stage_start);
+    for (size_t start = 0; start < message_length; start += ADFGVX_ENCODE_BLOCK_SIZE)
+    {
+        size_t block_length = message_length - start < ADFGVX_ENCODE_BLOCK_SIZE ? message_length - start : ADFGVX_ENCODE_BLOCK_SIZE;
+        int last = start + block_length == message_length;
+        size_t produced = adfgvx_encode_symbols(message + start, block_length, symbols + pending);
+        ADFGVX_STATS_NEXT(ADFGVX_STAGE_ENCODE, stage_start, block_length);
+
+        size_t available = pending + produced;
+        size_t i = 0;
+        if (kernels != NULL || tiled)
+        {
+            // Completa a linha atual simbolo a simbolo; as linhas inteiras vao para o kernel.
+            for (; i < available && col != 0; i++)
+            {
+                output[next_position[col]++] = symbols[i];
+                col = (col + 1 == key_length) ? 0 : col + 1;
+            }
+            size_t rows = (available - i) / (size_t)key_length;
+            if (tile_buffer != NULL && !last && available - i < tile_symbols)
+            {
+                rows = 0; // O ladrilho ainda nao esta completo.
+            }
+            if (kernels != NULL)
+            {
+                kernels->scatter_rows(next_position, symbols + i, rows, output);
+            }
+            else
+            {
+                adfgvx_transpose_scatter_tiles(key_length, next_position, symbols + i, rows, output, streaming);
+            }
+            i += rows * (size_t)key_length;
+        }
+        pending = 0;
+        if (tile_buffer != NULL && !last)
+        {
+            // A linha incompleta (ou o ladrilho incompleto) fica para o proximo bloco.
+            pending = available - i;
+            if (i > 0)
+            {
+                memmove(symbols, symbols + i, pending);
+            }
+            i = available;
+        }
+        for (; i < available; i++)
+        {
+            output[next_position[col]++] = symbols[i];
+            col = (col + 1 == key_length) ? 0 : col + 1;
+        }
+        ADFGVX_STATS_NEXT(ADFGVX_STAGE_TRANSPOSE, stage_start, produced);
+    }
+    free(tile_buffer);
+}
+
+/**
+ * @brief Corpo de cipher_adfgvx_linear_ctx, com a tabela do inicio das colunas fornecida
+ * pelo chamador (pilha, heap ou arena).
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * @param column_start Area de key_length posicoes (conteudo de entrada ignorado).
+ */
+static int cipher_linear_with_starts(const adfgvx_key_ctx *key_ctx,
+                                     const char message[],
+                                     size_t message_length,
+                                     char output[],
+                                     size_t output_capacity,
+                                     size_t *output_length,
+                                     size_t column_start[])
+{
+    size_t total_symbols = cipher_adfgvx_output_length(message, message_length);
+    *output_length = 0;
+    if (total_symbols > 0 && !output)
+    {
+        return 1;
+    }
+    if (total_symbols > output_capacity)
+    {
+        return 2;
+    }
+
+    adfgvx_key_ctx_column_starts(key_ctx, total_symbols, column_start);
+    scatter_symbols(key_ctx->key_length, column_start, 0, message, message_length, output,
+                    total_symbols >= adfgvx_transpose_stream_threshold());
+    *output_length = total_symbols;
+    return 0;
+}
+
+int cipher_adfgvx_linear_ctx(const adfgvx_key_ctx *key_ctx,
+                             const char message[],
+                             size_t message_length,
+                             char output[],
+                             size_t output_capacity,
+                             size_t *output_length)
+{
+    if (!key_ctx || !message || !output_length)
+    {
+        return 1;
+    }
+
+    size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+    size_t *column_start = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, (size_t)key_ctx->key_length);
+    if (column_start == NULL)
+    {
+        *output_length = 0;
+        return 3;
+    }
+    int status = cipher_linear_with_starts(key_ctx, message, message_length, output, output_capacity, output_length, column_start);
+    adfgvx_key_scratch_free(column_start, stack_start);
+    return status;
+}
+
+int cipher_adfgvx_ws(adfgvx_workspace *ws,
+                     const char key[],
+                     int key_length,
+                     const char message[],
+                     size_t message_length,
+                     char output[],
+                     size_t output_capacity,
+                     size_t *output_length)
+{
+    if (!ws || !key || !message || !output_length || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+    *output_length = 0;
+    if (adfgvx_workspace_reserve(ws, ADFGVX_WORKSPACE_KEY_BYTES(key_length)) != 0)
+    {
+        return 3;
+    }
+
+    // Agenda da chave e inicio das colunas na arena, devolvidos ao fim da chamada.
+    size_t mark = adfgvx_workspace_mark(ws);
+    adfgvx_key_ctx key_ctx;
+    adfgvx_key_ctx_init_ws(&key_ctx, key, key_length, ws);
+    size_t *column_start = adfgvx_workspace_alloc(ws, (size_t)key_length * sizeof(size_t));
+    int status = cipher_linear_with_starts(&key_ctx, message, message_length, output, output_capacity, output_length, column_start);
+    adfgvx_workspace_release(ws, mark);
+    return status;
+}
+
+int cipher_adfgvx_linear(const char key[],
+                         int key_length,
+                         const char message[],
+                         size_t message_length,
+                         char output[],
+                         size_t output_capacity,
+                         size_t *output_length)
+{
+    // Chaves curtas usam uma arena fixa na pilha (nenhuma alocacao); as longas, uma no heap.
+    unsigned char stack_workspace[ADFGVX_WORKSPACE_KEY_BYTES(ADFGVX_KEY_STACK_COLUMNS)];
+    adfgvx_workspace ws;
+    int short_key = key_length <= ADFGVX_KEY_STACK_COLUMNS;
+
+    adfgvx_workspace_init(&ws, short_key ? stack_workspace : NULL, short_key ? sizeof(stack_workspace) : 0);
+    int status = cipher_adfgvx_ws(&ws, key, key_length, message, message_length, output, output_capacity, output_length);
+    adfgvx_workspace_free(&ws);
+    return status;
+}
+
+size_t cipher_adfgvx_batch(const adfgvx_key_ctx *key_ctx, adfgvx_batch_item items[], size_t count)
+{
+    size_t failures = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        adfgvx_batch_item *item = &items[i];
+
+        item->status = cipher_adfgvx_linear_ctx(key_ctx, item->input, item->input_length,
+                                                item->output, item->output_capacity, &item->output_length);
+        failures += item->status != 0;
+    }
+    return failures;
+}
+
+/**
+ * @brief Estado compartilhado pelas tarefas de cipher_adfgvx_parallel.
+ * A mensagem e dividida em chunk_count trechos de chunk_size bytes (o ultimo pode ser menor).
+ */
+typedef struct
+{
+    const adfgvx_key_ctx *key_ctx;
+    const char *message;
+    size_t message_length;
+    size_t chunk_size;
+    size_t *chunk_symbols;       // Primeira fase: simbolos de cada trecho; depois, indice do primeiro simbolo.
+    const size_t *column_start;
+    size_t *cursors;             // key_length cursores de escrita por trecho.
+    char *output;
+    int streaming;               // Texto cifrado maior que a cache de ultimo nivel.
+} parallel_cipher_job;
+
+static void parallel_count_task(void *user, size_t chunk)
+{
+    parallel_cipher_job *job = user;
+    size_t start = chunk * job->chunk_size;
+    size_t length = job->message_length - start < job->chunk_size ? job->message_length - start : job->chunk_size;
+
+    job->chunk_symbols[chunk] = cipher_adfgvx_output_length(job->message + start, length);
+}
+
+static void parallel_scatter_task(void *user, size_t chunk)
+{
+    parallel_cipher_job *job = user;
+    size_t key_length = (size_t)job->key_ctx->key_length;
+    size_t start = chunk * job->chunk_size;
+    size_t length = job->message_length - start < job->chunk_size ? job->message_length - start : job->chunk_size;
+    size_t *cursors = job->cursors + chunk * key_length;
+
+    memcpy(cursors, job->column_start, key_length * sizeof(size_t));
+    scatter_symbols(job->key_ctx->key_length, cursors, job->chunk_symbols[chunk],
+                    job->message + start, length, job->output, job->streaming);
+}
+
+int cipher_adfgvx_parallel(const adfgvx_key_ctx *key_ctx,
+                           const char message[],
+                           size_t message_length,
+                           char output[],
+                           size_t output_capacity,
+                           size_t *output_length,
+                           thread_pool *pool,
+                           size_t parallel_threshold)
+{
+    if (!pool || thread_pool_size(pool) < 2 || message_length < parallel_threshold || message_length == 0)
+    {
+        return cipher_adfgvx_linear_ctx(key_ctx, message, message_length, output, output_capacity, output_length);
+    }
+    if (!key_ctx || !message || !output_length)
+    {
+        return 1;
+    }
+    *output_length = 0;
+
+    // Alguns trechos por thread equilibram a carga quando as threads andam em ritmos diferentes.
+    parallel_cipher_job job;
+    size_t chunk_count = (size_t)thread_pool_size(pool) * ADFGVX_PARALLEL_CHUNKS_PER_THREAD;
+    job.chunk_size = (message_length + chunk_count - 1) / chunk_count;
+    chunk_count = (message_length + job.chunk_size - 1) / job.chunk_size;
+
+    job.key_ctx = key_ctx;
+    job.message = message;
+    job.message_length = message_length;
+    job.output = output;
+    // Um bloco: indices dos trechos, inicio das colunas e os cursores de cada trecho.
+    job.chunk_symbols = malloc((chunk_count + (chunk_count + 1) * (size_t)key_ctx->key_length) * sizeof(size_t));
+    if (job.chunk_symbols == NULL)
+    {
+        return cipher_adfgvx_linear_ctx(key_ctx, message, message_length, output, output_capacity, output_length);
+    }
+    size_t *column_start = job.chunk_symbols + chunk_count;
+    job.column_start = column_start;
+    job.cursors = column_start + key_ctx->key_length;
+
+    // Fase 1: cada trecho conta quantos simbolos gera (caracteres fora da matriz sao
+    // ignorados, entao o indice do primeiro simbolo de um trecho depende dos anteriores).
+    adfgvx_codec_init();
+    thread_pool_run(pool, chunk_count, parallel_count_task, &job);
+
+    size_t total_symbols = 0;
+    for (size_t i = 0; i < chunk_count; i++)
+    {
+        size_t symbols = job.chunk_symbols[i];
+        job.chunk_symbols[i] = total_symbols;
+        total_symbols += symbols;
+    }
+
+    if (total_symbols > 0 && !output)
+    {
+        free(job.chunk_symbols);
+        return 1;
+    }
+    if (total_symbols > output_capacity)
+    {
+        free(job.chunk_symbols);
+        return 2;
+    }
+
+    // Fase 2: cada trecho espalha os seus simbolos; as posicoes de destino sao disjuntas.
+    adfgvx_key_ctx_column_starts(key_ctx, total_symbols, column_start);
+    job.streaming = total_symbols >= adfgvx_transpose_stream_threshold();
+    thread_pool_run(pool, chunk_count, parallel_scatter_task, &job);
+
+    free(job.chunk_symbols);
+    *output_length = total_symbols;
+    return 0;
+}
+
+/**
+ * @brief Transpoe simbolos ja codificados: symbols[i] vai para a coluna i % key_length,
+ * na linha i / key_length. As linhas inteiras vao para o kernel especializado ou para os
+ * ladrilhos, como em scatter_symbols; a linha incompleta do fim, para o laco generico.
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * @param next_position Entrada: inicio de cada coluna (adfgvx_key_ctx_column_starts).
+ * E usado como cursor de escrita de cada coluna (alterado).
+ */
+static void transpose_symbols(int key_length,
+                              size_t next_position[],
+                              const char *symbols,
+                              size_t symbol_count,
+                              char *output,
+                              int streaming)
+{
+    const adfgvx_transpose_kernels *kernels = adfgvx_transpose_kernels_for(key_length);
+    size_t rows = symbol_count / (size_t)key_length;
+
+    ADFGVX_STATS_BEGIN(stage_start);
+    if (kernels != NULL)
+    {
+        kernels->scatter_rows(next_position, symbols, rows, output);
+    }
+    else if (adfgvx_transpose_tiled_enabled())
+    {
+        adfgvx_transpose_scatter_tiles(key_length, next_position, symbols, rows, output, streaming);
+    }
+    else
+    {
+        rows = 0;
+    }
+    int col = 0;
+    for (size_t i = rows * (size_t)key_length; i < symbol_count; i++)
+    {
+        output[next_position[col]++] = symbols[i];
+        col = (col + 1 == key_length) ? 0 : col + 1;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_TRANSPOSE, stage_start, symbol_count);
+}
+
+int cipher_adfgvx_rounds(const adfgvx_key_ctx keys[],
+                         int round_count,
+                         const char message[],
+                         size_t message_length,
+                         char output[],
+                         size_t output_capacity,
+                         size_t *output_length)
+{
+    if (!keys || round_count < 1 || round_count > ADFGVX_MAX_ROUNDS || !message || !output_length)
+    {
+        return 1;
+    }
+    size_t total_symbols = cipher_adfgvx_output_length(message, message_length);
+    *output_length = 0;
+    if (total_symbols > 0 && !output)
+    {
+        return 1;
+    }
+    if (total_symbols > output_capacity)
+    {
+        return 2;
+    }
+    if (total_symbols == 0)
+    {
+        return 0;
+    }
+
+    adfgvx_rounds_map map;
+    int status = adfgvx_rounds_map_init(&map, keys, round_count, total_symbols);
+    if (status != 0)
+    {
+        return status == 1 ? 1 : 3;
+    }
+    if (map.period > 0)
+    {
+        // As rodadas sao uma transposicao de map.period colunas virtuais (kernels e ladrilhos).
+        scatter_symbols(map.period, map.period_start, 0, message, message_length, output,
+                        total_symbols >= adfgvx_transpose_stream_threshold());
+        adfgvx_rounds_map_free(&map);
+        *output_length = total_symbols;
+        return 0;
+    }
+
+    // Periodo longo demais: uma passagem por rodada, alternando entre output e um buffer
+    // auxiliar de modo que a ultima grave em output. A primeira codifica e espalha com
+    // keys[0]; as demais transpoem os simbolos da anterior.
+    char *scratch = malloc(total_symbols);
+    if (scratch == NULL)
+    {
+        adfgvx_rounds_map_free(&map);
+        return 3;
+    }
+    char *buffers[2] = {output, scratch};
+    int streaming = total_symbols >= adfgvx_transpose_stream_threshold();
+    scatter_symbols(map.key_length[0], map.column_start[0], 0, message, message_length, buffers[(round_count - 1) % 2],
+                    streaming);
+    for (int r = 1; r < round_count; r++)
+    {
+        transpose_symbols(map.key_length[r], map.column_start[r], buffers[(round_count - r) % 2], total_symbols,
+                          buffers[(round_count - 1 - r) % 2], streaming);
+    }
+    free(scratch);
+    adfgvx_rounds_map_free(&map);
+    *output_length = total_symbols;
+    return 0;
+}
+
+/**
+ * @brief Despeja o buffer em memoria de uma coluna no seu arquivo temporario.
+ * Função auxiliar estática, interna a este módulo.
+ *
+ * @return int 0 em caso de sucesso, 1 se a escrita falhar.
+ */
+static int flush_stream_column(adfgvx_cipher_stream *ctx, int col)
+{
+    size_t pending = ctx->column_buffered[col];
+    char *buffer = ctx->column_buffer + (size_t)col * ADFGVX_STREAM_BUFFER_SIZE;
+
+    if (pending > 0 && fwrite(buffer, 1, pending, ctx->column_spill[col]) != pending)
+    {
+        return 1;
+    }
+    ctx->column_buffered[col] = 0;
+    return 0;
+}
+
+/**
+ * @brief Acrescenta um simbolo a coluna correspondente do contexto de fluxo.
+ * Equivalente em fluxo de insert_symbol_to_column.
+ */
+static int append_stream_symbol(adfgvx_cipher_stream *ctx, char symbol)
+{
+    int col = ctx->next_column;
+
+    if (ctx->column_buffered[col] == ADFGVX_STREAM_BUFFER_SIZE && flush_stream_column(ctx, col) != 0)
+    {
+        return 1;
+    }
+    ctx->column_buffer[(size_t)col * ADFGVX_STREAM_BUFFER_SIZE + ctx->column_buffered[col]++] = symbol;
+    ctx->symbol_count++;
+    ctx->next_column = (col + 1 == ctx->key_length) ? 0 : col + 1;
+    return 0;
+}
+
+/**
+ * @brief Libera os buffers e fecha os arquivos temporarios do contexto.
+ */
+static void release_stream(adfgvx_cipher_stream *ctx)
+{
+    for (int i = 0; i < ctx->key_length; i++)
+    {
+        if (ctx->column_spill[i] != NULL)
+        {
+            fclose(ctx->column_spill[i]);
+            ctx->column_spill[i] = NULL;
+        }
+    }
+    free(ctx->column_buffer);
+    ctx->column_buffer = NULL;
+}
+
+int adfgvx_cipher_stream_init(adfgvx_cipher_stream *ctx, const char key[], int key_length)
+{
+    if (!ctx || !key || key_length <= 0 || key_length > ADFGVX_STREAM_MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+
+    adfgvx_codec_init();
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->key_length = key_length;
+    adfgvx_key_column_order(key, key_length, ctx->column_order);
+
+    ctx->column_buffer = malloc((size_t)key_length * ADFGVX_STREAM_BUFFER_SIZE);
+    if (ctx->column_buffer == NULL)
+    {
+        return 2;
+    }
+
+    for (int i = 0; i < key_length; i++)
+    {
+        ctx->column_spill[i] = tmpfile();
+        if (ctx->column_spill[i] == NULL)
+        {
+            release_stream(ctx);
+            return 2;
+        }
+    }
+    return 0;
+}
+
+int adfgvx_cipher_stream_update(adfgvx_cipher_stream *ctx, const char *chunk, size_t length)
+{
+    char block_symbols[2 * ADFGVX_ENCODE_BLOCK_SIZE];
+
+    ADFGVX_STATS_BEGIN(stage_start);
+    for (size_t start = 0; start < length; start += ADFGVX_ENCODE_BLOCK_SIZE)
+    {
+        size_t block_length = length - start < ADFGVX_ENCODE_BLOCK_SIZE ? length - start : ADFGVX_ENCODE_BLOCK_SIZE;
+        size_t produced = adfgvx_encode_symbols(chunk + start, block_length, block_symbols);
+        ADFGVX_STATS_NEXT(ADFGVX_STAGE_ENCODE, stage_start, block_length);
+
+        for (size_t i = 0; i < produced; i++)
+        {
+            if (append_stream_symbol(ctx, block_symbols[i]) != 0)
+            {
+                return 1;
+            }
+        }
+        ADFGVX_STATS_NEXT(ADFGVX_STAGE_TRANSPOSE, stage_start, produced);
+    }
+    return 0;
+}
+
+int adfgvx_cipher_stream_final(adfgvx_cipher_stream *ctx, FILE *output)
+{
+    int status = 0;
+
+    ADFGVX_STATS_BEGIN(stage_start);
+    if (output != NULL)
+    {
+        // Copia cada coluna para a saida na ordem alfabetica da chave. O que ainda esta
+        // no buffer da coluna e despejado antes, e o proprio buffer serve de area de copia.
+        for (int i = 0; i < ctx->key_length && status == 0; i++)
+        {
+            int col = ctx->column_order[i];
+            FILE *spill = ctx->column_spill[col];
+            char *buffer = ctx->column_buffer + (size_t)col * ADFGVX_STREAM_BUFFER_SIZE;
+            size_t n;
+
+            if (flush_stream_column(ctx, col) != 0 || fflush(spill) != 0)
+            {
+                status = 1;
+                break;
+            }
+            rewind(spill);
+
+            while ((n = fread(buffer, 1, ADFGVX_STREAM_BUFFER_SIZE, spill)) > 0)
+            {
+                if (fwrite(buffer, 1, n, output) != n)
+                {
+                    status = 1;
+                    break;
+                }
+            }
+            if (ferror(spill))
+            {
+                status = 1;
+            }
+        }
+
+        if (status == 0 && fflush(output) != 0)
+        {
+            status = 1;
+        }
+    }
+
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, ctx->symbol_count);
+    release_stream(ctx);
+    return status;
+}
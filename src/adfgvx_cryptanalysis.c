@@ -0,0 +1,899 @@
+#include "adfgvx_cryptanalysis.h"
+#include "adfgvx_key.h"      // Para adfgvx_key_ctx_init_order_ws
+#include "adfgvx_workspace.h" // Para a arena das agendas de chave dos candidatos
+#include "adfgvx_decipher.h" // Para decipher_adfgvx_direct_ctx
+#include <math.h>            // Para log10 e exp
+#include <pthread.h>         // Para o lock da melhor solucao compartilhada
+#include <stdlib.h>          // Para malloc, calloc e free
+#include <string.h>          // Para memcpy e memcmp
+
+// Faixa de permutacoes (ou de palavras) avaliada por cada tarefa da busca.
+#define SEARCH_RANKS_PER_TASK 720
+#define SEARCH_WORDS_PER_TASK 1024
+
+// Trocas aleatorias aplicadas a melhor solucao compartilhada quando um reinicio parte dela.
+#define SQUARE_RESTART_PERTURBATION 6
+
+// Texto de treino embutido. Sem acentos: a matriz Polybius so tem letras maiusculas,
+// espaco, virgula, ponto e alguns digitos; o restante e descartado ao construir o modelo.
+const char adfgvx_default_corpus[] =
+    "A CRIPTOGRAFIA ESTUDA OS METODOS PARA ESCREVER MENSAGENS DE FORMA QUE APENAS O "
+    "DESTINATARIO POSSA LER O SEU CONTEUDO. DURANTE A PRIMEIRA GUERRA MUNDIAL O EXERCITO "
+    "ALEMAO USOU UMA CIFRA CHAMADA ADFGVX, QUE COMBINAVA UMA SUBSTITUICAO POR UMA MATRIZ "
+    "COM UMA TRANSPOSICAO DE COLUNAS DEFINIDA POR UMA PALAVRA CHAVE. AS LETRAS ESCOLHIDAS "
+    "PARA NOMEAR AS LINHAS E AS COLUNAS ERAM FACEIS DE DISTINGUIR NO CODIGO MORSE, O QUE "
+    "REDUZIA OS ERROS DE TRANSMISSAO PELO RADIO. O OFICIAL FRANCES GEORGES PAINVIN PASSOU "
+    "DIAS E NOITES ANALISANDO AS MENSAGENS INTERCEPTADAS ATE CONSEGUIR RECUPERAR AS CHAVES "
+    "DE ALGUNS DIAS, E AS INFORMACOES OBTIDAS AJUDARAM A DEFESA DE PARIS. "
+    "NA ESCOLA, O PROFESSOR EXPLICOU QUE UMA BOA CHAVE DEVE SER LONGA E DIFICIL DE "
+    "ADIVINHAR, MAS QUE A SEGURANCA DE UM SISTEMA NAO PODE DEPENDER DO SEGREDO DO "
+    "ALGORITMO. OS ALUNOS ESCREVERAM PEQUENOS PROGRAMAS EM C PARA CIFRAR E DECIFRAR "
+    "TEXTOS, MEDIRAM O TEMPO DE EXECUCAO E COMPARARAM OS RESULTADOS COM AS MENSAGENS "
+    "ORIGINAIS. DEPOIS, CADA GRUPO TENTOU QUEBRAR A CIFRA DOS COLEGAS USANDO A FREQUENCIA "
+    "DAS LETRAS E DOS PARES DE LETRAS MAIS COMUNS NA LINGUA PORTUGUESA. "
+    "O RELATORIO FINAL DEVE CONTER UMA INTRODUCAO, A DESCRICAO DO ALGORITMO, OS TESTES "
+    "REALIZADOS E UMA CONCLUSAO SOBRE AS VANTAGENS E AS LIMITACOES DO METODO. TAMBEM E "
+    "IMPORTANTE DOCUMENTAR AS FUNCOES, EXPLICAR AS ESTRUTURAS DE DADOS E INDICAR COMO "
+    "COMPILAR E EXECUTAR O PROJETO EM DIFERENTES SISTEMAS OPERACIONAIS. "
+    "ATAQUE AO AMANHECER. A TROPA DEVE AVANCAR PELO NORTE DA CIDADE E AGUARDAR NOVAS "
+    "ORDENS PERTO DA PONTE. O COMANDANTE PEDIU QUE A MENSAGEM FOSSE ENVIADA ANTES DAS "
+    "SEIS HORAS DA MANHA, QUANDO O CORREIO PARTE PARA A FRENTE DE BATALHA. NENHUM "
+    "SOLDADO DEVE DEIXAR A POSICAO SEM AUTORIZACAO, E OS SUPRIMENTOS CHEGARAO NO "
+    "SEGUNDO DIA DO MES. "
+    "O TEMPO ESTAVA FRIO E CHUVOSO QUANDO O TREM CHEGOU A ESTACAO. OS PASSAGEIROS "
+    "DESCERAM DEPRESSA, CARREGANDO MALAS E PACOTES, E PROCURARAM ABRIGO NO PEQUENO CAFE "
+    "DO OUTRO LADO DA RUA. ALI, ENTRE UMA CONVERSA E OUTRA, UM VELHO TELEGRAFISTA CONTOU "
+    "COMO ERA O TRABALHO NOS ANOS DA GUERRA, QUANDO CADA LETRA ERRADA PODIA MUDAR O "
+    "SENTIDO DE UMA ORDEM E COLOCAR MUITAS VIDAS EM PERIGO. "
+    "PARA QUE UM TEXTO SEJA BEM COMPREENDIDO, AS PALAVRAS PRECISAM SER ESCOLHIDAS COM "
+    "CUIDADO E AS FRASES DEVEM SEGUIR UMA ORDEM LOGICA. O LEITOR ESPERA ENCONTRAR "
+    "PRIMEIRO A IDEIA PRINCIPAL E DEPOIS OS DETALHES QUE A SUSTENTAM, COM EXEMPLOS "
+    "SIMPLES E DIRETOS SEMPRE QUE POSSIVEL.";
+
+/**
+ * @brief Retorna o indice (0 .. ADFGVX_ALPHABET_SIZE - 1) de um caractere na matriz
+ * Polybius, ou -1 se ele nao estiver na matriz.
+ * (Funcao auxiliar estatica)
+ */
+static int alphabet_index(char c)
+{
+    const char *pair = adfgvx_encode_table[(unsigned char)c];
+
+    if (pair[0] == 0)
+    {
+        return -1;
+    }
+    return adfgvx_symbol_value[(unsigned char)pair[0]] * ADFGVX_SYMBOL_COUNT +
+           adfgvx_symbol_value[(unsigned char)pair[1]];
+}
+
+/**
+ * @brief Estima o log10 da probabilidade de cada n-grama (n = 3 ou 4) de um texto de treino.
+ *
+ * Os n-gramas sao contados sobre a sequencia de caracteres validos (como o texto decifrado);
+ * os nunca vistos recebem uma probabilidade bem menor que a do mais raro visto (floor).
+ * (Funcao auxiliar estatica, compartilhada pelos modelos de trigramas e de quadrigramas)
+ *
+ * @return int 0 em caso de sucesso, 1 se faltar memoria ou o texto nao tiver n-gramas.
+ */
+static int build_log_probabilities(const char *text, size_t length, int order, float log_probability[], size_t ngram_count,
+                                   float *floor_value, unsigned long long *ngram_total)
+{
+    unsigned int *counts = calloc(ngram_count, sizeof(unsigned int));
+    if (counts == NULL)
+    {
+        return 1;
+    }
+
+    adfgvx_codec_init();
+
+    unsigned long long total = 0;
+    size_t current = 0; // Indice dos ultimos order caracteres validos.
+    int seen = 0;
+    for (size_t i = 0; i < length; i++)
+    {
+        char c = text[i];
+        if (c >= 'a' && c <= 'z')
+        {
+            c = (char)(c - 'a' + 'A');
+        }
+
+        int index = alphabet_index(c);
+        if (index < 0)
+        {
+            continue;
+        }
+        current = (current * ADFGVX_ALPHABET_SIZE + (size_t)index) % ngram_count;
+        if (++seen >= order)
+        {
+            counts[current]++;
+            total++;
+        }
+    }
+
+    if (total == 0)
+    {
+        free(counts);
+        return 1;
+    }
+
+    *ngram_total = total;
+    *floor_value = (float)log10(0.01 / (double)total);
+    for (size_t i = 0; i < ngram_count; i++)
+    {
+        log_probability[i] = counts[i] > 0 ? (float)log10((double)counts[i] / (double)total) : *floor_value;
+    }
+
+    free(counts);
+    return 0;
+}
+
+int adfgvx_ngram_model_build(adfgvx_ngram_model *model, const char *text, size_t length)
+{
+    if (!model || !text)
+    {
+        return 1;
+    }
+    return build_log_probabilities(text, length, 3, model->log_probability, ADFGVX_TRIGRAM_COUNT,
+                                   &model->floor, &model->trigram_total);
+}
+
+int adfgvx_quadgram_model_build(adfgvx_quadgram_model *model, const char *text, size_t length)
+{
+    if (!model || !text)
+    {
+        return 1;
+    }
+    return build_log_probabilities(text, length, 4, model->log_probability, ADFGVX_QUADGRAM_COUNT,
+                                   &model->floor, &model->quadgram_total);
+}
+
+double adfgvx_ngram_score(const adfgvx_ngram_model *model, const char *text, size_t length)
+{
+    if (length < 3)
+    {
+        return model->floor;
+    }
+
+    double sum = 0;
+    int a = alphabet_index(text[0]);
+    int b = alphabet_index(text[1]);
+    for (size_t i = 2; i < length; i++)
+    {
+        int c = alphabet_index(text[i]);
+
+        sum += (a < 0 || b < 0 || c < 0) ? model->floor
+                                         : model->log_probability[(a * ADFGVX_ALPHABET_SIZE + b) * ADFGVX_ALPHABET_SIZE + c];
+        a = b;
+        b = c;
+    }
+    return sum / (double)(length - 2);
+}
+
+/**
+ * @brief Uma tarefa de busca: uma faixa de permutacoes de um comprimento de chave, ou
+ * uma faixa de palavras do dicionario, com a sua propria lista de melhores candidatos.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    const adfgvx_key_search *search;
+    int key_length;                     // Busca exaustiva: comprimento das permutacoes.
+    unsigned long long first_rank;      // Busca exaustiva: indice lexicografico da primeira permutacao.
+    const char *const *words;           // Busca por dicionario: primeira palavra da faixa.
+    size_t count;                       // Permutacoes (ou palavras) da faixa.
+    adfgvx_key_candidate best[ADFGVX_MAX_CANDIDATES];
+    size_t best_found;
+    size_t best_capacity;
+    adfgvx_key_search_stats stats;
+} search_task;
+
+/**
+ * @brief Insere um candidato numa lista ordenada (do melhor para o pior), ignorando
+ * ordens de colunas ja presentes.
+ * (Funcao auxiliar estatica)
+ */
+static void insert_candidate(adfgvx_key_candidate best[], size_t *found, size_t capacity, const adfgvx_key_candidate *candidate)
+{
+    for (size_t i = 0; i < *found; i++)
+    {
+        if (best[i].key_length == candidate->key_length &&
+            memcmp(best[i].column_order, candidate->column_order, (size_t)candidate->key_length * sizeof(int)) == 0)
+        {
+            return;
+        }
+    }
+    if (*found == capacity && candidate->score <= best[capacity - 1].score)
+    {
+        return;
+    }
+
+    size_t position = *found < capacity ? (*found)++ : capacity - 1;
+    while (position > 0 && best[position - 1].score < candidate->score)
+    {
+        best[position] = best[position - 1];
+        position--;
+    }
+    best[position] = *candidate;
+}
+
+/**
+ * @brief Avalia um candidato: decifra e pontua o prefixo, descarta-o se for bem pior que
+ * os candidatos ja guardados e, caso contrario, decifra e pontua o texto inteiro.
+ * (Funcao auxiliar estatica)
+ */
+static void evaluate_candidate(search_task *task, const adfgvx_key_ctx *key_ctx, const char *key, char *plaintext)
+{
+    const adfgvx_key_search *search = task->search;
+    size_t pairs = search->ciphertext_length / 2;
+    size_t prefix = search->prefix_pairs < pairs ? search->prefix_pairs : pairs;
+    size_t decoded = 0;
+    adfgvx_key_candidate candidate;
+
+    // Decifra apenas o prefixo (codigo 2 = capacidade atingida, esperado aqui).
+    decipher_adfgvx_direct_ctx(key_ctx, search->ciphertext, search->ciphertext_length, plaintext, prefix, &decoded);
+    candidate.prefix_score = adfgvx_ngram_score(search->model, plaintext, decoded);
+    task->stats.tested++;
+
+    if (task->best_found == task->best_capacity &&
+        candidate.prefix_score < task->best[task->best_capacity - 1].score - search->abort_margin)
+    {
+        task->stats.aborted++;
+        return;
+    }
+
+    candidate.score = candidate.prefix_score;
+    if (prefix < pairs)
+    {
+        decipher_adfgvx_direct_ctx(key_ctx, search->ciphertext, search->ciphertext_length, plaintext, pairs, &decoded);
+        candidate.score = adfgvx_ngram_score(search->model, plaintext, decoded);
+    }
+
+    candidate.key_length = key_ctx->key_length;
+    memcpy(candidate.column_order, key_ctx->column_order, (size_t)key_ctx->key_length * sizeof(int));
+    memcpy(candidate.key, key, (size_t)key_ctx->key_length);
+    candidate.key[key_ctx->key_length] = '\0';
+    insert_candidate(task->best, &task->best_found, task->best_capacity, &candidate);
+}
+
+/**
+ * @brief Obtem a permutacao de indice rank (na ordem lexicografica) de 0 .. length - 1.
+ * (Funcao auxiliar estatica)
+ */
+static void unrank_permutation(unsigned long long rank, int length, int permutation[])
+{
+    int available[ADFGVX_SEARCH_MAX_KEY_LENGTH];
+    unsigned long long factorial = 1;
+
+    for (int i = 0; i < length; i++)
+    {
+        available[i] = i;
+        if (i > 0)
+        {
+            factorial *= (unsigned long long)i; // (length - 1)! ao fim do laco
+        }
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+        int remaining = length - i;
+        int index = (int)(rank / factorial);
+
+        rank %= factorial;
+        permutation[i] = available[index];
+        for (int j = index; j < remaining - 1; j++)
+        {
+            available[j] = available[j + 1];
+        }
+        if (remaining > 1)
+        {
+            factorial /= (unsigned long long)(remaining - 1);
+        }
+    }
+}
+
+/**
+ * @brief Avanca para a proxima permutacao na ordem lexicografica.
+ * (Funcao auxiliar estatica)
+ */
+static void next_permutation(int permutation[], int length)
+{
+    int i = length - 2;
+    while (i >= 0 && permutation[i] > permutation[i + 1])
+    {
+        i--;
+    }
+    if (i < 0)
+    {
+        return; // Ultima permutacao; nao ocorre dentro de uma faixa valida.
+    }
+
+    int j = length - 1;
+    while (permutation[j] < permutation[i])
+    {
+        j--;
+    }
+    int swap = permutation[i];
+    permutation[i] = permutation[j];
+    permutation[j] = swap;
+
+    for (int a = i + 1, b = length - 1; a < b; a++, b--)
+    {
+        swap = permutation[a];
+        permutation[a] = permutation[b];
+        permutation[b] = swap;
+    }
+}
+
+static void order_search_task(void *user, size_t index)
+{
+    search_task *task = (search_task *)user + index;
+    char *plaintext = malloc(task->search->ciphertext_length / 2 + 1);
+    int order[ADFGVX_SEARCH_MAX_KEY_LENGTH];
+    char key[ADFGVX_SEARCH_MAX_KEY_LENGTH];
+    adfgvx_key_ctx key_ctx;
+    // A agenda de cada candidato e montada numa arena fixa da tarefa, sem malloc por candidato.
+    unsigned char workspace_buffer[ADFGVX_WORKSPACE_KEY_BYTES(ADFGVX_SEARCH_MAX_KEY_LENGTH)];
+    adfgvx_workspace ws;
+
+    if (plaintext == NULL)
+    {
+        return;
+    }
+    adfgvx_workspace_init(&ws, workspace_buffer, sizeof(workspace_buffer));
+
+    unrank_permutation(task->first_rank, task->key_length, order);
+    for (size_t n = 0; n < task->count; n++)
+    {
+        // Chave equivalente: a coluna na i-esima posicao recebe a i-esima letra.
+        for (int i = 0; i < task->key_length; i++)
+        {
+            key[order[i]] = (char)('A' + i);
+        }
+        if (adfgvx_key_ctx_init_order_ws(&key_ctx, order, task->key_length, &ws) == 0)
+        {
+            evaluate_candidate(task, &key_ctx, key, plaintext);
+        }
+        adfgvx_workspace_release(&ws, 0);
+        next_permutation(order, task->key_length);
+    }
+    free(plaintext);
+}
+
+static void word_search_task(void *user, size_t index)
+{
+    search_task *task = (search_task *)user + index;
+    char *plaintext = malloc(task->search->ciphertext_length / 2 + 1);
+    adfgvx_key_ctx key_ctx;
+    unsigned char workspace_buffer[ADFGVX_WORKSPACE_KEY_BYTES(ADFGVX_SEARCH_MAX_KEY_LENGTH)];
+    adfgvx_workspace ws;
+
+    if (plaintext == NULL)
+    {
+        return;
+    }
+    adfgvx_workspace_init(&ws, workspace_buffer, sizeof(workspace_buffer));
+
+    for (size_t n = 0; n < task->count; n++)
+    {
+        const char *word = task->words[n];
+        size_t length = strlen(word);
+
+        if (length > 0 && length <= ADFGVX_SEARCH_MAX_KEY_LENGTH && adfgvx_key_ctx_init_ws(&key_ctx, word, (int)length, &ws) == 0)
+        {
+            evaluate_candidate(task, &key_ctx, word, plaintext);
+        }
+        adfgvx_workspace_release(&ws, 0);
+    }
+    free(plaintext);
+}
+
+/**
+ * @brief Executa as tarefas (no pool ou na thread chamadora) e combina os resultados.
+ * (Funcao auxiliar estatica)
+ */
+static size_t run_search(const adfgvx_key_search *search, search_task tasks[], size_t task_count, thread_pool_task function,
+                         adfgvx_key_candidate best[], size_t best_count, adfgvx_key_search_stats *stats)
+{
+    adfgvx_key_search_stats total = {0, 0};
+    size_t found = 0;
+
+    if (search->pool != NULL)
+    {
+        thread_pool_run(search->pool, task_count, function, tasks);
+    }
+    else
+    {
+        for (size_t i = 0; i < task_count; i++)
+        {
+            function(tasks, i);
+        }
+    }
+
+    for (size_t i = 0; i < task_count; i++)
+    {
+        for (size_t j = 0; j < tasks[i].best_found; j++)
+        {
+            insert_candidate(best, &found, best_count, &tasks[i].best[j]);
+        }
+        total.tested += tasks[i].stats.tested;
+        total.aborted += tasks[i].stats.aborted;
+    }
+    if (stats != NULL)
+    {
+        *stats = total;
+    }
+    return found;
+}
+
+/**
+ * @brief Valida os parametros comuns das buscas.
+ * (Funcao auxiliar estatica)
+ */
+static int valid_search(const adfgvx_key_search *search, const adfgvx_key_candidate best[], size_t best_count)
+{
+    return search && search->ciphertext && search->model && best && best_count > 0 &&
+           best_count <= ADFGVX_MAX_CANDIDATES && search->ciphertext_length % 2 == 0;
+}
+
+size_t adfgvx_search_column_orders(const adfgvx_key_search *search,
+                                   int min_key_length,
+                                   int max_key_length,
+                                   adfgvx_key_candidate best[],
+                                   size_t best_count,
+                                   adfgvx_key_search_stats *stats)
+{
+    if (!valid_search(search, best, best_count) || min_key_length < 1 ||
+        max_key_length > ADFGVX_SEARCH_MAX_KEY_LENGTH || min_key_length > max_key_length)
+    {
+        return 0;
+    }
+
+    // Uma tarefa para cada faixa de SEARCH_RANKS_PER_TASK permutacoes de cada comprimento.
+    size_t task_count = 0;
+    for (int k = min_key_length; k <= max_key_length; k++)
+    {
+        unsigned long long permutations = 1;
+        for (int i = 2; i <= k; i++)
+        {
+            permutations *= (unsigned long long)i;
+        }
+        task_count += (size_t)((permutations + SEARCH_RANKS_PER_TASK - 1) / SEARCH_RANKS_PER_TASK);
+    }
+
+    search_task *tasks = calloc(task_count, sizeof(search_task));
+    if (tasks == NULL)
+    {
+        return 0;
+    }
+
+    size_t t = 0;
+    for (int k = min_key_length; k <= max_key_length; k++)
+    {
+        unsigned long long permutations = 1;
+        for (int i = 2; i <= k; i++)
+        {
+            permutations *= (unsigned long long)i;
+        }
+        for (unsigned long long rank = 0; rank < permutations; rank += SEARCH_RANKS_PER_TASK, t++)
+        {
+            tasks[t].search = search;
+            tasks[t].key_length = k;
+            tasks[t].first_rank = rank;
+            tasks[t].count = (size_t)(permutations - rank < SEARCH_RANKS_PER_TASK ? permutations - rank : SEARCH_RANKS_PER_TASK);
+            tasks[t].best_capacity = best_count;
+        }
+    }
+
+    size_t found = run_search(search, tasks, task_count, order_search_task, best, best_count, stats);
+    free(tasks);
+    return found;
+}
+
+size_t adfgvx_search_wordlist(const adfgvx_key_search *search,
+                              const char *const words[],
+                              size_t word_count,
+                              adfgvx_key_candidate best[],
+                              size_t best_count,
+                              adfgvx_key_search_stats *stats)
+{
+    if (!valid_search(search, best, best_count) || (!words && word_count > 0))
+    {
+        return 0;
+    }
+
+    size_t task_count = (word_count + SEARCH_WORDS_PER_TASK - 1) / SEARCH_WORDS_PER_TASK;
+    search_task *tasks = calloc(task_count > 0 ? task_count : 1, sizeof(search_task));
+    if (tasks == NULL)
+    {
+        return 0;
+    }
+
+    for (size_t t = 0; t < task_count; t++)
+    {
+        size_t first = t * SEARCH_WORDS_PER_TASK;
+
+        tasks[t].search = search;
+        tasks[t].words = words + first;
+        tasks[t].count = word_count - first < SEARCH_WORDS_PER_TASK ? word_count - first : SEARCH_WORDS_PER_TASK;
+        tasks[t].best_capacity = best_count;
+    }
+
+    size_t found = run_search(search, tasks, task_count, word_search_task, best, best_count, stats);
+    free(tasks);
+    return found;
+}
+
+/**
+ * @brief Dados do solucionador compartilhados pelos reinicios e a melhor solucao ate o momento.
+ *
+ * Com a transposicao desfeita, o texto plano e uma sequencia de celulas (0 .. 35). Cada
+ * quadrigrama de celulas distinto aparece uma vez, com o numero de ocorrencias como peso,
+ * e cada celula tem a lista dos quadrigramas que a contem: trocar duas celulas so altera
+ * a pontuacao desses quadrigramas.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    const adfgvx_square_search *search;
+    size_t quad_count;              // Quadrigramas de celulas distintos.
+    const unsigned int *quads;      // As 4 celulas de cada um, uma por byte (primeira no byte baixo).
+    const unsigned int *weights;    // Ocorrencias de cada um no texto.
+    const unsigned int *cell_quads; // Quadrigramas agrupados por celula.
+    const unsigned char *levels;    // Modelo quantizado: (log10 - floor) / level_step, em 0 .. 255.
+    double level_step;              // log10 por nivel.
+    size_t cell_start[ADFGVX_ALPHABET_SIZE + 1]; // Inicio da lista de cada celula em cell_quads.
+    double temperature;             // Temperatura inicial, ja escalada pelo tamanho do texto.
+
+    pthread_mutex_t lock;           // Protege os campos abaixo.
+    int have_best;
+    double best_sum;                // Soma do log10 dos quadrigramas da melhor solucao.
+    unsigned char best_mapping[ADFGVX_ALPHABET_SIZE];
+    adfgvx_square_search_stats stats;
+} square_problem;
+
+/**
+ * @brief Gerador pseudoaleatorio (xorshift) de cada reinicio.
+ * (Funcao auxiliar estatica)
+ */
+static unsigned int next_random(unsigned int *state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * @brief Indice no modelo do quadrigrama de celulas quad, com cada celula c contendo o
+ * caractere mapping[c].
+ * (Funcao auxiliar estatica)
+ */
+static size_t mapped_quadgram(const unsigned char mapping[], unsigned int quad)
+{
+    return (((size_t)mapping[quad & 0xFF] * ADFGVX_ALPHABET_SIZE + mapping[(quad >> 8) & 0xFF]) * ADFGVX_ALPHABET_SIZE +
+            mapping[(quad >> 16) & 0xFF]) * ADFGVX_ALPHABET_SIZE + mapping[quad >> 24];
+}
+
+static int quad_contains(unsigned int quad, unsigned int cell)
+{
+    return (quad & 0xFF) == cell || ((quad >> 8) & 0xFF) == cell || ((quad >> 16) & 0xFF) == cell || (quad >> 24) == cell;
+}
+
+static int compare_quads(const void *a, const void *b)
+{
+    unsigned int x = *(const unsigned int *)a;
+    unsigned int y = *(const unsigned int *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Um reinicio do recozimento simulado.
+ * (Funcao auxiliar estatica, executada pelas threads do pool)
+ */
+static void square_restart_task(void *user, size_t index)
+{
+    square_problem *problem = (square_problem *)user;
+    const adfgvx_square_search *search = problem->search;
+    const unsigned char *levels = problem->levels;
+    unsigned char *current = malloc(problem->quad_count);  // Nivel atual de cada quadrigrama.
+    unsigned char *proposed = malloc(problem->quad_count); // Nivel depois da troca avaliada.
+    unsigned int *touched = malloc(problem->quad_count * sizeof(unsigned int));
+    unsigned char mapping[ADFGVX_ALPHABET_SIZE], best_mapping[ADFGVX_ALPHABET_SIZE];
+    unsigned int state = search->seed + (unsigned int)index * 0x9E3779B9u;
+    unsigned long long accepted = 0;
+
+    if (state == 0)
+    {
+        state = 1;
+    }
+    if (current == NULL || proposed == NULL || touched == NULL)
+    {
+        free(current);
+        free(proposed);
+        free(touched);
+        return;
+    }
+
+    // Ponto de partida: atribuicao aleatoria ou (reinicios impares) a melhor ate agora, perturbada.
+    for (int i = 0; i < ADFGVX_ALPHABET_SIZE; i++)
+    {
+        mapping[i] = (unsigned char)i;
+    }
+    pthread_mutex_lock(&problem->lock);
+    int from_best = (index % 2) == 1 && problem->have_best;
+    if (from_best)
+    {
+        memcpy(mapping, problem->best_mapping, sizeof(mapping));
+    }
+    pthread_mutex_unlock(&problem->lock);
+    for (int i = 0; i < (from_best ? SQUARE_RESTART_PERTURBATION : ADFGVX_ALPHABET_SIZE - 1); i++)
+    {
+        int a = from_best ? (int)(next_random(&state) % ADFGVX_ALPHABET_SIZE) : i;
+        int b = from_best ? (int)(next_random(&state) % ADFGVX_ALPHABET_SIZE)
+                          : i + (int)(next_random(&state) % (unsigned int)(ADFGVX_ALPHABET_SIZE - i));
+        unsigned char swap = mapping[a];
+        mapping[a] = mapping[b];
+        mapping[b] = swap;
+    }
+
+    // Somas e variacoes em niveis inteiros; so a temperatura e convertida.
+    long long sum = 0;
+    for (size_t q = 0; q < problem->quad_count; q++)
+    {
+        current[q] = levels[mapped_quadgram(mapping, problem->quads[q])];
+        sum += (long long)problem->weights[q] * current[q];
+    }
+    long long best_sum = sum;
+    double level_temperature = problem->temperature / problem->level_step;
+    memcpy(best_mapping, mapping, sizeof(mapping));
+
+    for (unsigned long long step = 0; step < search->iterations; step++)
+    {
+        unsigned int a = next_random(&state) % ADFGVX_ALPHABET_SIZE;
+        unsigned int b = next_random(&state) % (ADFGVX_ALPHABET_SIZE - 1);
+        size_t touched_count = 0;
+        long long delta = 0;
+
+        b += b >= a; // b != a
+
+        // Troca as celulas e reavalia apenas os quadrigramas que contem a ou b.
+        unsigned char swap = mapping[a];
+        mapping[a] = mapping[b];
+        mapping[b] = swap;
+        for (size_t i = problem->cell_start[a]; i < problem->cell_start[a + 1]; i++)
+        {
+            unsigned int q = problem->cell_quads[i];
+            proposed[touched_count] = levels[mapped_quadgram(mapping, problem->quads[q])];
+            delta += (long long)problem->weights[q] * (proposed[touched_count] - current[q]);
+            touched[touched_count++] = q;
+        }
+        for (size_t i = problem->cell_start[b]; i < problem->cell_start[b + 1]; i++)
+        {
+            unsigned int q = problem->cell_quads[i];
+            if (quad_contains(problem->quads[q], a))
+            {
+                continue; // Ja avaliado na lista de a.
+            }
+            proposed[touched_count] = levels[mapped_quadgram(mapping, problem->quads[q])];
+            delta += (long long)problem->weights[q] * (proposed[touched_count] - current[q]);
+            touched[touched_count++] = q;
+        }
+
+        // Criterio de Metropolis, com temperatura decrescendo linearmente ate zero.
+        double temperature = level_temperature * (double)(search->iterations - step) / (double)search->iterations;
+        if (delta >= 0 || (double)(next_random(&state) >> 8) * (1.0 / 16777216.0) < exp((double)delta / temperature))
+        {
+            for (size_t i = 0; i < touched_count; i++)
+            {
+                current[touched[i]] = proposed[i];
+            }
+            sum += delta;
+            accepted++;
+            if (sum > best_sum)
+            {
+                best_sum = sum;
+                memcpy(best_mapping, mapping, sizeof(mapping));
+            }
+        }
+        else
+        {
+            mapping[b] = mapping[a];
+            mapping[a] = swap;
+        }
+    }
+
+    // Pontuacao exata da melhor atribuicao, com o modelo original.
+    const float *log_probability = search->model->log_probability;
+    double exact_sum = 0;
+    for (size_t q = 0; q < problem->quad_count; q++)
+    {
+        exact_sum += (double)problem->weights[q] * log_probability[mapped_quadgram(best_mapping, problem->quads[q])];
+    }
+
+    pthread_mutex_lock(&problem->lock);
+    if (!problem->have_best || exact_sum > problem->best_sum)
+    {
+        problem->have_best = 1;
+        problem->best_sum = exact_sum;
+        memcpy(problem->best_mapping, best_mapping, sizeof(best_mapping));
+    }
+    problem->stats.evaluations += search->iterations;
+    problem->stats.accepted += accepted;
+    problem->stats.restarts++;
+    pthread_mutex_unlock(&problem->lock);
+
+    free(current);
+    free(proposed);
+    free(touched);
+}
+
+/**
+ * @brief Libera os buffers do solucionador.
+ * (Funcao auxiliar estatica)
+ */
+static void free_square_buffers(unsigned char *cells, unsigned int *quads, unsigned int *weights, unsigned int *cell_quads,
+                                unsigned char *levels)
+{
+    free(cells);
+    free(quads);
+    free(weights);
+    free(cell_quads);
+    free(levels);
+}
+
+int adfgvx_solve_square(const adfgvx_square_search *search, adfgvx_square_solution *best, adfgvx_square_search_stats *stats)
+{
+    if (!search || !search->ciphertext || !search->key_ctx || !search->model || !best || search->restarts < 1 ||
+        search->iterations == 0 || search->temperature <= 0 || search->ciphertext_length % 2 != 0 ||
+        search->ciphertext_length < 8)
+    {
+        return 1;
+    }
+
+    size_t length = search->ciphertext_length / 2;
+    size_t quad_total = length - 3;
+    size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+    size_t *column_start = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, (size_t)search->key_ctx->key_length);
+    unsigned char *cells = malloc(length);
+    unsigned int *quads = malloc(quad_total * sizeof(unsigned int));
+    unsigned int *weights = malloc(quad_total * sizeof(unsigned int));
+    unsigned int *cell_quads = malloc(4 * quad_total * sizeof(unsigned int));
+    unsigned char *levels = malloc(ADFGVX_QUADGRAM_COUNT);
+
+    if (column_start == NULL || cells == NULL || quads == NULL || weights == NULL || cell_quads == NULL || levels == NULL)
+    {
+        adfgvx_key_scratch_free(column_start, stack_start);
+        free_square_buffers(cells, quads, weights, cell_quads, levels);
+        return 2;
+    }
+
+    // Desfaz a transposicao: o simbolo i esta em column_start[i % k] + i / k.
+    adfgvx_codec_init();
+    adfgvx_key_ctx_column_starts(search->key_ctx, search->ciphertext_length, column_start);
+    size_t key_length = (size_t)search->key_ctx->key_length;
+    for (size_t p = 0; p < length; p++)
+    {
+        size_t i = 2 * p;
+        unsigned char row = adfgvx_symbol_value[(unsigned char)search->ciphertext[column_start[i % key_length] + i / key_length]];
+        unsigned char col = adfgvx_symbol_value[(unsigned char)search->ciphertext[column_start[(i + 1) % key_length] + (i + 1) / key_length]];
+
+        if (row == ADFGVX_CODEC_INVALID || col == ADFGVX_CODEC_INVALID)
+        {
+            adfgvx_key_scratch_free(column_start, stack_start);
+            free_square_buffers(cells, quads, weights, cell_quads, levels);
+            return 3;
+        }
+        cells[p] = (unsigned char)(row * ADFGVX_SYMBOL_COUNT + col);
+    }
+    adfgvx_key_scratch_free(column_start, stack_start);
+
+    // Quadrigramas de celulas distintos, com o numero de ocorrencias.
+    for (size_t s = 0; s < quad_total; s++)
+    {
+        quads[s] = (unsigned int)cells[s] | (unsigned int)cells[s + 1] << 8 |
+                   (unsigned int)cells[s + 2] << 16 | (unsigned int)cells[s + 3] << 24;
+    }
+    qsort(quads, quad_total, sizeof(unsigned int), compare_quads);
+    size_t quad_count = 0;
+    for (size_t s = 0; s < quad_total; s++)
+    {
+        if (quad_count > 0 && quads[quad_count - 1] == quads[s])
+        {
+            weights[quad_count - 1]++;
+            continue;
+        }
+        quads[quad_count] = quads[s];
+        weights[quad_count++] = 1;
+    }
+
+    // Lista dos quadrigramas de cada celula (cada quadrigrama uma vez por celula distinta).
+    square_problem problem;
+    size_t counts[ADFGVX_ALPHABET_SIZE] = {0};
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (size_t q = 0; q < quad_count; q++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                unsigned int cell = (quads[q] >> (8 * j)) & 0xFF;
+                if ((j > 0 && (quads[q] & 0xFF) == cell) || (j > 1 && ((quads[q] >> 8) & 0xFF) == cell) ||
+                    (j > 2 && ((quads[q] >> 16) & 0xFF) == cell))
+                {
+                    continue; // Celula repetida no mesmo quadrigrama.
+                }
+                if (pass == 0)
+                {
+                    counts[cell]++;
+                }
+                else
+                {
+                    cell_quads[counts[cell]++] = (unsigned int)q;
+                }
+            }
+        }
+        if (pass == 0)
+        {
+            problem.cell_start[0] = 0;
+            for (int c = 0; c < ADFGVX_ALPHABET_SIZE; c++)
+            {
+                problem.cell_start[c + 1] = problem.cell_start[c] + counts[c];
+                counts[c] = problem.cell_start[c];
+            }
+        }
+    }
+
+    // Modelo quantizado em 256 niveis entre floor e 0: 1,7 MB em vez de 6,7 MB, de modo que
+    // as consultas aleatorias do recozimento ficam quase sempre na cache.
+    const float *log_probability = search->model->log_probability;
+    problem.level_step = -(double)search->model->floor / 255.0;
+    for (size_t i = 0; i < ADFGVX_QUADGRAM_COUNT; i++)
+    {
+        double level = ((double)log_probability[i] - search->model->floor) / problem.level_step + 0.5;
+        levels[i] = (unsigned char)(level < 0 ? 0 : (level > 255 ? 255 : level));
+    }
+
+    problem.search = search;
+    problem.quad_count = quad_count;
+    problem.quads = quads;
+    problem.weights = weights;
+    problem.cell_quads = cell_quads;
+    problem.levels = levels;
+    problem.temperature = search->temperature * (double)length / 1000.0;
+    problem.have_best = 0;
+    problem.best_sum = 0;
+    problem.stats.evaluations = 0;
+    problem.stats.accepted = 0;
+    problem.stats.restarts = 0;
+    pthread_mutex_init(&problem.lock, NULL);
+
+    if (search->pool != NULL)
+    {
+        thread_pool_run(search->pool, (size_t)search->restarts, square_restart_task, &problem);
+    }
+    else
+    {
+        for (int r = 0; r < search->restarts; r++)
+        {
+            square_restart_task(&problem, (size_t)r);
+        }
+    }
+    pthread_mutex_destroy(&problem.lock);
+    free_square_buffers(cells, quads, weights, cell_quads, levels);
+
+    if (!problem.have_best)
+    {
+        return 2; // Nenhum reinicio conseguiu alocar os seus buffers.
+    }
+    for (int c = 0; c < ADFGVX_ALPHABET_SIZE; c++)
+    {
+        best->square[c] = adfgvx_square_cells[problem.best_mapping[c]];
+    }
+    best->score = problem.best_sum / (double)quad_total;
+    if (stats != NULL)
+    {
+        *stats = problem.stats;
+    }
+    return 0;
+}
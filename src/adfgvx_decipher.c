@@ -1,259 +1,945 @@
-#include "cipher_config.h"
-#include "adfgvx_decipher.h"
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h>
-
-// Constantes symbols e square so necessrias para a decifragem
-// e so encapsuladas neste mdulo como static.
-static const char symbols[6] = {'A', 'D', 'F', 'G', 'V', 'X'};
-static const char square[6][6] = {
-    {'A', 'B', 'C', 'D', 'E', 'F'},
-    {'G', 'H', 'I', 'J', 'K', 'L'},
-    {'M', 'N', 'O', 'P', 'Q', 'R'},
-    {'S', 'T', 'U', 'V', 'W', 'X'},
-    {'Y', 'Z', ' ', ',', '.', '1'},
-    {'2', '3', '4', '5', '6', '7'}};
-
-/**
- * @brief Retorna o ndice de um smbolo ADFGVX dentro do vetor `symbols`.
- * (Funo auxiliar esttica)
- */
-static int symbol_index(char c)
-{
-    for (int i = 0; i < 6; i++)
-    {
-        if (symbols[i] == c)
-            return i;
-    }
-    return -1; // Smbolo no encontrado
-}
-
-/**
- * @brief Reconstri as colunas originais da cifra com base na chave de transposio.
- * (Funo auxiliar esttica - lgica fornecida pelo utilizador)
- */
-static void reverse_transposition(char *input, char *key, int key_length, char columns[][MAX_MESSAGE_LENGTH], int col_counts[])
-{
-    if (key_length <= 0) { // Proteo contra key_length invlido
-        // Zera col_counts se key_length for invlido para evitar uso de dados no inicializados
-        // No entanto, a funo que chama deve garantir key_length > 0.
-        // Se key_length  usado para dimensionar 'order', ele deve ser > 0.
-        return;
-    }
-
-    int len = strlen(input);
-    if (len == 0) { // Se a entrada estiver vazia, no h nada a fazer.
-        for(int i=0; i<key_length; ++i) col_counts[i] = 0;
-        return;
-    }
-    int rows = len / key_length;
-    int extra = len % key_length;
-
-    // 1) monta o vetor order[] = {0,1,2,...,key_length-1}
-    int order[key_length]; // VLA
-    for (int i = 0; i < key_length; i++) {
-        order[i] = i;
-    }
-
-    // 2) ordena order[] de acordo com key[order[j]], para obter a ordem alfabtica
-    //    dos ndices originais da chave.
-    for (int i = 0; i < key_length - 1; i++) {
-        for (int j = 0; j < key_length - i - 1; j++) {
-            if (key[order[j]] > key[order[j + 1]]) {
-                int tmp = order[j];
-                order[j] = order[j + 1];
-                order[j + 1] = tmp;
-            }
-        }
-    }
-    // Agora order[i] = ndice original da i-sima coluna EM ORDEM ALFABTICA da chave.
-
-    // 3) determina quantos smbolos cada coluna (identificada pelo seu ndice original) vai ter.
-    //    A lgica fornecida: a coluna orig_index recebeu rows+1 smbolos se orig_index < extra.
-    //    Isto significa que as primeiras 'extra' colunas *na ordem original da chave* so as mais longas.
-    //    Isto  diferente da forma como a cifragem normalmente distribui (onde as primeiras 'extra'
-    //    colunas *na ordem alfabtica da chave* so as mais longas ao ler o texto cifrado linearmente).
-    //    No entanto, vamos seguir a lgica fornecida.
-    //    Para que esta lgica funcione, o texto cifrado (input) deve ter sido construdo
-    //    de forma que as colunas correspondentes aos primeiros 'extra' ndices originais da chave
-    //    foram preenchidas com 'rows+1' smbolos, e as restantes com 'rows' smbolos,
-    //    E ENTO estas colunas foram concatenadas na ordem alfabtica da chave.
-    //    Se for assim, ento, ao ler o 'input', precisamos saber o comprimento de cada
-    //    coluna *na ordem alfabtica*.
-    //    A i-sima coluna na ordem alfabtica (que originalmente era a coluna order[i])
-    //    ter rows+1 smbolos se ELA (a i-sima coluna alfabtica) for uma das 'extra' colunas.
-    //    Portanto, o comprimento da coluna order[i]  rows + (i < extra ? 1 : 0).
-    //    O cdigo do utilizador faz: col_counts[orig_index] = rows + (orig_index < extra ? 1 : 0);
-    //    Vou manter a lgica do utilizador como solicitada.
-    for (int i = 0; i < key_length; i++)
-    {
-        int orig_index = order[i]; // orig_index  o ndice da coluna original que  a i-sima na ordem alfabtica
-        col_counts[orig_index] = rows + (orig_index < extra ? 1 : 0);
-    }
-
-
-    // 4) preenche cada columns[orig_index] lendo do texto cifrado linearizado
-    //    O texto cifrado (input)  a concatenao das colunas na ordem alfabtica da chave.
-    //    A i-sima coluna na ordem alfabtica da chave  a coluna original order[i].
-    //    O comprimento desta i-sima coluna alfabtica  o que precisamos para ler do input.
-    //    Este comprimento NO  col_counts[order[i]] (que foi calculado acima com base em orig_index < extra).
-    //    Precisamos do comprimento da i-sima coluna *alfabtica*.
-    //    Seja `len_alpha[i]` o comprimento da i-sima coluna alfabtica.
-    //    `len_alpha[i] = rows + (i < extra ? 1 : 0);`
-    //    Ento, lemos `len_alpha[i]` caracteres do `input` e colocamos em `columns[order[i]]`.
-    //    A lgica do utilizador no passo 4 :
-    //    `int col_index = order[i];`
-    //    `for (int j = 0; j < col_counts[col_index]; j++) { columns[col_index][j] = input[pos++]; }`
-    //    Isto usa `col_counts[col_index]` (onde `col_index`  o ndice original) como o nmero de
-    //    caracteres a serem lidos do `input` para a coluna `columns[col_index]`.
-    //    Isto implica que `col_counts[k]` deve ser o comprimento da coluna `k` quando ela  lida
-    //    do `input` (ou seja, quando a coluna `k` aparece na ordem alfabtica da chave).
-    //    Portanto, o passo 3 do utilizador est correto se `col_counts[orig_index]` for interpretado
-    //    como o comprimento da coluna `orig_index` *quando ela  lida do texto cifrado linear*.
-    //    Mas o texto cifrado  lido coluna alfabtica por coluna alfabtica.
-    //    A i-sima coluna alfabtica tem `rows + (i < extra ? 1 : 0)` caracteres.
-    //    Esta i-sima coluna alfabtica corresponde  coluna original `order[i]`.
-    //    Ento, `columns[order[i]]`  preenchida com `rows + (i < extra ? 1 : 0)` caracteres.
-    //    E `col_counts[order[i]]` deve ser igual a `rows + (i < extra ? 1 : 0)`.
-    //    A lgica do utilizador no passo 3: `col_counts[orig_index] = rows + (orig_index < extra ? 1 : 0);`
-    //    A lgica do utilizador no passo 4: usa `col_counts[col_index]` (onde `col_index = order[i]`).
-    //    Vou implementar exatamente como o utilizador forneceu, assumindo que a sua cifragem
-    //    produz um `input` que  decifrvel por esta lgica.
-
-    // Limpa col_counts antes de recalcular, para garantir que no h lixo.
-    memset(col_counts, 0, key_length * sizeof(int));
-
-    // Passo 3 do utilizador (calcula o tamanho de cada coluna original)
-    for (int i = 0; i < key_length; i++) {
-        int orig_index = order[i]; // order[i]  o ndice original da i-sima coluna alfabtica
-        // O utilizador atribui o comprimento  coluna original baseado no seu prprio ndice original.
-        col_counts[orig_index] = rows + (orig_index < extra ? 1 : 0);
-    }
-
-    // Passo 4 do utilizador (preenche as colunas)
-    int pos = 0;
-    for (int i = 0; i < key_length; i++) { // Itera sobre as colunas na ordem alfabtica da chave
-        int original_col_index_to_fill = order[i]; // Esta  a coluna original que estamos a preencher agora
-        // O nmero de caracteres a ler do 'input' para esta coluna (original_col_index_to_fill)
-        //  o seu tamanho, que foi calculado em col_counts[original_col_index_to_fill].
-        int num_chars_for_this_col = col_counts[original_col_index_to_fill];
-
-        for (int j = 0; j < num_chars_for_this_col; j++) {
-            if (pos < len) {
-                columns[original_col_index_to_fill][j] = input[pos++];
-            } else {
-                // Erro: input mais curto que o esperado pelos comprimentos das colunas.
-                // Preencher o resto com nulos ou retornar erro?
-                // Por agora, apenas para.
-                return;
-            }
-        }
-    }
-}
-
-
-/**
- * @brief Reverte a organizacao em colunas, reconstruindo a sequencia de simbolos linha a linha.
- * (Funcao auxiliar estatica - logica do utilizador)
- */
-static void reverse_polybius(char columns[][MAX_MESSAGE_LENGTH], int col_counts[], int key_length, char *output)
-{
-    if (key_length <= 0 || !output) {
-        if (output) output[0] = '\0';
-        return;
-    }
-
-    int max_rows = 0, pos = 0;
-
-    for (int i = 0; i < key_length; i++)
-    {
-        if (col_counts[i] > max_rows)
-            max_rows = col_counts[i];
-    }
-
-    for (int r = 0; r < max_rows; r++)
-    {
-        for (int c = 0; c < key_length; c++) // Itera sobre as colunas na ordem original da chave
-        {
-            if (r < col_counts[c]) // Se a coluna 'c' tiver um simbolo na linha 'r'
-            {
-                if (pos < MAX_MESSAGE_LENGTH * 2) { // Protege o buffer de saida 'output' (rearranged)
-                    output[pos++] = columns[c][r];
-                } else {
-                    if (output) output[pos] = '\0'; // Tenta terminar a string
-                    return; // Buffer de saida cheio
-                }
-            }
-        }
-    }
-    if (output) output[pos] = '\0'; // Termina a string de saida
-}
-
-/**
- * @brief Decodifica pares de simbolos ADFGVX em caracteres da matriz Polybius.
- * (Funcao auxiliar estatica - logica do utilizador)
- */
-static void decode_symbols(char *pairs, char *message)
-{
-    if (!pairs || !message) return;
-
-    int len = strlen(pairs);
-    int msg_index = 0;
-
-    if (len % 2 != 0) {
-        message[0] = '\0'; // Nao pode decodificar numero impar de simbolos
-        return;
-    }
-
-    for (int i = 0; i < len; i += 2)
-    {
-        int row = symbol_index(pairs[i]);
-        int col = symbol_index(pairs[i + 1]);
-        if (row >= 0 && col >= 0) // Se o par de simbolos e valido
-        {
-            if (msg_index < MAX_MESSAGE_LENGTH - 1) { // Protege o buffer de saida 'message'
-                message[msg_index++] = square[row][col];
-            } else {
-                break; // Buffer de mensagem cheio
-            }
-        } else {
-            // Par de simbolos invalido.
-            // O comportamento original era parar. Mantendo isso.
-            break;
-        }
-    }
-    message[msg_index] = '\0'; // Termina a string da mensagem decifrada
-}
-
-// Implementacao da funcao publica
-void decipher_adfgvx(char *encrypted_text, char *key, int key_length, char *output)
-{
-    // Validacao basica de parametros
-    if (!encrypted_text || !key || !output || key_length <= 0 || key_length >= MAX_KEY_LENGTH) {
-        if (output) output[0] = '\0';
-        return;
-    }
-    if (strlen(encrypted_text) == 0) {
-        output[0] = '\0';
-        return;
-    }
-
-    // VLAs para 'columns' e 'col_counts'.
-    char columns[key_length][MAX_MESSAGE_LENGTH];
-    int col_counts[key_length];
-    //  crucial zerar col_counts e columns antes de us-los,
-    // especialmente porque reverse_transposition pode no preencher todas as partes se len for 0.
-    memset(col_counts, 0, key_length * sizeof(int));
-    for(int i=0; i<key_length; ++i) {
-        memset(columns[i], 0, MAX_MESSAGE_LENGTH * sizeof(char));
-    }
-
-    // Buffer para a sequencia de simbolos apos reverter a transposicao.
-    // O tamanho mximo  o mesmo do texto cifrado (que pode ser at MAX_MESSAGE_LENGTH * 2).
-    char rearranged_symbols[MAX_MESSAGE_LENGTH * 2 + 1]; // +1 para o nulo
-
-    reverse_transposition(encrypted_text, key, key_length, columns, col_counts);
-    reverse_polybius(columns, col_counts, key_length, rearranged_symbols);
-    decode_symbols(rearranged_symbols, output);
-}
+#define _POSIX_C_SOURCE 200809L // Para fseeko com -std=c99
+#define _FILE_OFFSET_BITS 64    // off_t de 64 bits tambem nas plataformas de 32 bits
+
+#include "cipher_config.h"
+#include "adfgvx_decipher.h"
+#include "adfgvx_codec.h"
+#include "adfgvx_key.h"
+#include "adfgvx_stats.h"
+#include "adfgvx_transpose.h"
+#include "file_operations.h" // Para read_file_at
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+// As constantes symbols e square ficam no codec compartilhado (adfgvx_codec.c),
+// que decodifica cada par de simbolos em O(1) (adfgvx_decode_pair).
+
+// Decifragem por coleta direta (direct gather).
+//
+// A versao anterior montava a matriz columns[key_length][MAX_MESSAGE_LENGTH] a partir do
+// texto cifrado (reverse_transposition), copiava-a linha a linha para uma sequencia de
+// simbolos (reverse_polybius) e so entao decodificava os pares (decode_symbols).
+// Como a coluna original c tem rows + (c < extra ? 1 : 0) simbolos e as colunas aparecem
+// no texto cifrado na ordem alfabetica da chave, a posicao de cada simbolo no texto cifrado
+// e calculavel (adfgvx_key_column_starts): basta percorrer os simbolos na ordem original,
+// buscar cada um na sua posicao e decodificar os pares diretamente na saida.
+
+/**
+ * @brief Laco generico de gather_pairs: busca e decodifica count pares a partir da coluna *col.
+ * (Funcao auxiliar estatica)
+ *
+ * @param col Entrada e saida: coluna original do proximo simbolo.
+ * @return size_t Numero de pares decodificados (para no primeiro par invalido).
+ */
+static size_t gather_pairs_generic(int key_length,
+                                   size_t next_position[],
+                                   int *col,
+                                   const char *encrypted_text,
+                                   size_t count,
+                                   char *output)
+{
+    int c = *col;
+    size_t written = 0;
+
+    for (; written < count; written++)
+    {
+        char row_symbol = encrypted_text[next_position[c]++];
+        c = (c + 1 == key_length) ? 0 : c + 1;
+        char col_symbol = encrypted_text[next_position[c]++];
+        c = (c + 1 == key_length) ? 0 : c + 1;
+
+        int decoded = adfgvx_decode_pair(row_symbol, col_symbol);
+        if (decoded < 0)
+        {
+            break;
+        }
+        output[written] = (char)decoded;
+    }
+    *col = c;
+    return written;
+}
+
+/**
+ * @brief Decodifica count pares seguidos de symbols.
+ * (Funcao auxiliar estatica)
+ *
+ * @return size_t Numero de pares decodificados (para no primeiro par invalido).
+ */
+static size_t decode_run(const char *symbols, size_t count, char *output)
+{
+    for (size_t p = 0; p < count; p++)
+    {
+        int decoded = adfgvx_decode_pair(symbols[2 * p], symbols[2 * p + 1]);
+        if (decoded < 0)
+        {
+            return p;
+        }
+        output[p] = (char)decoded;
+    }
+    return count;
+}
+
+/**
+ * @brief Le tile_count ladrilhos de ADFGVX_TILE_ROWS linhas inteiras (a partir da coluna 0)
+ * para tile, coluna por coluna (adfgvx_transpose_gather_tile), e decodifica os pares de
+ * cada ladrilho em sequencia, duas linhas (key_length pares) por vez: com key_length impar,
+ * o par do meio junta o ultimo simbolo de uma linha ao primeiro da seguinte.
+ * (Funcao auxiliar estatica)
+ *
+ * @param tile Area de ADFGVX_TILE_ROWS * adfgvx_transpose_tile_pitch(key_length) bytes.
+ * @return size_t Numero de pares decodificados; menor que tile_count * ADFGVX_TILE_ROWS / 2
+ * * key_length se um par invalido for encontrado (next_position fica indefinido).
+ */
+static size_t gather_pair_tiles(int key_length,
+                                size_t next_position[],
+                                const char *encrypted_text,
+                                size_t tile_count,
+                                char *tile,
+                                char *output)
+{
+    size_t k = (size_t)key_length;
+    size_t pitch = adfgvx_transpose_tile_pitch(key_length);
+    size_t half = k / 2; // Pares inteiros dentro de cada linha.
+    size_t written = 0;
+
+    for (size_t t = 0; t < tile_count; t++)
+    {
+        adfgvx_transpose_gather_tile(key_length, next_position, encrypted_text, ADFGVX_TILE_ROWS, pitch, tile);
+        for (size_t r = 0; r < ADFGVX_TILE_ROWS; r += 2)
+        {
+            const char *first = tile + r * pitch;
+            const char *second = first + pitch;
+            size_t decoded = decode_run(first, half, output + written);
+            written += decoded;
+            if (decoded < half)
+            {
+                return written;
+            }
+            if (k % 2 != 0)
+            {
+                int middle = adfgvx_decode_pair(first[k - 1], second[0]);
+                if (middle < 0)
+                {
+                    return written;
+                }
+                output[written++] = (char)middle;
+            }
+            decoded = decode_run(second + k % 2, half, output + written);
+            written += decoded;
+            if (decoded < half)
+            {
+                return written;
+            }
+        }
+    }
+    return written;
+}
+
+/**
+ * @brief Busca no texto cifrado e decodifica os pares first_pair .. first_pair + pair_count - 1
+ * da sequencia original de simbolos, gravando-os em output[0 .. pair_count - 1].
+ * Com um kernel especializado para key_length (adfgvx_transpose_kernels_for), ou com
+ * ladrilhos nas chaves longas, so os pares ate a primeira linha que comeca num par e os do
+ * fim usam o laco generico.
+ * (Funcao auxiliar estatica)
+ *
+ * @param key_length Comprimento da chave.
+ * @param next_position Entrada: inicio de cada coluna original no texto cifrado
+ * (adfgvx_key_ctx_column_starts). E usado como cursor de leitura de cada coluna (alterado).
+ * @return size_t Numero de pares decodificados; menor que pair_count se um par invalido
+ * for encontrado (a decodificacao para nele).
+ */
+static size_t gather_pairs(int key_length,
+                           size_t next_position[],
+                           const char *encrypted_text,
+                           size_t first_pair,
+                           size_t pair_count,
+                           char *output)
+{
+    size_t first_symbol = 2 * first_pair;
+    int col = (int)(first_symbol % (size_t)key_length);
+    size_t row = first_symbol / (size_t)key_length;
+
+    // As colunas anteriores a col ja entregaram o simbolo da linha atual.
+    for (int c = 0; c < key_length; c++)
+    {
+        next_position[c] += row + (c < col);
+    }
+
+    const adfgvx_transpose_kernels *kernels = adfgvx_transpose_kernels_for(key_length);
+    size_t tile_pairs = ADFGVX_TILE_ROWS / 2 * (size_t)key_length;
+    char *tile = NULL;
+    if (kernels == NULL && adfgvx_transpose_tiled_enabled() && pair_count >= tile_pairs + (size_t)key_length)
+    {
+        tile = malloc(ADFGVX_TILE_ROWS * adfgvx_transpose_tile_pitch(key_length)); // Sem memoria, o laco generico.
+    }
+    size_t written;
+    ADFGVX_STATS_BEGIN(stage_start);
+    if (kernels == NULL && tile == NULL)
+    {
+        written = gather_pairs_generic(key_length, next_position, &col, encrypted_text, pair_count, output);
+    }
+    else
+    {
+        // Pares avulsos ate um par comecar na coluna 0 (no maximo key_length pares).
+        size_t head = 0;
+        for (int c = col; c != 0 && head < pair_count; head++)
+        {
+            c += 2;
+            c = c >= key_length ? c - key_length : c;
+        }
+        written = gather_pairs_generic(key_length, next_position, &col, encrypted_text, head, output);
+        if (written == head && tile != NULL)
+        {
+            // Ladrilhos inteiros; o resto no laco generico.
+            size_t tile_count = (pair_count - head) / tile_pairs;
+            size_t decoded = gather_pair_tiles(key_length, next_position, encrypted_text, tile_count, tile, output + written);
+            written += decoded;
+            if (decoded == tile_count * tile_pairs)
+            {
+                written += gather_pairs_generic(key_length, next_position, &col, encrypted_text,
+                                                pair_count - written, output + written);
+            }
+        }
+        else if (written == head)
+        {
+            // Blocos de key_length pares (duas linhas inteiras) no kernel; o resto no laco generico.
+            size_t block_pairs = (pair_count - head) / (size_t)key_length * (size_t)key_length;
+            size_t decoded = kernels->gather_rows(next_position, encrypted_text, block_pairs / (size_t)key_length, output + written);
+            written += decoded;
+            if (decoded == block_pairs)
+            {
+                written += gather_pairs_generic(key_length, next_position, &col, encrypted_text,
+                                                pair_count - written, output + written);
+            }
+        }
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_DECODE, stage_start, 2 * written);
+    free(tile);
+    return written;
+}
+
+/**
+ * @brief Desfaz a transposicao de simbolos sem decodifica-los: output[i] recebe o simbolo
+ * da coluna i % key_length, na linha i / key_length. Nas chaves longas, as linhas inteiras
+ * sao lidas em ladrilhos (adfgvx_transpose_gather_tile); o resto, coluna por coluna.
+ * (Funcao auxiliar estatica)
+ *
+ * @param next_position Entrada: inicio de cada coluna (adfgvx_key_ctx_column_starts).
+ * E usado como cursor de leitura de cada coluna (alterado).
+ */
+static void gather_symbols(int key_length,
+                           size_t next_position[],
+                           const char *encrypted_text,
+                           size_t symbol_count,
+                           char *output)
+{
+    size_t k = (size_t)key_length;
+    size_t rows = symbol_count / k;
+    size_t row = 0;
+    char *tile = NULL;
+
+    if (adfgvx_transpose_kernels_for(key_length) == NULL && adfgvx_transpose_tiled_enabled() && rows >= ADFGVX_TILE_ROWS)
+    {
+        tile = malloc(ADFGVX_TILE_ROWS * adfgvx_transpose_tile_pitch(key_length)); // Sem memoria, coluna por coluna.
+    }
+    ADFGVX_STATS_BEGIN(stage_start);
+    if (tile != NULL)
+    {
+        size_t pitch = adfgvx_transpose_tile_pitch(key_length);
+        for (; row + ADFGVX_TILE_ROWS <= rows; row += ADFGVX_TILE_ROWS)
+        {
+            adfgvx_transpose_gather_tile(key_length, next_position, encrypted_text, ADFGVX_TILE_ROWS, pitch, tile);
+            for (size_t r = 0; r < ADFGVX_TILE_ROWS; r++)
+            {
+                memcpy(output + (row + r) * k, tile + r * pitch, k);
+            }
+        }
+        free(tile);
+    }
+    // Linhas restantes, coluna por coluna: cada coluna e lida em sequencia e gravada com passo k.
+    size_t remaining = symbol_count - row * k;
+    for (size_t c = 0; c < k; c++)
+    {
+        size_t count = remaining / k + (c < remaining % k);
+        const char *column = encrypted_text + next_position[c];
+        char *target = output + row * k + c;
+        for (size_t i = 0; i < count; i++)
+        {
+            target[i * k] = column[i];
+        }
+        next_position[c] += count;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_TRANSPOSE, stage_start, symbol_count);
+}
+
+/**
+ * @brief Corpo de decipher_adfgvx_direct_ctx, com o espaco para o inicio das colunas
+ * (key_length posicoes) fornecido pelo chamador.
+ * (Funcao auxiliar estatica)
+ */
+static int decipher_direct_with_starts(const adfgvx_key_ctx *key_ctx,
+                                       const char *encrypted_text,
+                                       size_t encrypted_length,
+                                       char *output,
+                                       size_t output_capacity,
+                                       size_t *output_length,
+                                       size_t column_start[])
+{
+    adfgvx_key_ctx_column_starts(key_ctx, encrypted_length, column_start);
+
+    size_t pairs = encrypted_length / 2;
+    size_t limit = pairs < output_capacity ? pairs : output_capacity;
+    size_t written = gather_pairs(key_ctx->key_length, column_start, encrypted_text, 0, limit, output);
+
+    *output_length = written;
+    if (written < limit)
+    {
+        return 3; // Par de simbolos invalido: a decodificacao para aqui.
+    }
+    return written < pairs ? 2 : 0;
+}
+
+/**
+ * @brief Validacao comum de decipher_adfgvx_direct_ctx e decipher_adfgvx_ws.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 se os parametros forem validos, ou o codigo de erro a retornar.
+ */
+static int check_direct_params(const char *encrypted_text,
+                               size_t encrypted_length,
+                               const char *output,
+                               size_t *output_length)
+{
+    if (!encrypted_text || !output_length)
+    {
+        return 1;
+    }
+    *output_length = 0;
+    if (encrypted_length % 2 != 0)
+    {
+        return 3; // Nao pode decodificar numero impar de simbolos
+    }
+    if (encrypted_length > 0 && !output)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+int decipher_adfgvx_direct_ctx(const adfgvx_key_ctx *key_ctx,
+                               const char *encrypted_text,
+                               size_t encrypted_length,
+                               char *output,
+                               size_t output_capacity,
+                               size_t *output_length)
+{
+    if (!key_ctx)
+    {
+        return 1;
+    }
+    int status = check_direct_params(encrypted_text, encrypted_length, output, output_length);
+    if (status != 0)
+    {
+        return status;
+    }
+
+    size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+    size_t *column_start = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, (size_t)key_ctx->key_length);
+    if (column_start == NULL)
+    {
+        return 4;
+    }
+    status = decipher_direct_with_starts(key_ctx, encrypted_text, encrypted_length, output, output_capacity, output_length, column_start);
+    adfgvx_key_scratch_free(column_start, stack_start);
+    return status;
+}
+
+/**
+ * @brief Valida os parametros de uma decifragem de trecho e calcula quantos pares decodificar.
+ * (Funcao auxiliar estatica)
+ *
+ * @param pair_count Saida: pares do trecho (que termina no fim da mensagem), limitados
+ * pela capacidade da saida.
+ * @param truncated Saida: 1 se a capacidade da saida cortou o trecho.
+ * @return int 0 se os parametros forem validos, 1 caso contrario.
+ */
+static int prepare_range(const adfgvx_key_ctx *key_ctx,
+                         size_t encrypted_length,
+                         size_t offset,
+                         size_t length,
+                         const char *output,
+                         size_t output_capacity,
+                         size_t *output_length,
+                         size_t *pair_count,
+                         int *truncated)
+{
+    size_t pairs = encrypted_length / 2;
+
+    if (!key_ctx || !output_length || (!output && output_capacity > 0) || encrypted_length % 2 != 0 || offset > pairs)
+    {
+        return 1;
+    }
+
+    size_t available = pairs - offset < length ? pairs - offset : length;
+    *pair_count = available < output_capacity ? available : output_capacity;
+    *truncated = available > output_capacity;
+    *output_length = 0;
+    return 0;
+}
+
+int decipher_adfgvx_range_ctx(const adfgvx_key_ctx *key_ctx,
+                              const char *encrypted_text,
+                              size_t encrypted_length,
+                              size_t offset,
+                              size_t length,
+                              char *output,
+                              size_t output_capacity,
+                              size_t *output_length)
+{
+    size_t pair_count = 0;
+    int truncated = 0;
+
+    if (!encrypted_text ||
+        prepare_range(key_ctx, encrypted_length, offset, length, output, output_capacity, output_length, &pair_count, &truncated) != 0)
+    {
+        return 1;
+    }
+
+    if (pair_count > 0)
+    {
+        size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+        size_t *column_start = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, (size_t)key_ctx->key_length);
+        if (column_start == NULL)
+        {
+            return 4;
+        }
+        adfgvx_key_ctx_column_starts(key_ctx, encrypted_length, column_start);
+
+        *output_length = gather_pairs(key_ctx->key_length, column_start, encrypted_text, offset, pair_count, output);
+        adfgvx_key_scratch_free(column_start, stack_start);
+        if (*output_length < pair_count)
+        {
+            return 3;
+        }
+    }
+    return truncated ? 2 : 0;
+}
+
+int decipher_adfgvx_file_range(const adfgvx_key_ctx *key_ctx,
+                               FILE *encrypted_file,
+                               size_t encrypted_length,
+                               size_t offset,
+                               size_t length,
+                               char *output,
+                               size_t output_capacity,
+                               size_t *output_length)
+{
+    size_t pair_count = 0;
+    int truncated = 0;
+
+    if (!encrypted_file ||
+        prepare_range(key_ctx, encrypted_length, offset, length, output, output_capacity, output_length, &pair_count, &truncated) != 0)
+    {
+        return 1;
+    }
+    if (pair_count == 0)
+    {
+        return truncated ? 2 : 0;
+    }
+
+    // Os simbolos first .. last do trecho ocupam, em cada coluna, uma faixa contigua de
+    // linhas: uma leitura posicionada por coluna os traz para um buffer compacto.
+    size_t k = (size_t)key_ctx->key_length;
+    size_t first = 2 * offset;
+    size_t last = 2 * (offset + pair_count) - 1;
+    size_t stack_scratch[3 * ADFGVX_KEY_STACK_COLUMNS];
+    size_t *column_start = adfgvx_key_scratch(stack_scratch, 3 * ADFGVX_KEY_STACK_COLUMNS, 3 * k);
+    size_t compact_length = 0;
+
+    if (column_start == NULL)
+    {
+        return 4;
+    }
+    size_t *first_row = column_start + k;
+    size_t *row_count = first_row + k;
+    adfgvx_key_ctx_column_starts(key_ctx, encrypted_length, column_start);
+    for (size_t c = 0; c < k; c++)
+    {
+        size_t end_row = last / k + (c <= last % k ? 1 : 0); // Uma linha apos a ultima usada.
+
+        first_row[c] = first / k + (c < first % k ? 1 : 0);
+        row_count[c] = end_row > first_row[c] ? end_row - first_row[c] : 0;
+        compact_length += row_count[c];
+    }
+
+    char *compact = malloc(compact_length);
+    if (compact == NULL)
+    {
+        adfgvx_key_scratch_free(column_start, stack_scratch);
+        return 4;
+    }
+
+    // column_start[c] passa a ser o inicio da coluna no buffer compacto, depois de lida.
+    size_t position = 0;
+    for (size_t c = 0; c < k; c++)
+    {
+        if (row_count[c] > 0 && read_file_at(encrypted_file, column_start[c] + first_row[c], compact + position, row_count[c]) != 0)
+        {
+            free(compact);
+            adfgvx_key_scratch_free(column_start, stack_scratch);
+            return 4;
+        }
+        // Inicio "virtual" da coluna no buffer compacto, para que column_start[c] + linha
+        // caia na faixa lida (a aritmetica sem sinal e modular, como em gather_pairs).
+        column_start[c] = position - first_row[c];
+        position += row_count[c];
+    }
+
+    *output_length = gather_pairs(key_ctx->key_length, column_start, compact, offset, pair_count, output);
+    free(compact);
+    adfgvx_key_scratch_free(column_start, stack_scratch);
+    if (*output_length < pair_count)
+    {
+        return 3;
+    }
+    return truncated ? 2 : 0;
+}
+
+int decipher_adfgvx_ws(adfgvx_workspace *ws,
+                       const char *encrypted_text,
+                       size_t encrypted_length,
+                       const char *key,
+                       int key_length,
+                       char *output,
+                       size_t output_capacity,
+                       size_t *output_length)
+{
+    if (!ws || !key || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+    int status = check_direct_params(encrypted_text, encrypted_length, output, output_length);
+    if (status != 0)
+    {
+        return status;
+    }
+    if (adfgvx_workspace_reserve(ws, ADFGVX_WORKSPACE_KEY_BYTES(key_length)) != 0)
+    {
+        return 4;
+    }
+
+    // Agenda da chave e inicio das colunas na arena, devolvidos ao fim da chamada.
+    size_t mark = adfgvx_workspace_mark(ws);
+    adfgvx_key_ctx key_ctx;
+    adfgvx_key_ctx_init_ws(&key_ctx, key, key_length, ws);
+    size_t *column_start = adfgvx_workspace_alloc(ws, (size_t)key_length * sizeof(size_t));
+    status = decipher_direct_with_starts(&key_ctx, encrypted_text, encrypted_length, output, output_capacity, output_length, column_start);
+    adfgvx_workspace_release(ws, mark);
+    return status;
+}
+
+int decipher_adfgvx_direct(const char *encrypted_text,
+                           size_t encrypted_length,
+                           const char *key,
+                           int key_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length)
+{
+    // Chaves curtas usam uma arena fixa na pilha (nenhuma alocacao); as longas, uma no heap.
+    unsigned char stack_workspace[ADFGVX_WORKSPACE_KEY_BYTES(ADFGVX_KEY_STACK_COLUMNS)];
+    adfgvx_workspace ws;
+    int short_key = key_length <= ADFGVX_KEY_STACK_COLUMNS;
+
+    adfgvx_workspace_init(&ws, short_key ? stack_workspace : NULL, short_key ? sizeof(stack_workspace) : 0);
+    int status = decipher_adfgvx_ws(&ws, encrypted_text, encrypted_length, key, key_length, output, output_capacity, output_length);
+    adfgvx_workspace_free(&ws);
+    return status;
+}
+
+size_t decipher_adfgvx_batch(const adfgvx_key_ctx *key_ctx, adfgvx_batch_item items[], size_t count)
+{
+    size_t failures = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        adfgvx_batch_item *item = &items[i];
+
+        item->status = decipher_adfgvx_direct_ctx(key_ctx, item->input, item->input_length,
+                                                  item->output, item->output_capacity, &item->output_length);
+        failures += item->status != 0;
+    }
+    return failures;
+}
+
+/**
+ * @brief Estado compartilhado pelas tarefas de decipher_adfgvx_parallel.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    int key_length;
+    const size_t *column_start;
+    size_t *cursors;        // key_length cursores de leitura por tarefa.
+    const char *encrypted_text;
+    size_t pair_count;      // Pares a decodificar (ja limitados pela capacidade da saida).
+    size_t chunk_pairs;     // Pares por tarefa (a ultima pode ter menos).
+    size_t *chunk_decoded;  // Pares decodificados por cada tarefa antes de um par invalido.
+    char *output;
+} parallel_decipher_job;
+
+static void parallel_gather_task(void *user, size_t chunk)
+{
+    parallel_decipher_job *job = user;
+    size_t first = chunk * job->chunk_pairs;
+    size_t count = job->pair_count - first < job->chunk_pairs ? job->pair_count - first : job->chunk_pairs;
+    size_t *cursors = job->cursors + chunk * (size_t)job->key_length;
+
+    memcpy(cursors, job->column_start, (size_t)job->key_length * sizeof(size_t));
+    job->chunk_decoded[chunk] = gather_pairs(job->key_length, cursors, job->encrypted_text,
+                                             first, count, job->output + first);
+}
+
+int decipher_adfgvx_parallel(const adfgvx_key_ctx *key_ctx,
+                             const char *encrypted_text,
+                             size_t encrypted_length,
+                             char *output,
+                             size_t output_capacity,
+                             size_t *output_length,
+                             thread_pool *pool,
+                             size_t parallel_threshold)
+{
+    if (!pool || thread_pool_size(pool) < 2 || encrypted_length < parallel_threshold ||
+        !key_ctx || !encrypted_text || !output_length || !output || encrypted_length % 2 != 0)
+    {
+        return decipher_adfgvx_direct_ctx(key_ctx, encrypted_text, encrypted_length, output, output_capacity, output_length);
+    }
+
+    size_t pairs = encrypted_length / 2;
+    parallel_decipher_job job;
+    job.key_length = key_ctx->key_length;
+    job.encrypted_text = encrypted_text;
+    job.pair_count = pairs < output_capacity ? pairs : output_capacity;
+    job.output = output;
+
+    size_t chunk_count = (size_t)thread_pool_size(pool) * ADFGVX_PARALLEL_CHUNKS_PER_THREAD;
+    job.chunk_pairs = (job.pair_count + chunk_count - 1) / chunk_count;
+    if (job.chunk_pairs == 0)
+    {
+        return decipher_adfgvx_direct_ctx(key_ctx, encrypted_text, encrypted_length, output, output_capacity, output_length);
+    }
+    chunk_count = (job.pair_count + job.chunk_pairs - 1) / job.chunk_pairs;
+
+    // Um bloco: pares de cada tarefa, inicio das colunas e os cursores de cada tarefa.
+    job.chunk_decoded = malloc((chunk_count + (chunk_count + 1) * (size_t)job.key_length) * sizeof(size_t));
+    if (job.chunk_decoded == NULL)
+    {
+        return decipher_adfgvx_direct_ctx(key_ctx, encrypted_text, encrypted_length, output, output_capacity, output_length);
+    }
+    size_t *column_start = job.chunk_decoded + chunk_count;
+    adfgvx_key_ctx_column_starts(key_ctx, encrypted_length, column_start);
+    job.column_start = column_start;
+    job.cursors = column_start + job.key_length;
+
+    adfgvx_codec_init();
+    thread_pool_run(pool, chunk_count, parallel_gather_task, &job);
+
+    // Como na versao sequencial, a saida valida termina no primeiro par invalido.
+    size_t written = 0;
+    int status = job.pair_count < pairs ? 2 : 0;
+    for (size_t i = 0; i < chunk_count; i++)
+    {
+        size_t first = i * job.chunk_pairs;
+        size_t count = job.pair_count - first < job.chunk_pairs ? job.pair_count - first : job.chunk_pairs;
+
+        written += job.chunk_decoded[i];
+        if (job.chunk_decoded[i] < count)
+        {
+            status = 3;
+            break;
+        }
+    }
+    free(job.chunk_decoded);
+
+    *output_length = written;
+    return status;
+}
+
+int decipher_adfgvx_rounds(const adfgvx_key_ctx keys[],
+                           int round_count,
+                           const char *encrypted_text,
+                           size_t encrypted_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length)
+{
+    if (!keys || round_count < 1 || round_count > ADFGVX_MAX_ROUNDS)
+    {
+        return 1;
+    }
+    int status = check_direct_params(encrypted_text, encrypted_length, output, output_length);
+    if (status != 0 || encrypted_length == 0)
+    {
+        return status;
+    }
+
+    adfgvx_rounds_map map;
+    status = adfgvx_rounds_map_init(&map, keys, round_count, encrypted_length);
+    if (status != 0)
+    {
+        return status == 1 ? 1 : 4;
+    }
+
+    size_t pairs = encrypted_length / 2;
+    size_t limit = pairs < output_capacity ? pairs : output_capacity;
+    size_t written = 0;
+    if (map.period > 0)
+    {
+        // As rodadas sao uma transposicao de map.period colunas virtuais: coleta direta.
+        written = gather_pairs(map.period, map.period_start, encrypted_text, 0, limit, output);
+    }
+    else
+    {
+        // Periodo longo demais: desfaz as rodadas da ultima para a segunda, uma passagem por
+        // rodada entre dois buffers auxiliares; a primeira e desfeita pela coleta dos pares.
+        char *scratch = malloc((round_count > 2 ? 2 : 1) * encrypted_length);
+        if (scratch == NULL)
+        {
+            adfgvx_rounds_map_free(&map);
+            return 4;
+        }
+        const char *source = encrypted_text;
+        for (int r = round_count - 1; r > 0; r--)
+        {
+            char *target = scratch + (size_t)((round_count - 1 - r) % 2) * encrypted_length;
+            gather_symbols(map.key_length[r], map.column_start[r], source, encrypted_length, target);
+            source = target;
+        }
+        written = gather_pairs(map.key_length[0], map.column_start[0], source, 0, limit, output);
+        free(scratch);
+    }
+    adfgvx_rounds_map_free(&map);
+
+    *output_length = written;
+    if (written < limit)
+    {
+        return 3; // Par de simbolos invalido: a decodificacao para aqui.
+    }
+    return written < pairs ? 2 : 0;
+}
+
+// Implementacao da funcao publica
+void decipher_adfgvx(char *encrypted_text, char *key, int key_length, char *output)
+{
+    size_t decoded_length = 0;
+
+    if (!output) {
+        return;
+    }
+
+    // Mesmo contrato de antes: saida de ate MAX_MESSAGE_LENGTH - 1 caracteres, vazia para
+    // entradas invalidas ou numero impar de simbolos, e truncada no primeiro par invalido.
+    // decipher_adfgvx_direct ja grava o prefixo valido em output nesses casos.
+    if (encrypted_text && strlen(encrypted_text) % 2 == 0) {
+        decipher_adfgvx_direct(encrypted_text, strlen(encrypted_text), key, key_length,
+                               output, MAX_MESSAGE_LENGTH - 1, &decoded_length);
+    }
+    output[decoded_length] = '\0';
+}
+
+int adfgvx_decipher_stream_init(adfgvx_decipher_stream *ctx, const char *key, int key_length)
+{
+    if (!ctx || !key || key_length <= 0 || key_length > ADFGVX_STREAM_MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+
+    adfgvx_codec_init();
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->key_length = key_length;
+    adfgvx_key_column_order(key, key_length, ctx->column_order);
+
+    ctx->spill = tmpfile();
+    if (ctx->spill == NULL)
+    {
+        return 2;
+    }
+    return 0;
+}
+
+int adfgvx_decipher_stream_update(adfgvx_decipher_stream *ctx, const char *chunk, size_t length)
+{
+    size_t run_start = 0;
+
+    // Escreve os trechos entre quebras de linha diretamente no arquivo temporario.
+    for (size_t i = 0; i <= length; i++)
+    {
+        if (i == length || chunk[i] == '\r' || chunk[i] == '\n')
+        {
+            size_t run = i - run_start;
+
+            if (run > 0 && fwrite(chunk + run_start, 1, run, ctx->spill) != run)
+            {
+                return 1;
+            }
+            ctx->symbol_count += run;
+            run_start = i + 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Cursor de leitura de uma coluna dentro do arquivo temporario.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    unsigned long long next_offset; // Posicao, no arquivo, do proximo simbolo ainda nao carregado.
+    unsigned long long remaining;   // Simbolos da coluna ainda nao carregados.
+    char *buffer;      // Buffer de ADFGVX_STREAM_BUFFER_SIZE bytes da coluna.
+    size_t position;   // Proximo simbolo a consumir no buffer.
+    size_t filled;     // Simbolos validos no buffer.
+} column_cursor;
+
+/**
+ * @brief Posiciona o arquivo temporario em offset, com deslocamento de 64 bits.
+ * (Funcao auxiliar estatica)
+ *
+ * fseek recebe um long, de 32 bits no Windows e nas plataformas de 32 bits: o arquivo
+ * temporario passa de 2 GiB com cerca de 1 GiB de mensagem.
+ *
+ * @return int 0 em caso de sucesso, diferente de 0 em caso de erro.
+ */
+static int seek_spill(FILE *spill, unsigned long long offset)
+{
+#ifdef _WIN32
+    return _fseeki64(spill, (long long)offset, SEEK_SET);
+#else
+    return fseeko(spill, (off_t)offset, SEEK_SET);
+#endif
+}
+
+/**
+ * @brief Retorna o proximo simbolo da coluna, recarregando o buffer quando necessario.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int O simbolo (0..255), ou -1 em caso de erro de leitura ou fim da coluna.
+ */
+static int next_column_symbol(FILE *spill, column_cursor *cursor)
+{
+    if (cursor->position == cursor->filled)
+    {
+        size_t wanted = cursor->remaining < ADFGVX_STREAM_BUFFER_SIZE ? (size_t)cursor->remaining : ADFGVX_STREAM_BUFFER_SIZE;
+
+        if (wanted == 0 || seek_spill(spill, cursor->next_offset) != 0 ||
+            fread(cursor->buffer, 1, wanted, spill) != wanted)
+        {
+            return -1;
+        }
+        cursor->next_offset += wanted;
+        cursor->remaining -= wanted;
+        cursor->position = 0;
+        cursor->filled = wanted;
+    }
+    return (unsigned char)cursor->buffer[cursor->position++];
+}
+
+int adfgvx_decipher_stream_final(adfgvx_decipher_stream *ctx, FILE *output)
+{
+    int key_length = ctx->key_length;
+    unsigned long long total = ctx->symbol_count;
+    column_cursor cursors[ADFGVX_STREAM_MAX_KEY_LENGTH];
+    char *buffers = NULL;
+    char *out_buffer = NULL;
+    size_t out_filled = 0;
+    int status = 0;
+
+    if (output == NULL || total == 0)
+    {
+        fclose(ctx->spill);
+        return 0;
+    }
+    if (total % 2 != 0)
+    {
+        fclose(ctx->spill);
+        return 2; // Nao pode decodificar numero impar de simbolos
+    }
+
+    buffers = malloc((size_t)(key_length + 1) * ADFGVX_STREAM_BUFFER_SIZE);
+    if (buffers == NULL || fflush(ctx->spill) != 0)
+    {
+        free(buffers);
+        fclose(ctx->spill);
+        return 1;
+    }
+    out_buffer = buffers + (size_t)key_length * ADFGVX_STREAM_BUFFER_SIZE;
+
+    // A coluna original c tem rows + 1 simbolos se c < extra, e as colunas aparecem no
+    // texto cifrado na ordem alfabetica da chave (como em adfgvx_key_column_starts).
+    unsigned long long rows = total / (unsigned long long)key_length;
+    unsigned long long extra = total % (unsigned long long)key_length;
+    unsigned long long offset = 0;
+    for (int i = 0; i < key_length; i++)
+    {
+        int col = ctx->column_order[i];
+        unsigned long long count = rows + ((unsigned long long)col < extra ? 1 : 0);
+
+        cursors[col].next_offset = offset;
+        cursors[col].remaining = count;
+        cursors[col].buffer = buffers + (size_t)col * ADFGVX_STREAM_BUFFER_SIZE;
+        cursors[col].position = 0;
+        cursors[col].filled = 0;
+        offset += count;
+    }
+
+    // Percorre os simbolos na ordem original (linha a linha) e decodifica os pares.
+    ADFGVX_STATS_BEGIN(stage_start);
+    int col = 0;
+    for (unsigned long long i = 0; i < total && status == 0; i += 2)
+    {
+        int row_symbol = next_column_symbol(ctx->spill, &cursors[col]);
+        col = (col + 1 == key_length) ? 0 : col + 1;
+        int col_symbol = next_column_symbol(ctx->spill, &cursors[col]);
+        col = (col + 1 == key_length) ? 0 : col + 1;
+
+        if (row_symbol < 0 || col_symbol < 0)
+        {
+            status = 1;
+            break;
+        }
+
+        int decoded = adfgvx_decode_pair((char)row_symbol, (char)col_symbol);
+        if (decoded < 0)
+        {
+            status = 2; // Par de simbolos invalido: a decodificacao para aqui.
+            break;
+        }
+
+        out_buffer[out_filled++] = (char)decoded;
+        if (out_filled == ADFGVX_STREAM_BUFFER_SIZE)
+        {
+            if (fwrite(out_buffer, 1, out_filled, output) != out_filled)
+            {
+                status = 1;
+            }
+            out_filled = 0;
+        }
+    }
+
+    if (status != 1 && out_filled > 0 && fwrite(out_buffer, 1, out_filled, output) != out_filled)
+    {
+        status = 1;
+    }
+    if (status != 1 && fflush(output) != 0)
+    {
+        status = 1;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_DECODE, stage_start, total);
+
+    free(buffers);
+    fclose(ctx->spill);
+    return status;
+}
@@ -0,0 +1,1007 @@
+#include "adfgvx_fuzz.h"
+#include "adfgvx_reference.h"
+#include "adfgvx_core.h"
+#include "adfgvx_decipher.h"
+#include "adfgvx_container.h"
+#include "adfgvx_codec.h"
+#include "adfgvx_transpose.h"
+#include "adfgvx_key.h"
+#include "adfgvx_packed.h"
+#include "adfgvx_workspace.h"
+#include "cipher_config.h"
+#include <stdlib.h> // Para malloc e free
+#include <string.h> // Para memcpy, memchr e memset
+
+// Maior chave comparada com as implementacoes que guardam uma coluna por chave (a matriz
+// original, os contextos de fluxo e o container, que cifra um bloco por vez).
+#define FUZZ_COLUMN_KEY_LENGTH ADFGVX_STREAM_MAX_KEY_LENGTH
+
+// Maior chave das rodadas seguintes a primeira em check_rounds.
+#define FUZZ_ROUND_KEY_LENGTH 300
+
+/**
+ * @brief Caso em execucao: os campos decodificados dos bytes, as saidas da referencia e os
+ * contadores. Todos os buffers ficam num unico bloco.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    int mode;
+    int mutation;             // Alteracao do texto cifrado (bits 2-3 do modo).
+    int short_capacity;       // Bit 4 do modo.
+    char *key;
+    int key_length;
+    char *message;
+    size_t message_length;
+    char *filtered;           // A mensagem sem os caracteres fora da matriz.
+    size_t filtered_length;
+    size_t stream_chunk;      // Bytes entregues por chamada de update.
+    size_t container_block;   // Caracteres por bloco do container.
+    unsigned int seed;
+    unsigned char replacement;
+    char *expected;           // Texto cifrado da referencia.
+    size_t expected_length;
+    char *encrypted;          // Texto cifrado decifrado pelas implementacoes (com a alteracao).
+    size_t encrypted_length;
+    char *decrypted;          // Decifragem do texto alterado pela referencia, sem limite de saida.
+    size_t decrypted_length;
+    int decrypted_status;
+    char *scratch;            // Saida das outras implementacoes.
+    size_t scratch_capacity;
+    thread_pool *pool;
+    FILE *report;
+    unsigned long long comparisons;
+    unsigned long long mismatches;
+} fuzz_case;
+
+/**
+ * @brief Gerador pseudoaleatorio (xorshift).
+ */
+static unsigned int next_random(unsigned int *state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+size_t adfgvx_fuzz_generate(unsigned int *state, size_t max_message_length, unsigned char *data)
+{
+    // Chaves em geral curtas, as vezes acima das colunas da pilha (ADFGVX_KEY_STACK_COLUMNS)
+    // ou do limite dos contextos de fluxo, e raramente perto de MAX_KEY_LENGTH.
+    unsigned int kind = next_random(state) % 20;
+    int key_length;
+    if (kind < 12)
+    {
+        key_length = 1 + (int)(next_random(state) % 16);
+    }
+    else if (kind < 17)
+    {
+        key_length = 17 + (int)(next_random(state) % 48);
+    }
+    else if (kind < 19)
+    {
+        key_length = 65 + (int)(next_random(state) % 300);
+    }
+    else
+    {
+        key_length = 1 + (int)(next_random(state) % (MAX_KEY_LENGTH - 1));
+    }
+    unsigned int raw_length = key_length <= 64 ? (unsigned int)(key_length - 1) : 0x8000u | (unsigned int)(key_length - 1);
+
+    data[0] = (unsigned char)next_random(state);
+    data[1] = (unsigned char)(raw_length & 0xFF);
+    data[2] = (unsigned char)(raw_length >> 8);
+    for (size_t i = 3; i < ADFGVX_FUZZ_HEADER_SIZE; i++)
+    {
+        data[i] = (unsigned char)next_random(state);
+    }
+
+    // Chaves com poucos caracteres distintos exercitam a ordenacao estavel das repeticoes.
+    static const char repeated[] = "ABCDE";
+    unsigned int alphabet = next_random(state) % 4;
+    unsigned char *key = data + ADFGVX_FUZZ_HEADER_SIZE;
+    for (int i = 0; i < key_length; i++)
+    {
+        unsigned int r = next_random(state);
+        key[i] = alphabet < 2 ? (unsigned char)repeated[r % 5] : alphabet == 2 ? (unsigned char)('A' + r % 26) : (unsigned char)(r >> 8);
+    }
+
+    // Mensagens de qualquer tamanho, curtas, ou com o numero de simbolos perto de um
+    // multiplo da chave (linhas completas da transposicao, mais ou menos um ou dois).
+    size_t message_length;
+    unsigned int shape = next_random(state) % 4;
+    if (shape == 0)
+    {
+        message_length = next_random(state) % (max_message_length + 1);
+    }
+    else if (shape == 1)
+    {
+        message_length = next_random(state) % 17;
+    }
+    else
+    {
+        size_t rows = next_random(state) % (2 * max_message_length / (size_t)key_length + 1);
+        size_t symbols = rows * (size_t)key_length + next_random(state) % 5;
+        symbols = symbols >= 2 ? symbols - 2 : 0;
+        message_length = (symbols + next_random(state) % 2) / 2;
+    }
+    if (message_length > max_message_length)
+    {
+        message_length = max_message_length;
+    }
+
+    unsigned char *message = key + key_length;
+    for (size_t i = 0; i < message_length; i++)
+    {
+        message[i] = (unsigned char)(next_random(state) >> 8);
+    }
+    return ADFGVX_FUZZ_HEADER_SIZE + (size_t)key_length + message_length;
+}
+
+/**
+ * @brief Registra uma comparacao com a referencia e descreve a divergencia, se houver.
+ * (Funcao auxiliar estatica)
+ */
+static void compare(fuzz_case *fc,
+                    const char *name,
+                    int status,
+                    int expected_status,
+                    const char *output,
+                    size_t length,
+                    const char *expected,
+                    size_t expected_length)
+{
+    fc->comparisons++;
+    if (status == expected_status && length == expected_length && (length == 0 || memcmp(output, expected, length) == 0))
+    {
+        return;
+    }
+
+    size_t first = 0;
+    while (first < length && first < expected_length && output[first] == expected[first])
+    {
+        first++;
+    }
+    fc->mismatches++;
+    if (fc->report != NULL)
+    {
+        fprintf(fc->report,
+                "DIVERGENCIA em %s: status %d (referencia %d), %lu bytes (referencia %lu), primeira diferenca no byte %lu; "
+                "chave de %d colunas, mensagem de %lu bytes, modo 0x%02X\n",
+                name, status, expected_status, (unsigned long)length, (unsigned long)expected_length,
+                (unsigned long)first, fc->key_length, (unsigned long)fc->message_length, (unsigned)fc->mode);
+    }
+}
+
+/**
+ * @brief Le de volta o conteudo de um arquivo temporario.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se houver erro de leitura.
+ */
+static int read_back(FILE *file, char *buffer, size_t capacity, size_t *length)
+{
+    if (fflush(file) != 0)
+    {
+        return 1;
+    }
+    rewind(file);
+    *length = fread(buffer, 1, capacity, file);
+    return ferror(file) ? 1 : 0;
+}
+
+/**
+ * @brief Decodifica os bytes do caso e aloca os buffers.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int decode_case(fuzz_case *fc, const unsigned char *data, size_t size)
+{
+    unsigned char header[ADFGVX_FUZZ_HEADER_SIZE] = {0};
+    if (size > 0)
+    {
+        memcpy(header, data, size < ADFGVX_FUZZ_HEADER_SIZE ? size : ADFGVX_FUZZ_HEADER_SIZE);
+    }
+    const unsigned char *body = size > ADFGVX_FUZZ_HEADER_SIZE ? data + ADFGVX_FUZZ_HEADER_SIZE : NULL;
+    size_t body_size = size > ADFGVX_FUZZ_HEADER_SIZE ? size - ADFGVX_FUZZ_HEADER_SIZE : 0;
+
+    fc->mode = header[0];
+    fc->mutation = (header[0] >> 2) & 3;
+    fc->short_capacity = (header[0] >> 4) & 1;
+    unsigned int raw_length = header[1] | (unsigned int)header[2] << 8;
+    fc->key_length = (raw_length & 0x8000) ? 1 + (int)((raw_length & 0x7FFF) % (MAX_KEY_LENGTH - 1)) : 1 + (int)(raw_length % 64);
+    if ((size_t)fc->key_length > body_size)
+    {
+        fc->key_length = body_size > 0 ? (int)body_size : 1;
+    }
+    fc->stream_chunk = 1 + (header[3] | (size_t)header[4] << 8);
+    fc->container_block = 1 + header[4] % 100;
+    fc->seed = header[5] | (unsigned int)header[6] << 8 | (unsigned int)header[7] << 16;
+    fc->replacement = header[7];
+
+    size_t key_bytes = body_size < (size_t)fc->key_length ? body_size : (size_t)fc->key_length;
+    size_t m = body_size - key_bytes;
+    fc->message_length = m;
+    fc->scratch_capacity = 2 * m + MAX_MESSAGE_LENGTH;
+
+    // Chave, mensagem, mensagem filtrada, texto cifrado, texto alterado, decifragem e saida.
+    char *block = malloc((size_t)fc->key_length + m + m + 2 * m + 2 * m + m + fc->scratch_capacity);
+    if (block == NULL)
+    {
+        return 2;
+    }
+    fc->key = block;
+    fc->message = fc->key + fc->key_length;
+    fc->filtered = fc->message + m;
+    fc->expected = fc->filtered + m;
+    fc->encrypted = fc->expected + 2 * m;
+    fc->decrypted = fc->encrypted + 2 * m;
+    fc->scratch = fc->decrypted + m;
+
+    memset(fc->key, 0, (size_t)fc->key_length);
+    if (key_bytes > 0)
+    {
+        memcpy(fc->key, body, key_bytes);
+    }
+
+    const char *cells = adfgvx_square_cells;
+    int cell_count = ADFGVX_SYMBOL_COUNT * ADFGVX_SYMBOL_COUNT;
+    for (size_t i = 0; i < m; i++)
+    {
+        unsigned char b = body[key_bytes + i];
+        char c;
+        switch (fc->mode & 3)
+        {
+        case 1:
+            c = cells[b % cell_count];
+            break;
+        case 2:
+            c = b < 224 ? cells[b % cell_count] : (char)b;
+            break;
+        case 3:
+            c = b % 8 == 0 ? '\n' : b % 8 == 1 ? (char)('a' + b % 26) : cells[b % cell_count];
+            break;
+        default:
+            c = (char)b;
+            break;
+        }
+        fc->message[i] = c;
+        if (c != '\0' && memchr(cells, c, (size_t)cell_count) != NULL)
+        {
+            fc->filtered[fc->filtered_length++] = c;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Cifra com o fluxo (init / update / final), em blocos de stream_chunk bytes.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se o contexto ou o arquivo temporario nao puderem ser criados.
+ */
+static int check_cipher_stream(fuzz_case *fc)
+{
+    adfgvx_cipher_stream stream;
+    FILE *output = tmpfile();
+    size_t length = 0;
+
+    if (output == NULL || adfgvx_cipher_stream_init(&stream, fc->key, fc->key_length) != 0)
+    {
+        if (output != NULL)
+        {
+            fclose(output);
+        }
+        return 2;
+    }
+    int status = 0;
+    for (size_t start = 0; start < fc->message_length && status == 0; start += fc->stream_chunk)
+    {
+        size_t chunk = fc->message_length - start < fc->stream_chunk ? fc->message_length - start : fc->stream_chunk;
+        status = adfgvx_cipher_stream_update(&stream, fc->message + start, chunk);
+    }
+    int final_status = adfgvx_cipher_stream_final(&stream, status == 0 ? output : NULL);
+    if (status == 0)
+    {
+        status = final_status;
+    }
+    if (status == 0 && read_back(output, fc->scratch, fc->scratch_capacity, &length) != 0)
+    {
+        status = 1;
+    }
+    fclose(output);
+    compare(fc, "adfgvx_cipher_stream", status, 0, fc->scratch, length, fc->expected, fc->expected_length);
+    return 0;
+}
+
+/**
+ * @brief Cifra com a matriz de colunas original (cipher_adfgvx) e le as colunas na ordem.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int check_cipher_matrix(fuzz_case *fc)
+{
+    size_t k = (size_t)fc->key_length;
+    char (*matrix)[MAX_MESSAGE_LENGTH] = malloc(k * sizeof(*matrix));
+    int *counts = calloc(2 * k, sizeof(int));
+    char *message = malloc(fc->message_length + 1);
+
+    if (matrix == NULL || counts == NULL || message == NULL)
+    {
+        free(matrix);
+        free(counts);
+        free(message);
+        return 2;
+    }
+    int *order = counts + k;
+    memcpy(message, fc->message, fc->message_length);
+    message[fc->message_length] = '\0';
+
+    cipher_adfgvx(fc->key, fc->key_length, message, matrix, counts, order);
+    size_t length = 0;
+    for (size_t i = 0; i < k; i++)
+    {
+        int col = order[i];
+        memcpy(fc->scratch + length, matrix[col], (size_t)counts[col]);
+        length += (size_t)counts[col];
+    }
+    compare(fc, "cipher_adfgvx (matriz)", 0, 0, fc->scratch, length, fc->expected, fc->expected_length);
+
+    free(matrix);
+    free(counts);
+    free(message);
+    return 0;
+}
+
+/**
+ * @brief Cifra em container (blocos de container_block caracteres), confere cada bloco com
+ * a referencia e decifra o container de volta.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se os arquivos temporarios nao puderem ser criados.
+ */
+static int check_container(fuzz_case *fc, const adfgvx_key_ctx *key_ctx)
+{
+    adfgvx_container_writer writer;
+    adfgvx_container container;
+    FILE *file = tmpfile();
+    FILE *output = tmpfile();
+
+    if (file == NULL || output == NULL)
+    {
+        if (file != NULL)
+        {
+            fclose(file);
+        }
+        if (output != NULL)
+        {
+            fclose(output);
+        }
+        return 2;
+    }
+
+    int status = adfgvx_container_writer_init(&writer, file, key_ctx, fc->container_block, fc->pool);
+    if (status == 0)
+    {
+        for (size_t start = 0; start < fc->message_length && status == 0; start += fc->stream_chunk)
+        {
+            size_t chunk = fc->message_length - start < fc->stream_chunk ? fc->message_length - start : fc->stream_chunk;
+            status = adfgvx_container_writer_update(&writer, fc->message + start, chunk);
+        }
+        int final_status = adfgvx_container_writer_final(&writer);
+        status = status != 0 ? status : final_status;
+    }
+    if (status == 0 && fflush(file) == 0)
+    {
+        rewind(file);
+        status = adfgvx_container_open(&container, file);
+    }
+    if (status != 0)
+    {
+        compare(fc, "adfgvx_container_writer", status, 0, NULL, 0, NULL, 0);
+        fclose(file);
+        fclose(output);
+        return 0;
+    }
+
+    // Cada bloco e o texto cifrado (pela referencia) do trecho correspondente da mensagem
+    // filtrada; a conferencia para no primeiro bloco divergente.
+    char expected[2 * 100];
+    char stored[2 * 100];
+    unsigned long long mismatches = fc->mismatches;
+    for (size_t b = 0; b < container.block_count && fc->mismatches == mismatches; b++)
+    {
+        size_t length = container.blocks[b].length;
+        size_t expected_length = 0;
+        size_t stored_length = 0;
+
+        if (b * fc->container_block + length > fc->filtered_length || 2 * length > sizeof(stored))
+        {
+            compare(fc, "container (indice)", 1, 0, NULL, 0, NULL, 0);
+            break;
+        }
+        adfgvx_reference_cipher(fc->key, fc->key_length, fc->filtered + b * fc->container_block, length,
+                                expected, sizeof(expected), &expected_length);
+        if (fseek(file, (long)container.blocks[b].offset, SEEK_SET) == 0)
+        {
+            stored_length = fread(stored, 1, 2 * length, file);
+        }
+        compare(fc, "adfgvx_container_writer (bloco)", 0, 0, stored, stored_length, expected, expected_length);
+    }
+
+    size_t length = 0;
+    status = adfgvx_container_decrypt(&container, key_ctx, output, fc->pool);
+    if (status == 0 && read_back(output, fc->scratch, fc->scratch_capacity, &length) != 0)
+    {
+        status = 4;
+    }
+    compare(fc, "adfgvx_container_decrypt", status, 0, fc->scratch, length, fc->filtered, fc->filtered_length);
+
+    adfgvx_container_close(&container);
+    fclose(file);
+    fclose(output);
+    return 0;
+}
+
+/**
+ * @brief Compara adfgvx_packed_encrypt com a referencia: o texto cifrado compacto e
+ * expandido para ASCII antes da comparacao. Com a capacidade curta do caso, o buffer
+ * compacto tem um byte a menos que o necessario.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int check_packed_cipher(fuzz_case *fc, const adfgvx_key_ctx *key_ctx, int reference_status, size_t reference_length)
+{
+    size_t capacity = fc->short_capacity && fc->expected_length > 0 ? adfgvx_packed_size(fc->expected_length) - 1
+                                                                      : adfgvx_packed_size(2 * fc->message_length);
+    unsigned char *packed = malloc(capacity + 1);
+    size_t symbol_count = 0;
+
+    if (packed == NULL)
+    {
+        return 2;
+    }
+    int status = adfgvx_packed_encrypt(key_ctx, fc->message, fc->message_length, packed, capacity, &symbol_count);
+    if (status == 0)
+    {
+        adfgvx_unpack_symbols(packed, symbol_count, fc->scratch);
+    }
+    else
+    {
+        symbol_count = 0;
+    }
+    free(packed);
+    compare(fc, "adfgvx_packed_encrypt", status, reference_status, fc->scratch, symbol_count, fc->expected, reference_length);
+    return 0;
+}
+
+/**
+ * @brief Compara adfgvx_packed_decrypt com a referencia, sobre o texto cifrado alterado do
+ * caso compactado (os simbolos invalidos viram ADFGVX_PACKED_INVALID).
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int check_packed_decipher(fuzz_case *fc, const adfgvx_key_ctx *key_ctx, size_t capacity,
+                                 int reference_status, size_t reference_length)
+{
+    unsigned char *packed = malloc(adfgvx_packed_size(fc->encrypted_length) + 1);
+    size_t length = 0;
+
+    if (packed == NULL)
+    {
+        return 2;
+    }
+    adfgvx_pack_symbols(fc->encrypted, fc->encrypted_length, packed);
+    int status = adfgvx_packed_decrypt(key_ctx, packed, fc->encrypted_length, fc->scratch, capacity, &length);
+    free(packed);
+    compare(fc, "adfgvx_packed_decrypt", status, reference_status, fc->scratch, length, fc->decrypted, reference_length);
+    return 0;
+}
+
+/**
+ * @brief Compara todas as implementacoes da cifragem com a referencia.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int check_cipher(fuzz_case *fc)
+{
+    static const char *kernel_names[3] = {"cipher_adfgvx_linear (kernel escalar)",
+                                          "cipher_adfgvx_linear (kernel ssse3)",
+                                          "cipher_adfgvx_linear (kernel avx2)"};
+    size_t capacity = fc->short_capacity && fc->expected_length > 0 ? fc->expected_length - 1 : 2 * fc->message_length;
+    size_t reference_length = 0;
+    size_t length = 0;
+    int reference_status = adfgvx_reference_cipher(fc->key, fc->key_length, fc->message, fc->message_length,
+                                                   fc->scratch, capacity, &reference_length);
+    const char *m = fc->message;
+    size_t n = fc->message_length;
+
+    // Cada kernel do codec que a CPU suporta.
+    adfgvx_encode_kernel active = adfgvx_codec_active_kernel();
+    for (int kernel = ADFGVX_KERNEL_SCALAR; kernel <= ADFGVX_KERNEL_AVX2; kernel++)
+    {
+        if (adfgvx_codec_select_kernel((adfgvx_encode_kernel)kernel) == 0)
+        {
+            int status = cipher_adfgvx_linear(fc->key, fc->key_length, m, n, fc->scratch, capacity, &length);
+            compare(fc, kernel_names[kernel], status, reference_status, fc->scratch, length, fc->expected, reference_length);
+        }
+    }
+    adfgvx_codec_select_kernel(active);
+
+    // O laco generico da transposicao, nas chaves que tem kernel especializado.
+    if (adfgvx_transpose_kernels_for(fc->key_length) != NULL)
+    {
+        adfgvx_transpose_select_specialized(0);
+        int status = cipher_adfgvx_linear(fc->key, fc->key_length, m, n, fc->scratch, capacity, &length);
+        adfgvx_transpose_select_specialized(1);
+        compare(fc, "cipher_adfgvx_linear (transposicao generica)", status, reference_status, fc->scratch, length, fc->expected, reference_length);
+    }
+    else
+    {
+        // Chaves longas: o laco generico, sem os ladrilhos.
+        adfgvx_transpose_select_tiled(0);
+        int status = cipher_adfgvx_linear(fc->key, fc->key_length, m, n, fc->scratch, capacity, &length);
+        adfgvx_transpose_select_tiled(1);
+        compare(fc, "cipher_adfgvx_linear (sem ladrilhos)", status, reference_status, fc->scratch, length, fc->expected, reference_length);
+    }
+
+    adfgvx_key_ctx key_ctx;
+    if (adfgvx_key_ctx_init(&key_ctx, fc->key, fc->key_length) != 0)
+    {
+        return 2;
+    }
+    int status = cipher_adfgvx_linear_ctx(&key_ctx, m, n, fc->scratch, capacity, &length);
+    compare(fc, "cipher_adfgvx_linear_ctx", status, reference_status, fc->scratch, length, fc->expected, reference_length);
+
+    if (check_packed_cipher(fc, &key_ctx, reference_status, reference_length) != 0)
+    {
+        adfgvx_key_ctx_free(&key_ctx);
+        return 2;
+    }
+
+    adfgvx_workspace ws;
+    adfgvx_workspace_init(&ws, NULL, 0);
+    status = cipher_adfgvx_ws(&ws, fc->key, fc->key_length, m, n, fc->scratch, capacity, &length);
+    adfgvx_workspace_free(&ws);
+    compare(fc, "cipher_adfgvx_ws", status, reference_status, fc->scratch, length, fc->expected, reference_length);
+
+    adfgvx_batch_item item = {m, n, fc->scratch, capacity, 0, 0};
+    cipher_adfgvx_batch(&key_ctx, &item, 1);
+    compare(fc, "cipher_adfgvx_batch", item.status, reference_status, fc->scratch, item.output_length, fc->expected, reference_length);
+
+    if (fc->pool != NULL)
+    {
+        status = cipher_adfgvx_parallel(&key_ctx, m, n, fc->scratch, capacity, &length, fc->pool, 0);
+        compare(fc, "cipher_adfgvx_parallel", status, reference_status, fc->scratch, length, fc->expected, reference_length);
+    }
+
+    // As implementacoes com uma coluna por chave so aceitam chaves curtas; a matriz original
+    // tambem exige a mensagem sem '\0' e colunas de ate MAX_MESSAGE_LENGTH simbolos.
+    status = 0;
+    if (fc->key_length <= FUZZ_COLUMN_KEY_LENGTH)
+    {
+        if (memchr(m, '\0', n) == NULL && fc->expected_length / (size_t)fc->key_length < MAX_MESSAGE_LENGTH)
+        {
+            status = check_cipher_matrix(fc);
+        }
+        if (status == 0)
+        {
+            status = check_cipher_stream(fc);
+        }
+        if (status == 0)
+        {
+            status = check_container(fc, &key_ctx);
+        }
+    }
+    adfgvx_key_ctx_free(&key_ctx);
+    return status;
+}
+
+/**
+ * @brief Compara decipher_adfgvx_range_ctx e decipher_adfgvx_file_range com o trecho
+ * correspondente da decifragem da referencia.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se o arquivo temporario nao puder ser criado.
+ */
+static int check_range(fuzz_case *fc, const adfgvx_key_ctx *key_ctx)
+{
+    size_t pairs = fc->encrypted_length / 2;
+    size_t offset = fc->seed % (pairs + 1);
+    size_t length = (fc->seed >> 8) % (pairs + 2);
+    size_t capacity = fc->short_capacity ? length / 2 : length;
+    size_t available = pairs - offset < length ? pairs - offset : length;
+    size_t count = available < capacity ? available : capacity;
+    int expected_status;
+    size_t expected_length;
+
+    // A referencia para no primeiro par invalido: depois dele, nada se sabe sobre o texto.
+    if (fc->decrypted_length >= offset + count)
+    {
+        expected_status = available > capacity ? 2 : 0;
+        expected_length = count;
+    }
+    else if (fc->decrypted_length >= offset)
+    {
+        expected_status = 3;
+        expected_length = fc->decrypted_length - offset;
+    }
+    else
+    {
+        return 0;
+    }
+    const char *expected = fc->decrypted + offset;
+
+    size_t output_length = 0;
+    int status = decipher_adfgvx_range_ctx(key_ctx, fc->encrypted, fc->encrypted_length, offset, length,
+                                           fc->scratch, capacity, &output_length);
+    compare(fc, "decipher_adfgvx_range_ctx", status, expected_status, fc->scratch, output_length, expected, expected_length);
+
+    FILE *file = tmpfile();
+    if (file == NULL)
+    {
+        return 2;
+    }
+    if (fwrite(fc->encrypted, 1, fc->encrypted_length, file) != fc->encrypted_length || fflush(file) != 0)
+    {
+        fclose(file);
+        return 2;
+    }
+    status = decipher_adfgvx_file_range(key_ctx, file, fc->encrypted_length, offset, length,
+                                        fc->scratch, capacity, &output_length);
+    fclose(file);
+    compare(fc, "decipher_adfgvx_file_range", status, expected_status, fc->scratch, output_length, expected, expected_length);
+    return 0;
+}
+
+/**
+ * @brief Decifra com o fluxo (init / update / final), em blocos de stream_chunk bytes.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se o contexto ou o arquivo temporario nao puderem ser criados.
+ */
+static int check_decipher_stream(fuzz_case *fc)
+{
+    adfgvx_decipher_stream stream;
+    FILE *output = tmpfile();
+    size_t length = 0;
+
+    if (output == NULL || adfgvx_decipher_stream_init(&stream, fc->key, fc->key_length) != 0)
+    {
+        if (output != NULL)
+        {
+            fclose(output);
+        }
+        return 2;
+    }
+    int status = 0;
+    for (size_t start = 0; start < fc->encrypted_length && status == 0; start += fc->stream_chunk)
+    {
+        size_t chunk = fc->encrypted_length - start < fc->stream_chunk ? fc->encrypted_length - start : fc->stream_chunk;
+        status = adfgvx_decipher_stream_update(&stream, fc->encrypted + start, chunk);
+    }
+    int final_status = adfgvx_decipher_stream_final(&stream, output);
+    status = status != 0 ? status : final_status;
+    if (status != 1 && read_back(output, fc->scratch, fc->scratch_capacity, &length) != 0)
+    {
+        status = 1;
+    }
+    fclose(output);
+
+    // O fluxo devolve 2 tanto para um numero impar de simbolos quanto para um par invalido.
+    compare(fc, "adfgvx_decipher_stream", status, fc->decrypted_status == 0 ? 0 : 2,
+            fc->scratch, length, fc->decrypted, fc->decrypted_length);
+    return 0;
+}
+
+/**
+ * @brief Altera o texto cifrado (conforme o modo) e compara todas as implementacoes da
+ * decifragem com a referencia.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int check_decipher(fuzz_case *fc)
+{
+    size_t n = fc->expected_length;
+
+    memcpy(fc->encrypted, fc->expected, n);
+    if (fc->mutation == 1 && n > 0)
+    {
+        fc->encrypted[fc->seed % n] = (char)fc->replacement;
+    }
+    else if (fc->mutation == 2 && n > 0)
+    {
+        n--;
+    }
+    else if (fc->mutation == 3)
+    {
+        n -= fc->seed % (n + 1);
+    }
+    fc->encrypted_length = n;
+
+    // Decifragem completa (capacidade para todos os pares) e a da capacidade do caso.
+    size_t pairs = n / 2;
+    fc->decrypted_status = adfgvx_reference_decipher(fc->encrypted, n, fc->key, fc->key_length,
+                                                     fc->decrypted, fc->message_length, &fc->decrypted_length);
+    if (fc->decrypted_status == 4)
+    {
+        return 2;
+    }
+    size_t capacity = fc->short_capacity && pairs > 0 ? fc->seed % pairs : fc->message_length;
+    size_t reference_length = 0;
+    int reference_status = adfgvx_reference_decipher(fc->encrypted, n, fc->key, fc->key_length,
+                                                     fc->scratch, capacity, &reference_length);
+    const char *expected = fc->decrypted;
+    size_t length = 0;
+
+    int status = decipher_adfgvx_direct(fc->encrypted, n, fc->key, fc->key_length, fc->scratch, capacity, &length);
+    compare(fc, "decipher_adfgvx_direct", status, reference_status, fc->scratch, length, expected, reference_length);
+
+    if (adfgvx_transpose_kernels_for(fc->key_length) != NULL)
+    {
+        adfgvx_transpose_select_specialized(0);
+        status = decipher_adfgvx_direct(fc->encrypted, n, fc->key, fc->key_length, fc->scratch, capacity, &length);
+        adfgvx_transpose_select_specialized(1);
+        compare(fc, "decipher_adfgvx_direct (transposicao generica)", status, reference_status, fc->scratch, length, expected, reference_length);
+    }
+    else
+    {
+        adfgvx_transpose_select_tiled(0);
+        status = decipher_adfgvx_direct(fc->encrypted, n, fc->key, fc->key_length, fc->scratch, capacity, &length);
+        adfgvx_transpose_select_tiled(1);
+        compare(fc, "decipher_adfgvx_direct (sem ladrilhos)", status, reference_status, fc->scratch, length, expected, reference_length);
+    }
+
+    adfgvx_key_ctx key_ctx;
+    if (adfgvx_key_ctx_init(&key_ctx, fc->key, fc->key_length) != 0)
+    {
+        return 2;
+    }
+    status = decipher_adfgvx_direct_ctx(&key_ctx, fc->encrypted, n, fc->scratch, capacity, &length);
+    compare(fc, "decipher_adfgvx_direct_ctx", status, reference_status, fc->scratch, length, expected, reference_length);
+
+    if (check_packed_decipher(fc, &key_ctx, capacity, reference_status, reference_length) != 0)
+    {
+        adfgvx_key_ctx_free(&key_ctx);
+        return 2;
+    }
+
+    adfgvx_workspace ws;
+    adfgvx_workspace_init(&ws, NULL, 0);
+    status = decipher_adfgvx_ws(&ws, fc->encrypted, n, fc->key, fc->key_length, fc->scratch, capacity, &length);
+    adfgvx_workspace_free(&ws);
+    compare(fc, "decipher_adfgvx_ws", status, reference_status, fc->scratch, length, expected, reference_length);
+
+    adfgvx_batch_item item = {fc->encrypted, n, fc->scratch, capacity, 0, 0};
+    decipher_adfgvx_batch(&key_ctx, &item, 1);
+    compare(fc, "decipher_adfgvx_batch", item.status, reference_status, fc->scratch, item.output_length, expected, reference_length);
+
+    if (fc->pool != NULL)
+    {
+        status = decipher_adfgvx_parallel(&key_ctx, fc->encrypted, n, fc->scratch, capacity, &length, fc->pool, 0);
+        compare(fc, "decipher_adfgvx_parallel", status, reference_status, fc->scratch, length, expected, reference_length);
+    }
+
+    // decipher_adfgvx recebe uma string e devolve no maximo MAX_MESSAGE_LENGTH - 1 caracteres
+    // (nada com um numero impar de simbolos).
+    if (memchr(fc->encrypted, '\0', n) == NULL)
+    {
+        char *text = malloc(n + 1);
+        if (text == NULL)
+        {
+            adfgvx_key_ctx_free(&key_ctx);
+            return 2;
+        }
+        memcpy(text, fc->encrypted, n);
+        text[n] = '\0';
+        decipher_adfgvx(text, fc->key, fc->key_length, fc->scratch);
+        free(text);
+        size_t legacy_length = n % 2 != 0 ? 0 : fc->decrypted_length < MAX_MESSAGE_LENGTH - 1 ? fc->decrypted_length : MAX_MESSAGE_LENGTH - 1;
+        compare(fc, "decipher_adfgvx", 0, 0, fc->scratch, strlen(fc->scratch), expected, legacy_length);
+    }
+
+    status = 0;
+    if (n % 2 == 0)
+    {
+        status = check_range(fc, &key_ctx);
+    }
+    // O fluxo descarta as quebras de linha do texto cifrado, que a referencia trata como simbolos invalidos.
+    if (status == 0 && fc->key_length <= FUZZ_COLUMN_KEY_LENGTH &&
+        memchr(fc->encrypted, '\n', n) == NULL && memchr(fc->encrypted, '\r', n) == NULL)
+    {
+        status = check_decipher_stream(fc);
+    }
+    adfgvx_key_ctx_free(&key_ctx);
+    return status;
+}
+
+/**
+ * @brief Transposicao colunar simples (le as colunas na ordem alfabetica da chave), para a
+ * referencia encadeada das rodadas. A ordem estavel das colunas e calculada aqui, por
+ * selecao, sem adfgvx_key_column_order.
+ * (Funcao auxiliar estatica)
+ */
+static void reference_transpose(const char *key, int key_length, const char *input, size_t length, char *output)
+{
+    int order[FUZZ_ROUND_KEY_LENGTH];
+    size_t position = 0;
+
+    for (int i = 0; i < key_length; i++)
+    {
+        order[i] = i;
+    }
+    for (int i = 0; i < key_length; i++)
+    {
+        // O menor caractere restante; entre iguais, a coluna mais a esquerda.
+        int best = i;
+        for (int j = i + 1; j < key_length; j++)
+        {
+            if (key[order[j]] < key[order[best]])
+            {
+                best = j;
+            }
+        }
+        int chosen = order[best];
+        memmove(order + i + 1, order + i, (size_t)(best - i) * sizeof(int));
+        order[i] = chosen;
+    }
+    for (int i = 0; i < key_length; i++)
+    {
+        for (size_t j = (size_t)order[i]; j < length; j += (size_t)key_length)
+        {
+            output[position++] = input[j];
+        }
+    }
+}
+
+/**
+ * @brief Compara cipher_adfgvx_rounds e decipher_adfgvx_rounds com a referencia encadeada:
+ * a chave do caso na primeira rodada e de 1 a ADFGVX_MAX_ROUNDS - 1 chaves derivadas da
+ * semente nas seguintes. A cifragem deve dar a cifragem da referencia seguida de uma
+ * transposicao simples por chave seguinte; a decifragem do texto alterado do caso,
+ * transposto da mesma forma, deve dar a decifragem da referencia desse texto (com a
+ * capacidade do caso, o numero impar de simbolos e os simbolos invalidos).
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 2 se faltar memoria.
+ */
+static int check_rounds(fuzz_case *fc)
+{
+    char round_keys[ADFGVX_MAX_ROUNDS - 1][FUZZ_ROUND_KEY_LENGTH];
+    int round_key_lengths[ADFGVX_MAX_ROUNDS - 1];
+    adfgvx_key_ctx keys[ADFGVX_MAX_ROUNDS];
+    unsigned int state = (fc->seed ^ 0x9E3779B9u) | 1u;
+    int round_count = 2 + (int)(next_random(&state) % (ADFGVX_MAX_ROUNDS - 1));
+
+    // Chaves em geral curtas (periodos pequenos, kernels), as vezes longas (ladrilhos e
+    // periodos maiores que a mensagem).
+    for (int r = 0; r < round_count - 1; r++)
+    {
+        unsigned int kind = next_random(&state) % 4;
+        int length = kind < 3 ? 1 + (int)(next_random(&state) % 16) : 1 + (int)(next_random(&state) % FUZZ_ROUND_KEY_LENGTH);
+        int repeated = next_random(&state) % 2;
+        for (int i = 0; i < length; i++)
+        {
+            unsigned int c = next_random(&state);
+            round_keys[r][i] = (char)(repeated ? 'A' + c % 5 : 'A' + c % 26);
+        }
+        round_key_lengths[r] = length;
+    }
+
+    size_t m = fc->message_length;
+    char *chain = malloc(4 * m + 2);
+    if (chain == NULL)
+    {
+        return 2;
+    }
+    char *chain_scratch = chain + 2 * m + 1;
+    if (adfgvx_key_ctx_init(&keys[0], fc->key, fc->key_length) != 0)
+    {
+        free(chain);
+        return 2;
+    }
+    for (int r = 1; r < round_count; r++)
+    {
+        if (adfgvx_key_ctx_init(&keys[r], round_keys[r - 1], round_key_lengths[r - 1]) != 0)
+        {
+            for (int i = 0; i < r; i++)
+            {
+                adfgvx_key_ctx_free(&keys[i]);
+            }
+            free(chain);
+            return 2;
+        }
+    }
+
+    // Cifragem: a referencia (com a capacidade do caso) e uma transposicao por chave seguinte.
+    size_t capacity = fc->short_capacity && fc->expected_length > 0 ? fc->expected_length - 1 : 2 * m;
+    size_t reference_length = 0;
+    size_t length = 0;
+    int reference_status = adfgvx_reference_cipher(fc->key, fc->key_length, fc->message, m,
+                                                   fc->scratch, capacity, &reference_length);
+    memcpy(chain, fc->expected, reference_length);
+    for (int r = 1; r < round_count; r++)
+    {
+        reference_transpose(round_keys[r - 1], round_key_lengths[r - 1], chain, reference_length, chain_scratch);
+        memcpy(chain, chain_scratch, reference_length);
+    }
+    int status = cipher_adfgvx_rounds(keys, round_count, fc->message, m, fc->scratch, capacity, &length);
+    compare(fc, "cipher_adfgvx_rounds", status, reference_status, fc->scratch, length, chain, reference_length);
+
+    // Decifragem: o texto alterado do caso passa pelas mesmas transposicoes.
+    size_t n = fc->encrypted_length;
+    size_t pairs = n / 2;
+    capacity = fc->short_capacity && pairs > 0 ? fc->seed % pairs : m;
+    memcpy(chain, fc->encrypted, n);
+    for (int r = 1; r < round_count; r++)
+    {
+        reference_transpose(round_keys[r - 1], round_key_lengths[r - 1], chain, n, chain_scratch);
+        memcpy(chain, chain_scratch, n);
+    }
+    reference_status = adfgvx_reference_decipher(fc->encrypted, n, fc->key, fc->key_length,
+                                                 chain_scratch, capacity, &reference_length);
+    status = decipher_adfgvx_rounds(keys, round_count, chain, n, fc->scratch, capacity, &length);
+    compare(fc, "decipher_adfgvx_rounds", status, reference_status, fc->scratch, length, chain_scratch, reference_length);
+
+    for (int r = 0; r < round_count; r++)
+    {
+        adfgvx_key_ctx_free(&keys[r]);
+    }
+    free(chain);
+    return reference_status == 4 ? 2 : 0;
+}
+
+int adfgvx_fuzz_run_case(const unsigned char *data, size_t size, thread_pool *pool, FILE *report, adfgvx_fuzz_stats *stats)
+{
+    fuzz_case fc;
+
+    memset(&fc, 0, sizeof(fc));
+    fc.pool = pool;
+    fc.report = report;
+    adfgvx_codec_init();
+    if ((data == NULL && size > 0) || decode_case(&fc, data, size) != 0)
+    {
+        return 2;
+    }
+
+    // Referencia: cifragem e ida e volta (a mensagem sem os caracteres fora da matriz).
+    int status = adfgvx_reference_cipher(fc.key, fc.key_length, fc.message, fc.message_length,
+                                         fc.expected, 2 * fc.message_length, &fc.expected_length);
+    if (status == 0)
+    {
+        size_t length = 0;
+        int round_trip = adfgvx_reference_decipher(fc.expected, fc.expected_length, fc.key, fc.key_length,
+                                                   fc.decrypted, fc.message_length, &length);
+        compare(&fc, "referencia (ida e volta)", round_trip, 0, fc.decrypted, length, fc.filtered, fc.filtered_length);
+        status = check_cipher(&fc);
+    }
+    else
+    {
+        status = 2;
+    }
+    if (status == 0)
+    {
+        status = check_decipher(&fc);
+    }
+    if (status == 0)
+    {
+        status = check_rounds(&fc);
+    }
+
+    if (stats != NULL)
+    {
+        stats->cases++;
+        stats->comparisons += fc.comparisons;
+        stats->mismatches += fc.mismatches;
+    }
+    free(fc.key);
+    return status != 0 ? status : fc.mismatches > 0;
+}
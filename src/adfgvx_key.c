@@ -0,0 +1,362 @@
+#include "adfgvx_key.h"
+#include "adfgvx_codec.h"
+#include "adfgvx_stats.h"
+#include <limits.h> // Para CHAR_MIN e UCHAR_MAX
+#include <stdlib.h> // Para malloc e free
+
+// Chaves de ate este comprimento sao ordenadas por insercao em adfgvx_key_column_order.
+#define KEY_INSERTION_SORT_COLUMNS 16
+
+void adfgvx_key_column_order(const char key[], int key_length, int column_order[])
+{
+    // Chaves curtas: insercao estavel, sem a tabela de contagem (zerar e acumular os
+    // UCHAR_MAX + 2 contadores custaria mais que ordenar a chave inteira).
+    if (key_length <= KEY_INSERTION_SORT_COLUMNS)
+    {
+        for (int i = 0; i < key_length; i++)
+        {
+            int j = i;
+            while (j > 0 && key[column_order[j - 1]] > key[i])
+            {
+                column_order[j] = column_order[j - 1];
+                j--;
+            }
+            column_order[j] = i;
+        }
+        return;
+    }
+
+    int first[UCHAR_MAX + 2] = {0}; // first[v] = primeira posicao da ordem com o valor v.
+
+    // Ordenacao por contagem, estavel. Os valores sao ordenados como char (com ou sem
+    // sinal, conforme o compilador), como na comparacao da insercao das chaves curtas.
+    for (int i = 0; i < key_length; i++)
+    {
+        first[(int)key[i] - CHAR_MIN + 1]++;
+    }
+    for (int v = 1; v <= UCHAR_MAX + 1; v++)
+    {
+        first[v] += first[v - 1];
+    }
+    for (int i = 0; i < key_length; i++)
+    {
+        column_order[first[(int)key[i] - CHAR_MIN]++] = i;
+    }
+}
+
+void adfgvx_key_column_starts(const int column_order[], int key_length, size_t total_symbols, size_t column_start[])
+{
+    size_t rows = total_symbols / (size_t)key_length;
+    size_t extra = total_symbols % (size_t)key_length;
+    size_t offset = 0;
+
+    for (int i = 0; i < key_length; i++)
+    {
+        int col = column_order[i];
+
+        column_start[col] = offset;
+        offset += rows + ((size_t)col < extra ? 1 : 0);
+    }
+}
+
+/**
+ * @brief Preenche a ordem e a ordem inversa de um contexto cujo bloco ja foi reservado.
+ * (Funcao auxiliar estatica)
+ */
+static void fill_key_tables(adfgvx_key_ctx *ctx, const char key[], int key_length)
+{
+    adfgvx_codec_init();
+    ADFGVX_STATS_BEGIN(stage_start);
+    ctx->column_rank = ctx->column_order + key_length;
+    adfgvx_key_column_order(key, key_length, ctx->column_order);
+    for (int i = 0; i < key_length; i++)
+    {
+        ctx->column_rank[ctx->column_order[i]] = i;
+    }
+    ctx->key_length = key_length;
+    ADFGVX_STATS_END(ADFGVX_STAGE_KEY, stage_start, (unsigned long long)key_length);
+}
+
+int adfgvx_key_ctx_init(adfgvx_key_ctx *ctx, const char key[], int key_length)
+{
+    if (!ctx)
+    {
+        return 1;
+    }
+    ctx->key_length = 0;
+    ctx->column_order = NULL;
+    ctx->column_rank = NULL;
+    ctx->owns_tables = 1;
+    if (!key || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+
+    ctx->column_order = malloc(2 * (size_t)key_length * sizeof(int));
+    if (ctx->column_order == NULL)
+    {
+        return 2;
+    }
+    fill_key_tables(ctx, key, key_length);
+    return 0;
+}
+
+int adfgvx_key_ctx_init_ws(adfgvx_key_ctx *ctx, const char key[], int key_length, adfgvx_workspace *ws)
+{
+    if (!ctx)
+    {
+        return 1;
+    }
+    ctx->key_length = 0;
+    ctx->column_order = NULL;
+    ctx->column_rank = NULL;
+    ctx->owns_tables = 0;
+    if (!key || !ws || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+
+    ctx->column_order = adfgvx_workspace_alloc(ws, 2 * (size_t)key_length * sizeof(int));
+    if (ctx->column_order == NULL)
+    {
+        return 2;
+    }
+    fill_key_tables(ctx, key, key_length);
+    return 0;
+}
+
+/**
+ * @brief Copia uma ordem de colunas para um contexto cujo bloco ja foi reservado,
+ * conferindo se ela e uma permutacao de 0 .. key_length - 1.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se column_order nao for uma permutacao.
+ */
+static int fill_order_tables(adfgvx_key_ctx *ctx, const int column_order[], int key_length)
+{
+    adfgvx_codec_init();
+    ctx->column_rank = ctx->column_order + key_length;
+    for (int i = 0; i < key_length; i++)
+    {
+        ctx->column_rank[i] = -1;
+    }
+    for (int i = 0; i < key_length; i++)
+    {
+        int col = column_order[i];
+
+        if (col < 0 || col >= key_length || ctx->column_rank[col] >= 0)
+        {
+            return 1;
+        }
+        ctx->column_order[i] = col;
+        ctx->column_rank[col] = i;
+    }
+    ctx->key_length = key_length;
+    return 0;
+}
+
+int adfgvx_key_ctx_init_order(adfgvx_key_ctx *ctx, const int column_order[], int key_length)
+{
+    if (!ctx)
+    {
+        return 1;
+    }
+    ctx->key_length = 0;
+    ctx->column_order = NULL;
+    ctx->column_rank = NULL;
+    ctx->owns_tables = 1;
+    if (!column_order || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+
+    ctx->column_order = malloc(2 * (size_t)key_length * sizeof(int));
+    if (ctx->column_order == NULL)
+    {
+        return 2;
+    }
+    if (fill_order_tables(ctx, column_order, key_length) != 0)
+    {
+        adfgvx_key_ctx_free(ctx);
+        return 1;
+    }
+    return 0;
+}
+
+int adfgvx_key_ctx_init_order_ws(adfgvx_key_ctx *ctx, const int column_order[], int key_length, adfgvx_workspace *ws)
+{
+    if (!ctx)
+    {
+        return 1;
+    }
+    ctx->key_length = 0;
+    ctx->column_order = NULL;
+    ctx->column_rank = NULL;
+    ctx->owns_tables = 0;
+    if (!column_order || !ws || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+
+    ctx->column_order = adfgvx_workspace_alloc(ws, 2 * (size_t)key_length * sizeof(int));
+    if (ctx->column_order == NULL)
+    {
+        return 2;
+    }
+    if (fill_order_tables(ctx, column_order, key_length) != 0)
+    {
+        adfgvx_key_ctx_free(ctx);
+        return 1;
+    }
+    return 0;
+}
+
+void adfgvx_key_ctx_free(adfgvx_key_ctx *ctx)
+{
+    if (ctx != NULL)
+    {
+        if (ctx->owns_tables)
+        {
+            free(ctx->column_order);
+        }
+        ctx->column_order = NULL;
+        ctx->column_rank = NULL;
+        ctx->key_length = 0;
+    }
+}
+
+void adfgvx_key_ctx_column_starts(const adfgvx_key_ctx *ctx, size_t total_symbols, size_t column_start[])
+{
+    adfgvx_key_column_starts(ctx->column_order, ctx->key_length, total_symbols, column_start);
+}
+
+int adfgvx_rounds_map_init(adfgvx_rounds_map *map, const adfgvx_key_ctx keys[], int round_count, size_t total_symbols)
+{
+    if (!map)
+    {
+        return 1;
+    }
+    map->column_start[0] = NULL;
+    if (!keys || round_count < 1 || round_count > ADFGVX_MAX_ROUNDS)
+    {
+        return 1;
+    }
+
+    size_t columns = 0;
+    size_t period = 1;
+    for (int r = 0; r < round_count; r++)
+    {
+        if (keys[r].key_length < 1 || keys[r].column_order == NULL)
+        {
+            return 1;
+        }
+        columns += (size_t)keys[r].key_length;
+        // O periodo so interessa ate ADFGVX_ROUNDS_MAX_PERIOD (0: grande demais).
+        period = period > ADFGVX_ROUNDS_MAX_PERIOD / (size_t)keys[r].key_length ? 0 : period * (size_t)keys[r].key_length;
+    }
+    // Com menos simbolos que o periodo (mesmo acima do maximo), cada simbolo fica na sua
+    // coluna virtual, sempre na linha 0.
+    if (period == 0 ? total_symbols <= ADFGVX_ROUNDS_MAX_PERIOD : period > total_symbols)
+    {
+        period = total_symbols;
+    }
+    ADFGVX_STATS_BEGIN(stage_start);
+    size_t *block = malloc((columns + period) * sizeof(size_t));
+    if (block == NULL)
+    {
+        return 2;
+    }
+    map->round_count = round_count;
+    map->total_symbols = total_symbols;
+    for (int r = 0; r < round_count; r++)
+    {
+        map->key_length[r] = keys[r].key_length;
+        map->column_start[r] = block;
+        adfgvx_key_ctx_column_starts(&keys[r], total_symbols, block);
+        block += keys[r].key_length;
+    }
+
+    // Coluna virtual j: comeca na posicao final do simbolo j.
+    map->period = (int)period;
+    map->period_start = period > 0 ? block : NULL;
+    if (period > 0)
+    {
+        adfgvx_rounds_map_positions(map, 0, period, block);
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_KEY, stage_start, (unsigned long long)(columns + period));
+    return 0;
+}
+
+// Uma rodada sobre as posicoes de entrada (a saida da rodada anterior). Com K constante, o
+// compilador troca a divisao e o resto por multiplicacoes.
+#define ADFGVX_ROUND_POSITIONS(K)                                            \
+    for (size_t i = 0; i < count; i++)                                       \
+    {                                                                        \
+        size_t position = positions[i];                                      \
+        positions[i] = column_start[position % (K)] + position / (K);        \
+    }
+
+/**
+ * @brief Aplica uma rodada (depois da primeira) a count posicoes.
+ * (Funcao auxiliar estatica)
+ */
+static void apply_round(const size_t column_start[], int key_length, size_t count, size_t positions[])
+{
+    switch (key_length)
+    {
+    case 1: break; // Uma coluna: a transposicao nao move nada.
+    case 2: ADFGVX_ROUND_POSITIONS(2) break;
+    case 3: ADFGVX_ROUND_POSITIONS(3) break;
+    case 4: ADFGVX_ROUND_POSITIONS(4) break;
+    case 5: ADFGVX_ROUND_POSITIONS(5) break;
+    case 6: ADFGVX_ROUND_POSITIONS(6) break;
+    case 7: ADFGVX_ROUND_POSITIONS(7) break;
+    case 8: ADFGVX_ROUND_POSITIONS(8) break;
+    default: ADFGVX_ROUND_POSITIONS((size_t)key_length) break;
+    }
+}
+
+void adfgvx_rounds_map_positions(const adfgvx_rounds_map *map, size_t first_symbol, size_t count, size_t positions[])
+{
+    // Primeira rodada: indices sequenciais, a coluna e a linha avancam sem divisao.
+    const size_t *column_start = map->column_start[0];
+    int k = map->key_length[0];
+    int col = (int)(first_symbol % (size_t)k);
+    size_t row = first_symbol / (size_t)k;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        positions[i] = column_start[col] + row;
+        if (++col == k)
+        {
+            col = 0;
+            row++;
+        }
+    }
+    for (int r = 1; r < map->round_count; r++)
+    {
+        apply_round(map->column_start[r], map->key_length[r], count, positions);
+    }
+}
+
+void adfgvx_rounds_map_free(adfgvx_rounds_map *map)
+{
+    if (map && map->column_start[0])
+    {
+        free(map->column_start[0]);
+        map->column_start[0] = NULL;
+    }
+}
+
+size_t *adfgvx_key_scratch(size_t stack_buffer[], size_t stack_length, size_t length)
+{
+    return length <= stack_length ? stack_buffer : malloc(length * sizeof(size_t));
+}
+
+void adfgvx_key_scratch_free(size_t *scratch, const size_t stack_buffer[])
+{
+    if (scratch != stack_buffer)
+    {
+        free(scratch);
+    }
+}
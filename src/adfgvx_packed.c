@@ -0,0 +1,421 @@
+#include "adfgvx_packed.h"
+#include "adfgvx_codec.h" // Para adfgvx_encode_symbols, adfgvx_symbol_value e adfgvx_square_cells
+#include "adfgvx_core.h"  // Para cipher_adfgvx_output_length
+#include "adfgvx_stats.h" // Para a medicao da substituicao, da transposicao e da decodificacao
+#include <string.h>       // Para memcpy, memcmp e memset
+
+/**
+ * @brief Acrescenta (OR) o valor de um simbolo na posicao position de packed, que deve
+ * estar zerada nos 3 bits do simbolo.
+ * (Funcao auxiliar estatica)
+ */
+static inline void put_symbol(unsigned char *packed, size_t position, unsigned int value)
+{
+    size_t bit = ADFGVX_PACKED_BITS * position;
+    unsigned int shift = (unsigned int)(bit & 7);
+
+    packed[bit >> 3] |= (unsigned char)(value << shift);
+    if (shift > 8 - ADFGVX_PACKED_BITS) // O simbolo continua no byte seguinte.
+    {
+        packed[(bit >> 3) + 1] |= (unsigned char)(value >> (8 - shift));
+    }
+}
+
+/**
+ * @brief Le o valor (0..7) do simbolo na posicao position de packed.
+ * (Funcao auxiliar estatica)
+ */
+static inline unsigned int get_symbol(const unsigned char *packed, size_t position)
+{
+    size_t bit = ADFGVX_PACKED_BITS * position;
+    unsigned int shift = (unsigned int)(bit & 7);
+    unsigned int value = packed[bit >> 3] >> shift;
+
+    if (shift > 8 - ADFGVX_PACKED_BITS)
+    {
+        value |= (unsigned int)packed[(bit >> 3) + 1] << (8 - shift);
+    }
+    return value & 7;
+}
+
+/**
+ * @brief Acrescenta (OR) 8 simbolos consecutivos de uma coluna (24 bits, o simbolo r nos
+ * bits 3 * r) a partir da posicao position. Como 8 simbolos ocupam 3 bytes inteiros, o
+ * deslocamento dentro do byte e o mesmo para todos os grupos de uma coluna.
+ * (Funcao auxiliar estatica)
+ */
+static inline void put_group(unsigned char *packed, size_t position, unsigned long group)
+{
+    size_t bit = ADFGVX_PACKED_BITS * position;
+    unsigned int shift = (unsigned int)(bit & 7);
+    unsigned long value = group << shift;
+    unsigned char *out = packed + (bit >> 3);
+
+    // O primeiro e o quarto byte sao divididos com o grupo (ou a coluna) vizinho; os do
+    // meio sao so deste grupo.
+    out[0] |= (unsigned char)value;
+    out[1] = (unsigned char)(value >> 8);
+    out[2] = (unsigned char)(value >> 16);
+    if (shift != 0) // So entao o grupo chega ao quarto byte (que existe).
+    {
+        out[3] |= (unsigned char)(value >> 24);
+    }
+}
+
+/**
+ * @brief Le 8 simbolos consecutivos de uma coluna a partir da posicao position (24 bits).
+ * (Funcao auxiliar estatica)
+ */
+static inline unsigned long get_group(const unsigned char *packed, size_t position)
+{
+    size_t bit = ADFGVX_PACKED_BITS * position;
+    unsigned int shift = (unsigned int)(bit & 7);
+    const unsigned char *in = packed + (bit >> 3);
+    unsigned long value = (unsigned long)in[0] | (unsigned long)in[1] << 8 | (unsigned long)in[2] << 16;
+
+    if (shift != 0)
+    {
+        value |= (unsigned long)in[3] << 24;
+    }
+    return (value >> shift) & 0xFFFFFFUL;
+}
+
+/**
+ * @brief Espalha simbolos ASCII nas colunas do texto compacto, convertendo cada um no seu
+ * valor (adfgvx_symbol_value) ao grava-lo.
+ * Completa a linha atual simbolo a simbolo; depois, para cada grupo de 8 linhas inteiras,
+ * monta os 24 bits de cada coluna e os grava de uma vez (put_group); o resto volta ao
+ * laco simbolo a simbolo.
+ * (Funcao auxiliar estatica)
+ *
+ * @param col Coluna do primeiro simbolo (atualizada).
+ */
+static void scatter_values(int key_length,
+                           size_t next_position[],
+                           int *col,
+                           const char *symbols,
+                           size_t count,
+                           unsigned char *output)
+{
+    const unsigned char *values = (const unsigned char *)symbols;
+    size_t k = (size_t)key_length;
+    int c = *col;
+    size_t i = 0;
+
+    for (; i < count && c != 0; i++)
+    {
+        put_symbol(output, next_position[c]++, adfgvx_symbol_value[values[i]]);
+        c = (c + 1 == key_length) ? 0 : c + 1;
+    }
+    for (; count - i >= 8 * k; i += 8 * k)
+    {
+        for (size_t column = 0; column < k; column++)
+        {
+            const unsigned char *v = values + i + column;
+            unsigned long group = 0;
+            for (int row = 0; row < 8; row++)
+            {
+                group |= (unsigned long)adfgvx_symbol_value[v[row * k]] << (ADFGVX_PACKED_BITS * row);
+            }
+            put_group(output, next_position[column], group);
+            next_position[column] += 8;
+        }
+    }
+    for (; i < count; i++)
+    {
+        put_symbol(output, next_position[c]++, adfgvx_symbol_value[values[i]]);
+        c = (c + 1 == key_length) ? 0 : c + 1;
+    }
+    *col = c;
+}
+
+/**
+ * @brief Le e decodifica count pares simbolo a simbolo (a partir da coluna *col).
+ * (Funcao auxiliar estatica)
+ *
+ * @return size_t Pares decodificados; menor que count se um simbolo invalido for encontrado.
+ */
+static size_t decode_pairs(int key_length,
+                           size_t next_position[],
+                           int *col,
+                           const unsigned char *packed,
+                           size_t count,
+                           char *output)
+{
+    int c = *col;
+    size_t written = 0;
+
+    for (; written < count; written++)
+    {
+        unsigned int row = get_symbol(packed, next_position[c]++);
+        c = (c + 1 == key_length) ? 0 : c + 1;
+        unsigned int column = get_symbol(packed, next_position[c]++);
+        c = (c + 1 == key_length) ? 0 : c + 1;
+
+        if (row >= ADFGVX_SYMBOL_COUNT || column >= ADFGVX_SYMBOL_COUNT)
+        {
+            break;
+        }
+        output[written] = adfgvx_square_cells[row * ADFGVX_SYMBOL_COUNT + column];
+    }
+    *col = c;
+    return written;
+}
+
+/**
+ * @brief Decodifica group_count grupos de 8 linhas inteiras (4 * key_length pares cada, a
+ * partir da coluna 0): le os 24 bits de cada coluna de uma vez (get_group), espalha os
+ * valores das 8 linhas num bloco em ordem de linha e decodifica os pares em sequencia,
+ * pela tabela pair_cell. So para chaves de ate ADFGVX_KEY_STACK_COLUMNS colunas (o bloco
+ * fica na pilha).
+ * (Funcao auxiliar estatica)
+ *
+ * @param pair_cell Para cada par de valores (linha * 8 + coluna), o caractere da matriz,
+ * ou -1 se algum dos valores nao for um simbolo.
+ * @return size_t Pares decodificados; menor que group_count * 4 * key_length se um simbolo
+ * invalido for encontrado (next_position fica indefinido).
+ */
+static size_t decode_row_groups(int key_length,
+                                size_t next_position[],
+                                const unsigned char *packed,
+                                size_t group_count,
+                                const short pair_cell[64],
+                                char *output)
+{
+    unsigned char values[8 * ADFGVX_KEY_STACK_COLUMNS];
+    size_t written = 0;
+
+    for (size_t g = 0; g < group_count; g++)
+    {
+        for (int c = 0; c < key_length; c++)
+        {
+            unsigned long group = get_group(packed, next_position[c]);
+            next_position[c] += 8;
+            for (int row = 0; row < 8; row++)
+            {
+                values[row * key_length + c] = (unsigned char)((group >> (ADFGVX_PACKED_BITS * row)) & 7);
+            }
+        }
+        for (int p = 0; p < 4 * key_length; p++)
+        {
+            int cell = pair_cell[values[2 * p] * 8 + values[2 * p + 1]];
+            if (cell < 0)
+            {
+                return written;
+            }
+            output[written++] = (char)cell;
+        }
+    }
+    return written;
+}
+
+size_t adfgvx_packed_size(size_t symbol_count)
+{
+    // 8 simbolos a cada 3 bytes, sem estourar size_t no produto.
+    return symbol_count / 8 * 3 + (symbol_count % 8 * ADFGVX_PACKED_BITS + 7) / 8;
+}
+
+int adfgvx_pack_symbols(const char *symbols, size_t symbol_count, unsigned char *packed)
+{
+    unsigned int pending = 0; // Bits ainda nao gravados, a partir do bit 0.
+    int pending_bits = 0;
+    size_t written = 0;
+    int invalid = 0;
+
+    adfgvx_codec_init();
+    for (size_t i = 0; i < symbol_count; i++)
+    {
+        unsigned int value = adfgvx_symbol_value[(unsigned char)symbols[i]];
+        if (value == ADFGVX_CODEC_INVALID)
+        {
+            value = ADFGVX_PACKED_INVALID;
+            invalid = 1;
+        }
+        pending |= value << pending_bits;
+        pending_bits += ADFGVX_PACKED_BITS;
+        if (pending_bits >= 8)
+        {
+            packed[written++] = (unsigned char)pending;
+            pending >>= 8;
+            pending_bits -= 8;
+        }
+    }
+    if (pending_bits > 0)
+    {
+        packed[written] = (unsigned char)pending;
+    }
+    return invalid;
+}
+
+int adfgvx_unpack_symbols(const unsigned char *packed, size_t symbol_count, char *symbols)
+{
+    int invalid = 0;
+
+    for (size_t i = 0; i < symbol_count; i++)
+    {
+        unsigned int value = get_symbol(packed, i);
+        if (value >= ADFGVX_SYMBOL_COUNT)
+        {
+            symbols[i] = '?';
+            invalid = 1;
+        }
+        else
+        {
+            symbols[i] = adfgvx_symbols[value];
+        }
+    }
+    return invalid;
+}
+
+int adfgvx_packed_encrypt(const adfgvx_key_ctx *key_ctx,
+                          const char message[],
+                          size_t message_length,
+                          unsigned char output[],
+                          size_t output_capacity,
+                          size_t *symbol_count)
+{
+    if (!key_ctx || !message || !symbol_count)
+    {
+        return 1;
+    }
+    size_t total_symbols = cipher_adfgvx_output_length(message, message_length);
+    size_t total_bytes = adfgvx_packed_size(total_symbols);
+    *symbol_count = 0;
+    if (total_bytes > 0 && !output)
+    {
+        return 1;
+    }
+    if (total_bytes > output_capacity)
+    {
+        return 2;
+    }
+
+    size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+    size_t *next_position = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, (size_t)key_ctx->key_length);
+    if (next_position == NULL)
+    {
+        return 3;
+    }
+    adfgvx_key_ctx_column_starts(key_ctx, total_symbols, next_position);
+
+    // Os simbolos de colunas vizinhas dividem o byte da fronteira: cada um e acrescentado
+    // (OR) a saida zerada, em qualquer ordem.
+    memset(output, 0, total_bytes);
+    int key_length = key_ctx->key_length;
+    int col = 0;
+    char block_symbols[2 * ADFGVX_ENCODE_BLOCK_SIZE];
+    ADFGVX_STATS_BEGIN(stage_start);
+    for (size_t start = 0; start < message_length; start += ADFGVX_ENCODE_BLOCK_SIZE)
+    {
+        size_t block_length = message_length - start < ADFGVX_ENCODE_BLOCK_SIZE ? message_length - start : ADFGVX_ENCODE_BLOCK_SIZE;
+        size_t produced = adfgvx_encode_symbols(message + start, block_length, block_symbols);
+        ADFGVX_STATS_NEXT(ADFGVX_STAGE_ENCODE, stage_start, block_length);
+
+        scatter_values(key_length, next_position, &col, block_symbols, produced, output);
+        ADFGVX_STATS_NEXT(ADFGVX_STAGE_TRANSPOSE, stage_start, produced);
+    }
+    adfgvx_key_scratch_free(next_position, stack_start);
+    *symbol_count = total_symbols;
+    return 0;
+}
+
+int adfgvx_packed_decrypt(const adfgvx_key_ctx *key_ctx,
+                          const unsigned char *packed,
+                          size_t symbol_count,
+                          char *output,
+                          size_t output_capacity,
+                          size_t *output_length)
+{
+    if (!key_ctx || !packed || !output_length)
+    {
+        return 1;
+    }
+    *output_length = 0;
+    if (symbol_count % 2 != 0)
+    {
+        return 3; // Nao pode decodificar numero impar de simbolos
+    }
+    if (symbol_count > 0 && !output)
+    {
+        return 1;
+    }
+
+    size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+    size_t *next_position = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, (size_t)key_ctx->key_length);
+    if (next_position == NULL)
+    {
+        return 4;
+    }
+    adfgvx_key_ctx_column_starts(key_ctx, symbol_count, next_position);
+
+    int key_length = key_ctx->key_length;
+    int col = 0;
+    size_t pairs = symbol_count / 2;
+    size_t limit = pairs < output_capacity ? pairs : output_capacity;
+    size_t written = 0;
+    ADFGVX_STATS_BEGIN(stage_start);
+    if (key_length <= ADFGVX_KEY_STACK_COLUMNS)
+    {
+        // Grupos de 8 linhas inteiras (4 * key_length pares), a partir do primeiro par.
+        short pair_cell[64];
+        for (int v = 0; v < 64; v++)
+        {
+            int row = v >> 3, column = v & 7;
+            pair_cell[v] = row < ADFGVX_SYMBOL_COUNT && column < ADFGVX_SYMBOL_COUNT
+                               ? (short)(unsigned char)adfgvx_square_cells[row * ADFGVX_SYMBOL_COUNT + column]
+                               : -1;
+        }
+        size_t group_pairs = 4 * (size_t)key_length;
+        written = decode_row_groups(key_length, next_position, packed, limit / group_pairs, pair_cell, output);
+        if (written == limit / group_pairs * group_pairs)
+        {
+            written += decode_pairs(key_length, next_position, &col, packed, limit - written, output + written);
+        }
+    }
+    else
+    {
+        written = decode_pairs(key_length, next_position, &col, packed, limit, output);
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_DECODE, stage_start, adfgvx_packed_size(2 * written));
+    adfgvx_key_scratch_free(next_position, stack_start);
+
+    *output_length = written;
+    if (written < limit)
+    {
+        return 3; // Par de simbolos invalido: a decodificacao para aqui.
+    }
+    return written < pairs ? 2 : 0;
+}
+
+void adfgvx_packed_write_header(unsigned char header[ADFGVX_PACKED_HEADER_SIZE], size_t symbol_count)
+{
+    unsigned long long count = symbol_count;
+
+    memcpy(header, ADFGVX_PACKED_MAGIC, 8);
+    for (int i = 0; i < 8; i++)
+    {
+        header[8 + i] = (unsigned char)(count >> (8 * i));
+    }
+}
+
+int adfgvx_packed_read_header(const unsigned char *data, size_t length, size_t *symbol_count)
+{
+    unsigned long long count = 0;
+
+    if (!data || !symbol_count || length < ADFGVX_PACKED_HEADER_SIZE || memcmp(data, ADFGVX_PACKED_MAGIC, 8) != 0)
+    {
+        return 1;
+    }
+    for (int i = 7; i >= 0; i--)
+    {
+        count = (count << 8) | data[8 + i];
+    }
+    // Cada byte guarda menos de 3 simbolos: um cabecalho maior que isso nao cabe no arquivo.
+    size_t data_length = length - ADFGVX_PACKED_HEADER_SIZE;
+    if (count / 3 > data_length || adfgvx_packed_size((size_t)count) != data_length)
+    {
+        return 2;
+    }
+    *symbol_count = (size_t)count;
+    return 0;
+}
@@ -0,0 +1,281 @@
+#include "adfgvx_pipeline.h"
+#include "adfgvx_stats.h" // Para a medicao da leitura e da escrita (--stats)
+#include <pthread.h>
+#include <stdlib.h> // Para malloc, realloc e free
+#include <string.h> // Para memcpy
+
+/**
+ * @brief Uma posicao do anel: o bloco lido e a saida produzida para ele.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    char *input;
+    size_t input_length;
+    int last;
+    adfgvx_pipeline_buffer output;
+} pipeline_slot;
+
+/**
+ * @brief Estado compartilhado pelos tres estagios. O bloco de numero n ocupa a posicao
+ * n % depth; cada contador e o numero de blocos que ja passaram pelo estagio.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    FILE *input;
+    FILE *output;
+    size_t block_size;
+    size_t depth;
+    pipeline_slot *slots;
+    pthread_mutex_t lock;
+    pthread_cond_t changed;        // Sinalizada quando um contador avanca ou ocorre um erro.
+    unsigned long long read_count;
+    unsigned long long processed_count;
+    unsigned long long written_count;
+    int status;                    // Primeiro erro (0 se nenhum).
+    adfgvx_pipeline_stats stats;
+} pipeline;
+
+int adfgvx_pipeline_buffer_append(adfgvx_pipeline_buffer *buffer, const char *data, size_t length)
+{
+    if (length > buffer->capacity - buffer->length)
+    {
+        size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+        while (capacity - buffer->length < length)
+        {
+            capacity *= 2;
+        }
+        char *grown = realloc(buffer->data, capacity);
+        if (grown == NULL)
+        {
+            return 2;
+        }
+        buffer->data = grown;
+        buffer->capacity = capacity;
+    }
+    memcpy(buffer->data + buffer->length, data, length);
+    buffer->length += length;
+    return 0;
+}
+
+/**
+ * @brief Registra o primeiro erro e acorda os outros estagios.
+ * (Funcao auxiliar estatica; chamada sem o lock)
+ */
+static void fail(pipeline *p, int status)
+{
+    pthread_mutex_lock(&p->lock);
+    if (p->status == 0)
+    {
+        p->status = status;
+    }
+    pthread_cond_broadcast(&p->changed);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * @brief Estagio de leitura: preenche as posicoes livres do anel, em ordem.
+ * (Funcao auxiliar estatica, executada numa thread propria)
+ */
+static void *reader_main(void *arg)
+{
+    pipeline *p = arg;
+
+    for (unsigned long long n = 0;; n++)
+    {
+        pipeline_slot *slot = &p->slots[n % p->depth];
+
+        pthread_mutex_lock(&p->lock);
+        while (p->status == 0 && n - p->written_count >= p->depth)
+        {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        int stop = p->status != 0;
+        pthread_mutex_unlock(&p->lock);
+        if (stop)
+        {
+            return NULL;
+        }
+
+        ADFGVX_STATS_BEGIN(stage_start);
+        slot->input_length = fread(slot->input, 1, p->block_size, p->input);
+        ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, slot->input_length);
+        if (ferror(p->input))
+        {
+            fail(p, 3);
+            return NULL;
+        }
+        int last = slot->input_length < p->block_size;
+        slot->last = last;
+
+        pthread_mutex_lock(&p->lock);
+        p->stats.input_bytes += slot->input_length;
+        p->read_count = n + 1;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->lock);
+        if (last)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Estagio de escrita: grava a saida de cada bloco processado, em ordem.
+ * (Funcao auxiliar estatica, executada numa thread propria)
+ */
+static void *writer_main(void *arg)
+{
+    pipeline *p = arg;
+
+    for (unsigned long long n = 0;; n++)
+    {
+        pipeline_slot *slot = &p->slots[n % p->depth];
+
+        pthread_mutex_lock(&p->lock);
+        while (p->status == 0 && p->processed_count <= n)
+        {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        int stop = p->status != 0;
+        pthread_mutex_unlock(&p->lock);
+        if (stop)
+        {
+            return NULL;
+        }
+
+        ADFGVX_STATS_BEGIN(stage_start);
+        if ((slot->output.length > 0 && fwrite(slot->output.data, 1, slot->output.length, p->output) != slot->output.length) ||
+            (slot->last && fflush(p->output) != 0))
+        {
+            fail(p, 4);
+            return NULL;
+        }
+        ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, slot->output.length);
+
+        // Lido antes de liberar a posicao: depois disso o leitor pode reaproveita-la.
+        int last = slot->last;
+        pthread_mutex_lock(&p->lock);
+        p->stats.output_bytes += slot->output.length;
+        p->written_count = n + 1;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->lock);
+        if (last)
+        {
+            return NULL;
+        }
+    }
+}
+
+/**
+ * @brief Estagio de processamento, na thread chamadora.
+ * (Funcao auxiliar estatica)
+ */
+static void process_blocks(pipeline *p, adfgvx_pipeline_stage stage, void *user)
+{
+    for (unsigned long long n = 0;; n++)
+    {
+        pipeline_slot *slot = &p->slots[n % p->depth];
+
+        pthread_mutex_lock(&p->lock);
+        while (p->status == 0 && p->read_count <= n)
+        {
+            pthread_cond_wait(&p->changed, &p->lock);
+        }
+        int stop = p->status != 0;
+        pthread_mutex_unlock(&p->lock);
+        if (stop)
+        {
+            return;
+        }
+
+        slot->output.length = 0;
+        int status = stage(user, slot->input, slot->input_length, slot->last, &slot->output);
+        if (status != 0)
+        {
+            p->stats.stage_status = status;
+            fail(p, 5);
+            return;
+        }
+
+        // Lido antes de liberar a posicao: depois da escrita o leitor pode reaproveita-la.
+        int last = slot->last;
+        pthread_mutex_lock(&p->lock);
+        p->stats.blocks++;
+        p->processed_count = n + 1;
+        pthread_cond_broadcast(&p->changed);
+        pthread_mutex_unlock(&p->lock);
+        if (last)
+        {
+            return;
+        }
+    }
+}
+
+int adfgvx_pipeline_run(FILE *input,
+                        FILE *output,
+                        size_t block_size,
+                        size_t queue_depth,
+                        adfgvx_pipeline_stage stage,
+                        void *user,
+                        adfgvx_pipeline_stats *stats)
+{
+    pipeline p;
+    pthread_t reader, writer;
+
+    if (!input || !output || !stage || block_size == 0 || queue_depth < 2)
+    {
+        return 1;
+    }
+    memset(&p, 0, sizeof(p));
+    p.input = input;
+    p.output = output;
+    p.block_size = block_size;
+    p.depth = queue_depth;
+    p.slots = calloc(queue_depth, sizeof(pipeline_slot));
+    int status = p.slots == NULL ? 2 : 0;
+    for (size_t i = 0; i < queue_depth && status == 0; i++)
+    {
+        p.slots[i].input = malloc(block_size);
+        status = p.slots[i].input == NULL ? 2 : 0;
+    }
+
+    if (status == 0)
+    {
+        pthread_mutex_init(&p.lock, NULL);
+        pthread_cond_init(&p.changed, NULL);
+        if (pthread_create(&reader, NULL, reader_main, &p) != 0)
+        {
+            status = 2;
+        }
+        else
+        {
+            if (pthread_create(&writer, NULL, writer_main, &p) != 0)
+            {
+                fail(&p, 2);
+            }
+            else
+            {
+                process_blocks(&p, stage, user);
+                pthread_join(writer, NULL);
+            }
+            pthread_join(reader, NULL);
+            status = p.status;
+        }
+        pthread_cond_destroy(&p.changed);
+        pthread_mutex_destroy(&p.lock);
+    }
+
+    for (size_t i = 0; p.slots != NULL && i < queue_depth; i++)
+    {
+        free(p.slots[i].input);
+        free(p.slots[i].output.data);
+    }
+    free(p.slots);
+    if (stats != NULL)
+    {
+        *stats = p.stats;
+    }
+    return status;
+}
@@ -0,0 +1,233 @@
+#include "adfgvx_records.h"
+#include "adfgvx_core.h"     // Para cipher_adfgvx_batch
+#include "adfgvx_decipher.h" // Para decipher_adfgvx_batch
+#include "cipher_config.h"   // Para ADFGVX_RECORD_BLOCK_SIZE
+#include "adfgvx_stats.h"    // Para a medicao da leitura e da escrita (--stats)
+#include <stdlib.h>          // Para malloc, realloc e free
+#include <string.h>          // Para memchr e memmove
+
+/**
+ * @brief Estado compartilhado pelas tarefas de um bloco de registros.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    const adfgvx_key_ctx *key_ctx;
+    adfgvx_records_mode mode;
+    adfgvx_batch_item *items;
+    size_t item_count;
+    size_t items_per_task;
+} records_job;
+
+/**
+ * @brief Processa um trecho contiguo de registros do bloco atual.
+ * (Funcao auxiliar estatica, executada pelas threads do pool)
+ */
+static void records_task(void *user, size_t task)
+{
+    records_job *job = user;
+    size_t first = task * job->items_per_task;
+    size_t count = job->item_count - first < job->items_per_task ? job->item_count - first : job->items_per_task;
+
+    if (job->mode == ADFGVX_RECORDS_ENCRYPT)
+    {
+        cipher_adfgvx_batch(job->key_ctx, job->items + first, count);
+    }
+    else
+    {
+        decipher_adfgvx_batch(job->key_ctx, job->items + first, count);
+    }
+}
+
+/**
+ * @brief Garante que *buffer tenha pelo menos needed elementos de element_size bytes.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se faltar memoria (o buffer antigo e mantido).
+ */
+static int ensure_capacity(void **buffer, size_t *capacity, size_t needed, size_t element_size)
+{
+    if (needed <= *capacity)
+    {
+        return 0;
+    }
+
+    size_t grown = *capacity > 0 ? *capacity : 1;
+    while (grown < needed)
+    {
+        grown *= 2;
+    }
+    void *data = realloc(*buffer, grown * element_size);
+    if (data == NULL)
+    {
+        return 1;
+    }
+    *buffer = data;
+    *capacity = grown;
+    return 0;
+}
+
+int adfgvx_process_records(FILE *input,
+                           FILE *output,
+                           const adfgvx_key_ctx *key_ctx,
+                           adfgvx_records_mode mode,
+                           thread_pool *pool,
+                           adfgvx_records_stats *stats)
+{
+    adfgvx_records_stats counters = {0, 0, 0, 0};
+    char *data = NULL;                // Bytes lidos e ainda nao processados.
+    size_t data_capacity = 0;
+    size_t data_used = 0;
+    adfgvx_batch_item *items = NULL;  // Registros do bloco atual.
+    size_t item_capacity = 0;
+    char *arena = NULL;               // Saidas dos registros do bloco atual.
+    size_t arena_capacity = 0;
+    int at_eof = 0;
+    int status = 0;
+
+    if (!input || !output || !key_ctx)
+    {
+        return 1;
+    }
+    if (ensure_capacity((void **)&data, &data_capacity, ADFGVX_RECORD_BLOCK_SIZE, 1) != 0)
+    {
+        return 2;
+    }
+
+    while (status == 0)
+    {
+        // Completa o buffer de entrada.
+        if (!at_eof && data_used < data_capacity)
+        {
+            ADFGVX_STATS_BEGIN(stage_start);
+            size_t n = fread(data + data_used, 1, data_capacity - data_used, input);
+            ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, n);
+            data_used += n;
+            if (ferror(input))
+            {
+                status = 3;
+                break;
+            }
+            at_eof = feof(input);
+        }
+
+        // O bloco termina na ultima quebra de linha lida (ou no fim do arquivo).
+        size_t block_end = data_used;
+        if (!at_eof)
+        {
+            while (block_end > 0 && data[block_end - 1] != '\n')
+            {
+                block_end--;
+            }
+            if (block_end == 0)
+            {
+                // Linha maior que o buffer: aumenta o buffer e continua lendo.
+                if (data_used == data_capacity &&
+                    ensure_capacity((void **)&data, &data_capacity, data_capacity * 2, 1) != 0)
+                {
+                    status = 2;
+                }
+                continue;
+            }
+        }
+        if (block_end == 0)
+        {
+            break; // Fim do arquivo e nada pendente.
+        }
+
+        // Separa os registros e reserva a saida de cada um na arena.
+        size_t arena_needed = 0;
+        size_t count = 0;
+        for (size_t start = 0; start < block_end && status == 0; count++)
+        {
+            const char *newline = memchr(data + start, '\n', block_end - start);
+            size_t end = newline ? (size_t)(newline - data) : block_end;
+            size_t length = end - start;
+
+            if (length > 0 && data[end - 1] == '\r')
+            {
+                length--;
+            }
+            if (ensure_capacity((void **)&items, &item_capacity, count + 1, sizeof(adfgvx_batch_item)) != 0)
+            {
+                status = 2;
+                break;
+            }
+            items[count].input = data + start;
+            items[count].input_length = length;
+            items[count].output_capacity = mode == ADFGVX_RECORDS_ENCRYPT ? 2 * length : length / 2;
+            items[count].output_length = 0;
+            items[count].status = 0;
+            arena_needed += items[count].output_capacity;
+            start = end + 1;
+        }
+        if (status != 0 || ensure_capacity((void **)&arena, &arena_capacity, arena_needed + 1, 1) != 0)
+        {
+            status = 2;
+            break;
+        }
+
+        size_t offset = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            items[i].output = arena + offset;
+            offset += items[i].output_capacity;
+        }
+
+        // Processa o bloco: cada tarefa cuida de um trecho contiguo de registros.
+        records_job job;
+        size_t task_count = 1;
+        job.key_ctx = key_ctx;
+        job.mode = mode;
+        job.items = items;
+        job.item_count = count;
+        job.items_per_task = count;
+        if (thread_pool_size(pool) > 1 && count > 1)
+        {
+            task_count = (size_t)thread_pool_size(pool) * ADFGVX_PARALLEL_CHUNKS_PER_THREAD;
+            job.items_per_task = (count + task_count - 1) / task_count;
+            task_count = (count + job.items_per_task - 1) / job.items_per_task;
+            thread_pool_run(pool, task_count, records_task, &job);
+        }
+        else
+        {
+            records_task(&job, 0);
+        }
+
+        // Escreve as saidas na ordem dos registros.
+        ADFGVX_STATS_BEGIN(stage_start);
+        unsigned long long written_before = counters.output_bytes;
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t length = items[i].status == 0 ? items[i].output_length : 0;
+
+            counters.failed += items[i].status != 0;
+            if ((length > 0 && fwrite(items[i].output, 1, length, output) != length) || putc('\n', output) == EOF)
+            {
+                status = 3;
+                break;
+            }
+            counters.output_bytes += length + 1;
+        }
+        ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, counters.output_bytes - written_before);
+        counters.records += count;
+        counters.input_bytes += block_end;
+
+        memmove(data, data + block_end, data_used - block_end);
+        data_used -= block_end;
+    }
+
+    if (status == 0 && fflush(output) != 0)
+    {
+        status = 3;
+    }
+    if (stats != NULL)
+    {
+        *stats = counters;
+    }
+
+    free(arena);
+    free(items);
+    free(data);
+    return status;
+}
@@ -0,0 +1,261 @@
+#include "adfgvx_reference.h"
+#include "cipher_config.h" // Para MAX_KEY_LENGTH
+#include <stdlib.h>        // Para malloc e free
+
+// Copia propria das constantes da cifra: a referencia nao depende do codec compartilhado.
+static const char symbols[6] = {'A', 'D', 'F', 'G', 'V', 'X'};
+static const char square[6][6] = {
+    {'A', 'B', 'C', 'D', 'E', 'F'},
+    {'G', 'H', 'I', 'J', 'K', 'L'},
+    {'M', 'N', 'O', 'P', 'Q', 'R'},
+    {'S', 'T', 'U', 'V', 'W', 'X'},
+    {'Y', 'Z', ' ', ',', '.', '1'},
+    {'2', '3', '4', '5', '6', '7'}};
+
+/**
+ * @brief Encontra os simbolos ADFGVX de um caractere por busca linear na matriz.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 1 se o caractere foi encontrado, 0 caso contrario.
+ */
+static int get_adfgvx_symbols(char c, char *row, char *col)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        for (int j = 0; j < 6; j++)
+        {
+            if (square[i][j] == c)
+            {
+                *row = symbols[i];
+                *col = symbols[j];
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Retorna o indice de um simbolo ADFGVX, ou -1 se o caractere nao for um simbolo.
+ * (Funcao auxiliar estatica)
+ */
+static int symbol_index(char c)
+{
+    for (int i = 0; i < 6; i++)
+    {
+        if (symbols[i] == c)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Ordena as colunas pela chave com Bubble Sort, como a versao original: uma copia
+ * da chave e ordenada e cada troca de caracteres troca tambem as colunas correspondentes.
+ * (Funcao auxiliar estatica)
+ *
+ * @param sorted_key Area de key_length caracteres (conteudo de entrada ignorado).
+ * @param order Saida: order[i] = coluna original na i-esima posicao alfabetica.
+ */
+static void sort_columns_by_key(const char key[], int key_length, char sorted_key[], int order[])
+{
+    for (int i = 0; i < key_length; i++)
+    {
+        sorted_key[i] = key[i];
+        order[i] = i;
+    }
+
+    for (int i = 0; i < key_length - 1; i++)
+    {
+        for (int j = 0; j < key_length - i - 1; j++)
+        {
+            if (sorted_key[j] > sorted_key[j + 1])
+            {
+                char temp_char = sorted_key[j];
+                sorted_key[j] = sorted_key[j + 1];
+                sorted_key[j + 1] = temp_char;
+
+                int temp_column = order[j];
+                order[j] = order[j + 1];
+                order[j + 1] = temp_column;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Aloca a matriz de colunas e as tabelas da chave num unico bloco.
+ * (Funcao auxiliar estatica)
+ *
+ * @param column_capacity Simbolos por coluna.
+ * @return char* A matriz (key_length colunas de column_capacity simbolos), seguida de
+ * sorted_key; order e counts recebem as tabelas de inteiros. NULL se faltar memoria.
+ */
+static char *allocate_columns(int key_length, size_t column_capacity, int **order, size_t **counts)
+{
+    size_t k = (size_t)key_length;
+
+    // As tabelas de inteiros ficam no inicio do bloco, alinhadas.
+    size_t *tables = malloc(k * sizeof(size_t) + k * sizeof(int) + k * column_capacity + k);
+    if (tables == NULL)
+    {
+        return NULL;
+    }
+    *counts = tables;
+    *order = (int *)(tables + k);
+    return (char *)(*order + k);
+}
+
+int adfgvx_reference_cipher(const char key[],
+                            int key_length,
+                            const char message[],
+                            size_t message_length,
+                            char output[],
+                            size_t output_capacity,
+                            size_t *output_length)
+{
+    if (!key || !message || !output_length || key_length <= 0 || key_length >= MAX_KEY_LENGTH)
+    {
+        return 1;
+    }
+    *output_length = 0;
+
+    size_t total = 0;
+    for (size_t i = 0; i < message_length; i++)
+    {
+        char row, col;
+        total += 2 * (size_t)get_adfgvx_symbols(message[i], &row, &col);
+    }
+    if (total > 0 && !output)
+    {
+        return 1;
+    }
+    if (total > output_capacity)
+    {
+        return 2;
+    }
+
+    // A coluna c recebe os simbolos c, c + key_length, c + 2 * key_length, ...
+    size_t k = (size_t)key_length;
+    size_t column_capacity = (total + k - 1) / k;
+    int *order;
+    size_t *counts;
+    char *columns = allocate_columns(key_length, column_capacity, &order, &counts);
+    if (columns == NULL)
+    {
+        return 3;
+    }
+    char *sorted_key = columns + k * column_capacity;
+
+    // 1) Substituicao: cada caractere vira dois simbolos, distribuidos nas colunas.
+    size_t symbol_count = 0;
+    for (size_t c = 0; c < k; c++)
+    {
+        counts[c] = 0;
+    }
+    for (size_t i = 0; i < message_length; i++)
+    {
+        char pair[2];
+        if (!get_adfgvx_symbols(message[i], &pair[0], &pair[1]))
+        {
+            continue; // Caracteres nao encontrados sao ignorados.
+        }
+        for (int s = 0; s < 2; s++)
+        {
+            size_t c = symbol_count % k;
+            columns[c * column_capacity + counts[c]++] = pair[s];
+            symbol_count++;
+        }
+    }
+
+    // 2) Transposicao: as colunas sao lidas na ordem alfabetica da chave.
+    sort_columns_by_key(key, key_length, sorted_key, order);
+    size_t position = 0;
+    for (int i = 0; i < key_length; i++)
+    {
+        size_t c = (size_t)order[i];
+        for (size_t r = 0; r < counts[c]; r++)
+        {
+            output[position++] = columns[c * column_capacity + r];
+        }
+    }
+
+    free(counts);
+    *output_length = position;
+    return 0;
+}
+
+int adfgvx_reference_decipher(const char *encrypted_text,
+                              size_t encrypted_length,
+                              const char key[],
+                              int key_length,
+                              char *output,
+                              size_t output_capacity,
+                              size_t *output_length)
+{
+    if (!key || key_length <= 0 || key_length >= MAX_KEY_LENGTH || !encrypted_text || !output_length)
+    {
+        return 1;
+    }
+    *output_length = 0;
+    if (encrypted_length % 2 != 0)
+    {
+        return 3; // Nao pode decodificar numero impar de simbolos.
+    }
+    if (encrypted_length > 0 && !output)
+    {
+        return 1;
+    }
+
+    size_t k = (size_t)key_length;
+    size_t rows = encrypted_length / k;
+    size_t extra = encrypted_length % k;
+    size_t column_capacity = rows + (extra > 0 ? 1 : 0);
+    int *order;
+    size_t *counts;
+    char *columns = allocate_columns(key_length, column_capacity, &order, &counts);
+    if (columns == NULL)
+    {
+        return 4;
+    }
+    char *sorted_key = columns + k * column_capacity;
+
+    // 1) Desfaz a transposicao: o texto cifrado e a concatenacao das colunas na ordem
+    // alfabetica da chave, e a coluna original c tem rows + 1 simbolos se c < extra.
+    sort_columns_by_key(key, key_length, sorted_key, order);
+    size_t position = 0;
+    for (int i = 0; i < key_length; i++)
+    {
+        size_t c = (size_t)order[i];
+        counts[c] = rows + (c < extra ? 1 : 0);
+        for (size_t r = 0; r < counts[c]; r++)
+        {
+            columns[c * column_capacity + r] = encrypted_text[position++];
+        }
+    }
+
+    // 2) Le as colunas linha a linha, na ordem original, e decodifica os pares.
+    size_t pairs = encrypted_length / 2;
+    size_t limit = pairs < output_capacity ? pairs : output_capacity;
+    int status = limit < pairs ? 2 : 0;
+    for (size_t p = 0; p < limit; p++)
+    {
+        size_t first = 2 * p;
+        size_t second = first + 1;
+        int row = symbol_index(columns[(first % k) * column_capacity + first / k]);
+        int col = symbol_index(columns[(second % k) * column_capacity + second / k]);
+
+        if (row < 0 || col < 0)
+        {
+            status = 3; // Par de simbolos invalido: a decodificacao para aqui.
+            break;
+        }
+        output[p] = square[row][col];
+        *output_length = p + 1;
+    }
+
+    free(counts);
+    return status;
+}
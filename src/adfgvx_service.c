@@ -0,0 +1,1376 @@
+#define _POSIX_C_SOURCE 200809L // Para clock_gettime, sockets e pthread_cond_timedwait com -std=c99
+
+#include "adfgvx_service.h"
+#include <stdlib.h> // Para malloc, calloc e free
+#include <string.h> // Para memcpy, memcmp e strlen
+
+#include "cipher_config.h"   // Para MAX_KEY_LENGTH e ADFGVX_SERVICE_*
+#include "adfgvx_core.h"     // Para cipher_adfgvx_parallel
+#include "adfgvx_decipher.h" // Para decipher_adfgvx_parallel
+#include "adfgvx_codec.h"    // Para adfgvx_codec_init
+#include "adfgvx_key.h"      // Para adfgvx_key_ctx
+#include "thread_pool.h"
+
+#ifndef _WIN32
+
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#ifdef MSG_NOSIGNAL
+#define SERVICE_SEND_FLAGS MSG_NOSIGNAL // Um cliente que fechou a conexao nao gera SIGPIPE.
+#else
+#define SERVICE_SEND_FLAGS 0
+#endif
+
+// Histograma de latencia: 4 faixas por potencia de 2 (erro relativo de ate 25% por faixa).
+#define SERVICE_HISTOGRAM_BUCKETS 256
+
+// Espaco reservado para a resposta de ADFGVX_SERVICE_STATS.
+#define SERVICE_STATS_CAPACITY 32768
+
+/**
+ * @brief Histograma de latencias, em nanossegundos.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    unsigned long long counts[SERVICE_HISTOGRAM_BUCKETS];
+    unsigned long long total;
+    unsigned long long max_ns;
+} service_histogram;
+
+/**
+ * @brief Agenda de uma chave no cache.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    char *key;
+    int key_length;
+    unsigned long hash;
+    adfgvx_key_ctx ctx;
+    int refs;                    // Requisicoes na fila ou em processamento que usam a agenda.
+    int cached;                  // 0 se ficou fora do cache (todas as posicoes em uso): liberada com refs == 0.
+    unsigned long long last_use; // Para substituir a usada ha mais tempo.
+} service_key;
+
+typedef struct service_connection service_connection;
+
+typedef struct service_request service_request;
+
+/**
+ * @brief Conexao de um cliente, com uma thread de leitura e uma de escrita proprias: um
+ * cliente que demora a ler as respostas so atrasa a propria conexao.
+ * (Estrutura auxiliar interna)
+ */
+struct service_connection
+{
+    int fd;
+    int refs;                   // Threads de leitura e de escrita ainda ativas.
+    int reading;                // 1 enquanto a thread de leitura esta ativa.
+    int broken;                 // 1 depois de um erro de escrita: as respostas seguintes sao descartadas.
+    pthread_cond_t changed;     // Respostas prontas para a escrita; requisicoes liberadas para a leitura.
+    service_request *replies_head; // Respostas prontas, na ordem das requisicoes.
+    service_request *replies_tail;
+    size_t pending;             // Requisicoes lidas e ainda nao respondidas.
+    size_t pending_bytes;       // Memoria dessas requisicoes (conteudo e espaco da resposta).
+    adfgvx_service *service;
+    service_connection *next;
+};
+
+/**
+ * @brief Requisicao recebida. A estrutura, o conteudo e o espaco da resposta ficam num
+ * unico bloco do heap.
+ * (Estrutura auxiliar interna)
+ */
+struct service_request
+{
+    service_request *next;
+    service_connection *connection;
+    service_key *key;        // NULL em ADFGVX_SERVICE_STATS ou se status ja veio preenchido.
+    int op;
+    int status;
+    unsigned int id;
+    const char *input;
+    size_t input_length;
+    char *output;
+    size_t output_capacity;
+    size_t output_length;
+    unsigned long long received_ns;
+};
+
+struct adfgvx_service
+{
+    adfgvx_service_config config;
+    char *socket_path;
+    int listen_fd;
+    int bound;                 // 1 se o caminho do socket foi criado por este servico.
+    thread_pool *pool;
+    pthread_mutex_t lock;      // Protege a fila, as conexoes, o cache e os sinalizadores abaixo.
+    pthread_cond_t changed;
+    int sync_ready;            // 1 depois de inicializar lock e changed.
+    pthread_t batcher;
+    int batcher_started;
+    service_request *queue_head;
+    service_request *queue_tail;
+    size_t queued;
+    int busy;                  // 1 enquanto a thread dos lotes processa um lote.
+    service_connection *connections;
+    int readers;               // Threads de leitura ativas.
+    int writers;               // Threads de escrita ativas.
+    int stop_requested;        // adfgvx_service_stop.
+    int stopping;              // Fim de adfgvx_service_run: as conexoes deixam de ser lidas.
+    int closing;               // adfgvx_service_close: a thread dos lotes termina.
+    service_key *keys[ADFGVX_SERVICE_KEY_CACHE];
+    unsigned long long key_clock;
+    unsigned long long key_hits;
+    unsigned long long key_misses;
+    service_request **batch;   // Lote atual (config.batch_size posicoes).
+    service_histogram latency[2]; // Cifragem e decifragem (alterados pelas threads de escrita, com o lock).
+    // Estatisticas dos lotes, alteradas apenas pela thread dos lotes.
+    unsigned long long batches;
+    unsigned long long batched_requests;
+    size_t largest_batch;
+};
+
+/**
+ * @brief Tempo monotonic atual, em nanossegundos.
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ull + (unsigned long long)ts.tv_nsec;
+}
+
+/**
+ * @brief Faixa do histograma de um valor: 0 a 3 tem faixas proprias; acima disso, cada
+ * potencia de 2 e dividida em 4 faixas.
+ * (Funcao auxiliar estatica)
+ */
+static size_t histogram_bucket(unsigned long long value)
+{
+    int exponent = 0;
+
+    if (value < 4)
+    {
+        return (size_t)value;
+    }
+    while ((value >> exponent) > 1)
+    {
+        exponent++;
+    }
+    return (size_t)(4 * (exponent - 1)) + (size_t)((value >> (exponent - 2)) & 3);
+}
+
+/**
+ * @brief Menor valor da faixa index (inversa de histogram_bucket).
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long long histogram_lower(size_t index)
+{
+    if (index < 4)
+    {
+        return index;
+    }
+    return (unsigned long long)(4 + index % 4) << (index / 4 - 1);
+}
+
+static void histogram_add(service_histogram *histogram, unsigned long long value)
+{
+    histogram->counts[histogram_bucket(value)]++;
+    histogram->total++;
+    if (value > histogram->max_ns)
+    {
+        histogram->max_ns = value;
+    }
+}
+
+/**
+ * @brief Percentil (0 < fraction <= 1) pelo posto mais proximo, aproximado pelo maior
+ * valor da faixa que o contem (nunca acima do maximo observado).
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long long histogram_percentile(const service_histogram *histogram, double fraction)
+{
+    unsigned long long rank = (unsigned long long)(fraction * (double)histogram->total + 0.999999);
+    unsigned long long seen = 0;
+
+    for (size_t i = 0; i + 1 < SERVICE_HISTOGRAM_BUCKETS && histogram->total > 0; i++)
+    {
+        seen += histogram->counts[i];
+        if (seen >= rank)
+        {
+            unsigned long long upper = histogram_lower(i + 1) - 1;
+            return upper < histogram->max_ns ? upper : histogram->max_ns;
+        }
+    }
+    return histogram->max_ns;
+}
+
+static void put_u32(unsigned char *p, unsigned long value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        p[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+static unsigned long get_u32(const unsigned char *p)
+{
+    return (unsigned long)p[0] | (unsigned long)p[1] << 8 | (unsigned long)p[2] << 16 | (unsigned long)p[3] << 24;
+}
+
+/**
+ * @brief Monta um cabecalho do protocolo.
+ * (Funcao auxiliar estatica)
+ */
+static void encode_header(unsigned char header[], int op, int status, unsigned int id, size_t key_length, size_t payload_length)
+{
+    header[0] = ADFGVX_SERVICE_VERSION;
+    header[1] = (unsigned char)op;
+    header[2] = (unsigned char)(status & 0xFF);
+    header[3] = (unsigned char)((status >> 8) & 0xFF);
+    put_u32(header + 4, id);
+    put_u32(header + 8, (unsigned long)key_length);
+    put_u32(header + 12, (unsigned long)payload_length);
+}
+
+/**
+ * @brief Le exatamente length bytes.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se a conexao fechar ou houver erro de leitura.
+ */
+static int read_exact(int fd, void *buffer, size_t length)
+{
+    char *p = buffer;
+
+    while (length > 0)
+    {
+        ssize_t got = read(fd, p, length);
+        if (got < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (got <= 0)
+        {
+            return 1;
+        }
+        p += got;
+        length -= (size_t)got;
+    }
+    return 0;
+}
+
+/**
+ * @brief Le e descarta length bytes (conteudo que nao sera usado).
+ * (Funcao auxiliar estatica)
+ */
+static int discard_bytes(int fd, size_t length)
+{
+    char scratch[4096];
+
+    while (length > 0)
+    {
+        size_t part = length < sizeof(scratch) ? length : sizeof(scratch);
+        if (read_exact(fd, scratch, part) != 0)
+        {
+            return 1;
+        }
+        length -= part;
+    }
+    return 0;
+}
+
+static int send_all(int fd, const char *data, size_t length)
+{
+    while (length > 0)
+    {
+        ssize_t sent = send(fd, data, length, SERVICE_SEND_FLAGS);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (sent < 0)
+        {
+            return 1;
+        }
+        data += sent;
+        length -= (size_t)sent;
+    }
+    return 0;
+}
+
+/**
+ * @brief Envia cabecalho, chave e conteudo numa unica chamada (sendmsg); se o envio for
+ * parcial, o restante segue com send.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se houver erro de escrita.
+ */
+static int send_frame(int fd, const unsigned char header[], const char *key, size_t key_length, const char *payload, size_t payload_length)
+{
+    struct iovec parts[3];
+    struct msghdr message;
+    ssize_t sent;
+
+    parts[0].iov_base = (void *)header;
+    parts[0].iov_len = ADFGVX_SERVICE_HEADER_SIZE;
+    parts[1].iov_base = (void *)key;
+    parts[1].iov_len = key_length;
+    parts[2].iov_base = (void *)payload;
+    parts[2].iov_len = payload_length;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = parts;
+    message.msg_iovlen = 3;
+    do
+    {
+        sent = sendmsg(fd, &message, SERVICE_SEND_FLAGS);
+    } while (sent < 0 && errno == EINTR);
+    if (sent < 0)
+    {
+        return 1;
+    }
+
+    size_t done = (size_t)sent;
+    for (int i = 0; i < 3; i++)
+    {
+        size_t skip = done < parts[i].iov_len ? done : parts[i].iov_len;
+        done -= skip;
+        if (send_all(fd, (const char *)parts[i].iov_base + skip, parts[i].iov_len - skip) != 0)
+        {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Hash FNV-1a da chave (compara as entradas do cache antes de memcmp).
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long key_hash(const char *key, int key_length)
+{
+    unsigned long hash = 2166136261ul;
+
+    for (int i = 0; i < key_length; i++)
+    {
+        hash = (hash ^ (unsigned char)key[i]) * 16777619ul;
+    }
+    return hash & 0xFFFFFFFFul;
+}
+
+static void free_key(service_key *entry)
+{
+    adfgvx_key_ctx_free(&entry->ctx);
+    free(entry->key);
+    free(entry);
+}
+
+/**
+ * @brief Obtem a agenda de uma chave: do cache, ou preparada agora e guardada no lugar
+ * livre (ou usado ha mais tempo e sem requisicoes pendentes).
+ * (Funcao auxiliar estatica; chamada com o lock)
+ *
+ * @return service_key* A agenda (com uma referencia a mais), ou NULL se faltar memoria.
+ */
+static service_key *acquire_key(adfgvx_service *service, const char *key, int key_length)
+{
+    unsigned long hash = key_hash(key, key_length);
+    int free_slot = -1, oldest = -1;
+
+    for (int i = 0; i < ADFGVX_SERVICE_KEY_CACHE; i++)
+    {
+        service_key *entry = service->keys[i];
+
+        if (entry != NULL && entry->hash == hash && entry->key_length == key_length && memcmp(entry->key, key, (size_t)key_length) == 0)
+        {
+            entry->refs++;
+            entry->last_use = ++service->key_clock;
+            service->key_hits++;
+            return entry;
+        }
+        if (entry == NULL)
+        {
+            free_slot = free_slot < 0 ? i : free_slot;
+        }
+        else if (entry->refs == 0 && (oldest < 0 || entry->last_use < service->keys[oldest]->last_use))
+        {
+            oldest = i;
+        }
+    }
+    service->key_misses++;
+    int victim = free_slot >= 0 ? free_slot : oldest;
+
+    service_key *entry = calloc(1, sizeof(service_key));
+    if (entry == NULL || (entry->key = malloc((size_t)key_length)) == NULL ||
+        adfgvx_key_ctx_init(&entry->ctx, key, key_length) != 0)
+    {
+        if (entry != NULL)
+        {
+            free(entry->key);
+        }
+        free(entry);
+        return NULL;
+    }
+    memcpy(entry->key, key, (size_t)key_length);
+    entry->key_length = key_length;
+    entry->hash = hash;
+    entry->refs = 1;
+    entry->last_use = ++service->key_clock;
+    if (victim >= 0)
+    {
+        if (service->keys[victim] != NULL)
+        {
+            free_key(service->keys[victim]);
+        }
+        service->keys[victim] = entry;
+        entry->cached = 1;
+    }
+    return entry;
+}
+
+/**
+ * @brief Devolve uma referencia a agenda de uma chave.
+ * (Funcao auxiliar estatica; chamada com o lock)
+ */
+static void release_key(service_key *entry)
+{
+    if (entry != NULL && --entry->refs == 0 && !entry->cached)
+    {
+        free_key(entry);
+    }
+}
+
+/**
+ * @brief Devolve uma referencia a conexao; a ultima a retira da lista e fecha o descritor.
+ * (Funcao auxiliar estatica; chamada com o lock)
+ */
+static void release_connection(service_connection *connection)
+{
+    if (--connection->refs == 0)
+    {
+        adfgvx_service *service = connection->service;
+
+        for (service_connection **link = &service->connections; *link != NULL; link = &(*link)->next)
+        {
+            if (*link == connection)
+            {
+                *link = connection->next;
+                break;
+            }
+        }
+        close(connection->fd);
+        pthread_cond_destroy(&connection->changed);
+        free(connection);
+    }
+}
+
+/**
+ * @brief Acrescenta texto formatado a buffer, sem passar de capacity.
+ * (Funcao auxiliar estatica)
+ */
+static void append_text(char *buffer, size_t capacity, size_t *length, const char *text)
+{
+    size_t size = strlen(text);
+
+    if (*length + size >= capacity)
+    {
+        size = *length + 1 < capacity ? capacity - *length - 1 : 0;
+    }
+    memcpy(buffer + *length, text, size);
+    *length += size;
+    buffer[*length] = '\0';
+}
+
+/**
+ * @brief Escreve as estatisticas em JSON (o conteudo da resposta de ADFGVX_SERVICE_STATS).
+ * (Funcao auxiliar estatica)
+ *
+ * @return size_t Bytes escritos em buffer (sem o terminador nulo).
+ */
+static size_t format_stats(adfgvx_service *service, char *buffer, size_t capacity)
+{
+    static const char *names[2] = {"encrypt", "decrypt"};
+    service_histogram latency[2];
+    char text[256];
+    size_t length = 0;
+    int entries = 0;
+
+    pthread_mutex_lock(&service->lock);
+    for (int i = 0; i < ADFGVX_SERVICE_KEY_CACHE; i++)
+    {
+        entries += service->keys[i] != NULL;
+    }
+    snprintf(text, sizeof(text), "{\"requests\": %llu, \"batches\": %llu, \"mean_batch\": %.2f, \"largest_batch\": %lu, "
+                                 "\"key_cache\": {\"entries\": %d, \"hits\": %llu, \"misses\": %llu}, \"latency_ns\": {",
+             service->batched_requests, service->batches,
+             service->batches > 0 ? (double)service->batched_requests / (double)service->batches : 0.0,
+             (unsigned long)service->largest_batch, entries, service->key_hits, service->key_misses);
+    memcpy(latency, service->latency, sizeof(latency));
+    pthread_mutex_unlock(&service->lock);
+    buffer[0] = '\0';
+    append_text(buffer, capacity, &length, text);
+
+    for (int op = 0; op < 2; op++)
+    {
+        const service_histogram *histogram = &latency[op];
+        int first = 1;
+
+        snprintf(text, sizeof(text), "%s\"%s\": {\"count\": %llu, \"p50\": %llu, \"p99\": %llu, \"max\": %llu, \"buckets\": [",
+                 op > 0 ? ", " : "", names[op], histogram->total, histogram_percentile(histogram, 0.50),
+                 histogram_percentile(histogram, 0.99), histogram->max_ns);
+        append_text(buffer, capacity, &length, text);
+        // Apenas as faixas com amostras: [menor valor da faixa, quantidade].
+        for (size_t i = 0; i < SERVICE_HISTOGRAM_BUCKETS; i++)
+        {
+            if (histogram->counts[i] > 0)
+            {
+                snprintf(text, sizeof(text), "%s[%llu, %llu]", first ? "" : ", ", histogram_lower(i), histogram->counts[i]);
+                append_text(buffer, capacity, &length, text);
+                first = 0;
+            }
+        }
+        append_text(buffer, capacity, &length, "]}");
+    }
+    append_text(buffer, capacity, &length, "}}");
+    return length;
+}
+
+/**
+ * @brief Cifra ou decifra uma requisicao (com o pool, se for a unica do lote).
+ * (Funcao auxiliar estatica)
+ */
+static void process_request(service_request *request, thread_pool *pool)
+{
+    int code;
+
+    if (request->status != 0 || request->op == ADFGVX_SERVICE_STATS)
+    {
+        return;
+    }
+    if (request->op == ADFGVX_SERVICE_ENCRYPT)
+    {
+        code = cipher_adfgvx_parallel(&request->key->ctx, request->input, request->input_length, request->output,
+                                      request->output_capacity, &request->output_length, pool, ADFGVX_PARALLEL_THRESHOLD);
+    }
+    else
+    {
+        code = decipher_adfgvx_parallel(&request->key->ctx, request->input, request->input_length, request->output,
+                                        request->output_capacity, &request->output_length, pool, ADFGVX_PARALLEL_THRESHOLD);
+    }
+    if (code != 0)
+    {
+        request->status = ADFGVX_SERVICE_STATUS_CIPHER + code;
+        request->output_length = 0;
+    }
+}
+
+/**
+ * @brief Tarefa do pool: uma requisicao do lote.
+ * (Funcao auxiliar estatica, usada com thread_pool_run)
+ */
+static void request_task(void *user, size_t task_index)
+{
+    process_request(((service_request **)user)[task_index], NULL);
+}
+
+/**
+ * @brief Escreve a resposta de uma requisicao na sua conexao.
+ * (Funcao auxiliar estatica)
+ */
+static void send_response(service_request *request)
+{
+    service_connection *connection = request->connection;
+    unsigned char header[ADFGVX_SERVICE_HEADER_SIZE];
+    size_t length = request->status == 0 ? request->output_length : 0;
+
+    encode_header(header, request->op, request->status, request->id, 0, length);
+    if (!connection->broken && send_frame(connection->fd, header, NULL, 0, request->output, length) != 0)
+    {
+        connection->broken = 1;
+    }
+}
+
+/**
+ * @brief Processa um lote: as requisicoes sao divididas entre as threads do pool (uma
+ * requisicao sozinha usa o pool para dividir a propria mensagem). As respostas sao
+ * escritas depois, pela thread de escrita de cada conexao.
+ * (Funcao auxiliar estatica)
+ */
+static void process_batch(adfgvx_service *service, size_t count)
+{
+    if (count == 1)
+    {
+        process_request(service->batch[0], service->pool);
+    }
+    else if (thread_pool_size(service->pool) > 1)
+    {
+        thread_pool_run(service->pool, count, request_task, service->batch);
+    }
+    else
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            process_request(service->batch[i], NULL);
+        }
+    }
+
+    service->batches++;
+    service->batched_requests += count;
+    service->largest_batch = count > service->largest_batch ? count : service->largest_batch;
+    for (size_t i = 0; i < count; i++)
+    {
+        service_request *request = service->batch[i];
+
+        if (request->op == ADFGVX_SERVICE_STATS && request->status == 0)
+        {
+            request->output_length = format_stats(service, request->output, request->output_capacity);
+        }
+    }
+}
+
+/**
+ * @brief Thread dos lotes: retira da fila ate batch_size requisicoes (esperando ate
+ * batch_wait_us por mais, se configurado), processa e entrega as respostas as conexoes.
+ * (Funcao auxiliar estatica)
+ */
+static void *batcher_main(void *arg)
+{
+    adfgvx_service *service = arg;
+
+    pthread_mutex_lock(&service->lock);
+    for (;;)
+    {
+        while (service->queued == 0 && !service->closing)
+        {
+            pthread_cond_wait(&service->changed, &service->lock);
+        }
+        if (service->queued == 0)
+        {
+            break;
+        }
+
+        if (service->config.batch_wait_us > 0 && service->queued < service->config.batch_size && !service->stopping)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)(service->config.batch_wait_us % 1000000) * 1000;
+            deadline.tv_sec += (time_t)(service->config.batch_wait_us / 1000000) + deadline.tv_nsec / 1000000000;
+            deadline.tv_nsec %= 1000000000;
+            while (service->queued < service->config.batch_size && !service->stopping && !service->closing &&
+                   pthread_cond_timedwait(&service->changed, &service->lock, &deadline) != ETIMEDOUT)
+            {
+            }
+        }
+
+        size_t count = 0;
+        while (service->queue_head != NULL && count < service->config.batch_size)
+        {
+            service->batch[count++] = service->queue_head;
+            service->queue_head = service->queue_head->next;
+        }
+        if (service->queue_head == NULL)
+        {
+            service->queue_tail = NULL;
+        }
+        service->queued -= count;
+        service->busy = 1;
+        pthread_mutex_unlock(&service->lock);
+
+        process_batch(service, count);
+
+        pthread_mutex_lock(&service->lock);
+        for (size_t i = 0; i < count; i++)
+        {
+            service_request *request = service->batch[i];
+            service_connection *connection = request->connection;
+
+            request->next = NULL;
+            if (connection->replies_tail != NULL)
+            {
+                connection->replies_tail->next = request;
+            }
+            else
+            {
+                connection->replies_head = request;
+            }
+            connection->replies_tail = request;
+            pthread_cond_broadcast(&connection->changed);
+        }
+        service->busy = 0;
+        pthread_cond_broadcast(&service->changed);
+    }
+    pthread_mutex_unlock(&service->lock);
+    return NULL;
+}
+
+/**
+ * @brief Espaco reservado para a resposta de uma requisicao.
+ * (Funcao auxiliar estatica)
+ */
+static size_t output_capacity_for(int op, size_t payload_length)
+{
+    if (op == ADFGVX_SERVICE_ENCRYPT)
+    {
+        return 2 * payload_length;
+    }
+    if (op == ADFGVX_SERVICE_DECRYPT)
+    {
+        return payload_length / 2;
+    }
+    return SERVICE_STATS_CAPACITY;
+}
+
+/**
+ * @brief Le o restante de uma requisicao (chave e conteudo) e monta a estrutura. Se
+ * faltar memoria, o conteudo e descartado e a requisicao volta so com o status.
+ * (Funcao auxiliar estatica)
+ *
+ * @return service_request* A requisicao, ou NULL se a conexao fechar (ou nem o status couber).
+ */
+static service_request *read_request(service_connection *connection, const unsigned char header[], int valid)
+{
+    int op = header[1];
+    size_t key_length = valid ? get_u32(header + 8) : 0;
+    size_t payload_length = valid ? get_u32(header + 12) : 0;
+    size_t output_capacity = output_capacity_for(op, payload_length);
+    char key[MAX_KEY_LENGTH];
+    service_request *request;
+
+    if (key_length > 0 && read_exact(connection->fd, key, key_length) != 0)
+    {
+        return NULL;
+    }
+
+    request = valid ? malloc(sizeof(service_request) + payload_length + output_capacity) : NULL;
+    if (request != NULL)
+    {
+        request->input = (const char *)(request + 1);
+        request->output = (char *)(request + 1) + payload_length;
+        request->status = 0;
+        if (read_exact(connection->fd, (char *)(request + 1), payload_length) != 0)
+        {
+            free(request);
+            return NULL;
+        }
+    }
+    else
+    {
+        if (valid && discard_bytes(connection->fd, payload_length) != 0)
+        {
+            return NULL;
+        }
+        request = malloc(sizeof(service_request));
+        if (request == NULL)
+        {
+            return NULL;
+        }
+        request->input = NULL;
+        request->output = NULL;
+        request->status = valid ? ADFGVX_SERVICE_STATUS_NO_MEMORY : ADFGVX_SERVICE_STATUS_BAD_REQUEST;
+        payload_length = 0;
+        output_capacity = 0;
+    }
+    request->next = NULL;
+    request->connection = connection;
+    request->key = NULL;
+    request->op = op;
+    request->id = (unsigned int)get_u32(header + 4);
+    request->input_length = payload_length;
+    request->output_capacity = output_capacity;
+    request->output_length = 0;
+    request->received_ns = now_ns();
+
+    if (request->status == 0 && op != ADFGVX_SERVICE_STATS)
+    {
+        adfgvx_service *service = connection->service;
+        pthread_mutex_lock(&service->lock);
+        request->key = acquire_key(service, key, (int)key_length);
+        pthread_mutex_unlock(&service->lock);
+        request->status = request->key != NULL ? 0 : ADFGVX_SERVICE_STATUS_NO_MEMORY;
+    }
+    return request;
+}
+
+/**
+ * @brief Fim da leitura de uma conexao: avisa a thread de escrita (que termina depois da
+ * ultima resposta) e devolve a referencia da leitura.
+ * (Funcao auxiliar estatica; chamada com o lock)
+ */
+static void finish_reading(service_connection *connection)
+{
+    adfgvx_service *service = connection->service;
+
+    connection->reading = 0;
+    service->readers--;
+    pthread_cond_broadcast(&connection->changed);
+    pthread_cond_broadcast(&service->changed);
+    release_connection(connection);
+}
+
+/**
+ * @brief Thread de leitura de uma conexao: le as requisicoes e as coloca na fila, na ordem.
+ * Com ADFGVX_SERVICE_CONNECTION_REQUESTS requisicoes (ou ADFGVX_SERVICE_CONNECTION_BYTES
+ * bytes) sem resposta escrita, para de ler ate a thread de escrita liberar algumas. Um
+ * cabecalho invalido entra na fila so com o status (para ser respondido depois das
+ * anteriores) e encerra a leitura.
+ * (Funcao auxiliar estatica)
+ */
+static void *connection_main(void *arg)
+{
+    service_connection *connection = arg;
+    adfgvx_service *service = connection->service;
+    unsigned char header[ADFGVX_SERVICE_HEADER_SIZE];
+
+    while (read_exact(connection->fd, header, sizeof(header)) == 0)
+    {
+        int op = header[1];
+        unsigned long key_length = get_u32(header + 8);
+        int valid = header[0] == ADFGVX_SERVICE_VERSION && get_u32(header + 12) <= service->config.max_payload &&
+                    (op == ADFGVX_SERVICE_STATS ? key_length == 0
+                                                : (op == ADFGVX_SERVICE_ENCRYPT || op == ADFGVX_SERVICE_DECRYPT) &&
+                                                      key_length >= 1 && key_length < MAX_KEY_LENGTH);
+        size_t payload_length = valid ? get_u32(header + 12) : 0;
+        size_t bytes = valid ? payload_length + output_capacity_for(op, payload_length) : 0;
+
+        // Uma requisicao sozinha sempre passa, mesmo acima do limite de bytes.
+        pthread_mutex_lock(&service->lock);
+        while (connection->pending > 0 && !service->stopping &&
+               (connection->pending >= ADFGVX_SERVICE_CONNECTION_REQUESTS ||
+                connection->pending_bytes + bytes > ADFGVX_SERVICE_CONNECTION_BYTES))
+        {
+            pthread_cond_wait(&connection->changed, &service->lock);
+        }
+        pthread_mutex_unlock(&service->lock);
+
+        service_request *request = read_request(connection, header, valid);
+        if (request == NULL)
+        {
+            break;
+        }
+        pthread_mutex_lock(&service->lock);
+        connection->pending++;
+        connection->pending_bytes += request->input_length + request->output_capacity;
+        if (service->queue_tail != NULL)
+        {
+            service->queue_tail->next = request;
+        }
+        else
+        {
+            service->queue_head = request;
+        }
+        service->queue_tail = request;
+        service->queued++;
+        pthread_cond_broadcast(&service->changed);
+        pthread_mutex_unlock(&service->lock);
+        if (!valid)
+        {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&service->lock);
+    finish_reading(connection);
+    pthread_mutex_unlock(&service->lock);
+    return NULL;
+}
+
+/**
+ * @brief Thread de escrita de uma conexao: escreve as respostas na ordem e libera as
+ * requisicoes. Termina quando a leitura acabou e todas as requisicoes foram respondidas.
+ * (Funcao auxiliar estatica)
+ */
+static void *writer_main(void *arg)
+{
+    service_connection *connection = arg;
+    adfgvx_service *service = connection->service;
+
+    pthread_mutex_lock(&service->lock);
+    for (;;)
+    {
+        while (connection->replies_head == NULL && (connection->reading || connection->pending > 0))
+        {
+            pthread_cond_wait(&connection->changed, &service->lock);
+        }
+        service_request *request = connection->replies_head;
+        if (request == NULL)
+        {
+            break;
+        }
+        connection->replies_head = request->next;
+        if (connection->replies_head == NULL)
+        {
+            connection->replies_tail = NULL;
+        }
+        pthread_mutex_unlock(&service->lock);
+
+        send_response(request);
+
+        pthread_mutex_lock(&service->lock);
+        if (request->op == ADFGVX_SERVICE_ENCRYPT || request->op == ADFGVX_SERVICE_DECRYPT)
+        {
+            histogram_add(&service->latency[request->op - 1], now_ns() - request->received_ns);
+        }
+        release_key(request->key);
+        connection->pending--;
+        connection->pending_bytes -= request->input_length + request->output_capacity;
+        free(request);
+        pthread_cond_broadcast(&connection->changed);
+    }
+    service->writers--;
+    release_connection(connection);
+    pthread_cond_broadcast(&service->changed);
+    pthread_mutex_unlock(&service->lock);
+    return NULL;
+}
+
+/**
+ * @brief Cria a conexao de um cliente aceito e as suas threads de leitura e de escrita.
+ * (Funcao auxiliar estatica)
+ */
+static void start_connection(adfgvx_service *service, int fd)
+{
+    service_connection *connection = calloc(1, sizeof(service_connection));
+    pthread_attr_t attributes;
+    pthread_t thread;
+
+    if (connection == NULL || pthread_cond_init(&connection->changed, NULL) != 0)
+    {
+        free(connection);
+        close(fd);
+        return;
+    }
+    connection->fd = fd;
+    connection->refs = 2;
+    connection->reading = 1;
+    connection->service = service;
+
+    pthread_mutex_lock(&service->lock);
+    connection->next = service->connections;
+    service->connections = connection;
+    service->readers++;
+    service->writers++;
+    pthread_mutex_unlock(&service->lock);
+
+    pthread_attr_init(&attributes);
+    pthread_attr_setdetachstate(&attributes, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attributes, writer_main, connection) != 0)
+    {
+        pthread_mutex_lock(&service->lock);
+        service->writers--;
+        release_connection(connection);
+        finish_reading(connection);
+        pthread_mutex_unlock(&service->lock);
+    }
+    else if (pthread_create(&thread, &attributes, connection_main, connection) != 0)
+    {
+        pthread_mutex_lock(&service->lock);
+        finish_reading(connection);
+        pthread_mutex_unlock(&service->lock);
+    }
+    pthread_attr_destroy(&attributes);
+}
+
+/**
+ * @brief Libera o que adfgvx_service_open chegou a criar.
+ * (Funcao auxiliar estatica)
+ */
+static void free_service(adfgvx_service *service)
+{
+    if (service->listen_fd >= 0)
+    {
+        close(service->listen_fd);
+    }
+    if (service->bound)
+    {
+        unlink(service->socket_path);
+    }
+    for (int i = 0; i < ADFGVX_SERVICE_KEY_CACHE; i++)
+    {
+        if (service->keys[i] != NULL)
+        {
+            free_key(service->keys[i]);
+        }
+    }
+    if (service->sync_ready)
+    {
+        pthread_cond_destroy(&service->changed);
+        pthread_mutex_destroy(&service->lock);
+    }
+    thread_pool_destroy(service->pool);
+    free(service->batch);
+    free(service->socket_path);
+    free(service);
+}
+
+int adfgvx_service_open(adfgvx_service **service_out, const adfgvx_service_config *config)
+{
+    struct sockaddr_un address;
+    struct stat existing;
+
+    if (!service_out || !config || !config->socket_path || config->socket_path[0] == '\0' ||
+        strlen(config->socket_path) >= sizeof(address.sun_path) || config->batch_size == 0 || config->thread_count < 1)
+    {
+        return 1;
+    }
+
+    adfgvx_service *service = calloc(1, sizeof(adfgvx_service));
+    if (service == NULL)
+    {
+        return 2;
+    }
+    service->config = *config;
+    service->listen_fd = -1;
+    service->socket_path = malloc(strlen(config->socket_path) + 1);
+    service->batch = malloc(config->batch_size * sizeof(service_request *));
+    service->pool = config->thread_count > 1 ? thread_pool_create(config->thread_count) : NULL;
+    if (!service->socket_path || !service->batch || (config->thread_count > 1 && !service->pool))
+    {
+        free_service(service);
+        return 2;
+    }
+    strcpy(service->socket_path, config->socket_path);
+    service->config.socket_path = service->socket_path;
+    adfgvx_codec_init();
+
+    // Um socket que sobrou de uma execucao anterior impediria o bind; outros arquivos nao sao tocados.
+    if (stat(service->socket_path, &existing) == 0 && S_ISSOCK(existing.st_mode))
+    {
+        unlink(service->socket_path);
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, service->socket_path);
+    service->listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (service->listen_fd < 0 || bind(service->listen_fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        free_service(service);
+        return 3;
+    }
+    service->bound = 1;
+    if (listen(service->listen_fd, 64) != 0)
+    {
+        free_service(service);
+        return 3;
+    }
+
+    if (pthread_mutex_init(&service->lock, NULL) != 0)
+    {
+        free_service(service);
+        return 2;
+    }
+    if (pthread_cond_init(&service->changed, NULL) != 0)
+    {
+        pthread_mutex_destroy(&service->lock);
+        free_service(service);
+        return 2;
+    }
+    service->sync_ready = 1;
+    if (pthread_create(&service->batcher, NULL, batcher_main, service) != 0)
+    {
+        free_service(service);
+        return 2;
+    }
+    service->batcher_started = 1;
+    *service_out = service;
+    return 0;
+}
+
+int adfgvx_service_run(adfgvx_service *service, const volatile sig_atomic_t *stop)
+{
+    struct pollfd listener;
+    int status = 0;
+
+    if (!service)
+    {
+        return 1;
+    }
+    listener.fd = service->listen_fd;
+    listener.events = POLLIN;
+    for (;;)
+    {
+        pthread_mutex_lock(&service->lock);
+        int stop_requested = service->stop_requested;
+        pthread_mutex_unlock(&service->lock);
+        if (stop_requested || (stop != NULL && *stop))
+        {
+            break;
+        }
+
+        listener.revents = 0;
+        int ready = poll(&listener, 1, ADFGVX_SERVICE_POLL_MS);
+        if (ready < 0 && errno != EINTR)
+        {
+            status = 3;
+            break;
+        }
+        if (ready > 0)
+        {
+            int fd = accept(service->listen_fd, NULL, NULL);
+            if (fd >= 0)
+            {
+                start_connection(service, fd);
+            }
+        }
+    }
+
+    // Deixa de ler as conexoes (as threads de leitura recebem fim de arquivo) e espera as
+    // requisicoes ja recebidas serem processadas.
+    pthread_mutex_lock(&service->lock);
+    service->stopping = 1;
+    for (service_connection *connection = service->connections; connection != NULL; connection = connection->next)
+    {
+        shutdown(connection->fd, SHUT_RD);
+        pthread_cond_broadcast(&connection->changed);
+    }
+    pthread_cond_broadcast(&service->changed);
+    while (service->readers > 0 || service->queued > 0 || service->busy)
+    {
+        pthread_cond_wait(&service->changed, &service->lock);
+    }
+
+    // Espera ate ADFGVX_SERVICE_DRAIN_MS as respostas serem escritas. Um cliente que nao le
+    // as suas tem a conexao fechada para escrita: o envio bloqueado falha e o restante e
+    // descartado.
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_nsec += (long)(ADFGVX_SERVICE_DRAIN_MS % 1000) * 1000000;
+    deadline.tv_sec += (time_t)(ADFGVX_SERVICE_DRAIN_MS / 1000) + deadline.tv_nsec / 1000000000;
+    deadline.tv_nsec %= 1000000000;
+    while (service->writers > 0 && pthread_cond_timedwait(&service->changed, &service->lock, &deadline) != ETIMEDOUT)
+    {
+    }
+    for (service_connection *connection = service->connections; connection != NULL; connection = connection->next)
+    {
+        shutdown(connection->fd, SHUT_WR);
+    }
+    while (service->writers > 0)
+    {
+        pthread_cond_wait(&service->changed, &service->lock);
+    }
+    service->stopping = 0;
+    service->stop_requested = 0;
+    pthread_mutex_unlock(&service->lock);
+    return status;
+}
+
+void adfgvx_service_stop(adfgvx_service *service)
+{
+    if (service != NULL)
+    {
+        pthread_mutex_lock(&service->lock);
+        service->stop_requested = 1;
+        pthread_mutex_unlock(&service->lock);
+    }
+}
+
+void adfgvx_service_write_stats(adfgvx_service *service, FILE *output)
+{
+    char *text = service != NULL ? malloc(SERVICE_STATS_CAPACITY) : NULL;
+
+    if (text != NULL)
+    {
+        format_stats(service, text, SERVICE_STATS_CAPACITY);
+        fprintf(output, "%s\n", text);
+        free(text);
+    }
+}
+
+void adfgvx_service_close(adfgvx_service *service)
+{
+    if (service == NULL)
+    {
+        return;
+    }
+    if (service->batcher_started)
+    {
+        pthread_mutex_lock(&service->lock);
+        service->closing = 1;
+        pthread_cond_broadcast(&service->changed);
+        pthread_mutex_unlock(&service->lock);
+        pthread_join(service->batcher, NULL);
+    }
+    free_service(service);
+}
+
+int adfgvx_service_connect(const char *socket_path, int *fd)
+{
+    struct sockaddr_un address;
+
+    if (!socket_path || !fd || socket_path[0] == '\0' || strlen(socket_path) >= sizeof(address.sun_path))
+    {
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, socket_path);
+    *fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (*fd < 0)
+    {
+        return 3;
+    }
+    if (connect(*fd, (struct sockaddr *)&address, sizeof(address)) != 0)
+    {
+        close(*fd);
+        *fd = -1;
+        return 3;
+    }
+    return 0;
+}
+
+int adfgvx_service_send(int fd,
+                        int op,
+                        unsigned int id,
+                        const char *key,
+                        int key_length,
+                        const char *payload,
+                        size_t payload_length)
+{
+    unsigned char header[ADFGVX_SERVICE_HEADER_SIZE];
+
+    if (op < ADFGVX_SERVICE_ENCRYPT || op > ADFGVX_SERVICE_STATS || key_length < 0 || key_length >= MAX_KEY_LENGTH ||
+        (key_length > 0 && !key) || (payload_length > 0 && !payload) || payload_length > 0xFFFFFFFFul)
+    {
+        return 1;
+    }
+    encode_header(header, op, 0, id, (size_t)key_length, payload_length);
+    return send_frame(fd, header, key, (size_t)key_length, payload, payload_length) == 0 ? 0 : 3;
+}
+
+int adfgvx_service_receive(int fd, unsigned int *id, int *status, char *output, size_t output_capacity, size_t *output_length)
+{
+    unsigned char header[ADFGVX_SERVICE_HEADER_SIZE];
+
+    if (!status || !output_length || (output_capacity > 0 && !output))
+    {
+        return 1;
+    }
+    if (read_exact(fd, header, sizeof(header)) != 0)
+    {
+        return 3;
+    }
+    size_t length = get_u32(header + 12);
+    if (header[0] != ADFGVX_SERVICE_VERSION || length > output_capacity)
+    {
+        return discard_bytes(fd, length) == 0 ? 4 : 3;
+    }
+    if (read_exact(fd, output, length) != 0)
+    {
+        return 3;
+    }
+    if (id != NULL)
+    {
+        *id = (unsigned int)get_u32(header + 4);
+    }
+    *status = header[2] | header[3] << 8;
+    *output_length = length;
+    return 0;
+}
+
+int adfgvx_service_request(int fd,
+                           int op,
+                           const char *key,
+                           int key_length,
+                           const char *payload,
+                           size_t payload_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length,
+                           int *status)
+{
+    int result = adfgvx_service_send(fd, op, 0, key, key_length, payload, payload_length);
+    return result != 0 ? result : adfgvx_service_receive(fd, NULL, status, output, output_capacity, output_length);
+}
+
+void adfgvx_service_disconnect(int fd)
+{
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+}
+
+#else // _WIN32: sem sockets UNIX; as funcoes apenas informam que o servico nao existe.
+
+int adfgvx_service_open(adfgvx_service **service, const adfgvx_service_config *config)
+{
+    (void)service;
+    (void)config;
+    return 4;
+}
+
+int adfgvx_service_run(adfgvx_service *service, const volatile sig_atomic_t *stop)
+{
+    (void)service;
+    (void)stop;
+    return 3;
+}
+
+void adfgvx_service_stop(adfgvx_service *service)
+{
+    (void)service;
+}
+
+void adfgvx_service_write_stats(adfgvx_service *service, FILE *output)
+{
+    (void)service;
+    (void)output;
+}
+
+void adfgvx_service_close(adfgvx_service *service)
+{
+    (void)service;
+}
+
+int adfgvx_service_connect(const char *socket_path, int *fd)
+{
+    (void)socket_path;
+    (void)fd;
+    return 3;
+}
+
+int adfgvx_service_send(int fd, int op, unsigned int id, const char *key, int key_length, const char *payload, size_t payload_length)
+{
+    (void)fd; (void)op; (void)id; (void)key; (void)key_length; (void)payload; (void)payload_length;
+    return 3;
+}
+
+int adfgvx_service_receive(int fd, unsigned int *id, int *status, char *output, size_t output_capacity, size_t *output_length)
+{
+    (void)fd; (void)id; (void)status; (void)output; (void)output_capacity; (void)output_length;
+    return 3;
+}
+
+int adfgvx_service_request(int fd,
+                           int op,
+                           const char *key,
+                           int key_length,
+                           const char *payload,
+                           size_t payload_length,
+                           char *output,
+                           size_t output_capacity,
+                           size_t *output_length,
+                           int *status)
+{
+    (void)fd; (void)op; (void)key; (void)key_length; (void)payload; (void)payload_length;
+    (void)output; (void)output_capacity; (void)output_length; (void)status;
+    return 3;
+}
+
+void adfgvx_service_disconnect(int fd)
+{
+    (void)fd;
+}
+
+#endif // _WIN32
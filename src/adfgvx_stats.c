@@ -0,0 +1,209 @@
+#define _POSIX_C_SOURCE 200809L // Para clock_gettime e getrusage com -std=c99
+
+#include "adfgvx_stats.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/resource.h> // Para getrusage
+#endif
+
+/**
+ * @brief Contadores de um estagio.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    unsigned long long ticks;
+    unsigned long long bytes;
+    unsigned long long calls;
+    unsigned long long peak_memory; // Maior pico de memoria do processo amostrado no estagio.
+} stage_counter;
+
+static const char *stage_names[ADFGVX_STAGE_COUNT] = {"read", "key", "scan", "encode", "transpose", "decode", "write"};
+static const char *stage_labels[ADFGVX_STAGE_COUNT] = {"leitura", "agenda da chave", "contagem", "substituicao",
+                                                       "transposicao", "decodificacao", "escrita"};
+
+int adfgvx_stats_enabled = 0;
+
+static stage_counter counters[ADFGVX_STAGE_COUNT];
+static unsigned long long start_ticks, end_ticks;
+static double start_seconds, end_seconds;
+
+/**
+ * @brief Soma value a *counter e retorna o valor anterior (atomico com o GCC).
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long long counter_add(unsigned long long *counter, unsigned long long value)
+{
+#if defined(__GNUC__)
+    return __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+#else
+    unsigned long long previous = *counter;
+    *counter = previous + value;
+    return previous;
+#endif
+}
+
+/**
+ * @brief Guarda value em *counter se for maior que o valor atual.
+ * (Funcao auxiliar estatica)
+ */
+static void counter_max(unsigned long long *counter, unsigned long long value)
+{
+#if defined(__GNUC__)
+    unsigned long long current = __atomic_load_n(counter, __ATOMIC_RELAXED);
+    while (value > current &&
+           !__atomic_compare_exchange_n(counter, &current, value, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+#else
+    if (value > *counter)
+    {
+        *counter = value;
+    }
+#endif
+}
+
+/**
+ * @brief Retorna o tempo monotonic atual, em segundos.
+ * (Funcao auxiliar estatica)
+ */
+static double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+#if !(defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+unsigned long long adfgvx_stats_clock(void)
+{
+    return (unsigned long long)(now_seconds() * 1e9);
+}
+#endif
+
+/**
+ * @brief Retorna o pico de memoria residente do processo ate agora, em bytes (0 se indisponivel).
+ * (Funcao auxiliar estatica)
+ */
+static unsigned long long peak_memory_bytes(void)
+{
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+#ifdef __APPLE__
+    return (unsigned long long)usage.ru_maxrss; // Em bytes no macOS.
+#else
+    return (unsigned long long)usage.ru_maxrss * 1024; // Em KiB no Linux e nos BSDs.
+#endif
+#endif
+}
+
+void adfgvx_stats_add(adfgvx_stage stage, unsigned long long ticks, unsigned long long bytes)
+{
+    stage_counter *counter = &counters[stage];
+
+    counter_add(&counter->ticks, ticks);
+    unsigned long long previous_calls = counter_add(&counter->calls, 1);
+    unsigned long long previous_bytes = counter_add(&counter->bytes, bytes);
+
+    // Amostra o pico de memoria na primeira chamada e a cada ADFGVX_STATS_MEMORY_SAMPLE_BYTES.
+    if (previous_calls == 0 ||
+        previous_bytes / ADFGVX_STATS_MEMORY_SAMPLE_BYTES != (previous_bytes + bytes) / ADFGVX_STATS_MEMORY_SAMPLE_BYTES)
+    {
+        counter_max(&counter->peak_memory, peak_memory_bytes());
+    }
+}
+
+void adfgvx_stats_enable(void)
+{
+    for (int i = 0; i < ADFGVX_STAGE_COUNT; i++)
+    {
+        counters[i].ticks = 0;
+        counters[i].bytes = 0;
+        counters[i].calls = 0;
+        counters[i].peak_memory = 0;
+    }
+    start_seconds = now_seconds();
+    start_ticks = adfgvx_stats_ticks();
+    adfgvx_stats_enabled = 1;
+}
+
+void adfgvx_stats_disable(void)
+{
+    if (adfgvx_stats_enabled)
+    {
+        adfgvx_stats_enabled = 0;
+        end_ticks = adfgvx_stats_ticks();
+        end_seconds = now_seconds();
+    }
+}
+
+int adfgvx_stats_write(FILE *output, int json)
+{
+    // O relogio dos pontos de medicao e convertido em segundos pela duracao da medicao.
+    unsigned long long last_ticks = adfgvx_stats_enabled ? adfgvx_stats_ticks() : end_ticks;
+    double last_seconds = adfgvx_stats_enabled ? now_seconds() : end_seconds;
+    double wall = last_seconds - start_seconds;
+    double ticks_per_second = wall > 0 && last_ticks > start_ticks ? (double)(last_ticks - start_ticks) / wall : 0;
+    unsigned long long peak = peak_memory_bytes();
+
+    if (json)
+    {
+        fprintf(output, "{\n  \"stats\": \"adfgvx\",\n  \"format_version\": 1,\n");
+        fprintf(output, "  \"wall_s\": %.6f,\n  \"peak_memory_bytes\": %llu,\n  \"stages\": [\n", wall, peak);
+    }
+    else
+    {
+        fprintf(output, "Estatisticas por estagio: %.6f s no total, pico de memoria %.1f MiB\n",
+                wall, (double)peak / (1024.0 * 1024.0));
+        fprintf(output, "  %-16s %10s %12s %8s %14s %10s %12s\n",
+                "estagio", "chamadas", "tempo (s)", "% total", "bytes", "MB/s", "pico (MiB)");
+    }
+
+    for (int i = 0; i < ADFGVX_STAGE_COUNT; i++)
+    {
+        const stage_counter *counter = &counters[i];
+        double seconds = ticks_per_second > 0 ? (double)counter->ticks / ticks_per_second : 0;
+        double share = wall > 0 ? seconds / wall : 0;
+        double mb_per_s = seconds > 0 ? (double)counter->bytes / seconds * 1e-6 : 0;
+
+        if (json)
+        {
+            fprintf(output, "    {\"stage\": \"%s\", \"calls\": %llu, \"seconds\": %.6f, \"share\": %.4f, "
+                            "\"bytes\": %llu, \"mb_per_s\": %.3f, \"peak_memory_bytes\": %llu}%s\n",
+                    stage_names[i], counter->calls, seconds, share, counter->bytes, mb_per_s,
+                    counter->peak_memory, i + 1 < ADFGVX_STAGE_COUNT ? "," : "");
+        }
+        else if (counter->calls > 0)
+        {
+            fprintf(output, "  %-16s %10llu %12.6f %7.1f%% %14llu %10.1f %12.1f\n",
+                    stage_labels[i], counter->calls, seconds, 100.0 * share, counter->bytes, mb_per_s,
+                    (double)counter->peak_memory / (1024.0 * 1024.0));
+        }
+    }
+
+    if (json)
+    {
+        fprintf(output, "  ]\n}\n");
+    }
+    else
+    {
+        fprintf(output, "  (com varias threads, o tempo de um estagio e a soma das threads e pode passar do total)\n");
+    }
+    return ferror(output) ? 1 : 0;
+}
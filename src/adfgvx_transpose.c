@@ -0,0 +1,314 @@
+#define _POSIX_C_SOURCE 200809L // Para sysconf com -std=c99
+
+#include "adfgvx_transpose.h"
+#include "adfgvx_codec.h" // Para adfgvx_decode_pair
+#include "cipher_config.h" // Para ADFGVX_TRANSPOSE_STREAM_THRESHOLD
+#include <pthread.h>       // Para pthread_once
+
+#ifndef _WIN32
+#include <unistd.h> // Para sysconf
+#endif
+
+// Gravacao nao temporal (SSE2) so em x86 com GCC/Clang, como os kernels do codec.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADFGVX_TRANSPOSE_X86_STREAM 1
+#include <immintrin.h>
+#include <stdint.h> // Para uintptr_t
+#else
+#define ADFGVX_TRANSPOSE_X86_STREAM 0
+#endif
+
+// Desenrola por completo o laco seguinte (de ADFGVX_TRANSPOSE_MAX_SPECIALIZED iteracoes ou
+// menos). Com K constante, cada indice c % K e c / K vira uma constante do codigo gerado.
+#if defined(__GNUC__) && (__GNUC__ >= 8 || defined(__clang__))
+#define ADFGVX_TRANSPOSE_UNROLL _Pragma("GCC unroll 16")
+#else
+#define ADFGVX_TRANSPOSE_UNROLL
+#endif
+
+static int specialized_enabled = 1;
+static int tiled_enabled = 1;
+
+// Limite da gravacao nao temporal, calculado uma unica vez (pthread_once): as threads dos
+// caminhos paralelos chegam a adfgvx_transpose_stream_threshold ao mesmo tempo.
+static pthread_once_t stream_threshold_once = PTHREAD_ONCE_INIT;
+static size_t stream_threshold = ADFGVX_TRANSPOSE_STREAM_THRESHOLD;
+
+/**
+ * @brief Gera scatter_rows_K: espalha linhas completas de K simbolos.
+ * Os inicios das colunas ficam num vetor local (em registradores) e cada linha grava na
+ * mesma deslocacao row de todas as colunas, sem cursor de coluna nem desvio por simbolo.
+ */
+#define ADFGVX_DEFINE_SCATTER_ROWS(K)                                                              \
+    static void scatter_rows_##K(size_t next_position[], const char *symbols, size_t row_count,   \
+                                 char *output)                                                     \
+    {                                                                                              \
+        size_t base[K];                                                                            \
+        ADFGVX_TRANSPOSE_UNROLL                                                                    \
+        for (int c = 0; c < K; c++)                                                                \
+        {                                                                                          \
+            base[c] = next_position[c];                                                            \
+        }                                                                                          \
+        for (size_t row = 0; row < row_count; row++, symbols += K)                                 \
+        {                                                                                          \
+            ADFGVX_TRANSPOSE_UNROLL                                                                \
+            for (int c = 0; c < K; c++)                                                            \
+            {                                                                                      \
+                output[base[c] + row] = symbols[c];                                                \
+            }                                                                                      \
+        }                                                                                          \
+        ADFGVX_TRANSPOSE_UNROLL                                                                    \
+        for (int c = 0; c < K; c++)                                                                \
+        {                                                                                          \
+            next_position[c] = base[c] + row_count;                                                \
+        }                                                                                          \
+    }
+
+/**
+ * @brief Gera gather_rows_K: coleta e decodifica blocos de K pares (duas linhas de K simbolos).
+ * Como 2 * K simbolos sempre fecham duas linhas, o simbolo s do bloco esta na coluna s % K e
+ * na linha row + s / K, ambas constantes depois do desenrolamento, para K par ou impar.
+ */
+#define ADFGVX_DEFINE_GATHER_ROWS(K)                                                               \
+    static size_t gather_rows_##K(size_t next_position[], const char *encrypted_text,             \
+                                  size_t block_count, char *output)                                \
+    {                                                                                              \
+        size_t base[K];                                                                            \
+        size_t written = 0;                                                                        \
+        ADFGVX_TRANSPOSE_UNROLL                                                                    \
+        for (int c = 0; c < K; c++)                                                                \
+        {                                                                                          \
+            base[c] = next_position[c];                                                            \
+        }                                                                                          \
+        for (size_t row = 0; row < 2 * block_count; row += 2)                                      \
+        {                                                                                          \
+            ADFGVX_TRANSPOSE_UNROLL                                                                \
+            for (int s = 0; s < 2 * K; s += 2)                                                     \
+            {                                                                                      \
+                char row_symbol = encrypted_text[base[s % K] + row + s / K];                       \
+                char col_symbol = encrypted_text[base[(s + 1) % K] + row + (s + 1) / K];           \
+                int decoded = adfgvx_decode_pair(row_symbol, col_symbol);                          \
+                if (decoded < 0)                                                                   \
+                {                                                                                  \
+                    return written;                                                                \
+                }                                                                                  \
+                output[written++] = (char)decoded;                                                 \
+            }                                                                                      \
+        }                                                                                          \
+        ADFGVX_TRANSPOSE_UNROLL                                                                    \
+        for (int c = 0; c < K; c++)                                                                \
+        {                                                                                          \
+            next_position[c] = base[c] + 2 * block_count;                                          \
+        }                                                                                          \
+        return written;                                                                            \
+    }
+
+#define ADFGVX_DEFINE_TRANSPOSE_KERNELS(K) \
+    ADFGVX_DEFINE_SCATTER_ROWS(K)          \
+    ADFGVX_DEFINE_GATHER_ROWS(K)
+
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(1)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(2)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(3)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(4)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(5)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(6)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(7)
+ADFGVX_DEFINE_TRANSPOSE_KERNELS(8)
+
+// Tabela de despacho, indexada pelo comprimento da chave (a posicao 0 nao e usada).
+static const adfgvx_transpose_kernels kernel_table[ADFGVX_TRANSPOSE_MAX_SPECIALIZED + 1] = {
+    {0, NULL, NULL},
+    {1, scatter_rows_1, gather_rows_1},
+    {2, scatter_rows_2, gather_rows_2},
+    {3, scatter_rows_3, gather_rows_3},
+    {4, scatter_rows_4, gather_rows_4},
+    {5, scatter_rows_5, gather_rows_5},
+    {6, scatter_rows_6, gather_rows_6},
+    {7, scatter_rows_7, gather_rows_7},
+    {8, scatter_rows_8, gather_rows_8},
+};
+
+const adfgvx_transpose_kernels *adfgvx_transpose_kernels_for(int key_length)
+{
+    if (!specialized_enabled || key_length < 1 || key_length > ADFGVX_TRANSPOSE_MAX_SPECIALIZED)
+    {
+        return NULL;
+    }
+    return &kernel_table[key_length];
+}
+
+void adfgvx_transpose_select_specialized(int enabled)
+{
+    specialized_enabled = enabled != 0;
+}
+
+int adfgvx_transpose_specialized_enabled(void)
+{
+    return specialized_enabled;
+}
+
+/**
+ * @brief Grava as linhas first_row .. first_row + row_count - 1 de cada coluna de um
+ * ladrilho com gravacao comum.
+ * (Funcao auxiliar estatica)
+ */
+static void scatter_tile_columns(int key_length, const size_t next_position[], const char *symbols,
+                                 size_t row_count, char *output)
+{
+    for (int c = 0; c < key_length; c++)
+    {
+        char *column = output + next_position[c];
+        const char *source = symbols + c;
+        for (size_t r = 0; r < row_count; r++)
+        {
+            column[r] = source[r * (size_t)key_length];
+        }
+    }
+}
+
+#if ADFGVX_TRANSPOSE_X86_STREAM
+/**
+ * @brief Como scatter_tile_columns, mas cada linha de cache inteira (64 bytes alinhados)
+ * de uma coluna e montada num buffer local e gravada com _mm_stream_si128, sem ler a linha
+ * do destino para a cache; as pontas da coluna, que dividem a linha com a coluna vizinha,
+ * vao com gravacao comum.
+ * (Funcao auxiliar estatica)
+ */
+__attribute__((target("sse2")))
+static void stream_tile_columns(int key_length, const size_t next_position[], const char *symbols,
+                                size_t row_count, char *output)
+{
+    size_t k = (size_t)key_length;
+    union
+    {
+        __m128i lanes[4];
+        char bytes[64];
+    } line;
+
+    for (int c = 0; c < key_length; c++)
+    {
+        char *column = output + next_position[c];
+        const char *source = symbols + c;
+        size_t r = 0;
+
+        for (; r < row_count && ((uintptr_t)(column + r) & 63) != 0; r++)
+        {
+            column[r] = source[r * k];
+        }
+        for (; r + 64 <= row_count; r += 64)
+        {
+            const char *row = source + r * k;
+            for (int i = 0; i < 64; i++)
+            {
+                line.bytes[i] = row[(size_t)i * k];
+            }
+            __m128i *target = (__m128i *)(void *)(column + r);
+            _mm_stream_si128(target, line.lanes[0]);
+            _mm_stream_si128(target + 1, line.lanes[1]);
+            _mm_stream_si128(target + 2, line.lanes[2]);
+            _mm_stream_si128(target + 3, line.lanes[3]);
+        }
+        for (; r < row_count; r++)
+        {
+            column[r] = source[r * k];
+        }
+    }
+}
+#endif
+
+void adfgvx_transpose_scatter_tiles(int key_length,
+                                    size_t next_position[],
+                                    const char *symbols,
+                                    size_t row_count,
+                                    char *output,
+                                    int streaming)
+{
+#if !ADFGVX_TRANSPOSE_X86_STREAM
+    (void)streaming;
+#endif
+    size_t tile_rows = streaming ? ADFGVX_TILE_STREAM_ROWS : ADFGVX_TILE_ROWS;
+    size_t tile_symbols = tile_rows * (size_t)key_length;
+
+    for (size_t row = 0; row < row_count; row += tile_rows, symbols += tile_symbols)
+    {
+        size_t rows = row_count - row < tile_rows ? row_count - row : tile_rows;
+#if ADFGVX_TRANSPOSE_X86_STREAM
+        if (streaming)
+        {
+            stream_tile_columns(key_length, next_position, symbols, rows, output);
+        }
+        else
+#endif
+        {
+            scatter_tile_columns(key_length, next_position, symbols, rows, output);
+        }
+        for (int c = 0; c < key_length; c++)
+        {
+            next_position[c] += rows;
+        }
+    }
+#if ADFGVX_TRANSPOSE_X86_STREAM
+    // As gravacoes nao temporais ficam visiveis (e ordenadas) antes do retorno.
+    if (streaming)
+    {
+        _mm_sfence();
+    }
+#endif
+}
+
+void adfgvx_transpose_gather_tile(int key_length,
+                                  size_t next_position[],
+                                  const char *encrypted_text,
+                                  size_t row_count,
+                                  size_t tile_pitch,
+                                  char *tile)
+{
+    for (int c = 0; c < key_length; c++)
+    {
+        const char *column = encrypted_text + next_position[c];
+        char *target = tile + c;
+        for (size_t r = 0; r < row_count; r++)
+        {
+            target[r * tile_pitch] = column[r];
+        }
+        next_position[c] += row_count;
+    }
+}
+
+size_t adfgvx_transpose_tile_pitch(int key_length)
+{
+    size_t lines = ((size_t)key_length + 63) / 64;
+    return (lines | 1) * 64;
+}
+
+/**
+ * @brief Le o tamanho da cache de ultimo nivel, se o sistema o informar.
+ * (Funcao auxiliar estatica, chamada uma unica vez por pthread_once)
+ */
+static void init_stream_threshold(void)
+{
+#if !defined(_WIN32) && defined(_SC_LEVEL3_CACHE_SIZE)
+    long cache = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if (cache > 0)
+    {
+        stream_threshold = (size_t)cache;
+    }
+#endif
+}
+
+size_t adfgvx_transpose_stream_threshold(void)
+{
+    pthread_once(&stream_threshold_once, init_stream_threshold);
+    return stream_threshold;
+}
+
+void adfgvx_transpose_select_tiled(int enabled)
+{
+    tiled_enabled = enabled != 0;
+}
+
+int adfgvx_transpose_tiled_enabled(void)
+{
+    return tiled_enabled;
+}
@@ -0,0 +1,108 @@
+#include "adfgvx_workspace.h"
+#include <stdint.h> // Para uintptr_t
+#include <stdlib.h> // Para malloc e free
+
+int adfgvx_workspace_init(adfgvx_workspace *ws, void *buffer, size_t size)
+{
+    if (!ws)
+    {
+        return 1;
+    }
+    ws->base = buffer;
+    ws->capacity = size;
+    ws->used = 0;
+    ws->peak = 0;
+    ws->fixed = buffer != NULL;
+    if (buffer == NULL && size > 0)
+    {
+        ws->base = malloc(size);
+        if (ws->base == NULL)
+        {
+            ws->capacity = 0;
+            return 2;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Bytes de preenchimento ate o proximo endereco alinhado (o buffer do modo fixo
+ * pode nao ser alinhado).
+ * (Funcao auxiliar estatica)
+ */
+static size_t align_padding(const unsigned char *address)
+{
+    return (size_t)(-(uintptr_t)address) & (ADFGVX_WORKSPACE_ALIGN - 1);
+}
+
+int adfgvx_workspace_reserve(adfgvx_workspace *ws, size_t size)
+{
+    if (size <= ws->capacity - ws->used)
+    {
+        return 0;
+    }
+    if (ws->fixed || ws->used > 0)
+    {
+        return 1;
+    }
+
+    // Arena do heap vazia: troca por uma que caiba (nenhum bloco entregue se move).
+    unsigned char *grown = malloc(size);
+    if (grown == NULL)
+    {
+        return 2;
+    }
+    free(ws->base);
+    ws->base = grown;
+    ws->capacity = size;
+    return 0;
+}
+
+void *adfgvx_workspace_alloc(adfgvx_workspace *ws, size_t size)
+{
+    if (ws->base == NULL)
+    {
+        return NULL;
+    }
+
+    size_t padding = align_padding(ws->base + ws->used);
+    if (padding + size > ws->capacity - ws->used)
+    {
+        return NULL;
+    }
+
+    void *block = ws->base + ws->used + padding;
+    ws->used += padding + size;
+    if (ws->used > ws->peak)
+    {
+        ws->peak = ws->used;
+    }
+    return block;
+}
+
+size_t adfgvx_workspace_mark(const adfgvx_workspace *ws)
+{
+    return ws->used;
+}
+
+void adfgvx_workspace_release(adfgvx_workspace *ws, size_t mark)
+{
+    if (mark < ws->used)
+    {
+        ws->used = mark;
+    }
+}
+
+void adfgvx_workspace_free(adfgvx_workspace *ws)
+{
+    if (ws != NULL)
+    {
+        if (!ws->fixed)
+        {
+            free(ws->base);
+            ws->base = NULL;
+            ws->capacity = 0;
+        }
+        ws->used = 0;
+    }
+}
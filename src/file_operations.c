@@ -1,9 +1,28 @@
+#define _POSIX_C_SOURCE 200809L // Para ftruncate, fstat, pread e mmap com -std=c99
+#define _FILE_OFFSET_BITS 64    // off_t de 64 bits tambem nas plataformas de 32 bits
+
 #include "file_operations.h"
+#include "adfgvx_stats.h"
+#include <stdint.h> // Para SIZE_MAX
 #include <stdio.h>
+#include <stdlib.h> // Para malloc e free
 #include <string.h> // Para strcspn
 
+#if FILE_OPERATIONS_HAVE_MMAP
+#include <fcntl.h>    // Para open
+#include <sys/mman.h> // Para mmap, munmap e posix_madvise
+#endif
+#ifdef _WIN32
+#include <fcntl.h>    // Para _O_BINARY
+#include <io.h>       // Para _filelengthi64, _fileno, _read e _setmode
+#else
+#include <sys/stat.h> // Para fstat
+#include <unistd.h>   // Para close, ftruncate, pread e read
+#endif
+
 int read_file(const char *filename, char *buffer, int max_length)
 {
+    ADFGVX_STATS_BEGIN(stage_start);
     FILE *file_ptr = fopen(filename, "r");
     if (file_ptr == NULL)
     {
@@ -19,14 +38,145 @@ int read_file(const char *filename, char *buffer, int max_length)
     buffer[strcspn(buffer, "\r\n")] = '\0';
 
     fclose(file_ptr);
+    ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, strlen(buffer));
+    return 0;
+}
+
+int read_file_in_chunks(const char *filename,
+                        size_t chunk_size,
+                        chunk_consumer consumer,
+                        void *user,
+                        unsigned long long *total_read)
+{
+    FILE *file_ptr = fopen(filename, "rb");
+    if (file_ptr == NULL)
+    {
+        return 1;
+    }
+
+    char *chunk = malloc(chunk_size);
+    if (chunk == NULL)
+    {
+        fclose(file_ptr);
+        return 2;
+    }
+
+    int status = 0;
+    unsigned long long total = 0;
+    size_t n;
+    ADFGVX_STATS_BEGIN(stage_start);
+    while ((n = fread(chunk, 1, chunk_size, file_ptr)) > 0)
+    {
+        // So a leitura conta como estagio de leitura; o consumidor mede os seus estagios.
+        ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, n);
+        total += n;
+        if (consumer(user, chunk, n) != 0)
+        {
+            status = 3;
+            break;
+        }
+        ADFGVX_STATS_RESTART(stage_start);
+    }
+    if (status == 0 && ferror(file_ptr))
+    {
+        status = 2;
+    }
+
+    if (total_read != NULL)
+    {
+        *total_read = total;
+    }
+
+    free(chunk);
+    fclose(file_ptr);
+    return status;
+}
+
+int read_whole_file(const char *filename, char **buffer, size_t *length)
+{
+    ADFGVX_STATS_BEGIN(stage_start);
+    FILE *file_ptr = fopen(filename, "rb");
+    if (file_ptr == NULL)
+    {
+        return 1;
+    }
+
+    // O tamanho atual do arquivo e so uma estimativa inicial: o buffer cresce se preciso.
+    size_t capacity = ADFGVX_IO_CHUNK_SIZE;
+    if (fseek(file_ptr, 0, SEEK_END) == 0)
+    {
+        long size = ftell(file_ptr);
+        if (size > 0)
+        {
+            capacity = (size_t)size + 1;
+        }
+        rewind(file_ptr);
+    }
+
+    char *data = malloc(capacity);
+    size_t used = 0;
+    size_t n;
+    while (data != NULL && (n = fread(data + used, 1, capacity - used, file_ptr)) > 0)
+    {
+        used += n;
+        if (used == capacity)
+        {
+            char *grown = realloc(data, capacity * 2);
+            if (grown == NULL)
+            {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+
+    int status = (data == NULL || ferror(file_ptr)) ? 2 : 0;
+    fclose(file_ptr);
+    if (status != 0)
+    {
+        free(data);
+        return status;
+    }
+
+    *buffer = data;
+    *length = used;
+    ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, used);
     return 0;
 }
 
+int write_buffer_to_file(const char *filename, const char *data, size_t length)
+{
+    ADFGVX_STATS_BEGIN(stage_start);
+    FILE *file_ptr = fopen(filename, "wb");
+    if (file_ptr == NULL)
+    {
+        return 1;
+    }
+
+    int status = 0;
+    if ((length > 0 && fwrite(data, 1, length, file_ptr) != length) || fflush(file_ptr) != 0)
+    {
+        status = 2;
+    }
+    if (fclose(file_ptr) != 0)
+    {
+        status = 2;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, length);
+    return status;
+}
+
 int write_encrypted_data_to_file(const char *filename,
                                  int key_length,
                                  char encoded_symbol_matrix[][MAX_MESSAGE_LENGTH],
-                                 int symbols_per_column[])
+                                 int symbols_per_column[],
+                                 int column_order[])
 {
+    ADFGVX_STATS_BEGIN(stage_start);
+    unsigned long long written = 0;
     FILE *output_file_ptr = fopen(filename, "w");
     if (output_file_ptr == NULL)
     {
@@ -36,23 +186,31 @@ int write_encrypted_data_to_file(const char *filename,
 
     for (int i = 0; i < key_length; i++)
     {
-        for (int j = 0; j < symbols_per_column[i]; j++)
+        int col = column_order[i]; // Colunas lidas na ordem alfabetica da chave
+        size_t count = (size_t)symbols_per_column[col];
+
+        // Cada coluna e contigua na matriz: uma unica escrita por coluna.
+        if (fwrite(encoded_symbol_matrix[col], 1, count, output_file_ptr) != count)
         {
-            if (fputc(encoded_symbol_matrix[i][j], output_file_ptr) == EOF)
-            {
-                perror("Erro ao escrever no arquivo de saida cifrada");
-                fclose(output_file_ptr);
-                return 1;
-            }
+            perror("Erro ao escrever no arquivo de saida cifrada");
+            fclose(output_file_ptr);
+            return 1;
         }
+        written += count;
     }
 
-    fclose(output_file_ptr);
+    if (fclose(output_file_ptr) != 0)
+    {
+        perror("Erro ao escrever no arquivo de saida cifrada");
+        return 1;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, written);
     return 0;
 }
 
 int write_plaintext_to_file(const char *filename, const char *plaintext_message)
 {
+    ADFGVX_STATS_BEGIN(stage_start);
     FILE *output_file_ptr = fopen(filename, "w");
     if (output_file_ptr == NULL)
     {
@@ -68,5 +226,255 @@ int write_plaintext_to_file(const char *filename, const char *plaintext_message)
     }
 
     fclose(output_file_ptr);
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, strlen(plaintext_message));
     return 0; // Sucesso
 }
+
+int map_input_file(const char *filename, mapped_file *file)
+{
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+
+#if FILE_OPERATIONS_HAVE_MMAP
+    // Com mmap, so a abertura e o mapeamento contam como leitura (sem bytes): as paginas
+    // sao lidas quando a mensagem e percorrida, e o custo aparece no estagio que a percorre
+    // primeiro.
+    ADFGVX_STATS_BEGIN(stage_start);
+    struct stat info;
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+    {
+        return 1;
+    }
+
+    // Arquivos maiores que o espaco de enderecos (so em 32 bits) nao podem ser mapeados.
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && (unsigned long long)info.st_size <= SIZE_MAX)
+    {
+        if (info.st_size == 0)
+        {
+            close(fd);
+            return 0; // Arquivo vazio: nada a mapear.
+        }
+
+        void *data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            // A entrada e percorrida do inicio ao fim: leitura antecipada agressiva.
+            posix_madvise(data, (size_t)info.st_size, POSIX_MADV_SEQUENTIAL);
+            file->data = data;
+            file->length = (size_t)info.st_size;
+            file->mapped = 1;
+            file->fd = fd;
+            ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, 0);
+            return 0;
+        }
+    }
+    close(fd);
+#endif
+
+    // Sem mmap (ou arquivo nao mapeavel): le tudo para um buffer.
+    return read_whole_file(filename, &file->data, &file->length);
+}
+
+int map_output_file(const char *filename, size_t length, mapped_file *file)
+{
+    ADFGVX_STATS_BEGIN(stage_start);
+    memset(file, 0, sizeof(*file));
+    file->fd = -1;
+    file->writable = 1;
+    file->length = length;
+
+#if FILE_OPERATIONS_HAVE_MMAP
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    if (length == 0)
+    {
+        file->fd = fd;
+        return 0;
+    }
+    if (ftruncate(fd, (off_t)length) != 0)
+    {
+        close(fd);
+        return 2;
+    }
+
+    void *data = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        close(fd);
+        return 2;
+    }
+    file->data = data;
+    file->mapped = 1;
+    file->fd = fd;
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, 0);
+    return 0;
+#else
+    file->stream = fopen(filename, "wb");
+    if (file->stream == NULL)
+    {
+        return 1;
+    }
+    file->data = malloc(length > 0 ? length : 1);
+    if (file->data == NULL)
+    {
+        fclose(file->stream);
+        file->stream = NULL;
+        return 2;
+    }
+    ADFGVX_STATS_END(ADFGVX_STAGE_WRITE, stage_start, 0);
+    return 0;
+#endif
+}
+
+int close_mapped_file(mapped_file *file, size_t final_length)
+{
+    int status = 0;
+    ADFGVX_STATS_BEGIN(stage_start);
+
+    if (final_length > file->length)
+    {
+        final_length = file->length;
+    }
+
+#if FILE_OPERATIONS_HAVE_MMAP
+    if (file->mapped)
+    {
+        if (munmap(file->data, file->length) != 0)
+        {
+            status = 2;
+        }
+        file->data = NULL;
+    }
+    if (file->fd >= 0)
+    {
+        // A saida foi dimensionada pelo maximo; o arquivo fica com o que foi produzido.
+        if (file->writable && ftruncate(file->fd, (off_t)final_length) != 0)
+        {
+            status = 2;
+        }
+        if (close(file->fd) != 0)
+        {
+            status = 2;
+        }
+        file->fd = -1;
+    }
+#endif
+
+    if (file->stream != NULL)
+    {
+        // Alternativa sem mmap: grava o buffer em blocos grandes.
+        for (size_t written = 0; written < final_length && status == 0; written += ADFGVX_IO_CHUNK_SIZE)
+        {
+            size_t n = final_length - written < ADFGVX_IO_CHUNK_SIZE ? final_length - written : ADFGVX_IO_CHUNK_SIZE;
+            if (fwrite(file->data + written, 1, n, file->stream) != n)
+            {
+                status = 2;
+            }
+        }
+        if (fclose(file->stream) != 0)
+        {
+            status = 2;
+        }
+        file->stream = NULL;
+    }
+
+    if (!file->mapped)
+    {
+        free(file->data);
+    }
+    file->data = NULL;
+    file->length = 0;
+    // Fechar a entrada (munmap) conta como leitura; gravar a saida, como escrita.
+    ADFGVX_STATS_END(file->writable ? ADFGVX_STAGE_WRITE : ADFGVX_STAGE_READ, stage_start,
+                     file->writable ? final_length : 0);
+    return status;
+}
+
+int get_file_size(FILE *stream, size_t *size)
+{
+#ifdef _WIN32
+    long long length = _filelengthi64(_fileno(stream));
+    if (length < 0)
+    {
+        return 2;
+    }
+    *size = (size_t)length;
+#else
+    struct stat info;
+    if (fstat(fileno(stream), &info) != 0 || (unsigned long long)info.st_size > SIZE_MAX)
+    {
+        return 2;
+    }
+    *size = (size_t)info.st_size;
+#endif
+    return 0;
+}
+
+int read_file_at(FILE *stream, size_t offset, char *buffer, size_t length)
+{
+    ADFGVX_STATS_BEGIN(stage_start);
+#ifdef _WIN32
+    if (_fseeki64(stream, (long long)offset, SEEK_SET) != 0 || fread(buffer, 1, length, stream) != length)
+    {
+        return 2;
+    }
+#else
+    int fd = fileno(stream);
+    size_t done = 0;
+
+    // pread pode ler menos que o pedido; repete ate completar ou chegar ao fim do arquivo.
+    while (done < length)
+    {
+        ssize_t n = pread(fd, buffer + done, length - done, (off_t)(offset + done));
+        if (n <= 0)
+        {
+            return 2;
+        }
+        done += (size_t)n;
+    }
+#endif
+    ADFGVX_STATS_END(ADFGVX_STAGE_READ, stage_start, length);
+    return 0;
+}
+
+int read_line_from_fd(int fd, char *buffer, int max_length)
+{
+    int length = 0;
+
+    // Um byte por vez, para nao consumir nada depois da linha (a chave e curta).
+    while (length < max_length - 1)
+    {
+        char c;
+#ifdef _WIN32
+        int got = _read(fd, &c, 1);
+#else
+        ssize_t got = read(fd, &c, 1);
+#endif
+        if (got < 0)
+        {
+            return 1;
+        }
+        if (got == 0 || c == '\n')
+        {
+            break;
+        }
+        buffer[length++] = c;
+    }
+    buffer[length] = '\0';
+    buffer[strcspn(buffer, "\r\n")] = '\0';
+    return buffer[0] == '\0' ? 2 : 0;
+}
+
+int set_binary_mode(FILE *stream)
+{
+#ifdef _WIN32
+    return _setmode(_fileno(stream), _O_BINARY) == -1 ? 1 : 0;
+#else
+    (void)stream;
+    return 0;
+#endif
+}
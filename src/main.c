@@ -1,86 +1,878 @@
-#include <stdio.h>
-#include <string.h> // Para strlen
-#include <stdlib.h> // Para EXIT_FAILURE, EXIT_SUCCESS (ou pode usar 0 e 1 diretamente)
-
-// Inclui os novos arquivos de cabealho dos mdulos
-#include "cipher_config.h"
-#include "file_operations.h"
-#include "adfgvx_core.h"
-
-/**
- * @brief Funcao principal do programa de cifragem ADFGVX.
- * (Mantendo a documentacao original da funcao main)
- */
-int main()
-{
-    // Variaveis para armazenar a chave e a mensagem lidas dos arquivos.
-    char cipher_key_buffer[MAX_KEY_LENGTH]; // Renomeado de cipher_key
-    char message_buffer[MAX_MESSAGE_LENGTH]; // Renomeado de message
-
-    // Contador de simbolos ADFGVX por coluna.
-    // Inicializado com zeros. O tamanho MAX_KEY_LENGTH  usado aqui pois
-    // o comprimento real da chave (actual_key_length) ainda nao  conhecido.
-    // Apenas as posicoes ate actual_key_length-1 serao usadas.
-    int symbols_per_column_count[MAX_KEY_LENGTH] = {0}; // Renomeado de symbols_per_column
-
-    int actual_key_length = 0; // Renomeado de KEY_LENGTH para clareza e evitar conflito com macros
-    int file_read_status;      // Renomeado de is_file_read
-
-    // Le a chave de cifra do arquivo
-    printf("Lendo chave de '%s'...\n", DEFAULT_KEY_FILE);
-    file_read_status = read_file(DEFAULT_KEY_FILE, cipher_key_buffer, MAX_KEY_LENGTH);
-    if (file_read_status != 0)
-    {
-        fprintf(stderr, "Erro lendo arquivo da chave '%s'. Codigo: %d\n", DEFAULT_KEY_FILE, file_read_status);
-        return EXIT_FAILURE; // Ou return 1;
-    }
-
-    // Define o tamanho real da chave com base no conteudo lido.
-    // A funcao read_file agora remove o '\n', entao strlen deve dar o comprimento correto.
-    actual_key_length = strlen(cipher_key_buffer);
-
-    // Validacao basica do comprimento da chave
-    if (actual_key_length == 0 || actual_key_length >= MAX_KEY_LENGTH) {
-        fprintf(stderr, "Erro: Comprimento da chave invalido (%d). Deve ser entre 1 e %d caracteres.\n",
-                actual_key_length, MAX_KEY_LENGTH - 1);
-        return EXIT_FAILURE;
-    }
-    printf("Chave lida: \"%s\" (Comprimento: %d)\n", cipher_key_buffer, actual_key_length);
-
-
-    // Matriz para armazenar os simbolos ADFGVX organizados por coluna.
-    // Usa VLA (Variable Length Array), uma funcionalidade do C99.
-    // A primeira dimensao  o comprimento real da chave.
-    // A segunda dimensao  MAX_MESSAGE_LENGTH, conforme esperado pelas funcoes do modulo de cifra.
-    char intermediate_encoded_matrix[actual_key_length][MAX_MESSAGE_LENGTH]; // Renomeado de encoded_symbol_matrix
-
-    // Ler a mensagem do arquivo
-    printf("Lendo mensagem de '%s'...\n", DEFAULT_MESSAGE_FILE);
-    file_read_status = read_file(DEFAULT_MESSAGE_FILE, message_buffer, MAX_MESSAGE_LENGTH);
-    if (file_read_status != 0)
-    {
-        fprintf(stderr, "Erro lendo arquivo da mensagem '%s'. Codigo: %d\n", DEFAULT_MESSAGE_FILE, file_read_status);
-        return EXIT_FAILURE;
-    }
-    // Para mensagens longas, imprimir apenas uma parte pode ser util
-    printf("Mensagem lida (primeiros 50 chars, se houver): \"%.50s%s\"\n",
-           message_buffer, strlen(message_buffer) > 50 ? "..." : "");
-
-
-    // Realizar a cifra ADFGVX
-    // symbols_per_column_count ja esta inicializado com zeros.
-    printf("Cifrando a mensagem...\n");
-    cipher_adfgvx(cipher_key_buffer, actual_key_length, message_buffer, intermediate_encoded_matrix, symbols_per_column_count);
-
-    // Salvar a mensagem cifrada em 'encrypted.txt' usando a nova funcao dedicada
-    printf("Salvando mensagem cifrada em '%s'...\n", DEFAULT_ENCRYPTED_FILE);
-    if (write_encrypted_data_to_file(DEFAULT_ENCRYPTED_FILE, actual_key_length, intermediate_encoded_matrix, symbols_per_column_count) != 0)
-    {
-        // A funcao write_encrypted_data_to_file ja imprime um erro com perror.
-        fprintf(stderr, "Falha ao salvar a mensagem cifrada.\n");
-        return EXIT_FAILURE;
-    }
-
-    printf("Processo de cifragem concluido com sucesso!\n");
-    return EXIT_SUCCESS; // Ou return 0;
-}
+#include <stdio.h>
+#include <string.h> // Para strlen
+#include <stdlib.h> // Para EXIT_FAILURE, EXIT_SUCCESS (ou pode usar 0 e 1 diretamente)
+#include <signal.h> // Para encerrar o servico (--serve) com SIGINT / SIGTERM
+
+// Inclui os novos arquivos de cabeçalho dos módulos
+#include "cipher_config.h"
+#include "file_operations.h"
+#include "adfgvx_core.h"
+#include "adfgvx_records.h"
+#include "adfgvx_container.h"
+#include "adfgvx_packed.h"
+#include "adfgvx_pipeline.h"
+#include "adfgvx_service.h"
+#include "adfgvx_stats.h"
+#include "thread_pool.h"
+
+/**
+ * @brief Opcoes da linha de comando.
+ */
+typedef struct
+{
+    int thread_count;
+    size_t parallel_threshold;
+    int line_mode;
+    int container_mode;
+    int packed_mode;        // --packed: texto cifrado no formato compacto (3 bits por simbolo).
+    int filter_mode;        // 'e' (-e) ou 'd' (-d) no modo filtro; 0 fora dele.
+    const char *key_text;   // --key: chave na linha de comando.
+    int key_fd;             // --key-fd: descritor de onde ler a chave (-1 se nao usado).
+    size_t block_size;      // --block-size: bytes por bloco do pipeline do modo filtro.
+    size_t queue_depth;     // --queue-depth: blocos em transito no pipeline.
+    const char *serve_path; // --serve: caminho do socket do servico (NULL fora dele).
+    size_t batch_size;      // --batch-size: requisicoes por lote do servico.
+    unsigned int batch_wait_us; // --batch-wait-us: espera por mais requisicoes num lote.
+    int stats;                  // --stats / --stats-json: mede os estagios e grava o resultado ao sair.
+    const char *stats_json_path; // --stats-json: arquivo JSON das medicoes ("-" para a saida padrao).
+    const char *round_keys[ADFGVX_MAX_ROUNDS - 1]; // --round-key: chaves das rodadas seguintes a primeira.
+    int round_key_count;
+} cipher_tool_options;
+
+// Destino das medicoes (--stats-json), usado por write_stats ao sair; NULL grava texto em stderr.
+static const char *stats_json_path = NULL;
+
+/**
+ * @brief Grava as medicoes por estagio (--stats), ao fim do programa: em texto na saida de
+ * erros (que nao se mistura ao texto cifrado do modo filtro) ou em JSON (--stats-json).
+ * (Funcao auxiliar estatica, registrada com atexit)
+ */
+static void write_stats(void)
+{
+    adfgvx_stats_disable();
+    if (stats_json_path == NULL)
+    {
+        adfgvx_stats_write(stderr, 0);
+        return;
+    }
+    FILE *json = strcmp(stats_json_path, "-") == 0 ? stdout : fopen(stats_json_path, "w");
+    if (json == NULL)
+    {
+        fprintf(stderr, "Erro ao abrir '%s' para as estatisticas.\n", stats_json_path);
+        return;
+    }
+    adfgvx_stats_write(json, 1);
+    if (json != stdout)
+    {
+        fclose(json);
+    }
+}
+
+/**
+ * @brief Repassa um bloco lido do arquivo de mensagem ao contexto de cifragem em fluxo.
+ * (Funcao auxiliar estatica, usada com read_file_in_chunks)
+ */
+static int cipher_chunk(void *user, const char *chunk, size_t length)
+{
+    return adfgvx_cipher_stream_update((adfgvx_cipher_stream *)user, chunk, length);
+}
+
+/**
+ * @brief Repassa um bloco lido do arquivo de mensagem ao contexto de escrita do container.
+ * (Funcao auxiliar estatica, usada com read_file_in_chunks)
+ */
+static int container_chunk(void *user, const char *chunk, size_t length)
+{
+    return adfgvx_container_writer_update((adfgvx_container_writer *)user, chunk, length);
+}
+
+/**
+ * @brief Le as opcoes de linha de comando.
+ *   --threads N             Cifra com N threads (0 = numero de processadores). Padrao: 1.
+ *   --parallel-threshold B  Tamanho minimo, em bytes, para dividir a mensagem entre as
+ *                           threads. Padrao: ADFGVX_PARALLEL_THRESHOLD.
+ *   --lines                 Cada linha da mensagem e um registro independente, cifrado
+ *                           numa linha propria da saida.
+ *   --container             Grava o texto cifrado no formato em blocos (adfgvx_container.h).
+ *   --packed                Grava o texto cifrado no formato compacto, 3 bits por simbolo (adfgvx_packed.h).
+ *   -e | -d                 Modo filtro: cifra (-e) ou decifra (-d) da entrada padrao para a
+ *                           saida padrao, no formato em blocos.
+ *   --key CHAVE             Usa CHAVE em vez de ler DEFAULT_KEY_FILE.
+ *   --key-fd N              Le a chave (uma linha) do descritor N, ex: --key-fd 3 3<chave.txt.
+ *   --block-size B          Modo filtro: bytes por bloco do pipeline. Padrao: ADFGVX_PIPELINE_BLOCK_SIZE.
+ *   --queue-depth N         Modo filtro: blocos em transito (>= 2). Padrao: ADFGVX_PIPELINE_QUEUE_DEPTH.
+ *   --serve CAMINHO         Servico local num socket UNIX (adfgvx_service.h), ate SIGINT / SIGTERM.
+ *   --batch-size N          Servico: requisicoes por lote. Padrao: ADFGVX_SERVICE_BATCH_SIZE.
+ *   --batch-wait-us N       Servico: espera por mais requisicoes num lote. Padrao: ADFGVX_SERVICE_BATCH_WAIT_US.
+ *   --stats                 Mede tempo, bytes e pico de memoria de cada estagio e grava a
+ *                           tabela na saida de erros ao terminar.
+ *   --stats-json ARQUIVO    Como --stats, mas grava as medicoes em JSON ("-" para a saida padrao,
+ *                           exceto no modo filtro, em que ela leva o texto cifrado).
+ *   --round-key CHAVE       Mais uma rodada de transposicao com CHAVE, depois da chave principal
+ *                           (repetivel ate ADFGVX_MAX_ROUNDS - 1 vezes; ex: dupla transposicao).
+ * (Funcao auxiliar estatica)
+ *
+ * @return int 0 em caso de sucesso, 1 se alguma opcao for invalida (ou se --lines, --container,
+ * --packed, o modo filtro e --serve forem combinados, ou algum deles com --round-key, ou se
+ * --stats-json - for usado no modo filtro).
+ */
+static int parse_arguments(int argc, char *argv[], cipher_tool_options *options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        char *end = NULL;
+
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > 1024)
+            {
+                return 1;
+            }
+            options->thread_count = value == 0 ? thread_pool_cpu_count() : (int)value;
+        }
+        else if (strcmp(argv[i], "--parallel-threshold") == 0 && i + 1 < argc)
+        {
+            unsigned long long value = strtoull(argv[++i], &end, 10);
+            if (*end != '\0' || argv[i][0] == '-')
+            {
+                return 1;
+            }
+            options->parallel_threshold = (size_t)value;
+        }
+        else if (strcmp(argv[i], "--lines") == 0)
+        {
+            options->line_mode = 1;
+        }
+        else if (strcmp(argv[i], "--container") == 0)
+        {
+            options->container_mode = 1;
+        }
+        else if (strcmp(argv[i], "--packed") == 0)
+        {
+            options->packed_mode = 1;
+        }
+        else if (strcmp(argv[i], "-e") == 0 || strcmp(argv[i], "-d") == 0)
+        {
+            options->filter_mode = argv[i][1];
+        }
+        else if (strcmp(argv[i], "--key") == 0 && i + 1 < argc)
+        {
+            options->key_text = argv[++i];
+        }
+        else if (strcmp(argv[i], "--key-fd") == 0 && i + 1 < argc)
+        {
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > 65535)
+            {
+                return 1;
+            }
+            options->key_fd = (int)value;
+        }
+        else if (strcmp(argv[i], "--block-size") == 0 && i + 1 < argc)
+        {
+            unsigned long long value = strtoull(argv[++i], &end, 10);
+            if (*end != '\0' || argv[i][0] == '-' || value == 0 || value > (size_t)-1 / 2)
+            {
+                return 1;
+            }
+            options->block_size = (size_t)value;
+        }
+        else if (strcmp(argv[i], "--queue-depth") == 0 && i + 1 < argc)
+        {
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 2 || value > 1024)
+            {
+                return 1;
+            }
+            options->queue_depth = (size_t)value;
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i + 1 < argc)
+        {
+            options->serve_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--batch-size") == 0 && i + 1 < argc)
+        {
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 1 || value > 65536)
+            {
+                return 1;
+            }
+            options->batch_size = (size_t)value;
+        }
+        else if (strcmp(argv[i], "--batch-wait-us") == 0 && i + 1 < argc)
+        {
+            long value = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || value < 0 || value > 1000000)
+            {
+                return 1;
+            }
+            options->batch_wait_us = (unsigned int)value;
+        }
+        else if (strcmp(argv[i], "--stats") == 0)
+        {
+            options->stats = 1;
+        }
+        else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc)
+        {
+            options->stats = 1;
+            options->stats_json_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--round-key") == 0 && i + 1 < argc)
+        {
+            size_t length = strlen(argv[++i]);
+            if (length == 0 || length >= MAX_KEY_LENGTH || options->round_key_count == ADFGVX_MAX_ROUNDS - 1)
+            {
+                return 1;
+            }
+            options->round_keys[options->round_key_count++] = argv[i];
+        }
+        else
+        {
+            return 1;
+        }
+    }
+    int modes = options->line_mode + options->container_mode + options->packed_mode + (options->filter_mode != 0) +
+                (options->serve_path != NULL);
+    if (modes > 1 || (modes > 0 && options->round_key_count > 0))
+    {
+        return 1;
+    }
+    // No modo filtro a saida padrao leva o texto cifrado: o JSON gravado ao sair
+    // corromperia o fluxo (ex: depois do rodape do container).
+    if (options->filter_mode && options->stats_json_path != NULL && strcmp(options->stats_json_path, "-") == 0)
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Libera os contextos das rodadas.
+ * (Funcao auxiliar estatica)
+ */
+static void free_round_keys(adfgvx_key_ctx keys[], int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        adfgvx_key_ctx_free(&keys[i]);
+    }
+}
+
+/**
+ * @brief Cifra a mensagem inteira de uma vez: a mensagem e o texto cifrado sao mapeados
+ * em memoria (map_input_file / map_output_file) e os simbolos sao gravados diretamente
+ * nas paginas do arquivo de saida. Com mais de uma thread, a mensagem e dividida entre
+ * as threads de um pool. Com chaves de rodadas (--round-key), as rodadas sao compostas
+ * num unico mapa (cipher_adfgvx_rounds, numa thread). Grava o resultado em DEFAULT_ENCRYPTED_FILE.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int EXIT_SUCCESS ou EXIT_FAILURE.
+ */
+static int cipher_file_mapped(const char *key, int key_length, int thread_count, size_t parallel_threshold,
+                              const char *const round_keys[], int round_key_count)
+{
+    adfgvx_key_ctx keys[ADFGVX_MAX_ROUNDS];
+    int round_count = 1 + round_key_count;
+    mapped_file message;
+    mapped_file encrypted;
+    size_t encrypted_length = 0;
+    int status;
+
+    for (int r = 0; r < round_count; r++)
+    {
+        const char *round_key = r == 0 ? key : round_keys[r - 1];
+        if (adfgvx_key_ctx_init(&keys[r], round_key, r == 0 ? key_length : (int)strlen(round_key)) != 0)
+        {
+            fprintf(stderr, "Erro ao preparar o contexto de cifragem.\n");
+            free_round_keys(keys, r);
+            return EXIT_FAILURE;
+        }
+    }
+
+    printf("Lendo e cifrando mensagem de '%s' com %d thread(s)...\n", DEFAULT_MESSAGE_FILE, thread_count);
+    status = map_input_file(DEFAULT_MESSAGE_FILE, &message);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro lendo arquivo da mensagem '%s'. Codigo: %d\n", DEFAULT_MESSAGE_FILE, status);
+        free_round_keys(keys, round_count);
+        return EXIT_FAILURE;
+    }
+
+    // Dois simbolos por caractere e o maximo possivel (caracteres invalidos nao geram nada);
+    // o arquivo e ajustado ao tamanho real ao ser fechado.
+    status = map_output_file(DEFAULT_ENCRYPTED_FILE, 2 * message.length, &encrypted);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro ao criar o arquivo cifrado '%s'. Codigo: %d\n", DEFAULT_ENCRYPTED_FILE, status);
+        close_mapped_file(&message, 0);
+        free_round_keys(keys, round_count);
+        return EXIT_FAILURE;
+    }
+
+    if (round_count > 1)
+    {
+        printf("Transposicao em %d rodadas.\n", round_count);
+        status = cipher_adfgvx_rounds(keys, round_count, message.data ? message.data : "", message.length,
+                                      encrypted.data, encrypted.length, &encrypted_length);
+    }
+    else
+    {
+        thread_pool *pool = thread_count > 1 ? thread_pool_create(thread_count) : NULL;
+        status = cipher_adfgvx_parallel(&keys[0], message.data ? message.data : "", message.length, encrypted.data, encrypted.length,
+                                        &encrypted_length, pool, parallel_threshold);
+        thread_pool_destroy(pool);
+    }
+    printf("Mensagem lida: %llu bytes (%llu simbolos cifrados)\n",
+           (unsigned long long)message.length, (unsigned long long)encrypted_length);
+    close_mapped_file(&message, 0);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro ao cifrar a mensagem. Codigo: %d\n", status);
+        close_mapped_file(&encrypted, 0);
+        free_round_keys(keys, round_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("Salvando mensagem cifrada em '%s'...\n", DEFAULT_ENCRYPTED_FILE);
+    status = close_mapped_file(&encrypted, encrypted_length);
+    if (status != 0)
+    {
+        fprintf(stderr, "Falha ao salvar a mensagem cifrada. Codigo: %d\n", status);
+        free_round_keys(keys, round_count);
+        return EXIT_FAILURE;
+    }
+
+    printf("Processo de cifragem concluido com sucesso!\n");
+    free_round_keys(keys, round_count);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Cifra cada linha de DEFAULT_MESSAGE_FILE como um registro independente e grava
+ * um texto cifrado por linha em DEFAULT_ENCRYPTED_FILE, na mesma ordem (modo --lines).
+ * (Funcao auxiliar estatica)
+ *
+ * @return int EXIT_SUCCESS ou EXIT_FAILURE.
+ */
+static int cipher_file_records(const char *key, int key_length, int thread_count)
+{
+    adfgvx_key_ctx key_ctx;
+    adfgvx_records_stats stats;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0)
+    {
+        fprintf(stderr, "Erro ao preparar o contexto de cifragem.\n");
+        return EXIT_FAILURE;
+    }
+
+    FILE *input = fopen(DEFAULT_MESSAGE_FILE, "rb");
+    if (input == NULL)
+    {
+        fprintf(stderr, "Erro lendo arquivo da mensagem '%s'.\n", DEFAULT_MESSAGE_FILE);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+    FILE *output = fopen(DEFAULT_ENCRYPTED_FILE, "wb");
+    if (output == NULL)
+    {
+        perror("Erro ao abrir arquivo para escrita da saida cifrada");
+        fclose(input);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    thread_pool *pool = thread_count > 1 ? thread_pool_create(thread_count) : NULL;
+    printf("Cifrando cada linha de '%s' para '%s' com %d threads...\n",
+           DEFAULT_MESSAGE_FILE, DEFAULT_ENCRYPTED_FILE, thread_pool_size(pool));
+    int status = adfgvx_process_records(input, output, &key_ctx, ADFGVX_RECORDS_ENCRYPT, pool, &stats);
+    thread_pool_destroy(pool);
+    fclose(input);
+    if (fclose(output) != 0 && status == 0)
+    {
+        status = 3;
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Falha ao cifrar os registros. Codigo: %d\n", status);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    printf("Registros cifrados: %llu (%llu bytes lidos, %llu bytes escritos)\n",
+           stats.records, stats.input_bytes, stats.output_bytes);
+    printf("Processo de cifragem concluido com sucesso!\n");
+    adfgvx_key_ctx_free(&key_ctx);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Cifra DEFAULT_MESSAGE_FILE no formato compacto (modo --packed): a mensagem e o
+ * arquivo de saida sao mapeados em memoria e os simbolos, com 3 bits cada, sao gravados
+ * direto nas paginas do arquivo, depois do cabecalho (adfgvx_packed.h).
+ * (Funcao auxiliar estatica)
+ *
+ * @return int EXIT_SUCCESS ou EXIT_FAILURE.
+ */
+static int cipher_file_packed(const char *key, int key_length)
+{
+    adfgvx_key_ctx key_ctx;
+    mapped_file message;
+    mapped_file encrypted;
+    size_t symbol_count = 0;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0)
+    {
+        fprintf(stderr, "Erro ao preparar o contexto de cifragem.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Lendo e cifrando mensagem de '%s' no formato compacto...\n", DEFAULT_MESSAGE_FILE);
+    int status = map_input_file(DEFAULT_MESSAGE_FILE, &message);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro lendo arquivo da mensagem '%s'. Codigo: %d\n", DEFAULT_MESSAGE_FILE, status);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    // Tamanho maximo (dois simbolos por caractere); o arquivo e ajustado ao ser fechado.
+    size_t capacity = adfgvx_packed_size(2 * message.length);
+    status = map_output_file(DEFAULT_ENCRYPTED_FILE, ADFGVX_PACKED_HEADER_SIZE + capacity, &encrypted);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro ao criar o arquivo cifrado '%s'. Codigo: %d\n", DEFAULT_ENCRYPTED_FILE, status);
+        close_mapped_file(&message, 0);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    unsigned char *header = (unsigned char *)encrypted.data;
+    status = adfgvx_packed_encrypt(&key_ctx, message.data ? message.data : "", message.length,
+                                   header + ADFGVX_PACKED_HEADER_SIZE, capacity, &symbol_count);
+    size_t packed_length = ADFGVX_PACKED_HEADER_SIZE + adfgvx_packed_size(symbol_count);
+    printf("Mensagem lida: %llu bytes (%llu simbolos cifrados, %llu bytes no formato compacto)\n",
+           (unsigned long long)message.length, (unsigned long long)symbol_count, (unsigned long long)packed_length);
+    close_mapped_file(&message, 0);
+    adfgvx_key_ctx_free(&key_ctx);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro ao cifrar a mensagem. Codigo: %d\n", status);
+        close_mapped_file(&encrypted, 0);
+        return EXIT_FAILURE;
+    }
+    adfgvx_packed_write_header(header, symbol_count);
+
+    printf("Salvando mensagem cifrada em '%s'...\n", DEFAULT_ENCRYPTED_FILE);
+    status = close_mapped_file(&encrypted, packed_length);
+    if (status != 0)
+    {
+        fprintf(stderr, "Falha ao salvar a mensagem cifrada. Codigo: %d\n", status);
+        return EXIT_FAILURE;
+    }
+
+    printf("Processo de cifragem concluido com sucesso!\n");
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Cifra DEFAULT_MESSAGE_FILE em fluxo no formato em blocos (modo --container):
+ * cabecalho, blocos de ADFGVX_CONTAINER_BLOCK_SIZE caracteres transpostos de forma
+ * independente (cifrados em paralelo com mais de uma thread), indice e rodape.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int EXIT_SUCCESS ou EXIT_FAILURE.
+ */
+static int cipher_file_container(const char *key, int key_length, int thread_count)
+{
+    adfgvx_key_ctx key_ctx;
+    adfgvx_container_writer writer;
+    unsigned long long message_bytes = 0;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0)
+    {
+        fprintf(stderr, "Erro ao preparar o contexto de cifragem.\n");
+        return EXIT_FAILURE;
+    }
+    FILE *output = fopen(DEFAULT_ENCRYPTED_FILE, "wb");
+    if (output == NULL)
+    {
+        perror("Erro ao abrir arquivo para escrita da saida cifrada");
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    thread_pool *pool = thread_count > 1 ? thread_pool_create(thread_count) : NULL;
+    int status = adfgvx_container_writer_init(&writer, output, &key_ctx, ADFGVX_CONTAINER_BLOCK_SIZE, pool);
+    if (status == 0)
+    {
+        printf("Cifrando '%s' em blocos de %d caracteres para '%s' com %d threads...\n",
+               DEFAULT_MESSAGE_FILE, ADFGVX_CONTAINER_BLOCK_SIZE, DEFAULT_ENCRYPTED_FILE, thread_pool_size(pool));
+        int read_status = read_file_in_chunks(DEFAULT_MESSAGE_FILE, ADFGVX_IO_CHUNK_SIZE, container_chunk, &writer, &message_bytes);
+        status = adfgvx_container_writer_final(&writer);
+        if (read_status != 0 && status == 0)
+        {
+            fprintf(stderr, "Erro lendo arquivo da mensagem '%s'. Codigo: %d\n", DEFAULT_MESSAGE_FILE, read_status);
+            status = 1;
+        }
+    }
+    thread_pool_destroy(pool);
+    if (fclose(output) != 0 && status == 0)
+    {
+        status = 3;
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Falha ao gravar o container cifrado. Codigo: %d\n", status);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    printf("Mensagem lida: %llu bytes (%llu caracteres em %llu blocos)\n",
+           message_bytes, writer.message_length, (unsigned long long)writer.block_count);
+    printf("Processo de cifragem concluido com sucesso!\n");
+    adfgvx_key_ctx_free(&key_ctx);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Estado do estagio de processamento do modo filtro.
+ * (Estrutura auxiliar interna)
+ */
+typedef struct
+{
+    int decrypt;
+    const adfgvx_key_ctx *key_ctx;
+    thread_pool *pool;
+    adfgvx_container_writer writer;
+    adfgvx_container_reader reader;
+    int started;                    // 1 entre o init e o final do contexto do container.
+    adfgvx_pipeline_buffer *output; // Saida do bloco do pipeline sendo processado.
+} filter_state;
+
+/**
+ * @brief Entrega os bytes produzidos pelo contexto do container a saida do bloco atual.
+ * (Funcao auxiliar estatica, usada como adfgvx_container_sink)
+ */
+static int filter_sink(void *user, const char *data, size_t length)
+{
+    return adfgvx_pipeline_buffer_append(((filter_state *)user)->output, data, length);
+}
+
+/**
+ * @brief Encerra o contexto do container (final) e devolve o seu codigo.
+ * (Funcao auxiliar estatica)
+ */
+static int finish_filter(filter_state *state)
+{
+    state->started = 0;
+    return state->decrypt ? adfgvx_container_reader_final(&state->reader) : adfgvx_container_writer_final(&state->writer);
+}
+
+/**
+ * @brief Estagio de processamento do modo filtro: repassa cada bloco lido ao contexto de
+ * escrita (-e) ou de leitura (-d) do container; os bytes produzidos vao para a saida do bloco.
+ * (Funcao auxiliar estatica, usada como adfgvx_pipeline_stage)
+ */
+static int filter_stage(void *user, const char *input, size_t length, int last, adfgvx_pipeline_buffer *output)
+{
+    filter_state *state = user;
+    int status = 0;
+
+    state->output = output;
+    if (!state->started)
+    {
+        // Iniciado no primeiro bloco, para que o cabecalho va para a saida dele.
+        status = state->decrypt ? adfgvx_container_reader_init(&state->reader, filter_sink, state, state->key_ctx, state->pool)
+                                : adfgvx_container_writer_init_sink(&state->writer, filter_sink, state, state->key_ctx,
+                                                                    ADFGVX_CONTAINER_BLOCK_SIZE, state->pool);
+        if (status != 0)
+        {
+            return status;
+        }
+        state->started = 1;
+    }
+
+    status = state->decrypt ? adfgvx_container_reader_update(&state->reader, input, length)
+                            : adfgvx_container_writer_update(&state->writer, input, length);
+    if (status != 0 || last)
+    {
+        int final_status = finish_filter(state);
+        status = status != 0 ? status : final_status;
+    }
+    return status;
+}
+
+/**
+ * @brief Modo filtro (-e / -d): cifra a entrada padrao para a saida padrao no formato em
+ * blocos, ou decifra um container recebido pela entrada padrao. Leitura, cifragem e
+ * escrita rodam em paralelo (adfgvx_pipeline_run). Mensagens so vao para stderr.
+ * (Funcao auxiliar estatica)
+ *
+ * @return int EXIT_SUCCESS ou EXIT_FAILURE.
+ */
+static int run_filter(const char *key, int key_length, const cipher_tool_options *options)
+{
+    adfgvx_key_ctx key_ctx;
+    filter_state state;
+    adfgvx_pipeline_stats stats;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0)
+    {
+        fprintf(stderr, "Erro ao preparar o contexto de cifragem.\n");
+        return EXIT_FAILURE;
+    }
+    if (set_binary_mode(stdin) != 0 || set_binary_mode(stdout) != 0)
+    {
+        fprintf(stderr, "Erro ao colocar a entrada e a saida padrao em modo binario.\n");
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    memset(&state, 0, sizeof(state));
+    state.decrypt = options->filter_mode == 'd';
+    state.key_ctx = &key_ctx;
+    state.pool = options->thread_count > 1 ? thread_pool_create(options->thread_count) : NULL;
+    int status = adfgvx_pipeline_run(stdin, stdout, options->block_size, options->queue_depth, filter_stage, &state, &stats);
+    if (state.started)
+    {
+        // O pipeline parou por erro de leitura ou escrita: apenas libera o contexto (a
+        // saida produzida pelo final e descartada).
+        adfgvx_pipeline_buffer discarded = {NULL, 0, 0};
+        state.output = &discarded;
+        finish_filter(&state);
+        free(discarded.data);
+    }
+    thread_pool_destroy(state.pool);
+    adfgvx_key_ctx_free(&key_ctx);
+
+    if (status == 5)
+    {
+        fprintf(stderr, "Erro ao %s o container. Codigo: %d\n", state.decrypt ? "decifrar" : "gravar", stats.stage_status);
+        return EXIT_FAILURE;
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro no pipeline do modo filtro. Codigo: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Sinalizador do servico, alterado pelo tratador de SIGINT / SIGTERM.
+static volatile sig_atomic_t service_stop = 0;
+
+static void request_service_stop(int signal_number)
+{
+    (void)signal_number;
+    service_stop = 1;
+}
+
+/**
+ * @brief Servico local (--serve): atende requisicoes de cifragem e decifragem num socket
+ * UNIX ate receber SIGINT ou SIGTERM; entao grava as estatisticas (histogramas de latencia).
+ * (Funcao auxiliar estatica)
+ *
+ * @return int EXIT_SUCCESS ou EXIT_FAILURE.
+ */
+static int run_service(const cipher_tool_options *options)
+{
+    adfgvx_service_config config;
+    adfgvx_service *service = NULL;
+
+    config.socket_path = options->serve_path;
+    config.thread_count = options->thread_count;
+    config.batch_size = options->batch_size;
+    config.batch_wait_us = options->batch_wait_us;
+    config.max_payload = ADFGVX_SERVICE_MAX_PAYLOAD;
+    int status = adfgvx_service_open(&service, &config);
+    if (status == 4)
+    {
+        fprintf(stderr, "Erro: o servico precisa de sockets UNIX, indisponiveis nesta plataforma.\n");
+        return EXIT_FAILURE;
+    }
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro ao abrir o servico em '%s'. Codigo: %d\n", options->serve_path, status);
+        return EXIT_FAILURE;
+    }
+
+    signal(SIGINT, request_service_stop);
+    signal(SIGTERM, request_service_stop);
+#ifdef SIGPIPE
+    signal(SIGPIPE, SIG_IGN); // Um cliente que fecha a conexao antes da resposta nao encerra o servico.
+#endif
+    printf("Servico escutando em '%s' com %d thread(s), lotes de ate %lu requisicoes (Ctrl+C encerra)...\n",
+           options->serve_path, options->thread_count, (unsigned long)options->batch_size);
+    fflush(stdout);
+    status = adfgvx_service_run(service, &service_stop);
+    printf("Servico encerrado. Estatisticas:\n");
+    adfgvx_service_write_stats(service, stdout);
+    adfgvx_service_close(service);
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro ao aceitar conexoes. Codigo: %d\n", status);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Funcao principal do programa de cifragem ADFGVX.
+ * (Mantendo a documentacao original da funcao main)
+ */
+int main(int argc, char *argv[])
+{
+    // Variaveis para armazenar a chave e a mensagem lidas dos arquivos.
+    // A mensagem nao e mais lida inteira para a memoria: ela e cifrada em fluxo,
+    // bloco a bloco, e pode ter qualquer tamanho.
+    char cipher_key_buffer[MAX_KEY_LENGTH]; // Renomeado de cipher_key
+    adfgvx_cipher_stream cipher_stream;
+    unsigned long long message_bytes = 0;
+
+    int actual_key_length = 0; // Renomeado de KEY_LENGTH para clareza e evitar conflito com macros
+    int file_read_status;      // Renomeado de is_file_read
+    cipher_tool_options options = {1, ADFGVX_PARALLEL_THRESHOLD, 0, 0, 0, 0, NULL, -1,
+                                   ADFGVX_PIPELINE_BLOCK_SIZE, ADFGVX_PIPELINE_QUEUE_DEPTH,
+                                   NULL, ADFGVX_SERVICE_BATCH_SIZE, ADFGVX_SERVICE_BATCH_WAIT_US, 0, NULL, {NULL}, 0};
+
+    if (parse_arguments(argc, argv, &options) != 0)
+    {
+        fprintf(stderr, "Uso: %s [--threads N] [--parallel-threshold BYTES] [--lines | --container | --packed]\n"
+                        "          [--key CHAVE | --key-fd N] [--round-key CHAVE ...] [--stats | --stats-json ARQUIVO]\n"
+                        "       %s -e | -d [--key CHAVE | --key-fd N] [--threads N] [--block-size BYTES] [--queue-depth N]\n"
+                        "          (modo filtro: entrada padrao -> saida padrao, no formato em blocos)\n"
+                        "       %s --serve CAMINHO [--threads N] [--batch-size N] [--batch-wait-us N]\n"
+                        "          (servico local num socket UNIX; chave e mensagem vem em cada requisicao)\n",
+                argv[0], argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (ADFGVX_STATS && options.stats)
+    {
+        // As medicoes sao gravadas ao sair, qualquer que seja o caminho de retorno.
+        stats_json_path = options.stats_json_path;
+        adfgvx_stats_enable();
+        atexit(write_stats);
+    }
+    else if (options.stats)
+    {
+        fprintf(stderr, "Aviso: compilado com ADFGVX_STATS=0; --stats nao tem efeito.\n");
+    }
+    if (options.serve_path != NULL)
+    {
+        return run_service(&options); // Cada requisicao traz a sua chave.
+    }
+
+    // Le a chave de cifra (do arquivo, da linha de comando ou de um descritor). No modo
+    // filtro a saida padrao e o texto cifrado: nada e impresso nela.
+    if (options.key_text != NULL)
+    {
+        file_read_status = strlen(options.key_text) < MAX_KEY_LENGTH ? 0 : 2;
+        if (file_read_status == 0)
+        {
+            strcpy(cipher_key_buffer, options.key_text);
+        }
+    }
+    else if (options.key_fd >= 0)
+    {
+        file_read_status = read_line_from_fd(options.key_fd, cipher_key_buffer, MAX_KEY_LENGTH);
+    }
+    else
+    {
+        if (!options.filter_mode)
+        {
+            printf("Lendo chave de '%s'...\n", DEFAULT_KEY_FILE);
+        }
+        file_read_status = read_file(DEFAULT_KEY_FILE, cipher_key_buffer, MAX_KEY_LENGTH);
+    }
+    if (file_read_status != 0)
+    {
+        if (options.key_text == NULL && options.key_fd < 0)
+        {
+            fprintf(stderr, "Erro lendo arquivo da chave '%s'. Codigo: %d\n", DEFAULT_KEY_FILE, file_read_status);
+        }
+        else
+        {
+            fprintf(stderr, "Erro lendo a chave (--key / --key-fd). Codigo: %d\n", file_read_status);
+        }
+        return EXIT_FAILURE; // Ou return 1;
+    }
+
+    // Define o tamanho real da chave com base no conteudo lido.
+    // A funcao read_file agora remove o '\n', entao strlen deve dar o comprimento correto.
+    actual_key_length = strlen(cipher_key_buffer);
+
+    // Validacao basica do comprimento da chave
+    if (actual_key_length == 0 || actual_key_length >= MAX_KEY_LENGTH) {
+        fprintf(stderr, "Erro: Comprimento da chave invalido (%d). Deve ser entre 1 e %d caracteres.\n",
+                actual_key_length, MAX_KEY_LENGTH - 1);
+        return EXIT_FAILURE;
+    }
+    if (options.filter_mode)
+    {
+        return run_filter(cipher_key_buffer, actual_key_length, &options);
+    }
+    printf("Chave lida: \"%s\" (Comprimento: %d)\n", cipher_key_buffer, actual_key_length);
+
+    if (options.line_mode)
+    {
+        return cipher_file_records(cipher_key_buffer, actual_key_length, options.thread_count);
+    }
+    if (options.container_mode)
+    {
+        return cipher_file_container(cipher_key_buffer, actual_key_length, options.thread_count);
+    }
+    if (options.packed_mode)
+    {
+        return cipher_file_packed(cipher_key_buffer, actual_key_length);
+    }
+
+    // Com mmap, a mensagem e cifrada direto entre os arquivos mapeados (sem copias pela
+    // stdio). Sem mmap, com mais de uma thread ela e lida inteira para a memoria; com uma
+    // thread continua sendo cifrada em fluxo, com memoria constante.
+    // O fluxo guarda um arquivo temporario por coluna; chaves mais longas que
+    // ADFGVX_STREAM_MAX_KEY_LENGTH tambem usam o caminho em memoria.
+    // As rodadas (--round-key) tambem usam o caminho em memoria.
+    if (FILE_OPERATIONS_HAVE_MMAP || options.thread_count > 1 || actual_key_length > ADFGVX_STREAM_MAX_KEY_LENGTH ||
+        options.round_key_count > 0)
+    {
+        return cipher_file_mapped(cipher_key_buffer, actual_key_length, options.thread_count, options.parallel_threshold,
+                                  options.round_keys, options.round_key_count);
+    }
+
+    if (adfgvx_cipher_stream_init(&cipher_stream, cipher_key_buffer, actual_key_length) != 0)
+    {
+        fprintf(stderr, "Erro ao preparar o contexto de cifragem.\n");
+        return EXIT_FAILURE;
+    }
+
+    // Ler e cifrar a mensagem do arquivo, bloco a bloco
+    printf("Lendo e cifrando mensagem de '%s'...\n", DEFAULT_MESSAGE_FILE);
+    file_read_status = read_file_in_chunks(DEFAULT_MESSAGE_FILE, ADFGVX_IO_CHUNK_SIZE, cipher_chunk, &cipher_stream, &message_bytes);
+    if (file_read_status != 0)
+    {
+        fprintf(stderr, "Erro lendo arquivo da mensagem '%s'. Codigo: %d\n", DEFAULT_MESSAGE_FILE, file_read_status);
+        adfgvx_cipher_stream_final(&cipher_stream, NULL);
+        return EXIT_FAILURE;
+    }
+    printf("Mensagem lida: %llu bytes (%llu simbolos cifrados)\n", message_bytes, cipher_stream.symbol_count);
+
+    // Salvar a mensagem cifrada em 'encrypted.txt'
+    printf("Salvando mensagem cifrada em '%s'...\n", DEFAULT_ENCRYPTED_FILE);
+    FILE *encrypted_file = fopen(DEFAULT_ENCRYPTED_FILE, "wb");
+    if (encrypted_file == NULL)
+    {
+        perror("Erro ao abrir arquivo para escrita da saida cifrada");
+        adfgvx_cipher_stream_final(&cipher_stream, NULL);
+        return EXIT_FAILURE;
+    }
+    int final_status = adfgvx_cipher_stream_final(&cipher_stream, encrypted_file);
+    if (fclose(encrypted_file) != 0 || final_status != 0)
+    {
+        fprintf(stderr, "Falha ao salvar a mensagem cifrada.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("Processo de cifragem concluido com sucesso!\n");
+    return EXIT_SUCCESS; // Ou return 0;
+}
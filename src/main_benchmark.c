@@ -0,0 +1,776 @@
+#define _POSIX_C_SOURCE 200809L // Para clock_gettime com -std=c99
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h> // Para malloc, strtod e qsort
+
+#include "cipher_config.h"
+#include "adfgvx_core.h"     // Para cipher_adfgvx_linear_ctx / cipher_adfgvx_parallel
+#include "adfgvx_decipher.h" // Para decipher_adfgvx_direct_ctx / decipher_adfgvx_parallel
+#include "adfgvx_workspace.h" // Para a arena do modo one-shot
+#include "adfgvx_service.h"   // Para o modo service (cliente do servico local)
+#include "adfgvx_codec.h"    // Para a selecao do kernel de codificacao
+#include "adfgvx_transpose.h" // Para --transpose
+#include "adfgvx_packed.h"    // Para --format packed
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h> // Para __rdtsc
+#define BENCH_HAVE_TSC 1
+#else
+#define BENCH_HAVE_TSC 0
+#endif
+
+// Programa de benchmark da cifra ADFGVX.
+//
+// Para cada combinacao de sentido (cifragem / decifragem), comprimento de chave, tipo de
+// texto e tamanho de mensagem, executa a operacao ate acumular --min-time segundos de
+// amostras (depois de um aquecimento) e informa a mediana e o p99 da latencia, a vazao
+// em MB/s e os ciclos por byte (contador de ciclos da CPU, quando disponivel).
+// Os bytes considerados sao os da entrada de cada sentido: texto plano na cifragem e
+// texto cifrado na decifragem. Com --json, os resultados tambem sao gravados em JSON.
+// Com --mode one-shot, cada chamada tambem prepara a agenda da chave (cipher_adfgvx_ws /
+// decipher_adfgvx_ws com uma arena reutilizada), como um servico que recebe chave e
+// mensagem juntas; com mensagens curtas, mede o custo fixo por chamada. Com --mode service
+// --socket CAMINHO, cada chamada e uma requisicao (chave e mensagem) a um servico ja em
+// execucao (adfgvx_cipher_tool --serve CAMINHO): mede a latencia vista pelo cliente, e no
+// fim os histogramas medidos pelo proprio servico sao impressos. Com --format packed, o
+// texto cifrado fica no formato compacto (adfgvx_packed.h): a decifragem le 3/8 dos bytes.
+
+#define BENCH_MAX_SIZES 8
+#define BENCH_MAX_KEYS 8
+#define BENCH_MIN_SAMPLES 10
+#define BENCH_MAX_SAMPLES 20000
+#define BENCH_MIN_SAMPLE_SECONDS 20e-6 // Chamadas curtas sao agrupadas ate este tempo por amostra.
+
+// Tamanhos de mensagem varridos (limitados por --max-size).
+static const size_t bench_sizes[BENCH_MAX_SIZES] = {
+    16, 256, 4096, 65536, 1024 * 1024, 16 * 1024 * 1024, 256 * 1024 * 1024, 1024 * 1024 * 1024
+};
+
+// Tipos de texto: proporcoes diferentes de caracteres fora da matriz Polybius.
+typedef enum
+{
+    MIX_ALNUM = 0, // Apenas caracteres da matriz (A-Z, 0-9).
+    MIX_PROSE,     // Palavras em maiusculas, espacos, pontuacao e quebras de linha.
+    MIX_MIXED_CASE,// Texto comum com minusculas (descartadas pela cifra).
+    MIX_BINARY,    // Bytes aleatorios (em geral invalidos).
+    MIX_COUNT
+} text_mix;
+
+static const char *mix_names[MIX_COUNT] = {"alnum", "prose", "mixed-case", "binary"};
+
+// Modos de chamada (--mode).
+typedef enum
+{
+    MODE_CTX = 0, // Agenda da chave preparada uma vez por caso.
+    MODE_ONE_SHOT,// Agenda preparada a cada chamada, numa arena reutilizada.
+    MODE_SERVICE, // Requisicao ao servico local (--socket).
+    MODE_COUNT
+} bench_mode;
+
+static const char *mode_names[MODE_COUNT] = {"ctx", "one-shot", "service"};
+
+// Transposicao (--transpose).
+typedef enum
+{
+    TRANSPOSE_SPECIALIZED = 0, // Kernels por comprimento de chave e ladrilhos nas chaves longas.
+    TRANSPOSE_UNTILED,         // Kernels por comprimento de chave, sem ladrilhos.
+    TRANSPOSE_GENERIC,         // Sempre o laco generico.
+    TRANSPOSE_COUNT
+} bench_transpose;
+
+static const char *transpose_names[TRANSPOSE_COUNT] = {"specialized", "untiled", "generic"};
+
+/**
+ * @brief Opcoes da linha de comando.
+ */
+typedef struct
+{
+    size_t max_size;
+    double min_time;
+    int thread_count;
+    size_t parallel_threshold;
+    int key_lengths[BENCH_MAX_KEYS];
+    int key_count;
+    const char *json_path;
+    const char *kernel_name;
+    bench_transpose transpose; // --transpose.
+    int packed;              // --format packed: texto cifrado no formato compacto (3 bits por simbolo).
+    bench_mode mode;
+    const char *socket_path; // --socket: servico do modo service.
+} bench_options;
+
+/**
+ * @brief Estatisticas de um caso de benchmark.
+ */
+typedef struct
+{
+    double median_ns;
+    double p99_ns;
+    double mb_per_s;
+    double cycles_per_byte;
+    size_t samples;
+} bench_result;
+
+/**
+ * @brief Retorna o tempo monotonic atual, em segundos.
+ */
+static double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * @brief Retorna o contador de ciclos da CPU (0 se indisponivel).
+ */
+static unsigned long long read_cycles(void)
+{
+#if BENCH_HAVE_TSC
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Gerador pseudoaleatorio (xorshift) com semente fixa, para entradas reprodutiveis.
+ */
+static unsigned int next_random(unsigned int *state)
+{
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/**
+ * @brief Preenche buffer com length bytes do tipo de texto indicado.
+ */
+static void generate_text(text_mix mix, char *buffer, size_t length)
+{
+    static const char alnum[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+    // Letras com frequencia aproximada do ingles/portugues.
+    static const char letters[] = "EEEEEEEEEEEEAAAAAAAAAOOOOOOOOSSSSSSRRRRRRIIIIIINNNNNDDDDDMMMMUUUUTTTTTCCCCLLLPPPVVGGHQBFZJXKWY";
+    unsigned int state = 0x9E3779B9u;
+    size_t line = 0;
+
+    for (size_t i = 0; i < length; i++)
+    {
+        unsigned int r = next_random(&state);
+        char c;
+
+        switch (mix)
+        {
+        case MIX_ALNUM:
+            c = alnum[r % (sizeof(alnum) - 1)];
+            break;
+        case MIX_BINARY:
+            c = (char)(r >> 11);
+            break;
+        default:
+            // Palavras de ~5 letras separadas por espaco, pontuacao ocasional e linhas de ~70.
+            if (line >= 70)
+            {
+                c = '\n';
+                line = 0;
+            }
+            else if (r % 6 == 0)
+            {
+                c = (r >> 8) % 10 == 0 ? ',' : ((r >> 8) % 17 == 0 ? '.' : ' ');
+            }
+            else if (r % 53 == 1)
+            {
+                c = alnum[26 + (r >> 8) % 10]; // Digitos ocasionais.
+            }
+            else
+            {
+                c = letters[(r >> 8) % (sizeof(letters) - 1)];
+                // No texto comum, so o inicio das palavras fica em maiuscula.
+                if (mix == MIX_MIXED_CASE && i > 0 && buffer[i - 1] != ' ' && buffer[i - 1] != '\n')
+                {
+                    c = (char)(c - 'A' + 'a');
+                }
+            }
+            line = c == '\n' ? 0 : line + 1;
+            break;
+        }
+        buffer[i] = c;
+    }
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Dados de uma execucao da operacao medida.
+ */
+typedef struct
+{
+    int decrypt;
+    const adfgvx_key_ctx *key_ctx;
+    const char *key;           // Modo one-shot: chave (key_length caracteres) e arena.
+    int key_length;
+    adfgvx_workspace *ws;
+    int service_fd;            // Modo service: conexao com o servico (-1 nos outros modos).
+    int packed;                // Formato compacto: a decifragem le symbol_count simbolos de input.
+    size_t symbol_count;
+    const char *input;
+    size_t input_length;
+    char *output;
+    size_t output_capacity;
+    thread_pool *pool;
+    size_t parallel_threshold;
+} bench_case;
+
+/**
+ * @brief Executa a operacao uma vez.
+ * @return int Codigo de retorno da funcao de cifragem / decifragem.
+ */
+static int run_once(const bench_case *bc)
+{
+    size_t produced = 0;
+
+    if (bc->service_fd >= 0)
+    {
+        int status = 0;
+        int result = adfgvx_service_request(bc->service_fd, bc->decrypt ? ADFGVX_SERVICE_DECRYPT : ADFGVX_SERVICE_ENCRYPT,
+                                            bc->key, bc->key_length, bc->input, bc->input_length,
+                                            bc->output, bc->output_capacity, &produced, &status);
+        return result != 0 ? result : status;
+    }
+    if (bc->ws != NULL)
+    {
+        if (bc->decrypt)
+        {
+            return decipher_adfgvx_ws(bc->ws, bc->input, bc->input_length, bc->key, bc->key_length,
+                                      bc->output, bc->output_capacity, &produced);
+        }
+        return cipher_adfgvx_ws(bc->ws, bc->key, bc->key_length, bc->input, bc->input_length,
+                                bc->output, bc->output_capacity, &produced);
+    }
+    if (bc->packed)
+    {
+        if (bc->decrypt)
+        {
+            return adfgvx_packed_decrypt(bc->key_ctx, (const unsigned char *)bc->input, bc->symbol_count,
+                                         bc->output, bc->output_capacity, &produced);
+        }
+        return adfgvx_packed_encrypt(bc->key_ctx, bc->input, bc->input_length, (unsigned char *)bc->output,
+                                     bc->output_capacity, &produced);
+    }
+    if (bc->decrypt)
+    {
+        return decipher_adfgvx_parallel(bc->key_ctx, bc->input, bc->input_length, bc->output,
+                                        bc->output_capacity, &produced, bc->pool, bc->parallel_threshold);
+    }
+    return cipher_adfgvx_parallel(bc->key_ctx, bc->input, bc->input_length, bc->output,
+                                  bc->output_capacity, &produced, bc->pool, bc->parallel_threshold);
+}
+
+/**
+ * @brief Mede um caso: aquecimento, depois amostras ate min_time segundos.
+ * Chamadas mais curtas que BENCH_MIN_SAMPLE_SECONDS sao repetidas dentro de cada amostra
+ * (a amostra vale o tempo medio por chamada), para nao medir a resolucao do relogio.
+ *
+ * @return int 0 em caso de sucesso, 1 se a operacao falhar, 2 se faltar memoria.
+ */
+static int measure(const bench_case *bc, double min_time, bench_result *result)
+{
+    // Aquecimento: caches, paginas da saida e frequencia da CPU.
+    size_t repeats = 1;
+    double start = now_seconds();
+    double elapsed = 0;
+    int warmups = 0;
+    do
+    {
+        double t0 = now_seconds();
+        for (size_t r = 0; r < repeats; r++)
+        {
+            if (run_once(bc) != 0)
+            {
+                return 1;
+            }
+        }
+        double t = now_seconds() - t0;
+        if (t < BENCH_MIN_SAMPLE_SECONDS && repeats < ((size_t)1 << 24))
+        {
+            repeats *= 2;
+        }
+        elapsed = now_seconds() - start;
+        warmups++;
+    } while (warmups < 3 || (elapsed < min_time / 5 && warmups < 1000));
+
+    double *samples = malloc(BENCH_MAX_SAMPLES * sizeof(double));
+    double *cycles = malloc(BENCH_MAX_SAMPLES * sizeof(double));
+    if (samples == NULL || cycles == NULL)
+    {
+        free(samples);
+        free(cycles);
+        return 2;
+    }
+
+    size_t count = 0;
+    start = now_seconds();
+    while (count < BENCH_MAX_SAMPLES && (count < BENCH_MIN_SAMPLES || now_seconds() - start < min_time))
+    {
+        unsigned long long c0 = read_cycles();
+        double t0 = now_seconds();
+        for (size_t r = 0; r < repeats; r++)
+        {
+            run_once(bc);
+        }
+        double t = now_seconds() - t0;
+        unsigned long long c1 = read_cycles();
+
+        samples[count] = t * 1e9 / (double)repeats;
+        cycles[count] = (double)(c1 - c0) / (double)repeats;
+        count++;
+    }
+
+    qsort(samples, count, sizeof(double), compare_doubles);
+    qsort(cycles, count, sizeof(double), compare_doubles);
+
+    // p99 pelo metodo do posto mais proximo.
+    size_t p99_index = (count * 99 + 99) / 100;
+    result->samples = count;
+    result->median_ns = samples[count / 2];
+    result->p99_ns = samples[(p99_index > 0 ? p99_index - 1 : 0)];
+    result->mb_per_s = result->median_ns > 0 ? (double)bc->input_length / result->median_ns * 1e3 : 0;
+    result->cycles_per_byte = BENCH_HAVE_TSC && bc->input_length > 0 ? cycles[count / 2] / (double)bc->input_length : 0;
+
+    free(samples);
+    free(cycles);
+    return 0;
+}
+
+/**
+ * @brief Converte um tamanho com sufixo opcional K, M ou G (potencias de 1024).
+ * @return int 0 em caso de sucesso, 1 se o texto for invalido.
+ */
+static int parse_size(const char *text, size_t *value)
+{
+    char *end = NULL;
+    double number = strtod(text, &end);
+    double scale = 1;
+
+    if (end == text || number < 0)
+    {
+        return 1;
+    }
+    if (*end == 'K' || *end == 'k') { scale = 1024.0; end++; }
+    else if (*end == 'M' || *end == 'm') { scale = 1024.0 * 1024.0; end++; }
+    else if (*end == 'G' || *end == 'g') { scale = 1024.0 * 1024.0 * 1024.0; end++; }
+    if (*end != '\0')
+    {
+        return 1;
+    }
+    *value = (size_t)(number * scale);
+    return 0;
+}
+
+/**
+ * @brief Le as opcoes da linha de comando.
+ *   --max-size TAM          Maior mensagem da varredura (K/M/G). Padrao: 16M.
+ *   --min-time SEG          Tempo de amostragem por caso. Padrao: 0.2.
+ *   --key-lengths L1,L2,..  Comprimentos de chave (1 a MAX_KEY_LENGTH - 1). Padrao: 1,2,4,6,8.
+ *   --threads N             Usa as versoes paralelas com N threads (0 = processadores). Padrao: 1.
+ *   --parallel-threshold B  Limite das versoes paralelas. Padrao: ADFGVX_PARALLEL_THRESHOLD.
+ *   --kernel NOME           scalar, ssse3 ou avx2 (padrao: o melhor disponivel).
+ *   --transpose TIPO        specialized (kernels por comprimento de chave e ladrilhos nas
+ *                           chaves longas, padrao), untiled (sem ladrilhos) ou generic (sempre
+ *                           o laco generico).
+ *   --format ascii|packed   Texto cifrado em ASCII (padrao) ou no formato compacto de
+ *                           adfgvx_packed.h (numa thread, so no modo ctx).
+ *   --json ARQUIVO          Grava os resultados em JSON ("-" para a saida padrao).
+ *   --mode ctx|one-shot|service
+ *                           ctx: agenda da chave preparada uma vez por caso (padrao);
+ *                           one-shot: agenda preparada a cada chamada, numa arena reutilizada;
+ *                           service: cada chamada e uma requisicao ao servico de --socket.
+ *   --socket CAMINHO        Socket do servico (adfgvx_cipher_tool --serve CAMINHO).
+ *
+ * @return int 0 em caso de sucesso, 1 se alguma opcao for invalida.
+ */
+static int parse_arguments(int argc, char *argv[], bench_options *options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL)
+        {
+            return 1;
+        }
+        if (strcmp(argv[i], "--max-size") == 0)
+        {
+            if (parse_size(value, &options->max_size) != 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--min-time") == 0)
+        {
+            options->min_time = strtod(value, NULL);
+            if (options->min_time <= 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--key-lengths") == 0)
+        {
+            const char *p = value;
+            options->key_count = 0;
+            while (*p != '\0' && options->key_count < BENCH_MAX_KEYS)
+            {
+                char *end = NULL;
+                long length = strtol(p, &end, 10);
+                if (end == p || length < 1 || length >= MAX_KEY_LENGTH)
+                {
+                    return 1;
+                }
+                options->key_lengths[options->key_count++] = (int)length;
+                p = *end == ',' ? end + 1 : end;
+            }
+            if (options->key_count == 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            options->thread_count = atoi(value);
+            if (options->thread_count <= 0)
+            {
+                options->thread_count = thread_pool_cpu_count();
+            }
+        }
+        else if (strcmp(argv[i], "--parallel-threshold") == 0)
+        {
+            if (parse_size(value, &options->parallel_threshold) != 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--kernel") == 0)
+        {
+            options->kernel_name = value;
+        }
+        else if (strcmp(argv[i], "--transpose") == 0)
+        {
+            int transpose = 0;
+            while (transpose < TRANSPOSE_COUNT && strcmp(value, transpose_names[transpose]) != 0)
+            {
+                transpose++;
+            }
+            if (transpose == TRANSPOSE_COUNT)
+            {
+                return 1;
+            }
+            options->transpose = (bench_transpose)transpose;
+        }
+        else if (strcmp(argv[i], "--format") == 0)
+        {
+            if (strcmp(value, "ascii") != 0 && strcmp(value, "packed") != 0)
+            {
+                return 1;
+            }
+            options->packed = strcmp(value, "packed") == 0;
+        }
+        else if (strcmp(argv[i], "--json") == 0)
+        {
+            options->json_path = value;
+        }
+        else if (strcmp(argv[i], "--mode") == 0)
+        {
+            int mode = 0;
+            while (mode < MODE_COUNT && strcmp(value, mode_names[mode]) != 0)
+            {
+                mode++;
+            }
+            if (mode == MODE_COUNT)
+            {
+                return 1;
+            }
+            options->mode = (bench_mode)mode;
+        }
+        else if (strcmp(argv[i], "--socket") == 0)
+        {
+            options->socket_path = value;
+        }
+        else
+        {
+            return 1;
+        }
+        i++;
+    }
+    if (options->packed && (options->mode != MODE_CTX || options->thread_count > 1))
+    {
+        return 1;
+    }
+    return options->mode == MODE_SERVICE && options->socket_path == NULL ? 1 : 0;
+}
+
+static const char *kernel_name(adfgvx_encode_kernel kernel)
+{
+    switch (kernel)
+    {
+    case ADFGVX_KERNEL_AVX2:
+        return "avx2";
+    case ADFGVX_KERNEL_SSSE3:
+        return "ssse3";
+    default:
+        return "scalar";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench_options options = {16 * 1024 * 1024, 0.2, 1, ADFGVX_PARALLEL_THRESHOLD, {1, 2, 4, 6, 8}, 5, NULL, NULL, TRANSPOSE_SPECIALIZED, 0, MODE_CTX, NULL};
+    static char base_key[MAX_KEY_LENGTH];
+    FILE *json = NULL;
+    int first_result = 1;
+
+    if (parse_arguments(argc, argv, &options) != 0)
+    {
+        fprintf(stderr, "Uso: %s [--max-size TAM] [--min-time SEG] [--key-lengths L1,L2,...] [--threads N]\n"
+                        "          [--parallel-threshold B] [--kernel scalar|ssse3|avx2] [--json ARQUIVO]\n"
+                        "          [--transpose specialized|untiled|generic] [--format ascii|packed]\n"
+                        "          [--mode ctx|one-shot|service] [--socket CAMINHO]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // Chave base: "SEMB2025" repetida; cada caso usa os primeiros key_length caracteres
+    // (os comprimentos ate 8 medem as mesmas chaves de sempre).
+    for (int i = 0; i < MAX_KEY_LENGTH - 1; i++)
+    {
+        base_key[i] = "SEMB2025"[i % 8];
+    }
+
+    adfgvx_codec_init();
+    if (options.kernel_name != NULL)
+    {
+        adfgvx_encode_kernel kernel = ADFGVX_KERNEL_SCALAR;
+        if (strcmp(options.kernel_name, "ssse3") == 0) kernel = ADFGVX_KERNEL_SSSE3;
+        else if (strcmp(options.kernel_name, "avx2") == 0) kernel = ADFGVX_KERNEL_AVX2;
+        else if (strcmp(options.kernel_name, "scalar") != 0)
+        {
+            fprintf(stderr, "Kernel desconhecido: %s\n", options.kernel_name);
+            return EXIT_FAILURE;
+        }
+        if (adfgvx_codec_select_kernel(kernel) != 0)
+        {
+            fprintf(stderr, "Kernel '%s' nao suportado nesta CPU.\n", options.kernel_name);
+            return EXIT_FAILURE;
+        }
+    }
+    adfgvx_transpose_select_specialized(options.transpose != TRANSPOSE_GENERIC);
+    adfgvx_transpose_select_tiled(options.transpose == TRANSPOSE_SPECIALIZED);
+    const char *transpose_name = transpose_names[options.transpose];
+    const char *format_name = options.packed ? "packed" : "ascii";
+
+    // Maior tamanho da varredura: define os buffers, alocados uma unica vez.
+    size_t largest = 0;
+    for (int s = 0; s < BENCH_MAX_SIZES; s++)
+    {
+        if (bench_sizes[s] <= options.max_size)
+        {
+            largest = bench_sizes[s];
+        }
+    }
+    if (largest == 0)
+    {
+        fprintf(stderr, "Erro: --max-size menor que o menor tamanho da varredura (%lu bytes).\n", (unsigned long)bench_sizes[0]);
+        return EXIT_FAILURE;
+    }
+
+    char *message = malloc(largest);
+    char *encrypted = malloc(2 * largest);
+    char *decrypted = malloc(largest);
+    thread_pool *pool = options.thread_count > 1 ? thread_pool_create(options.thread_count) : NULL;
+    // Arena do modo one-shot: do tamanho da maior chave, alocada uma unica vez.
+    int longest_key = 0;
+    for (int k = 0; k < options.key_count; k++)
+    {
+        longest_key = options.key_lengths[k] > longest_key ? options.key_lengths[k] : longest_key;
+    }
+    adfgvx_workspace ws;
+    int ws_status = adfgvx_workspace_init(&ws, NULL, ADFGVX_WORKSPACE_KEY_BYTES(longest_key));
+    if (message == NULL || encrypted == NULL || decrypted == NULL || (options.thread_count > 1 && pool == NULL) || ws_status != 0)
+    {
+        fprintf(stderr, "Erro: memoria insuficiente para mensagens de %lu bytes.\n", (unsigned long)largest);
+        free(message); free(encrypted); free(decrypted);
+        thread_pool_destroy(pool);
+        adfgvx_workspace_free(&ws);
+        return EXIT_FAILURE;
+    }
+    int service_fd = -1;
+    if (options.mode == MODE_SERVICE && adfgvx_service_connect(options.socket_path, &service_fd) != 0)
+    {
+        fprintf(stderr, "Erro: nao foi possivel conectar ao servico em '%s'.\n", options.socket_path);
+        free(message); free(encrypted); free(decrypted);
+        thread_pool_destroy(pool);
+        adfgvx_workspace_free(&ws);
+        return EXIT_FAILURE;
+    }
+
+    if (options.json_path != NULL)
+    {
+        json = strcmp(options.json_path, "-") == 0 ? stdout : fopen(options.json_path, "w");
+        if (json == NULL)
+        {
+            perror("Erro ao abrir o arquivo JSON");
+            return EXIT_FAILURE;
+        }
+        fprintf(json, "{\n  \"benchmark\": \"adfgvx\",\n  \"format_version\": 1,\n");
+        fprintf(json, "  \"kernel\": \"%s\",\n  \"transpose\": \"%s\",\n  \"format\": \"%s\",\n  \"threads\": %d,\n  \"parallel_threshold\": %lu,\n",
+                kernel_name(adfgvx_codec_active_kernel()), transpose_name, format_name, thread_pool_size(pool),
+                (unsigned long)options.parallel_threshold);
+        fprintf(json, "  \"cycle_counter\": %s,\n  \"min_time_s\": %g,\n  \"mode\": \"%s\",\n  \"results\": [\n",
+                BENCH_HAVE_TSC ? "\"tsc\"" : "null", options.min_time, mode_names[options.mode]);
+    }
+
+    // A tabela vai para stderr quando o JSON ocupa a saida padrao.
+    FILE *report = json == stdout ? stderr : stdout;
+    fprintf(report, "Kernel: %s, transposicao: %s, formato: %s, threads: %d, ciclos: %s, modo: %s\n",
+            kernel_name(adfgvx_codec_active_kernel()), transpose_name, format_name,
+            thread_pool_size(pool), BENCH_HAVE_TSC ? "TSC" : "indisponivel", mode_names[options.mode]);
+    fprintf(report, "%-8s %-4s %-11s %12s %8s %13s %13s %10s %9s\n",
+            "sentido", "k", "texto", "bytes", "amostras", "mediana(ns)", "p99(ns)", "MB/s", "ciclos/B");
+
+    for (int m = 0; m < MIX_COUNT; m++)
+    {
+        generate_text((text_mix)m, message, largest);
+
+        for (int k = 0; k < options.key_count; k++)
+        {
+            adfgvx_key_ctx key_ctx;
+            if (adfgvx_key_ctx_init(&key_ctx, base_key, options.key_lengths[k]) != 0)
+            {
+                fprintf(stderr, "Erro ao preparar a chave de %d caracteres.\n", options.key_lengths[k]);
+                continue;
+            }
+
+            for (int s = 0; s < BENCH_MAX_SIZES && bench_sizes[s] <= largest; s++)
+            {
+                size_t size = bench_sizes[s];
+                size_t encrypted_length = 0;
+
+                size_t symbol_count = 0;
+                if (options.packed)
+                {
+                    // A decifragem le os simbolos compactados, que ocupam 3/8 do ASCII.
+                    adfgvx_packed_encrypt(&key_ctx, message, size, (unsigned char *)encrypted, 2 * largest, &symbol_count);
+                    encrypted_length = adfgvx_packed_size(symbol_count);
+                }
+                else
+                {
+                    cipher_adfgvx_linear_ctx(&key_ctx, message, size, encrypted, 2 * largest, &encrypted_length);
+                }
+
+                for (int direction = 0; direction < 2; direction++)
+                {
+                    bench_case bc;
+                    bench_result result;
+
+                    bc.decrypt = direction;
+                    bc.key_ctx = &key_ctx;
+                    bc.key = base_key;
+                    bc.key_length = options.key_lengths[k];
+                    bc.ws = options.mode == MODE_ONE_SHOT ? &ws : NULL;
+                    bc.service_fd = service_fd;
+                    bc.packed = options.packed;
+                    bc.symbol_count = symbol_count;
+                    bc.input = direction ? encrypted : message;
+                    bc.input_length = direction ? encrypted_length : size;
+                    // A cifragem regrava no mesmo buffer o texto cifrado que ja esta nele
+                    // (mesma mensagem e chave), entao a entrada da decifragem nao muda.
+                    bc.output = direction ? decrypted : encrypted;
+                    bc.output_capacity = direction ? largest : 2 * largest;
+                    bc.pool = pool;
+                    bc.parallel_threshold = options.parallel_threshold;
+
+                    if (bc.input_length == 0)
+                    {
+                        continue; // Ex: texto binario sem nenhum caractere valido.
+                    }
+
+                    if (measure(&bc, options.min_time, &result) != 0)
+                    {
+                        fprintf(stderr, "Erro ao medir o caso %s/%d/%s/%lu.\n", direction ? "decrypt" : "encrypt",
+                                options.key_lengths[k], mix_names[m], (unsigned long)size);
+                        continue;
+                    }
+
+                    fprintf(report, "%-8s %-4d %-11s %12lu %8lu %13.0f %13.0f %10.1f %9.2f\n",
+                            direction ? "decrypt" : "encrypt", options.key_lengths[k], mix_names[m],
+                            (unsigned long)bc.input_length, (unsigned long)result.samples,
+                            result.median_ns, result.p99_ns, result.mb_per_s, result.cycles_per_byte);
+                    if (json != NULL)
+                    {
+                        fprintf(json, "%s    {\"direction\": \"%s\", \"key_length\": %d, \"mix\": \"%s\", "
+                                      "\"message_bytes\": %lu, \"input_bytes\": %lu, \"samples\": %lu, "
+                                      "\"median_ns\": %.1f, \"p99_ns\": %.1f, \"mb_per_s\": %.3f, \"cycles_per_byte\": %.4f}",
+                                first_result ? "" : ",\n", direction ? "decrypt" : "encrypt", options.key_lengths[k],
+                                mix_names[m], (unsigned long)size, (unsigned long)bc.input_length,
+                                (unsigned long)result.samples, result.median_ns, result.p99_ns,
+                                result.mb_per_s, result.cycles_per_byte);
+                        first_result = 0;
+                    }
+                }
+            }
+            adfgvx_key_ctx_free(&key_ctx);
+        }
+    }
+
+    if (service_fd >= 0)
+    {
+        // Latencias medidas pelo servico (sem o tempo do socket no cliente), em JSON.
+        char *stats = malloc(65536);
+        size_t stats_length = 0;
+        int status = 0;
+        if (stats != NULL && adfgvx_service_request(service_fd, ADFGVX_SERVICE_STATS, NULL, 0, NULL, 0, stats, 65535,
+                                                    &stats_length, &status) == 0 && status == 0)
+        {
+            stats[stats_length] = '\0';
+            fprintf(report, "Estatisticas do servico: %s\n", stats);
+        }
+        free(stats);
+        adfgvx_service_disconnect(service_fd);
+    }
+
+    if (json != NULL)
+    {
+        fprintf(json, "\n  ]\n}\n");
+        if (json != stdout)
+        {
+            fclose(json);
+        }
+    }
+
+    thread_pool_destroy(pool);
+    adfgvx_workspace_free(&ws);
+    free(message);
+    free(encrypted);
+    free(decrypted);
+    return EXIT_SUCCESS;
+}
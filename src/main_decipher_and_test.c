@@ -1,256 +1,2585 @@
-#include <stdio.h>
-#include <string.h>
-#include <stdlib.h> // Para EXIT_SUCCESS, EXIT_FAILURE
-#include <time.h>   // Para test_execution_time
-
-#include "cipher_config.h"
-#include "file_operations.h"
-#include "adfgvx_core.h"     // Para cipher_adfgvx (usado em testes)
-#include "adfgvx_decipher.h" // Para decipher_adfgvx
-
-// --- Funes de Teste (Adaptadas do cdigo monoltico) ---
-
-/**
- * @brief Testa a funo de decifragem comparando com a mensagem original.
- * (Funo auxiliar esttica para os testes neste arquivo)
- */
-static void test_decipher(const char *test_name, char key[], char original_message[])
-{
-    printf("\n-> Teste de Decifragem: %s\n", test_name);
-    int key_length = strlen(key);
-    if (key_length == 0 || key_length >= MAX_KEY_LENGTH) {
-        printf("\tERRO: Chave de teste invlida '%s' para o teste '%s'.\n", key, test_name);
-        return;
-    }
-    if (strlen(original_message) == 0 && strcmp(test_name, "Teste com mensagem vazia") != 0) { // Permite teste de msg vazia
-         printf("\tAVISO: Mensagem original de teste vazia para '%s'.\n", test_name);
-    }
-
-
-    // VLA para a matriz de cifragem
-    char encoded_symbol_matrix[key_length][MAX_MESSAGE_LENGTH];
-    // Usar MAX_KEY_LENGTH para symbols_per_column  mais seguro se key_length for varivel
-    // ou inicializar um VLA com key_length. Para consistncia com o main original:
-    int symbols_per_column[MAX_KEY_LENGTH] = {0};
-
-    // Cifrar a mensagem usando o mdulo adfgvx_core
-    cipher_adfgvx(key, key_length, original_message, encoded_symbol_matrix, symbols_per_column);
-
-    // Linearizar mensagem cifrada para alimentar a decifragem
-    char encrypted_linear[MAX_MESSAGE_LENGTH * 2 + 1];
-    int pos = 0;
-    for (int i = 0; i < key_length; i++)
-    {
-        for (int j = 0; j < symbols_per_column[i]; j++)
-        {
-            if (pos < MAX_MESSAGE_LENGTH * 2) { // Protege o buffer
-                encrypted_linear[pos++] = encoded_symbol_matrix[i][j];
-            } else {
-                printf("\tERRO INTERNO DO TESTE: Buffer de encrypted_linear cheio durante a linearizao.\n");
-                encrypted_linear[pos] = '\0';
-                return; // No pode continuar o teste
-            }
-        }
-    }
-    encrypted_linear[pos] = '\0';
-
-    // Decifrar usando o mdulo adfgvx_decipher
-    char decrypted_output[MAX_MESSAGE_LENGTH];
-    decipher_adfgvx(encrypted_linear, key, key_length, decrypted_output);
-
-    printf("\t\tMensagem Original:  \"%.50s%s\"\n", original_message, strlen(original_message) > 50 ? "..." : "");
-    printf("\t\tChave:              \"%s\"\n", key);
-    printf("\t\tTexto Cifrado:    \"%.50s%s\"\n", encrypted_linear, strlen(encrypted_linear) > 50 ? "..." : "");
-    printf("\t\tMensagem Decifrada: \"%.50s%s\"\n", decrypted_output, strlen(decrypted_output) > 50 ? "..." : "");
-
-    if (strcmp(original_message, decrypted_output) == 0)
-    {
-        printf("\tSUCESSO: Mensagem decifrada corresponde  original!\n");
-    }
-    else
-    {
-        printf("\tERRO: A decifragem falhou. Mensagens no correspondem.\n");
-    }
-}
-
-/**
- * @brief Mede o tempo de execuo da cifragem de uma mensagem longa.
- * (Funo auxiliar esttica para os testes neste arquivo)
- */
-static void test_execution_time() // Nome original do monoltico
-{
-    printf("\n-> Teste: Tempo de Execuo da Cifragem\n");
-    char key[] = "CHAVE123"; // Chave de 8 caracteres
-    int key_length = strlen(key);
-
-    // Criar uma mensagem longa
-    char long_message[MAX_MESSAGE_LENGTH];
-    memset(long_message, 'A', MAX_MESSAGE_LENGTH - 1);
-    long_message[MAX_MESSAGE_LENGTH - 1] = '\0';
-
-    // A matriz encoded_symbol_matrix deve ter a primeira dimenso baseada no key_length real.
-    // Se key_length  8 (MAX_KEY_LENGTH-1), ento [MAX_KEY_LENGTH-1]  apropriado.
-    char encoded_symbol_matrix[MAX_KEY_LENGTH -1][MAX_MESSAGE_LENGTH]; // Ajustado para MAX_KEY_LENGTH-1
-    int symbols_per_column[MAX_KEY_LENGTH] = {0};
-
-    clock_t start_time = clock();
-    cipher_adfgvx(key, key_length, long_message, encoded_symbol_matrix, symbols_per_column);
-    clock_t end_time = clock();
-
-    double elapsed_seconds = (double)(end_time - start_time) / CLOCKS_PER_SEC;
-
-    printf("\t\tMensagem: %d caracteres 'A'\n", (int)strlen(long_message));
-    printf("\t\tChave: \"%s\"\n", key);
-    printf("\t\tTempo de cifragem: %.6f segundos\n", elapsed_seconds);
-
-    if (elapsed_seconds > 0.5) // Limite de 0.5 segundos
-    {
-        printf("\tAVISO: Tempo de execuo da cifragem excedeu 0.5 segundos!\n");
-    }
-    else
-    {
-        printf("\tSUCESSO: Tempo de execuo da cifragem dentro do limite de 0.5 segundos.\n");
-    }
-}
-
-/**
- * @brief Verifica se caracteres invlidos so ignorados durante a cifragem.
- * (Funo auxiliar esttica para os testes neste arquivo)
- */
-
- /**
- * @brief Testa a funo de decifragem comparando com a mensagem original.
- *
- * @note Usamos key UM e a messagem LUCAS previamente testadas tanto no site https://www.dcode.fr/adfgvx-cipher, quanto realizando a cifragem manualmente.
-    Cifra: Lucas -> XF FA AD GA AG
- */
-static void test_invalid_character() // Nome original do monoltico
-{
-    printf("\n-> Teste: Tratamento de Caracteres Invlidos na Cifragem\n");
-    char key[] = "UM";
-    int key_length = strlen(key);
-    char message_with_invalids[] = "L#UC%AS@!d"; // Esperado que apenas "LUCAS" seja cifrado
-
-    // VLA para a matriz de cifragem
-    char encoded_symbol_matrix[key_length][MAX_MESSAGE_LENGTH];
-    int symbols_per_column[MAX_KEY_LENGTH] = {0};
-
-
-    const char expected_cipher_for_LUCAS[] = "XFFAADGAAG";
-
-    cipher_adfgvx(key, key_length, message_with_invalids, encoded_symbol_matrix, symbols_per_column);
-
-    char actual_cipher[MAX_MESSAGE_LENGTH * 2 + 1] = {0}; // +1 para nulo
-    int pos = 0;
-    for (int i = 0; i < key_length; i++)
-    {
-        for (int j = 0; j < symbols_per_column[i]; j++)
-        {
-            if (pos < MAX_MESSAGE_LENGTH * 2) { // Protege buffer
-                actual_cipher[pos++] = encoded_symbol_matrix[i][j];
-            }
-        }
-    }
-    actual_cipher[pos] = '\0';
-
-    printf("\t\tMensagem Original com Invlidos: \"%s\"\n", message_with_invalids);
-    printf("\t\tChave: \"%s\"\n", key);
-    printf("\t\tTexto Cifrado Obtido:          \"%s\"\n", actual_cipher);
-    printf("\t\tTexto Cifrado Esperado (para \"LUCAS\"): \"%s\"\n", expected_cipher_for_LUCAS);
-
-    if (strcmp(actual_cipher, expected_cipher_for_LUCAS) == 0)
-    {
-        printf("\tSUCESSO: Caracteres invlidos ignorados e cifragem correta.\n");
-    }
-    else
-    {
-        printf("\tERRO: A mensagem cifrada est incorreta ou os caracteres invlidos no foram tratados como esperado.\n");
-    }
-}
-
-
-int main()
-{
-    char key_buffer[MAX_KEY_LENGTH];
-    char original_message_for_comparison[MAX_MESSAGE_LENGTH];
-    char encrypted_text_from_file[MAX_MESSAGE_LENGTH * 2 + 1];
-    char decrypted_message_buffer[MAX_MESSAGE_LENGTH];
-    int key_len_actual = 0;
-    int status;
-
-    printf("--- PROGRAMA DE TESTE DE DECIFRAGEM E OUTROS TESTES ADFGVX ---\n");
-
-    // Etapa principal: Decifrar um arquivo e comparar
-    printf("\n--- ETAPA PRINCIPAL: DECIFRAR ARQUIVO E COMPARAR ---\n");
-
-    // 1. Ler chave
-    printf("Lendo chave de '%s'...\n", DEFAULT_KEY_FILE);
-    status = read_file(DEFAULT_KEY_FILE, key_buffer, MAX_KEY_LENGTH);
-    if (status != 0) {
-        fprintf(stderr, "Erro ao ler o arquivo da chave '%s'. Cdigo: %d. Saindo da etapa principal.\n", DEFAULT_KEY_FILE, status);
-        // Prosseguir para os testes auto-contidos
-    } else {
-        key_len_actual = strlen(key_buffer);
-        if (key_len_actual == 0 || key_len_actual >= MAX_KEY_LENGTH) {
-            fprintf(stderr, "Erro: Comprimento da chave invlido (%d) lido de '%s'. Saindo da etapa principal.\n", key_len_actual, DEFAULT_KEY_FILE);
-            // Prosseguir para os testes auto-contidos
-        } else {
-            printf("Chave: \"%s\", Comprimento: %d\n", key_buffer, key_len_actual);
-
-            // 2. Ler texto cifrado
-            printf("Lendo texto cifrado de '%s'...\n", DEFAULT_ENCRYPTED_FILE);
-            status = read_file(DEFAULT_ENCRYPTED_FILE, encrypted_text_from_file, sizeof(encrypted_text_from_file));
-            if (status != 0) {
-                fprintf(stderr, "Erro ao ler o arquivo cifrado '%s'. Cdigo: %d.\n", DEFAULT_ENCRYPTED_FILE, status);
-                fprintf(stderr, "Certifique-se de que este arquivo existe (gerado por uma ferramenta de cifragem).\n");
-            } else {
-                printf("Texto Cifrado Lido: \"%.50s%s\"\n",
-                       encrypted_text_from_file, strlen(encrypted_text_from_file) > 50 ? "..." : "");
-
-                // 3. Decifrar
-                printf("Decifrando o texto lido...\n");
-                decipher_adfgvx(encrypted_text_from_file, key_buffer, key_len_actual, decrypted_message_buffer);
-                printf("Texto Decifrado: \"%.50s%s\"\n",
-                       decrypted_message_buffer, strlen(decrypted_message_buffer) > 50 ? "..." : "");
-
-                // 4. Salvar texto decifrado
-                printf("Salvando texto decifrado em '%s'...\n", DEFAULT_DECRYPTED_FILE_FOR_TEST);
-                if (write_plaintext_to_file(DEFAULT_DECRYPTED_FILE_FOR_TEST, decrypted_message_buffer) != 0) {
-                    fprintf(stderr, "Falha ao salvar o texto decifrado.\n");
-                } else {
-                    printf("Texto decifrado salvo com sucesso.\n");
-                }
-
-                // 5. Comparar com original
-                printf("Lendo mensagem original de '%s' para comparao...\n", DEFAULT_MESSAGE_FILE);
-                status = read_file(DEFAULT_MESSAGE_FILE, original_message_for_comparison, MAX_MESSAGE_LENGTH);
-                if (status != 0) {
-                    fprintf(stderr, "Erro ao ler o arquivo da mensagem original '%s'. Cdigo: %d. Comparao no ser feita.\n", DEFAULT_MESSAGE_FILE, status);
-                } else {
-                    if (strcmp(original_message_for_comparison, decrypted_message_buffer) == 0) {
-                        printf("VERIFICAO: SUCESSO! Texto decifrado corresponde ao original de '%s'.\n", DEFAULT_MESSAGE_FILE);
-                    } else {
-                        fprintf(stderr, "VERIFICAO: FALHA! Texto decifrado NO corresponde ao original de '%s'.\n", DEFAULT_MESSAGE_FILE);
-                    }
-                }
-            }
-        }
-    }
-
-    // --- Executar os "outros testes" (adaptados do monoltico) ---
-    printf("\n--- EXECUTANDO TESTES INTERNOS ADICIONAIS ---\n");
-
-    // Os testes usam chaves e mensagens embutidas.
-    test_decipher("Teste Interno 1", "UM", "LUCAS");
-    test_decipher("Teste Interno 2", "SEMB2025", "TESTANDO A CIFRA ADFGVX COM UMA CHAVE UM POUCO MAIOR E UMA MENSAGEM DE COMPRIMENTO MEDIO PARA VERIFICAR A CORRECAO.");
-    test_decipher("Teste Interno 3 (Msg Curta)", "CHAVE", "OI");
-    test_decipher("Teste Interno 4 (Msg Vazia)", "TESTE", "");
-
-
-    test_execution_time(); // Usa cipher_adfgvx
-    test_invalid_character(); // Usa cipher_adfgvx
-
-    printf("\n--- FIM DO PROGRAMA DE TESTES ---\n");
-    return EXIT_SUCCESS;
-}
-
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h> // Para EXIT_SUCCESS, EXIT_FAILURE
+#include <time.h>   // Para test_execution_time
+
+#include "cipher_config.h"
+#include "file_operations.h"
+#include "adfgvx_core.h"     // Para cipher_adfgvx (usado em testes)
+#include "adfgvx_decipher.h" // Para decipher_adfgvx
+#include "adfgvx_codec.h"    // Para os kernels de codificacao
+#include "thread_pool.h"     // Para as versoes paralelas
+#include "adfgvx_records.h"  // Para o modo de registros (--lines)
+#include "adfgvx_container.h" // Para o formato em blocos (--container)
+#include "adfgvx_cryptanalysis.h" // Para a recuperacao da chave
+#include "adfgvx_workspace.h" // Para as arenas de cipher_adfgvx_ws / decipher_adfgvx_ws
+#include "adfgvx_pipeline.h"  // Para o pipeline do modo filtro (-e / -d)
+#include "adfgvx_service.h"   // Para o servico local (--serve)
+#include "adfgvx_fuzz.h"      // Para o harness diferencial contra a referencia
+#include "adfgvx_stats.h"     // Para as medicoes por estagio (--stats)
+#include "adfgvx_transpose.h" // Para os kernels de transposicao e os ladrilhos
+#include "adfgvx_packed.h"    // Para o formato compacto (--packed)
+#include <pthread.h>          // Para rodar o servico numa thread em test_service
+
+// --- Funções de Teste (Adaptadas do código monolítico) ---
+
+/**
+ * @brief Testa a função de decifragem comparando com a mensagem original.
+ * (Função auxiliar estática para os testes neste arquivo)
+ */
+static void test_decipher(const char *test_name, char key[], char original_message[])
+{
+    printf("\n-> Teste de Decifragem: %s\n", test_name);
+    int key_length = strlen(key);
+    if (key_length == 0 || key_length >= MAX_KEY_LENGTH) {
+        printf("\tERRO: Chave de teste inválida '%s' para o teste '%s'.\n", key, test_name);
+        return;
+    }
+    if (strlen(original_message) == 0 && strcmp(test_name, "Teste com mensagem vazia") != 0) { // Permite teste de msg vazia
+         printf("\tAVISO: Mensagem original de teste vazia para '%s'.\n", test_name);
+    }
+
+
+    // Cifrar a mensagem usando o módulo adfgvx_core, direto no buffer linear que
+    // alimenta a decifragem (sem matriz intermediária).
+    char encrypted_linear[MAX_MESSAGE_LENGTH * 2 + 1];
+    size_t encrypted_length = 0;
+    if (cipher_adfgvx_linear(key, key_length, original_message, strlen(original_message),
+                             encrypted_linear, sizeof(encrypted_linear) - 1, &encrypted_length) != 0) {
+        printf("\tERRO INTERNO DO TESTE: Buffer de encrypted_linear insuficiente.\n");
+        return; // Não pode continuar o teste
+    }
+    encrypted_linear[encrypted_length] = '\0';
+
+    // Decifrar usando o módulo adfgvx_decipher
+    char decrypted_output[MAX_MESSAGE_LENGTH];
+    decipher_adfgvx(encrypted_linear, key, key_length, decrypted_output);
+
+    printf("\t\tMensagem Original:  \"%.50s%s\"\n", original_message, strlen(original_message) > 50 ? "..." : "");
+    printf("\t\tChave:              \"%s\"\n", key);
+    printf("\t\tTexto Cifrado:    \"%.50s%s\"\n", encrypted_linear, strlen(encrypted_linear) > 50 ? "..." : "");
+    printf("\t\tMensagem Decifrada: \"%.50s%s\"\n", decrypted_output, strlen(decrypted_output) > 50 ? "..." : "");
+
+    if (strcmp(original_message, decrypted_output) == 0)
+    {
+        printf("\tSUCESSO: Mensagem decifrada corresponde à original!\n");
+    }
+    else
+    {
+        printf("\tERRO: A decifragem falhou. Mensagens não correspondem.\n");
+    }
+}
+
+/**
+ * @brief Mede o tempo de execução da cifragem de uma mensagem longa.
+ * É apenas uma verificação de limite; medições de desempenho ficam no adfgvx_benchmark
+ * (src/main_benchmark.c).
+ * (Função auxiliar estática para os testes neste arquivo)
+ */
+static void test_execution_time() // Nome original do monolítico
+{
+    printf("\n-> Teste: Tempo de Execução da Cifragem\n");
+    char key[] = "CHAVE123"; // Chave de 8 caracteres
+    int key_length = strlen(key);
+
+    // Criar uma mensagem longa
+    char long_message[MAX_MESSAGE_LENGTH];
+    memset(long_message, 'A', MAX_MESSAGE_LENGTH - 1);
+    long_message[MAX_MESSAGE_LENGTH - 1] = '\0';
+
+    // Texto cifrado gravado diretamente num buffer linear (sem matriz intermediária).
+    static char encrypted_linear[2 * MAX_MESSAGE_LENGTH];
+    size_t encrypted_length = 0;
+
+    clock_t start_time = clock();
+    cipher_adfgvx_linear(key, key_length, long_message, strlen(long_message),
+                         encrypted_linear, sizeof(encrypted_linear), &encrypted_length);
+    clock_t end_time = clock();
+
+    double elapsed_seconds = (double)(end_time - start_time) / CLOCKS_PER_SEC;
+
+    printf("\t\tMensagem: %d caracteres 'A'\n", (int)strlen(long_message));
+    printf("\t\tChave: \"%s\"\n", key);
+    printf("\t\tTempo de cifragem: %.6f segundos\n", elapsed_seconds);
+
+    if (elapsed_seconds > 0.5) // Limite de 0.5 segundos
+    {
+        printf("\tAVISO: Tempo de execução da cifragem excedeu 0.5 segundos!\n");
+    }
+    else
+    {
+        printf("\tSUCESSO: Tempo de execução da cifragem dentro do limite de 0.5 segundos.\n");
+    }
+}
+
+/**
+ * @brief Verifica se caracteres inválidos são ignorados durante a cifragem.
+ * (Função auxiliar estática para os testes neste arquivo)
+ */
+
+ /**
+ * @brief Testa a função de decifragem comparando com a mensagem original.
+ *
+ * @note Usamos key UM e a messagem LUCAS previamente testadas tanto no site https://www.dcode.fr/adfgvx-cipher, quanto realizando a cifragem manualmente.
+    Cifra: Lucas -> XF FA AD GA AG
+ */
+static void test_invalid_character() // Nome original do monolítico
+{
+    printf("\n-> Teste: Tratamento de Caracteres Inválidos na Cifragem\n");
+    char key[] = "UM";
+    int key_length = strlen(key);
+    char message_with_invalids[] = "L#UC%AS@!d"; // Esperado que apenas "LUCAS" seja cifrado
+
+    // VLA para a matriz de cifragem
+    char encoded_symbol_matrix[key_length][MAX_MESSAGE_LENGTH];
+    int symbols_per_column[MAX_KEY_LENGTH] = {0};
+
+
+    const char expected_cipher_for_LUCAS[] = "XFFAADGAAG";
+
+    int column_order[MAX_KEY_LENGTH];
+    cipher_adfgvx(key, key_length, message_with_invalids, encoded_symbol_matrix, symbols_per_column, column_order);
+
+    char actual_cipher[MAX_MESSAGE_LENGTH * 2 + 1] = {0}; // +1 para nulo
+    int pos = 0;
+    for (int i = 0; i < key_length; i++)
+    {
+        int col = column_order[i];
+        for (int j = 0; j < symbols_per_column[col]; j++)
+        {
+            if (pos < MAX_MESSAGE_LENGTH * 2) { // Protege buffer
+                actual_cipher[pos++] = encoded_symbol_matrix[col][j];
+            }
+        }
+    }
+    actual_cipher[pos] = '\0';
+
+    printf("\t\tMensagem Original com Inválidos: \"%s\"\n", message_with_invalids);
+    printf("\t\tChave: \"%s\"\n", key);
+    printf("\t\tTexto Cifrado Obtido:          \"%s\"\n", actual_cipher);
+    printf("\t\tTexto Cifrado Esperado (para \"LUCAS\"): \"%s\"\n", expected_cipher_for_LUCAS);
+
+    // A cifragem direta no buffer linear deve produzir o mesmo texto cifrado.
+    char linear_cipher[MAX_MESSAGE_LENGTH * 2 + 1];
+    size_t linear_length = 0;
+    cipher_adfgvx_linear(key, key_length, message_with_invalids, strlen(message_with_invalids),
+                         linear_cipher, sizeof(linear_cipher) - 1, &linear_length);
+    linear_cipher[linear_length] = '\0';
+
+    if (strcmp(actual_cipher, expected_cipher_for_LUCAS) == 0 && strcmp(linear_cipher, expected_cipher_for_LUCAS) == 0)
+    {
+        printf("\tSUCESSO: Caracteres inválidos ignorados e cifragem correta.\n");
+    }
+    else
+    {
+        printf("\tERRO: A mensagem cifrada está incorreta ou os caracteres inválidos não foram tratados como esperado.\n");
+    }
+}
+
+/**
+ * @brief Testa a cifragem e a decifragem em fluxo, entregando a mensagem em blocos pequenos.
+ * Compara o resultado com cipher_adfgvx para uma mensagem curta e faz a ida e volta de uma
+ * mensagem maior que MAX_MESSAGE_LENGTH e que os buffers de coluna dos contextos.
+ * (Função auxiliar estática para os testes neste arquivo)
+ */
+static void test_stream_round_trip()
+{
+    printf("\n-> Teste: Cifragem e Decifragem em Fluxo (init/update/final)\n");
+    char key[] = "SEMB2025";
+    int key_length = strlen(key);
+    char short_message[] = "TESTE DE FLUXO, COM BLOCOS PEQUENOS. 123";
+    int failures = 0;
+
+    // 1) Mensagem curta em blocos de 3 bytes: o texto cifrado deve ser igual ao de cipher_adfgvx.
+    char encoded_symbol_matrix[key_length][MAX_MESSAGE_LENGTH];
+    int symbols_per_column[MAX_KEY_LENGTH] = {0};
+    int column_order[MAX_KEY_LENGTH];
+    char expected_cipher[MAX_MESSAGE_LENGTH * 2 + 1];
+    int pos = 0;
+    cipher_adfgvx(key, key_length, short_message, encoded_symbol_matrix, symbols_per_column, column_order);
+    for (int i = 0; i < key_length; i++)
+        for (int j = 0; j < symbols_per_column[column_order[i]]; j++)
+            expected_cipher[pos++] = encoded_symbol_matrix[column_order[i]][j];
+    expected_cipher[pos] = '\0';
+
+    adfgvx_cipher_stream cipher_stream;
+    FILE *cipher_file = tmpfile();
+    if (cipher_file == NULL || adfgvx_cipher_stream_init(&cipher_stream, key, key_length) != 0) {
+        printf("\tERRO INTERNO DO TESTE: não foi possível preparar o contexto de fluxo.\n");
+        if (cipher_file) fclose(cipher_file);
+        return;
+    }
+    for (size_t i = 0; i < strlen(short_message); i += 3) {
+        size_t n = strlen(short_message) - i < 3 ? strlen(short_message) - i : 3;
+        adfgvx_cipher_stream_update(&cipher_stream, short_message + i, n);
+    }
+    adfgvx_cipher_stream_final(&cipher_stream, cipher_file);
+
+    char stream_cipher[MAX_MESSAGE_LENGTH * 2 + 1];
+    rewind(cipher_file);
+    size_t stream_len = fread(stream_cipher, 1, sizeof(stream_cipher) - 1, cipher_file);
+    stream_cipher[stream_len] = '\0';
+    fclose(cipher_file);
+    if (strcmp(stream_cipher, expected_cipher) != 0) {
+        printf("\tERRO: Texto cifrado em fluxo difere de cipher_adfgvx.\n");
+        failures++;
+    }
+
+    // 2) Ida e volta de uma mensagem grande, maior que os buffers de coluna.
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ,.1234567";
+    const long large_length = 400000;
+    char chunk[1000];
+    FILE *encrypted = tmpfile();
+    FILE *decrypted = tmpfile();
+    adfgvx_decipher_stream decipher_stream;
+    if (encrypted == NULL || decrypted == NULL ||
+        adfgvx_cipher_stream_init(&cipher_stream, "KEY", 3) != 0) {
+        printf("\tERRO INTERNO DO TESTE: não foi possível preparar os arquivos temporários.\n");
+        if (encrypted) fclose(encrypted);
+        if (decrypted) fclose(decrypted);
+        return;
+    }
+    for (long i = 0; i < large_length; i += (long)sizeof(chunk)) {
+        for (size_t j = 0; j < sizeof(chunk); j++)
+            chunk[j] = alphabet[(i + (long)j) * 7 % 36];
+        adfgvx_cipher_stream_update(&cipher_stream, chunk, sizeof(chunk));
+    }
+    adfgvx_cipher_stream_final(&cipher_stream, encrypted);
+
+    rewind(encrypted);
+    adfgvx_decipher_stream_init(&decipher_stream, "KEY", 3);
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), encrypted)) > 0)
+        adfgvx_decipher_stream_update(&decipher_stream, chunk, n);
+    int final_status = adfgvx_decipher_stream_final(&decipher_stream, decrypted);
+
+    long matched = 0;
+    int c;
+    rewind(decrypted);
+    while ((c = fgetc(decrypted)) != EOF && c == alphabet[matched * 7 % 36])
+        matched++;
+    fclose(encrypted);
+    fclose(decrypted);
+
+    printf("\t\tMensagem curta:  \"%s\" (blocos de 3 bytes)\n", short_message);
+    printf("\t\tMensagem grande: %ld caracteres, chave \"KEY\"; %ld decifrados corretamente\n", large_length, matched);
+    if (final_status != 0 || matched != large_length) {
+        printf("\tERRO: Ida e volta em fluxo da mensagem grande falhou.\n");
+        failures++;
+    }
+
+    if (failures == 0) {
+        printf("\tSUCESSO: Contextos de fluxo equivalentes a cipher_adfgvx e reversíveis.\n");
+    }
+}
+
+/**
+ * @brief Compara cada kernel de codificacao suportado (SSSE3/AVX2) com o kernel escalar,
+ * com todos os bytes possiveis, em varios comprimentos e alinhamentos (para exercitar
+ * tanto o laco vetorial quanto a cauda escalar).
+ * (Função auxiliar estática para os testes neste arquivo)
+ */
+static void test_encode_kernels()
+{
+    printf("\n-> Teste: Kernels Vetoriais de Codificação x Kernel Escalar\n");
+    static const char *kernel_names[] = {"escalar", "SSSE3", "AVX2"};
+    static char input[4096 + 64];
+    static char expected[2 * sizeof(input)];
+    static char actual[2 * sizeof(input)];
+    adfgvx_encode_kernel original = adfgvx_codec_active_kernel();
+    int failures = 0;
+
+    // Metade dos bytes vem da matriz, para que os blocos misturem validos e invalidos.
+    srand(2025);
+    for (size_t i = 0; i < sizeof(input); i++) {
+        input[i] = (rand() % 2) ? "ABCDEFGHIJKLMNOPQRSTUVWXYZ ,.1234567"[rand() % 36] : (char)(rand() % 256);
+    }
+
+    for (int k = ADFGVX_KERNEL_SSSE3; k <= ADFGVX_KERNEL_AVX2; k++) {
+        if (adfgvx_codec_select_kernel((adfgvx_encode_kernel)k) != 0) {
+            printf("\t\tKernel %s: não suportado nesta CPU, ignorado.\n", kernel_names[k]);
+            continue;
+        }
+        for (size_t offset = 0; offset < 64; offset += 7) {
+            for (size_t length = 0; length + offset <= sizeof(input); length += (length < 100 ? 1 : 331)) {
+                adfgvx_codec_select_kernel(ADFGVX_KERNEL_SCALAR);
+                size_t expected_count = adfgvx_encode_symbols(input + offset, length, expected);
+                adfgvx_codec_select_kernel((adfgvx_encode_kernel)k);
+                size_t actual_count = adfgvx_encode_symbols(input + offset, length, actual);
+                if (actual_count != expected_count || memcmp(actual, expected, expected_count) != 0) {
+                    failures++;
+                }
+            }
+        }
+        printf("\t\tKernel %s: comparado com o escalar.\n", kernel_names[k]);
+    }
+    adfgvx_codec_select_kernel(original);
+
+    if (failures == 0) {
+        printf("\tSUCESSO: Kernels vetoriais produzem exatamente a saída do kernel escalar.\n");
+    } else {
+        printf("\tERRO: %d divergências entre kernels vetoriais e o escalar.\n", failures);
+    }
+}
+
+/**
+ * @brief Cifra e decifra um lote de mensagens curtas com um único contexto de chave,
+ * comparando cada item com cipher_adfgvx_linear e com a mensagem original.
+ * (Função auxiliar estática para os testes neste arquivo)
+ */
+static void test_key_ctx_batch()
+{
+    printf("\n-> Teste: Lote de Mensagens com Contexto de Chave Reutilizável\n");
+    char key[] = "BATCH";
+    const char *messages[] = {"LUCAS", "OI", "", "REGISTRO 42, CAMPO 7.", "MENSAGEM DE TAMANHO MEDIO PARA O LOTE"};
+    enum { COUNT = sizeof(messages) / sizeof(messages[0]), CAPACITY = 128 };
+    char encrypted[COUNT][CAPACITY];
+    char decrypted[COUNT][CAPACITY];
+    adfgvx_batch_item cipher_items[COUNT];
+    adfgvx_batch_item decipher_items[COUNT];
+    adfgvx_key_ctx key_ctx;
+    int failures = 0;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, strlen(key)) != 0) {
+        printf("\tERRO: Não foi possível inicializar o contexto de chave.\n");
+        return;
+    }
+
+    for (int i = 0; i < COUNT; i++) {
+        cipher_items[i].input = messages[i];
+        cipher_items[i].input_length = strlen(messages[i]);
+        cipher_items[i].output = encrypted[i];
+        cipher_items[i].output_capacity = CAPACITY;
+    }
+    failures += (int)cipher_adfgvx_batch(&key_ctx, cipher_items, COUNT);
+
+    for (int i = 0; i < COUNT; i++) {
+        char expected[CAPACITY];
+        size_t expected_length = 0;
+        cipher_adfgvx_linear(key, strlen(key), messages[i], strlen(messages[i]), expected, CAPACITY, &expected_length);
+        if (expected_length != cipher_items[i].output_length ||
+            memcmp(expected, encrypted[i], expected_length) != 0) {
+            failures++;
+        }
+
+        decipher_items[i].input = encrypted[i];
+        decipher_items[i].input_length = cipher_items[i].output_length;
+        decipher_items[i].output = decrypted[i];
+        decipher_items[i].output_capacity = CAPACITY;
+    }
+    failures += (int)decipher_adfgvx_batch(&key_ctx, decipher_items, COUNT);
+
+    for (int i = 0; i < COUNT; i++) {
+        if (decipher_items[i].output_length != strlen(messages[i]) ||
+            memcmp(decrypted[i], messages[i], decipher_items[i].output_length) != 0) {
+            failures++;
+        }
+    }
+
+    printf("\t\tChave: \"%s\", %d mensagens no lote\n", key, COUNT);
+    if (failures == 0) {
+        printf("\tSUCESSO: Lote cifrado igual a cipher_adfgvx_linear e decifrado corretamente.\n");
+    } else {
+        printf("\tERRO: %d falhas no processamento em lote.\n", failures);
+    }
+    adfgvx_key_ctx_free(&key_ctx);
+}
+
+/**
+ * @brief Testa as versoes paralelas (pool de threads) contra as sequenciais: mesma saida
+ * para varios tamanhos de chave, e mesmos codigos de retorno para capacidade
+ * insuficiente e par invalido no meio do texto cifrado.
+ */
+static void test_parallel_round_trip()
+{
+    printf("\n-> Teste: Cifragem e Decifragem Paralelas (Pool de Threads)\n");
+    const char *keys[] = {"A", "UM", "CHAVE", "SEMB2025"};
+    enum { KEY_COUNT = sizeof(keys) / sizeof(keys[0]), THREADS = 4 };
+    size_t length = 300000 + 7;
+    char *message = malloc(length);
+    char *expected = malloc(2 * length);
+    char *encrypted = malloc(2 * length);
+    char *decrypted = malloc(length);
+    thread_pool *pool = thread_pool_create(THREADS);
+    int failures = 0;
+
+    if (!message || !expected || !encrypted || !decrypted || !pool) {
+        printf("\tERRO: Falha ao alocar memória ou criar o pool de threads.\n");
+        free(message); free(expected); free(encrypted); free(decrypted);
+        thread_pool_destroy(pool);
+        return;
+    }
+
+    // Mistura caracteres validos com quebras de linha e simbolos fora da matriz,
+    // para que os trechos de cada thread gerem quantidades diferentes de simbolos.
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 ,.\n#";
+    unsigned int seed = 12345;
+    for (size_t i = 0; i < length; i++) {
+        seed = seed * 1103515245u + 12345u;
+        message[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+
+    for (int k = 0; k < KEY_COUNT; k++) {
+        adfgvx_key_ctx key_ctx;
+        size_t expected_length = 0, encrypted_length = 0, decoded_length = 0, decrypted_length = 0;
+
+        adfgvx_key_ctx_init(&key_ctx, keys[k], strlen(keys[k]));
+        cipher_adfgvx_linear_ctx(&key_ctx, message, length, expected, 2 * length, &expected_length);
+        if (cipher_adfgvx_parallel(&key_ctx, message, length, encrypted, 2 * length, &encrypted_length, pool, 0) != 0 ||
+            encrypted_length != expected_length || memcmp(expected, encrypted, expected_length) != 0) {
+            failures++;
+        }
+
+        if (decipher_adfgvx_parallel(&key_ctx, encrypted, encrypted_length, decrypted, length, &decrypted_length, pool, 0) != 0 ||
+            decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, expected, length, &decoded_length) != 0 ||
+            decrypted_length != decoded_length || memcmp(expected, decrypted, decoded_length) != 0) {
+            failures++;
+        }
+
+        // Capacidade insuficiente: prefixo gravado e codigo 2, como na versao sequencial.
+        if (decipher_adfgvx_parallel(&key_ctx, encrypted, encrypted_length, decrypted, 1000, &decrypted_length, pool, 0) != 2 ||
+            decrypted_length != 1000 || memcmp(expected, decrypted, 1000) != 0) {
+            failures++;
+        }
+
+        // Par invalido no meio: a saida para no primeiro par invalido, com codigo 3.
+        encrypted[encrypted_length / 2 + 1] = 'Z';
+        int direct_status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, expected, length, &decoded_length);
+        int parallel_status = decipher_adfgvx_parallel(&key_ctx, encrypted, encrypted_length, decrypted, length, &decrypted_length, pool, 0);
+        if (direct_status != 3 || parallel_status != 3 || decrypted_length != decoded_length ||
+            memcmp(expected, decrypted, decoded_length) != 0) {
+            failures++;
+        }
+        adfgvx_key_ctx_free(&key_ctx);
+    }
+
+    printf("\t\t%lu bytes, %d chaves, %d threads\n", (unsigned long)length, KEY_COUNT, thread_pool_size(pool));
+    if (failures == 0) {
+        printf("\tSUCESSO: Versões paralelas idênticas às sequenciais.\n");
+    } else {
+        printf("\tERRO: %d divergências entre as versões paralelas e sequenciais.\n", failures);
+    }
+
+    thread_pool_destroy(pool);
+    free(message); free(expected); free(encrypted); free(decrypted);
+}
+
+/**
+ * @brief Testa o modo de registros: cada linha cifrada independentemente, saida na
+ * mesma ordem, linhas vazias preservadas e registros invalidos viram linhas vazias.
+ */
+static void test_records_mode()
+{
+    printf("\n-> Teste: Modo de Registros (uma Mensagem por Linha)\n");
+    char key[] = "CHAVE";
+    enum { LINES = 20000 };
+    adfgvx_key_ctx key_ctx;
+    adfgvx_records_stats cipher_stats, decipher_stats;
+    thread_pool *pool = thread_pool_create(4);
+    FILE *plain = tmpfile();
+    FILE *encrypted = tmpfile();
+    FILE *decrypted = tmpfile();
+    int failures = 0;
+
+    if (!pool || !plain || !encrypted || !decrypted || adfgvx_key_ctx_init(&key_ctx, key, strlen(key)) != 0) {
+        printf("\tERRO: Não foi possível preparar o teste.\n");
+        thread_pool_destroy(pool);
+        if (plain) fclose(plain);
+        if (encrypted) fclose(encrypted);
+        if (decrypted) fclose(decrypted);
+        return;
+    }
+
+    // Linhas de tamanhos variados, com "\r\n" em algumas e uma linha vazia a cada 100;
+    // a ultima linha nao termina em quebra de linha.
+    for (int i = 0; i < LINES; i++) {
+        if (i % 100 == 0) {
+            fputs(i % 200 == 0 ? "\r\n" : "\n", plain);
+        } else {
+            fprintf(plain, "REGISTRO %d CAMPO %d%s", i, i * 7, i + 1 == LINES ? "" : (i % 3 == 0 ? "\r\n" : "\n"));
+        }
+    }
+    rewind(plain);
+
+    failures += adfgvx_process_records(plain, encrypted, &key_ctx, ADFGVX_RECORDS_ENCRYPT, pool, &cipher_stats) != 0;
+    fputs("ADF\n", encrypted); // Registro invalido (numero impar de simbolos).
+    rewind(encrypted);
+    failures += adfgvx_process_records(encrypted, decrypted, &key_ctx, ADFGVX_RECORDS_DECRYPT, pool, &decipher_stats) != 0;
+    failures += cipher_stats.records != LINES || decipher_stats.records != LINES + 1 || decipher_stats.failed != 1;
+
+    // Confere cada linha cifrada contra cipher_adfgvx_linear e cada linha decifrada contra a original.
+    rewind(plain);
+    rewind(encrypted);
+    rewind(decrypted);
+    char original[64], cipher_line[256], plain_line[64], expected[256];
+    for (int i = 0; i < LINES && failures == 0; i++) {
+        size_t expected_length = 0;
+
+        if (!fgets(original, sizeof(original), plain) || !fgets(cipher_line, sizeof(cipher_line), encrypted) ||
+            !fgets(plain_line, sizeof(plain_line), decrypted)) {
+            failures++;
+            break;
+        }
+        original[strcspn(original, "\r\n")] = '\0';
+        cipher_line[strcspn(cipher_line, "\n")] = '\0';
+        plain_line[strcspn(plain_line, "\n")] = '\0';
+
+        cipher_adfgvx_linear(key, strlen(key), original, strlen(original), expected, sizeof(expected), &expected_length);
+        if (expected_length != strlen(cipher_line) || memcmp(expected, cipher_line, expected_length) != 0) {
+            failures++;
+        }
+
+        // A decifragem devolve a linha sem os caracteres fora da matriz Polybius.
+        size_t kept = 0;
+        for (size_t j = 0; original[j] != '\0'; j++) {
+            if (adfgvx_encode_table[(unsigned char)original[j]][0] != 0) {
+                original[kept++] = original[j];
+            }
+        }
+        original[kept] = '\0';
+        if (strcmp(original, plain_line) != 0) {
+            failures++;
+        }
+    }
+    if (!fgets(plain_line, sizeof(plain_line), decrypted) || strcmp(plain_line, "\n") != 0) {
+        failures++; // A linha invalida deve virar uma linha vazia.
+    }
+
+    printf("\t\tChave: \"%s\", %d registros, %d threads\n", key, LINES, thread_pool_size(pool));
+    if (failures == 0) {
+        printf("\tSUCESSO: Registros cifrados e decifrados linha a linha, na ordem original.\n");
+    } else {
+        printf("\tERRO: %d falhas no modo de registros.\n", failures);
+    }
+
+    adfgvx_key_ctx_free(&key_ctx);
+    thread_pool_destroy(pool);
+    fclose(plain);
+    fclose(encrypted);
+    fclose(decrypted);
+}
+
+/**
+ * @brief Testa a camada de arquivos mapeados: saida dimensionada pelo maximo e ajustada
+ * ao tamanho real no fechamento, e leitura de volta pelo mapeamento de entrada.
+ */
+static void test_mapped_files()
+{
+    printf("\n-> Teste: Arquivos Mapeados em Memória (%s)\n", FILE_OPERATIONS_HAVE_MMAP ? "mmap" : "buffers");
+    const char *path = "./mapped_io_test.tmp";
+    char key[] = "SEMB2025";
+    const char *message = "ARQUIVO MAPEADO, GRAVADO DIRETO NAS PAGINAS DE SAIDA 2025.";
+    size_t length = strlen(message);
+    char expected[256];
+    size_t expected_length = 0, encrypted_length = 0;
+    adfgvx_key_ctx key_ctx;
+    mapped_file output, input;
+    int failures = 0;
+
+    adfgvx_key_ctx_init(&key_ctx, key, strlen(key));
+    cipher_adfgvx_linear(key, strlen(key), message, length, expected, sizeof(expected), &expected_length);
+
+    if (map_output_file(path, 2 * length, &output) != 0) {
+        printf("\tERRO: Não foi possível criar o arquivo mapeado.\n");
+        adfgvx_key_ctx_free(&key_ctx);
+        return;
+    }
+    failures += cipher_adfgvx_linear_ctx(&key_ctx, message, length, output.data, output.length, &encrypted_length) != 0;
+    failures += close_mapped_file(&output, encrypted_length) != 0;
+
+    if (map_input_file(path, &input) != 0) {
+        failures++;
+    } else {
+        if (input.length != expected_length || memcmp(input.data, expected, expected_length) != 0) {
+            failures++;
+        }
+        close_mapped_file(&input, 0);
+    }
+    remove(path);
+
+    printf("\t\tMensagem: \"%s\" (%lu simbolos)\n", message, (unsigned long)expected_length);
+    if (failures == 0) {
+        printf("\tSUCESSO: Texto cifrado gravado no mapeamento e lido de volta com o tamanho real.\n");
+    } else {
+        printf("\tERRO: %d falhas nos arquivos mapeados.\n", failures);
+    }
+    adfgvx_key_ctx_free(&key_ctx);
+}
+
+/**
+ * @brief Testa a decifragem de trechos: decipher_adfgvx_range_ctx (memoria) e
+ * decipher_adfgvx_file_range (leituras posicionadas) devem produzir o mesmo trecho da
+ * decifragem completa, inclusive nas bordas, e os mesmos codigos de erro.
+ */
+static void test_range_decrypt()
+{
+    printf("\n-> Teste: Decifragem de Trechos (Acesso Aleatório)\n");
+    const char *path = "./range_test.tmp";
+    const char *keys[] = {"A", "UM", "CHAVE", "SEMB2025"};
+    enum { KEY_COUNT = sizeof(keys) / sizeof(keys[0]) };
+    const size_t ranges[][2] = {{0, 1}, {0, 50}, {1, 7}, {12345, 4096}, {49990, 100}, {49999, 1}, {50000, 10}, {777, 0}};
+    size_t length = 50000;
+    char *message = malloc(length);
+    char *encrypted = malloc(2 * length);
+    char *full = malloc(length);
+    char slice[8192];
+    int failures = 0, checks = 0;
+
+    if (!message || !encrypted || !full) {
+        printf("\tERRO: Falha ao alocar memória.\n");
+        free(message); free(encrypted); free(full);
+        return;
+    }
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567 ,.";
+    unsigned int seed = 777;
+    for (size_t i = 0; i < length; i++) {
+        seed = seed * 1103515245u + 12345u;
+        message[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+
+    for (int k = 0; k < KEY_COUNT; k++) {
+        adfgvx_key_ctx key_ctx;
+        size_t encrypted_length = 0, full_length = 0, slice_length = 0;
+
+        adfgvx_key_ctx_init(&key_ctx, keys[k], strlen(keys[k]));
+        cipher_adfgvx_linear_ctx(&key_ctx, message, length, encrypted, 2 * length, &encrypted_length);
+        decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, full, length, &full_length);
+        write_buffer_to_file(path, encrypted, encrypted_length);
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            failures++;
+            continue;
+        }
+
+        for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+            size_t offset = ranges[r][0], count = ranges[r][1];
+            size_t expected = offset + count <= full_length ? count : full_length - offset;
+
+            checks += 2;
+            if (decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, offset, count, slice, sizeof(slice), &slice_length) != 0 ||
+                slice_length != expected || memcmp(slice, full + offset, expected) != 0) {
+                failures++;
+            }
+            memset(slice, 0, sizeof(slice));
+            if (decipher_adfgvx_file_range(&key_ctx, file, encrypted_length, offset, count, slice, sizeof(slice), &slice_length) != 0 ||
+                slice_length != expected || memcmp(slice, full + offset, expected) != 0) {
+                failures++;
+            }
+        }
+
+        // Capacidade insuficiente (inicio do trecho e codigo 2) e offset depois do fim (codigo 1).
+        checks += 3;
+        failures += decipher_adfgvx_file_range(&key_ctx, file, encrypted_length, 100, 500, slice, 10, &slice_length) != 2 ||
+                    slice_length != 10 || memcmp(slice, full + 100, 10) != 0;
+        failures += decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, full_length + 1, 1, slice, sizeof(slice), &slice_length) != 1;
+        failures += decipher_adfgvx_file_range(&key_ctx, file, encrypted_length, full_length + 1, 1, slice, sizeof(slice), &slice_length) != 1;
+        fclose(file);
+        adfgvx_key_ctx_free(&key_ctx);
+    }
+    remove(path);
+
+    printf("\t\t%d verificações, %d chaves\n", checks, KEY_COUNT);
+    if (failures == 0) {
+        printf("\tSUCESSO: Trechos idênticos aos da decifragem completa.\n");
+    } else {
+        printf("\tERRO: %d divergências na decifragem de trechos.\n", failures);
+    }
+    free(message); free(encrypted); free(full);
+}
+
+/**
+ * @brief Testa chaves longas (bem mais colunas que ADFGVX_KEY_STACK_COLUMNS, ate
+ * MAX_KEY_LENGTH - 1): a ordem das colunas deve ser a mesma da ordenacao por insercao
+ * usada antes, e a cifragem e as decifragens (completa, paralela e de trechos) devem
+ * fazer a ida e volta da mensagem. Chaves acima do limite devem ser recusadas.
+ */
+static void test_long_keys()
+{
+    printf("\n-> Teste: Chaves Longas (Milhares de Colunas)\n");
+    const char *path = "./long_key_test.tmp";
+    const int key_lengths[] = {33, 1000, MAX_KEY_LENGTH - 1};
+    enum { KEY_COUNT = sizeof(key_lengths) / sizeof(key_lengths[0]), THREADS = 4 };
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ,.1234567"; // So caracteres da matriz.
+    size_t length = 200000 + 3;
+    char *message = malloc(length);
+    char *encrypted = malloc(2 * length);
+    char *parallel = malloc(2 * length);
+    char *decrypted = malloc(length);
+    char *key = malloc(MAX_KEY_LENGTH);
+    int *reference = malloc(MAX_KEY_LENGTH * sizeof(int));
+    thread_pool *pool = thread_pool_create(THREADS);
+    int failures = 0;
+
+    if (!message || !encrypted || !parallel || !decrypted || !key || !reference || !pool) {
+        printf("\tERRO: Falha ao alocar memória ou criar o pool de threads.\n");
+        free(message); free(encrypted); free(parallel); free(decrypted); free(key); free(reference);
+        thread_pool_destroy(pool);
+        return;
+    }
+
+    unsigned int seed = 4096;
+    for (size_t i = 0; i < length; i++) {
+        seed = seed * 1103515245u + 12345u;
+        message[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+
+    for (int k = 0; k < KEY_COUNT; k++) {
+        int key_length = key_lengths[k];
+        adfgvx_key_ctx key_ctx;
+        size_t encrypted_length = 0, parallel_length = 0, decrypted_length = 0;
+
+        // Chave com muitos caracteres repetidos e alguns fora do ASCII (char negativo).
+        for (int i = 0; i < key_length; i++) {
+            seed = seed * 1103515245u + 12345u;
+            key[i] = (seed >> 16) % 8 == 0 ? (char)(0xC0 + (seed >> 20) % 32) : alphabet[(seed >> 16) % 26];
+        }
+        key[key_length] = '\0';
+
+        // Referencia: ordenacao por insercao, estavel, comparando char como antes.
+        for (int i = 0; i < key_length; i++) {
+            int j = i;
+            while (j > 0 && key[reference[j - 1]] > key[i]) {
+                reference[j] = reference[j - 1];
+                j--;
+            }
+            reference[j] = i;
+        }
+
+        if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0) {
+            failures++;
+            continue;
+        }
+        failures += memcmp(key_ctx.column_order, reference, key_length * sizeof(int)) != 0;
+
+        failures += cipher_adfgvx_linear_ctx(&key_ctx, message, length, encrypted, 2 * length, &encrypted_length) != 0 ||
+                    encrypted_length != 2 * length;
+        failures += cipher_adfgvx_parallel(&key_ctx, message, length, parallel, 2 * length, &parallel_length, pool, 0) != 0 ||
+                    parallel_length != encrypted_length || memcmp(parallel, encrypted, encrypted_length) != 0;
+        failures += decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, decrypted, length, &decrypted_length) != 0 ||
+                    decrypted_length != length || memcmp(decrypted, message, length) != 0;
+        memset(decrypted, 0, length);
+        failures += decipher_adfgvx_parallel(&key_ctx, encrypted, encrypted_length, decrypted, length, &decrypted_length, pool, 0) != 0 ||
+                    decrypted_length != length || memcmp(decrypted, message, length) != 0;
+
+        // Trechos: da memoria e do arquivo, comecando no meio de uma linha da transposicao.
+        write_buffer_to_file(path, encrypted, encrypted_length);
+        FILE *file = fopen(path, "rb");
+        size_t offset = length / 3 + 1, count = 5000;
+        failures += decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, offset, count, decrypted, length, &decrypted_length) != 0 ||
+                    decrypted_length != count || memcmp(decrypted, message + offset, count) != 0;
+        failures += file == NULL ||
+                    decipher_adfgvx_file_range(&key_ctx, file, encrypted_length, offset, count, decrypted, length, &decrypted_length) != 0 ||
+                    decrypted_length != count || memcmp(decrypted, message + offset, count) != 0;
+        if (file) fclose(file);
+        adfgvx_key_ctx_free(&key_ctx);
+    }
+    remove(path);
+
+    // Limites: MAX_KEY_LENGTH colunas na chave, ADFGVX_STREAM_MAX_KEY_LENGTH no fluxo.
+    adfgvx_key_ctx rejected;
+    adfgvx_cipher_stream cipher_stream;
+    memset(key, 'K', MAX_KEY_LENGTH);
+    failures += adfgvx_key_ctx_init(&rejected, key, MAX_KEY_LENGTH) != 1;
+    failures += adfgvx_cipher_stream_init(&cipher_stream, key, ADFGVX_STREAM_MAX_KEY_LENGTH + 1) != 1;
+
+    printf("\t\t%lu caracteres, chaves de %d, %d e %d colunas, %d threads\n", (unsigned long)length,
+           key_lengths[0], key_lengths[1], key_lengths[2], thread_pool_size(pool));
+    if (failures == 0) {
+        printf("\tSUCESSO: Chaves longas com a mesma ordem de colunas e ida e volta correta.\n");
+    } else {
+        printf("\tERRO: %d falhas com chaves longas.\n", failures);
+    }
+
+    thread_pool_destroy(pool);
+    free(message); free(encrypted); free(parallel); free(decrypted); free(key); free(reference);
+}
+
+/**
+ * @brief Testa as chamadas com arena: numa arena fixa (buffer estatico) e numa do heap
+ * reutilizada por muitas chamadas com chaves diferentes, o resultado deve ser o mesmo de
+ * cipher_adfgvx_linear / decipher_adfgvx_direct; a arena do heap so cresce na primeira
+ * chamada com a maior chave, e uma arena fixa pequena demais deve ser recusada.
+ */
+static void test_workspace()
+{
+    printf("\n-> Teste: Arena Reutilizavel (cipher_adfgvx_ws / decipher_adfgvx_ws)\n");
+    static unsigned char fixed_buffer[ADFGVX_WORKSPACE_KEY_BYTES(16)];
+    unsigned char tiny_buffer[ADFGVX_WORKSPACE_KEY_BYTES(2)];
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ,.1234567";
+    enum { LENGTH = 300, CALLS = 1000, LONG_KEY = 2000 };
+    char message[LENGTH], expected[2 * LENGTH], encrypted[2 * LENGTH], decrypted[LENGTH];
+    char key[LONG_KEY];
+    adfgvx_workspace fixed, heap, tiny;
+    size_t expected_length = 0, encrypted_length = 0, decrypted_length = 0;
+    int failures = 0;
+
+    if (adfgvx_workspace_init(&fixed, fixed_buffer, sizeof(fixed_buffer)) != 0 ||
+        adfgvx_workspace_init(&heap, NULL, 0) != 0 ||
+        adfgvx_workspace_init(&tiny, tiny_buffer, sizeof(tiny_buffer)) != 0) {
+        printf("\tERRO: Não foi possível inicializar as arenas.\n");
+        return;
+    }
+
+    unsigned int seed = 17;
+    for (int i = 0; i < LONG_KEY; i++) {
+        seed = seed * 1103515245u + 12345u;
+        key[i] = alphabet[(seed >> 16) % 26];
+    }
+    for (int i = 0; i < LENGTH; i++) {
+        message[i] = alphabet[(i * 7 + i / 11) % (sizeof(alphabet) - 1)];
+    }
+
+    // Muitas mensagens curtas, cada uma com a sua chave (1 a 16 colunas), nas duas arenas.
+    size_t heap_capacity = 0;
+    for (int n = 0; n < CALLS; n++) {
+        int key_length = 1 + n % 16;
+        size_t message_length = 1 + (size_t)(n * 37) % LENGTH;
+        const char *call_key = key + n % 64;
+
+        failures += cipher_adfgvx_linear(call_key, key_length, message, message_length, expected, sizeof(expected), &expected_length) != 0;
+        failures += cipher_adfgvx_ws(&fixed, call_key, key_length, message, message_length, encrypted, sizeof(encrypted), &encrypted_length) != 0 ||
+                    encrypted_length != expected_length || memcmp(encrypted, expected, expected_length) != 0;
+        failures += decipher_adfgvx_ws(&fixed, encrypted, encrypted_length, call_key, key_length, decrypted, sizeof(decrypted), &decrypted_length) != 0 ||
+                    decrypted_length != message_length || memcmp(decrypted, message, message_length) != 0;
+        failures += cipher_adfgvx_ws(&heap, call_key, key_length, message, message_length, encrypted, sizeof(encrypted), &encrypted_length) != 0 ||
+                    encrypted_length != expected_length || memcmp(encrypted, expected, expected_length) != 0;
+        failures += decipher_adfgvx_ws(&heap, encrypted, encrypted_length, call_key, key_length, decrypted, sizeof(decrypted), &decrypted_length) != 0 ||
+                    decrypted_length != message_length || memcmp(decrypted, message, message_length) != 0;
+        if (n == 15) {
+            heap_capacity = heap.capacity; // Depois da maior chave a arena nao deve mudar.
+        }
+        failures += n > 15 && heap.capacity != heap_capacity;
+        failures += adfgvx_workspace_mark(&fixed) != 0 || adfgvx_workspace_mark(&heap) != 0;
+    }
+
+    // Chave longa: a arena do heap cresce (vazia entre as chamadas); a fixa recusa.
+    size_t long_length = 0;
+    char *long_encrypted = malloc(2 * LENGTH);
+    failures += long_encrypted == NULL ||
+                cipher_adfgvx_linear(key, LONG_KEY, message, LENGTH, long_encrypted, 2 * LENGTH, &long_length) != 0 ||
+                cipher_adfgvx_ws(&heap, key, LONG_KEY, message, LENGTH, encrypted, sizeof(encrypted), &encrypted_length) != 0 ||
+                encrypted_length != long_length || memcmp(encrypted, long_encrypted, long_length) != 0;
+    failures += decipher_adfgvx_ws(&heap, encrypted, encrypted_length, key, LONG_KEY, decrypted, sizeof(decrypted), &decrypted_length) != 0 ||
+                decrypted_length != LENGTH || memcmp(decrypted, message, LENGTH) != 0;
+    failures += heap.capacity < ADFGVX_WORKSPACE_KEY_BYTES(LONG_KEY);
+    failures += cipher_adfgvx_ws(&fixed, key, LONG_KEY, message, LENGTH, encrypted, sizeof(encrypted), &encrypted_length) != 3;
+    failures += cipher_adfgvx_ws(&tiny, key, 16, message, LENGTH, encrypted, sizeof(encrypted), &encrypted_length) != 3;
+    failures += decipher_adfgvx_ws(&tiny, long_encrypted, 32, key, 16, decrypted, sizeof(decrypted), &decrypted_length) != 4;
+    free(long_encrypted);
+
+    // Contexto de chave na arena: nao e dono das tabelas, adfgvx_key_ctx_free nao as libera.
+    adfgvx_key_ctx key_ctx;
+    size_t mark = adfgvx_workspace_mark(&heap);
+    failures += adfgvx_key_ctx_init_ws(&key_ctx, key, 8, &heap) != 0 || key_ctx.owns_tables != 0;
+    adfgvx_key_ctx_free(&key_ctx);
+    adfgvx_workspace_release(&heap, mark);
+    failures += adfgvx_workspace_mark(&heap) != mark;
+
+    printf("\t\t%d chamadas por arena, arena fixa de %lu bytes, arena do heap com %lu bytes\n", CALLS,
+           (unsigned long)sizeof(fixed_buffer), (unsigned long)heap.capacity);
+    if (failures == 0) {
+        printf("\tSUCESSO: Arenas com os mesmos resultados das chamadas comuns, sem crescer após a maior chave.\n");
+    } else {
+        printf("\tERRO: %d falhas nas chamadas com arena.\n", failures);
+    }
+
+    adfgvx_workspace_free(&fixed);
+    adfgvx_workspace_free(&heap);
+    adfgvx_workspace_free(&tiny);
+}
+
+/**
+ * @brief Testa o formato em blocos: escrita em fluxo com um pool, abertura, decifragem
+ * completa e de um bloco isolado, e deteccao de arquivos truncados ou que nao sao containers.
+ */
+static void test_container()
+{
+    printf("\n-> Teste: Formato em Blocos (Container)\n");
+    char key[] = "BLOCOS";
+    enum { LENGTH = 60000, BLOCK = 1000, CHUNK = 777 };
+    adfgvx_key_ctx key_ctx;
+    adfgvx_container_writer writer;
+    adfgvx_container container;
+    thread_pool *pool = thread_pool_create(3);
+    FILE *file = tmpfile();
+    FILE *decrypted = tmpfile();
+    FILE *truncated = tmpfile();
+    char *message = malloc(LENGTH);
+    char *expected = malloc(LENGTH);
+    char *buffer = malloc(2 * LENGTH);
+    size_t expected_length = 0;
+    int failures = 0;
+
+    if (!pool || !file || !decrypted || !truncated || !message || !expected || !buffer ||
+        adfgvx_key_ctx_init(&key_ctx, key, strlen(key)) != 0) {
+        printf("\tERRO: Não foi possível preparar o teste.\n");
+        thread_pool_destroy(pool);
+        if (file) fclose(file);
+        if (decrypted) fclose(decrypted);
+        if (truncated) fclose(truncated);
+        free(message); free(expected); free(buffer);
+        return;
+    }
+
+    // Mensagem com quebras de linha e minusculas (fora da matriz, ignoradas pela cifra).
+    for (size_t i = 0; i < LENGTH; i++) {
+        message[i] = i % 61 == 60 ? '\n' : "ABCDEFGHIJKLMNOPQRSTUVWXYZ 1234567,.abc"[(i * 7 + i / 13) % 39];
+        if (adfgvx_encode_table[(unsigned char)message[i]][0] != 0) {
+            expected[expected_length++] = message[i];
+        }
+    }
+
+    failures += adfgvx_container_writer_init(&writer, file, &key_ctx, BLOCK, pool) != 0;
+    for (size_t i = 0; i < LENGTH && failures == 0; i += CHUNK) {
+        failures += adfgvx_container_writer_update(&writer, message + i, LENGTH - i < CHUNK ? LENGTH - i : CHUNK) != 0;
+    }
+    failures += adfgvx_container_writer_final(&writer) != 0;
+
+    // Abertura e decifragem completa (sequencial e com o pool).
+    if (failures == 0 && adfgvx_container_open(&container, file) == 0) {
+        size_t read = 0, block_length = 0;
+
+        failures += container.message_length != expected_length || container.block_count != (expected_length + BLOCK - 1) / BLOCK;
+        failures += adfgvx_container_decrypt(&container, &key_ctx, decrypted, pool) != 0;
+        rewind(decrypted);
+        read = fread(buffer, 1, 2 * LENGTH, decrypted);
+        failures += read != expected_length || memcmp(buffer, expected, expected_length) != 0;
+
+        // Bloco isolado (o bloco N comeca no caractere N * BLOCK) e o ultimo, incompleto.
+        failures += adfgvx_container_decrypt_block(&container, &key_ctx, 17, buffer, BLOCK, &block_length) != 0 ||
+                    block_length != BLOCK || memcmp(buffer, expected + 17 * BLOCK, BLOCK) != 0;
+        size_t last = container.block_count - 1;
+        failures += adfgvx_container_decrypt_block(&container, &key_ctx, last, buffer, BLOCK, &block_length) != 0 ||
+                    block_length != expected_length - last * BLOCK || memcmp(buffer, expected + last * BLOCK, block_length) != 0;
+        failures += adfgvx_container_decrypt_block(&container, &key_ctx, container.block_count, buffer, BLOCK, &block_length) != 1;
+        adfgvx_container_close(&container);
+    } else {
+        failures++;
+    }
+
+    // Copia do container sem os ultimos bytes: o rodape some e a abertura falha sem decifrar.
+    size_t file_size = 0;
+    if (failures == 0 && get_file_size(file, &file_size) == 0 && file_size <= 2 * LENGTH &&
+        read_file_at(file, 0, buffer, file_size) == 0) {
+        fwrite(buffer, 1, file_size - 5, truncated);
+        fflush(truncated);
+        failures += adfgvx_container_open(&container, truncated) != 4;
+    } else {
+        failures++;
+    }
+    rewind(decrypted); // Texto plano: nao e um container.
+    failures += adfgvx_container_open(&container, decrypted) != 3;
+
+    printf("\t\t%lu caracteres, blocos de %d, %d threads\n", (unsigned long)expected_length, BLOCK, thread_pool_size(pool));
+    if (failures == 0) {
+        printf("\tSUCESSO: Container escrito, decifrado por inteiro e por bloco, truncamento detectado.\n");
+    } else {
+        printf("\tERRO: %d falhas no formato em blocos.\n", failures);
+    }
+
+    adfgvx_key_ctx_free(&key_ctx);
+    thread_pool_destroy(pool);
+    fclose(file); fclose(decrypted); fclose(truncated);
+    free(message); free(expected); free(buffer);
+}
+
+/**
+ * @brief Estado do estagio de processamento usado em test_pipeline (como no modo filtro).
+ */
+typedef struct {
+    int decrypt;
+    const adfgvx_key_ctx *key_ctx;
+    thread_pool *pool;
+    adfgvx_container_writer writer;
+    adfgvx_container_reader reader;
+    int started;
+    adfgvx_pipeline_buffer *output;
+} pipeline_test_state;
+
+/**
+ * @brief Entrega os bytes do contexto do container a saida do bloco atual do pipeline.
+ * (Função auxiliar estática, usada como adfgvx_container_sink)
+ */
+static int pipeline_test_sink(void *user, const char *data, size_t length)
+{
+    return adfgvx_pipeline_buffer_append(((pipeline_test_state *)user)->output, data, length);
+}
+
+/**
+ * @brief Cifra (writer) ou decifra (reader) cada bloco recebido do pipeline.
+ * (Função auxiliar estática, usada como adfgvx_pipeline_stage)
+ */
+static int pipeline_test_stage(void *user, const char *input, size_t length, int last, adfgvx_pipeline_buffer *output)
+{
+    pipeline_test_state *state = user;
+    int status = 0;
+
+    state->output = output;
+    if (!state->started) {
+        status = state->decrypt ? adfgvx_container_reader_init(&state->reader, pipeline_test_sink, state, state->key_ctx, state->pool)
+                                : adfgvx_container_writer_init_sink(&state->writer, pipeline_test_sink, state, state->key_ctx, 1000, state->pool);
+        if (status != 0) {
+            return status;
+        }
+        state->started = 1;
+    }
+    status = state->decrypt ? adfgvx_container_reader_update(&state->reader, input, length)
+                            : adfgvx_container_writer_update(&state->writer, input, length);
+    if (status != 0 || last) {
+        state->started = 0;
+        int final_status = state->decrypt ? adfgvx_container_reader_final(&state->reader)
+                                          : adfgvx_container_writer_final(&state->writer);
+        status = status != 0 ? status : final_status;
+    }
+    return status;
+}
+
+/**
+ * @brief Testa o pipeline do modo filtro: cifragem para o formato em blocos (igual ao
+ * gravado por adfgvx_container_writer_init), decifragem sequencial do container com blocos
+ * de leitura de outro tamanho, e deteccao de um container truncado.
+ */
+static void test_pipeline()
+{
+    printf("\n-> Teste: Pipeline do Modo Filtro (adfgvx_pipeline_run)\n");
+    char key[] = "FILTRO";
+    enum { LENGTH = 200000, READ_BLOCK = 4099, DEPTH = 3 };
+    adfgvx_key_ctx key_ctx;
+    adfgvx_container_writer writer;
+    adfgvx_pipeline_stats stats;
+    pipeline_test_state state;
+    thread_pool *pool = thread_pool_create(3);
+    FILE *plain = tmpfile();
+    FILE *encrypted = tmpfile();
+    FILE *reference = tmpfile();
+    FILE *decrypted = tmpfile();
+    FILE *truncated = tmpfile();
+    char *message = malloc(LENGTH);
+    char *expected = malloc(LENGTH);
+    char *buffer = malloc(2 * LENGTH);
+    char *other = malloc(2 * LENGTH);
+    size_t expected_length = 0, encrypted_size = 0, reference_size = 0;
+    int failures = 0;
+
+    if (!pool || !plain || !encrypted || !reference || !decrypted || !truncated || !message || !expected || !buffer || !other ||
+        adfgvx_key_ctx_init(&key_ctx, key, strlen(key)) != 0) {
+        printf("\tERRO: Não foi possível preparar o teste.\n");
+        thread_pool_destroy(pool);
+        if (plain) fclose(plain);
+        if (encrypted) fclose(encrypted);
+        if (reference) fclose(reference);
+        if (decrypted) fclose(decrypted);
+        if (truncated) fclose(truncated);
+        free(message); free(expected); free(buffer); free(other);
+        return;
+    }
+
+    for (size_t i = 0; i < LENGTH; i++) {
+        message[i] = i % 71 == 70 ? '\n' : "ABCDEFGHIJKLMNOPQRSTUVWXYZ 1234567,.xyz"[(i * 11 + i / 17) % 39];
+        if (adfgvx_encode_table[(unsigned char)message[i]][0] != 0) {
+            expected[expected_length++] = message[i];
+        }
+    }
+    fwrite(message, 1, LENGTH, plain);
+    rewind(plain);
+
+    // Cifragem pelo pipeline e, para comparacao, pelo contexto de escrita direto no arquivo.
+    memset(&state, 0, sizeof(state));
+    state.key_ctx = &key_ctx;
+    state.pool = pool;
+    failures += adfgvx_pipeline_run(plain, encrypted, READ_BLOCK, DEPTH, pipeline_test_stage, &state, &stats) != 0;
+    failures += stats.input_bytes != LENGTH || stats.blocks != LENGTH / READ_BLOCK + 1;
+    failures += adfgvx_container_writer_init(&writer, reference, &key_ctx, 1000, pool) != 0 ||
+                adfgvx_container_writer_update(&writer, message, LENGTH) != 0 ||
+                adfgvx_container_writer_final(&writer) != 0;
+    failures += get_file_size(encrypted, &encrypted_size) != 0 || get_file_size(reference, &reference_size) != 0 ||
+                encrypted_size != reference_size || encrypted_size > 2 * LENGTH || encrypted_size != stats.output_bytes ||
+                read_file_at(encrypted, 0, buffer, encrypted_size) != 0 || read_file_at(reference, 0, other, reference_size) != 0 ||
+                memcmp(buffer, other, encrypted_size) != 0;
+
+    // Decifragem sequencial do container, com blocos de leitura menores que a fila.
+    if (failures == 0) {
+        memset(&state, 0, sizeof(state));
+        state.decrypt = 1;
+        state.key_ctx = &key_ctx;
+        state.pool = pool;
+        rewind(encrypted);
+        failures += adfgvx_pipeline_run(encrypted, decrypted, 777, 2, pipeline_test_stage, &state, &stats) != 0;
+        rewind(decrypted);
+        size_t read = fread(other, 1, 2 * LENGTH, decrypted);
+        failures += read != expected_length || memcmp(other, expected, expected_length) != 0;
+
+        // Sem os ultimos bytes (rodape incompleto): o estagio falha com o codigo de truncamento.
+        fwrite(buffer, 1, encrypted_size - 5, truncated);
+        rewind(truncated);
+        memset(&state, 0, sizeof(state));
+        state.decrypt = 1;
+        state.key_ctx = &key_ctx;
+        failures += adfgvx_pipeline_run(truncated, decrypted, READ_BLOCK, DEPTH, pipeline_test_stage, &state, &stats) != 5 ||
+                    stats.stage_status != 4;
+    }
+    failures += adfgvx_pipeline_run(plain, encrypted, READ_BLOCK, 1, pipeline_test_stage, &state, &stats) != 1;
+
+    printf("\t\t%lu caracteres, leitura em blocos de %d, fila de %d\n", (unsigned long)expected_length, READ_BLOCK, DEPTH);
+    if (failures == 0) {
+        printf("\tSUCESSO: Pipeline gera o mesmo container, decifra em fluxo e detecta o truncamento.\n");
+    } else {
+        printf("\tERRO: %d falhas no pipeline do modo filtro.\n", failures);
+    }
+
+    adfgvx_key_ctx_free(&key_ctx);
+    thread_pool_destroy(pool);
+    fclose(plain); fclose(encrypted); fclose(reference); fclose(decrypted); fclose(truncated);
+    free(message); free(expected); free(buffer); free(other);
+}
+
+/**
+ * @brief Executa o servico ate adfgvx_service_stop (thread auxiliar de test_service).
+ */
+static void *service_thread(void *arg)
+{
+    adfgvx_service_run((adfgvx_service *)arg, NULL);
+    return NULL;
+}
+
+/**
+ * @brief Requisicao feita numa thread auxiliar de test_service, para que o teste possa
+ * desistir de esperar a resposta em vez de travar.
+ */
+typedef struct {
+    int fd;
+    const char *key;
+    const char *message;
+    size_t length;
+    char *output;
+    size_t capacity;
+    size_t output_length;
+    int status;
+    int result;
+    int done;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} service_client_call;
+
+static void *service_client_thread(void *arg)
+{
+    service_client_call *call = arg;
+    int result = adfgvx_service_request(call->fd, ADFGVX_SERVICE_ENCRYPT, call->key, (int)strlen(call->key), call->message,
+                                        call->length, call->output, call->capacity, &call->output_length, &call->status);
+    pthread_mutex_lock(&call->lock);
+    call->result = result;
+    call->done = 1;
+    pthread_cond_signal(&call->finished);
+    pthread_mutex_unlock(&call->lock);
+    return NULL;
+}
+
+/**
+ * @brief Testa o servico local: duas conexoes enviam requisicoes sem esperar as respostas,
+ * com tres chaves alternadas; as respostas voltam na ordem, iguais a cipher_adfgvx_linear,
+ * e a decifragem, os erros (texto cifrado invalido, cabecalho invalido) e as estatisticas
+ * tambem sao conferidos. Um cliente que envia mensagens grandes e nao le as respostas nao
+ * pode atrasar as outras conexoes nem impedir o fim do servico.
+ */
+static void test_service()
+{
+    printf("\n-> Teste: Servico Local (adfgvx_service)\n");
+    const char *path = "./adfgvx_test_service.sock";
+    const char *keys[3] = {"K", "SERVICO", "CHAVEMAISLONGADOQUEASOUTRAS"};
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ ,.1234567";
+    enum { LENGTH = 300, REQUESTS = 240, LARGE = 1 << 20, STALLED_REQUESTS = 4 };
+    char message[LENGTH], expected[2 * LENGTH], received[2 * LENGTH];
+    char *stats = malloc(65536);
+    adfgvx_service_config config = {path, 3, 16, 500, 1 << 20};
+    adfgvx_service *service = NULL;
+    pthread_t thread;
+    int fds[2] = {-1, -1};
+    int stalled = -1;
+    int failures = 0;
+
+    int status = adfgvx_service_open(&service, &config);
+    if (status == 4) {
+        printf("\tSUCESSO: Servico indisponível nesta plataforma (sem sockets UNIX); teste ignorado.\n");
+        free(stats);
+        return;
+    }
+    if (status != 0 || stats == NULL || pthread_create(&thread, NULL, service_thread, service) != 0) {
+        printf("\tERRO: Não foi possível iniciar o serviço (código %d).\n", status);
+        adfgvx_service_close(service);
+        free(stats);
+        return;
+    }
+    for (int i = 0; i < LENGTH; i++) {
+        message[i] = alphabet[(i * 13 + i / 7) % (sizeof(alphabet) - 1)];
+    }
+
+    failures += adfgvx_service_connect(path, &fds[0]) != 0 || adfgvx_service_connect(path, &fds[1]) != 0;
+    // Todas as requisicoes sao enviadas antes de ler as respostas: o servico as junta em lotes.
+    for (int n = 0; n < REQUESTS && failures == 0; n++) {
+        const char *key = keys[n % 3];
+        failures += adfgvx_service_send(fds[n % 2], ADFGVX_SERVICE_ENCRYPT, (unsigned int)n, key, (int)strlen(key),
+                                        message, 1 + (size_t)(n * 37) % LENGTH) != 0;
+    }
+    for (int n = 0; n < REQUESTS && failures == 0; n++) {
+        const char *key = keys[n % 3];
+        size_t length = 1 + (size_t)(n * 37) % LENGTH, expected_length = 0, received_length = 0;
+        unsigned int id = 0;
+        int result = 0;
+
+        failures += cipher_adfgvx_linear(key, (int)strlen(key), message, length, expected, sizeof(expected), &expected_length) != 0;
+        failures += adfgvx_service_receive(fds[n % 2], &id, &result, received, sizeof(received), &received_length) != 0 ||
+                    id != (unsigned int)n || result != ADFGVX_SERVICE_STATUS_OK || received_length != expected_length ||
+                    memcmp(received, expected, expected_length) != 0;
+    }
+    // Uma requisicao por vez: a decifragem de cada texto cifrado devolve a mensagem.
+    for (int n = 0; n < REQUESTS && failures == 0; n += 10) {
+        const char *key = keys[n % 3];
+        size_t length = 1 + (size_t)(n * 37) % LENGTH, encrypted_length = 0, decrypted_length = 0;
+        int result = 0;
+
+        failures += cipher_adfgvx_linear(key, (int)strlen(key), message, length, expected, sizeof(expected), &encrypted_length) != 0 ||
+                    adfgvx_service_request(fds[n % 2], ADFGVX_SERVICE_DECRYPT, key, (int)strlen(key), expected, encrypted_length,
+                                           received, sizeof(received), &decrypted_length, &result) != 0 ||
+                    result != 0 || decrypted_length != length || memcmp(received, message, length) != 0;
+    }
+
+    // Texto cifrado com numero impar de simbolos: status de erro da decifragem.
+    size_t length = 0;
+    int result = 0;
+    failures += adfgvx_service_request(fds[0], ADFGVX_SERVICE_DECRYPT, keys[1], 7, "ADF", 3, received, sizeof(received),
+                                       &length, &result) != 0 || result != ADFGVX_SERVICE_STATUS_CIPHER + 3;
+    failures += adfgvx_service_request(fds[0], ADFGVX_SERVICE_STATS, NULL, 0, NULL, 0, stats, 65535, &length, &result) != 0 ||
+                result != 0 || length == 0;
+    stats[failures == 0 ? length : 0] = '\0';
+    failures += strstr(stats, "\"requests\"") == NULL || strstr(stats, "\"p99\"") == NULL;
+    // Cifragem sem chave: cabecalho invalido, respondido e a conexao encerrada.
+    failures += adfgvx_service_request(fds[1], ADFGVX_SERVICE_ENCRYPT, NULL, 0, message, 10, received, sizeof(received),
+                                       &length, &result) != 0 || result != ADFGVX_SERVICE_STATUS_BAD_REQUEST;
+    failures += adfgvx_service_receive(fds[1], NULL, &result, received, sizeof(received), &length) != 3;
+
+    // Cliente que nao le: as respostas de 2 MiB nao cabem no socket e a escrita dessa conexao
+    // fica bloqueada. Uma requisicao na outra conexao deve ser respondida mesmo assim; se nao
+    // for em 5 s, o cliente parado e fechado para destravar o servico e o teste falha.
+    char *large = malloc(LARGE);
+    int answered = 0;
+    failures += large == NULL || adfgvx_service_connect(path, &stalled) != 0;
+    for (int i = 0; i < LARGE && failures == 0; i++) {
+        large[i] = alphabet[(i * 7 + i / 11) % (sizeof(alphabet) - 1)];
+    }
+    for (int n = 0; n < STALLED_REQUESTS && failures == 0; n++) {
+        failures += adfgvx_service_send(stalled, ADFGVX_SERVICE_ENCRYPT, (unsigned int)n, keys[1], 7, large, LARGE) != 0;
+    }
+    if (failures == 0) {
+        service_client_call call;
+        pthread_t client;
+        size_t expected_length = 0;
+
+        memset(&call, 0, sizeof(call));
+        call.fd = fds[0];
+        call.key = keys[2];
+        call.message = message;
+        call.length = LENGTH;
+        call.output = received;
+        call.capacity = sizeof(received);
+        pthread_mutex_init(&call.lock, NULL);
+        pthread_cond_init(&call.finished, NULL);
+        if (pthread_create(&client, NULL, service_client_thread, &call) == 0) {
+            struct timespec deadline = {time(NULL) + 5, 0};
+            pthread_mutex_lock(&call.lock);
+            while (!call.done && pthread_cond_timedwait(&call.finished, &call.lock, &deadline) == 0) {
+            }
+            answered = call.done;
+            pthread_mutex_unlock(&call.lock);
+            if (!answered) {
+                adfgvx_service_disconnect(stalled);
+                stalled = -1;
+            }
+            pthread_join(client, NULL);
+        }
+        failures += cipher_adfgvx_linear(keys[2], (int)strlen(keys[2]), message, LENGTH, expected, sizeof(expected),
+                                         &expected_length) != 0;
+        failures += !answered || call.result != 0 || call.status != 0 || call.output_length != expected_length ||
+                    memcmp(received, expected, expected_length) != 0;
+        pthread_cond_destroy(&call.finished);
+        pthread_mutex_destroy(&call.lock);
+    }
+
+    // O servico para com o cliente parado ainda conectado: as respostas que ele nao le sao
+    // descartadas depois de ADFGVX_SERVICE_DRAIN_MS.
+    adfgvx_service_disconnect(fds[0]);
+    adfgvx_service_disconnect(fds[1]);
+    adfgvx_service_stop(service);
+    pthread_join(thread, NULL);
+    adfgvx_service_close(service);
+    adfgvx_service_disconnect(stalled);
+    free(large);
+    FILE *leftover = fopen(path, "r");
+    failures += leftover != NULL; // O socket e removido ao fechar o servico.
+    if (leftover) fclose(leftover);
+
+    double mean_batch = 0;
+    const char *batches = strstr(stats, "\"mean_batch\"");
+    if (batches) sscanf(batches, "\"mean_batch\": %lf", &mean_batch);
+    printf("\t\t%d requisicoes em 2 conexoes, 3 chaves, lote medio de %.2f requisicoes\n", REQUESTS, mean_batch);
+    printf("\t\tcliente que nao le %d respostas de %d MiB: outra conexao %s\n", STALLED_REQUESTS, 2 * LARGE >> 20,
+           answered ? "respondida" : "sem resposta");
+    if (failures == 0) {
+        printf("\tSUCESSO: Respostas do serviço em ordem e iguais às chamadas diretas, erros e estatísticas corretos.\n");
+    } else {
+        printf("\tERRO: %d falhas no serviço local.\n", failures);
+    }
+    free(stats);
+}
+
+/**
+ * @brief Executa o harness diferencial com uma semente fixa: cada implementacao da cifragem
+ * e da decifragem deve produzir a mesma saida e o mesmo codigo que a referencia congelada.
+ */
+static void test_differential_harness()
+{
+    printf("\n-> Teste: Harness Diferencial contra a Referência (adfgvx_fuzz)\n");
+    enum { CASES = 400, MAX_LENGTH = 1000 };
+    unsigned char *data = malloc(ADFGVX_FUZZ_HEADER_SIZE + MAX_KEY_LENGTH + MAX_LENGTH);
+    thread_pool *pool = thread_pool_create(3);
+    adfgvx_fuzz_stats stats = {0, 0, 0};
+    unsigned int state = 2025;
+    int errors = 0;
+
+    for (int i = 0; i < CASES && data != NULL && errors == 0; i++) {
+        size_t size = adfgvx_fuzz_generate(&state, MAX_LENGTH, data);
+        errors += adfgvx_fuzz_run_case(data, size, pool, stdout, &stats) == 2;
+    }
+    // Um caso vazio tambem e valido (chave de uma coluna, mensagem vazia).
+    errors += data == NULL || adfgvx_fuzz_run_case(NULL, 0, pool, stdout, &stats) != 0;
+
+    printf("\t\t%llu casos, %llu comparações\n", stats.cases, stats.comparisons);
+    if (errors == 0 && stats.mismatches == 0 && stats.comparisons > 10 * stats.cases) {
+        printf("\tSUCESSO: Todas as implementações iguais à referência nos dois sentidos.\n");
+    } else {
+        printf("\tERRO: %llu divergências da referência (%d casos sem memória).\n", stats.mismatches, errors);
+    }
+    thread_pool_destroy(pool);
+    free(data);
+}
+
+/**
+ * @brief Testa as medicoes por estagio (--stats): depois de uma cifragem e uma decifragem,
+ * cada estagio deve ter as chamadas e os bytes esperados, e o JSON deve trazer todos eles.
+ */
+static void test_stage_stats()
+{
+    printf("\n-> Teste: Medições por Estágio (--stats)\n");
+#if ADFGVX_STATS
+    enum { LENGTH = 10000 };
+    char *message = malloc(LENGTH);
+    char *encrypted = malloc(2 * LENGTH);
+    char *decrypted = malloc(LENGTH);
+    char *json = calloc(4096, 1);
+    FILE *file = tmpfile();
+    adfgvx_key_ctx key_ctx;
+    size_t encrypted_length = 0, decrypted_length = 0;
+    int failures = 0;
+
+    if (!message || !encrypted || !decrypted || !json || !file) {
+        printf("\tERRO: Falha ao alocar os buffers do teste.\n");
+        free(message); free(encrypted); free(decrypted); free(json);
+        if (file) fclose(file);
+        return;
+    }
+    for (int i = 0; i < LENGTH; i++) {
+        message[i] = "ATAQUE 1234"[i % 11];
+    }
+
+    adfgvx_stats_enable();
+    failures += adfgvx_key_ctx_init(&key_ctx, "SEMB2025", 8) != 0;
+    failures += cipher_adfgvx_linear_ctx(&key_ctx, message, LENGTH, encrypted, 2 * LENGTH, &encrypted_length) != 0;
+    failures += decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, decrypted, LENGTH, &decrypted_length) != 0;
+    adfgvx_stats_disable();
+    adfgvx_key_ctx_free(&key_ctx);
+    failures += decrypted_length != LENGTH || memcmp(decrypted, message, LENGTH) != 0;
+
+    // Depois de desligada, a medicao nao acumula mais nada.
+    failures += cipher_adfgvx_linear("SEMB2025", 8, message, LENGTH, encrypted, 2 * LENGTH, &encrypted_length) != 0;
+    failures += adfgvx_stats_write(file, 1) != 0;
+    rewind(file);
+    json[fread(json, 1, 4095, file)] = '\0';
+    fclose(file);
+
+    // Chamadas e bytes de cada estagio: blocos de ADFGVX_ENCODE_BLOCK_SIZE na substituicao.
+    const char *expected[] = {
+        "\"stage\": \"key\", \"calls\": 1,", "\"bytes\": 8,",
+        "\"stage\": \"scan\", \"calls\": 1,", "\"bytes\": 10000,",
+        "\"stage\": \"encode\", \"calls\": 3,", "\"bytes\": 10000,",
+        "\"stage\": \"transpose\", \"calls\": 3,", "\"bytes\": 20000,",
+        "\"stage\": \"decode\", \"calls\": 1,", "\"bytes\": 20000,",
+        "\"stage\": \"write\", \"calls\": 0,", "\"bytes\": 0,"};
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i += 2) {
+        const char *line = strstr(json, expected[i]);
+        const char *end = line ? strchr(line, '}') : NULL;
+        const char *bytes = line ? strstr(line, expected[i + 1]) : NULL;
+
+        if (!line || !bytes || bytes > end) {
+            printf("\t\tEstágio incorreto: %s\n", expected[i]);
+            failures++;
+        }
+    }
+
+    if (failures == 0) {
+        printf("\tSUCESSO: Chamadas e bytes de cada estágio corretos, JSON completo.\n");
+    } else {
+        printf("\tERRO: %d falhas nas medições por estágio.\n", failures);
+    }
+    free(message);
+    free(encrypted);
+    free(decrypted);
+    free(json);
+#else
+    printf("\tAVISO: Compilado com ADFGVX_STATS=0; teste ignorado.\n");
+#endif
+}
+
+/**
+ * @brief Testa os kernels de transposicao especializados por comprimento de chave: para
+ * k = 1 a 9, cifragem, decifragem, trechos e um par invalido devem dar o mesmo resultado
+ * com os kernels ligados e com o laco generico.
+ */
+static void test_specialized_transpose()
+{
+    printf("\n-> Teste: Kernels de Transposição Especializados por Chave\n");
+    enum { LENGTH = 9000 };
+    const char *key = "SEMB2025X";
+    const size_t lengths[] = {0, 1, 2, 3, 7, 8, 9, 15, 16, 17, 33, 4095, 4096, 4097, LENGTH};
+    const size_t ranges[][2] = {{0, 1}, {1, 7}, {3, 100}, {4097, 333}, {LENGTH - 5, 5}};
+    char *message = malloc(LENGTH);
+    char *encrypted = malloc(2 * LENGTH);
+    char *expected = malloc(2 * LENGTH);
+    char *decrypted = malloc(LENGTH);
+    char *generic = malloc(LENGTH);
+    int failures = 0, checks = 0;
+
+    if (!message || !encrypted || !expected || !decrypted || !generic) {
+        printf("\tERRO: Falha ao alocar memória.\n");
+        free(message); free(encrypted); free(expected); free(decrypted); free(generic);
+        return;
+    }
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567 ,.";
+    unsigned int seed = 2025;
+    for (size_t i = 0; i < LENGTH; i++) {
+        seed = seed * 1103515245u + 12345u;
+        message[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+
+    failures += adfgvx_transpose_kernels_for(8) == NULL || adfgvx_transpose_kernels_for(8)->key_length != 8;
+    failures += adfgvx_transpose_kernels_for(9) != NULL;
+
+    // Cada comprimento de chave com kernel (e um sem, k = 9): o caminho especializado deve
+    // gerar exatamente a saida do laco generico, inclusive nos trechos e com um par invalido.
+    for (int k = 1; k <= ADFGVX_TRANSPOSE_MAX_SPECIALIZED + 1; k++) {
+        adfgvx_key_ctx key_ctx;
+        if (adfgvx_key_ctx_init(&key_ctx, key, k) != 0) {
+            failures++;
+            continue;
+        }
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t n = lengths[l], encrypted_length = 0, expected_length = 0, length = 0, generic_length = 0;
+
+            adfgvx_transpose_select_specialized(0);
+            int expected_status = cipher_adfgvx_linear_ctx(&key_ctx, message, n, expected, 2 * LENGTH, &expected_length);
+            adfgvx_transpose_select_specialized(1);
+            int status = cipher_adfgvx_linear_ctx(&key_ctx, message, n, encrypted, 2 * LENGTH, &encrypted_length);
+            failures += status != expected_status || encrypted_length != expected_length ||
+                        memcmp(encrypted, expected, encrypted_length) != 0;
+
+            status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, decrypted, LENGTH, &length);
+            failures += status != 0 || length != n || memcmp(decrypted, message, n) != 0;
+            checks += 2;
+
+            for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+                adfgvx_transpose_select_specialized(0);
+                expected_status = decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, ranges[r][0], ranges[r][1],
+                                                            generic, LENGTH, &generic_length);
+                adfgvx_transpose_select_specialized(1);
+                status = decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, ranges[r][0], ranges[r][1],
+                                                   decrypted, LENGTH, &length);
+                failures += status != expected_status || length != generic_length || memcmp(decrypted, generic, length) != 0;
+                checks++;
+            }
+
+            // Um simbolo invalido no meio: os dois caminhos param no mesmo par.
+            if (encrypted_length > 20) {
+                encrypted[encrypted_length / 2 + 3] = '7';
+                adfgvx_transpose_select_specialized(0);
+                expected_status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, generic, LENGTH, &generic_length);
+                adfgvx_transpose_select_specialized(1);
+                status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, decrypted, LENGTH, &length);
+                failures += status != expected_status || expected_status == 0 || length != generic_length ||
+                            memcmp(decrypted, generic, length) != 0;
+                checks++;
+            }
+        }
+        adfgvx_key_ctx_free(&key_ctx);
+    }
+
+    if (failures == 0) {
+        printf("\tSUCESSO: %d comparações entre os kernels especializados e o laço genérico.\n", checks);
+    } else {
+        printf("\tERRO: %d falhas em %d comparações dos kernels especializados.\n", failures, checks);
+    }
+    free(message);
+    free(encrypted);
+    free(expected);
+    free(decrypted);
+    free(generic);
+}
+
+/**
+ * @brief Aplica uma transposicao colunar simples sobre uma sequencia de simbolos (le as
+ * colunas na ordem alfabetica da chave); referencia de test_transposition_rounds.
+ */
+static void transpose_symbols(const char *input, size_t length, const char *key, int key_length, char *output)
+{
+    int order[64];
+    size_t position = 0;
+
+    adfgvx_key_column_order(key, key_length, order);
+    for (int i = 0; i < key_length; i++) {
+        for (size_t j = (size_t)order[i]; j < length; j += (size_t)key_length) {
+            output[position++] = input[j];
+        }
+    }
+}
+
+/**
+ * @brief Testa a transposicao em varias rodadas: cipher_adfgvx_rounds deve dar o mesmo
+ * resultado que a cifragem com a primeira chave seguida das transposicoes com as demais,
+ * feitas uma a uma, e decipher_adfgvx_rounds deve recuperar a mensagem.
+ * As sequencias cobrem periodos (produto dos comprimentos) pequenos, com ladrilhos e
+ * maiores que ADFGVX_ROUNDS_MAX_PERIOD (uma passagem por rodada).
+ */
+static void test_transposition_rounds()
+{
+    printf("\n-> Teste: Transposição em Várias Rodadas\n");
+    enum { LENGTH = 140000 };
+    const char *round_keys[] = {"SEMB2025", "CHAVE", "A", "ZEBRAS", "SEMB2025SEMB2025SEMB2025SEMB2025SEMB2025X"};
+    // Numero de rodadas seguido dos indices das chaves (periodos 8, 40, 40, 9840, 1681 e 403440).
+    const int sequences[][6] = {{1, 0}, {2, 0, 1}, {3, 0, 1, 2}, {5, 0, 1, 2, 3, 4}, {2, 4, 4}, {5, 0, 1, 3, 4, 4}};
+    const size_t lengths[] = {0, 1, 7, 1000, 5000, LENGTH};
+    char *message = malloc(LENGTH);
+    char *expected = malloc(2 * LENGTH);
+    char *scratch = malloc(2 * LENGTH);
+    char *encrypted = malloc(2 * LENGTH);
+    char *decrypted = malloc(LENGTH);
+    adfgvx_key_ctx keys[5];
+    int failures = 0, checks = 0;
+
+    if (!message || !expected || !scratch || !encrypted || !decrypted) {
+        printf("\tERRO: Falha ao alocar memória.\n");
+        free(message); free(expected); free(scratch); free(encrypted); free(decrypted);
+        return;
+    }
+    for (int r = 0; r < 5; r++) {
+        failures += adfgvx_key_ctx_init(&keys[r], round_keys[r], (int)strlen(round_keys[r])) != 0;
+    }
+    for (size_t i = 0; i < LENGTH; i++) {
+        message[i] = "ATAQUE AO AMANHECER, 1234."[i % 26];
+    }
+
+    for (size_t c = 0; c < sizeof(sequences) / sizeof(sequences[0]) && failures == 0; c++) {
+        int rounds = sequences[c][0];
+        adfgvx_key_ctx sequence[5];
+        for (int r = 0; r < rounds; r++) {
+            sequence[r] = keys[sequences[c][1 + r]];
+        }
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t n = lengths[l], expected_length = 0, encrypted_length = 0, decrypted_length = 0;
+
+            // Referencia: cifragem com a primeira chave e uma passagem por rodada seguinte.
+            failures += cipher_adfgvx_linear_ctx(&sequence[0], message, n, expected, 2 * LENGTH, &expected_length) != 0;
+            for (int r = 1; r < rounds; r++) {
+                const char *round_key = round_keys[sequences[c][1 + r]];
+                transpose_symbols(expected, expected_length, round_key, (int)strlen(round_key), scratch);
+                memcpy(expected, scratch, expected_length);
+            }
+
+            int status = cipher_adfgvx_rounds(sequence, rounds, message, n, encrypted, 2 * LENGTH, &encrypted_length);
+            failures += status != 0 || encrypted_length != expected_length || memcmp(encrypted, expected, expected_length) != 0;
+            status = decipher_adfgvx_rounds(sequence, rounds, encrypted, encrypted_length, decrypted, LENGTH, &decrypted_length);
+            failures += status != 0 || decrypted_length != n || memcmp(decrypted, message, n) != 0;
+            checks += 2;
+        }
+    }
+
+    // Erros: capacidade insuficiente, numero impar de simbolos, par invalido e rodadas demais.
+    size_t encrypted_length = 0, decrypted_length = 0;
+    failures += cipher_adfgvx_rounds(keys, 2, message, 100, encrypted, 199, &encrypted_length) != 2;
+    failures += cipher_adfgvx_rounds(keys, 2, message, 100, encrypted, 200, &encrypted_length) != 0;
+    failures += decipher_adfgvx_rounds(keys, 2, encrypted, 199, decrypted, LENGTH, &decrypted_length) != 3;
+    failures += decipher_adfgvx_rounds(keys, 2, encrypted, 200, decrypted, 10, &decrypted_length) != 2 || decrypted_length != 10;
+    encrypted[0] = '7';
+    failures += decipher_adfgvx_rounds(keys, 2, encrypted, 200, decrypted, LENGTH, &decrypted_length) != 3;
+    failures += cipher_adfgvx_rounds(keys, 0, message, 100, encrypted, 200, &encrypted_length) != 1;
+    failures += cipher_adfgvx_rounds(keys, ADFGVX_MAX_ROUNDS + 1, message, 100, encrypted, 200, &encrypted_length) != 1;
+    checks += 7;
+
+    if (failures == 0) {
+        printf("\tSUCESSO: %d verificações de cifragem e decifragem em até 5 rodadas.\n", checks);
+    } else {
+        printf("\tERRO: %d falhas em %d verificações das rodadas.\n", failures, checks);
+    }
+    for (int r = 0; r < 5; r++) {
+        adfgvx_key_ctx_free(&keys[r]);
+    }
+    free(message);
+    free(expected);
+    free(scratch);
+    free(encrypted);
+    free(decrypted);
+}
+
+/**
+ * @brief Testa a transposicao por ladrilhos: nas chaves longas, cifragem, decifragem,
+ * trechos e um par invalido devem dar o mesmo resultado com e sem ladrilhos, e a gravacao
+ * nao temporal deve gravar o mesmo que a comum.
+ */
+static void test_tiled_transpose()
+{
+    printf("\n-> Teste: Transposição por Ladrilhos (Chaves Longas)\n");
+    enum { LENGTH = 100000, TILE_KEY = 37, TILE_ROWS = 200 };
+    const int key_lengths[] = {9, 20, 129, 300, 1000};
+    const size_t lengths[] = {1, 1000, 8191, 40000, LENGTH};
+    const size_t ranges[][2] = {{1, 7}, {3, 70000}, {LENGTH - 5, 5}};
+    char key[1001];
+    char *message = malloc(LENGTH);
+    char *encrypted = malloc(2 * LENGTH);
+    char *expected = malloc(2 * LENGTH);
+    char *decrypted = malloc(LENGTH);
+    char *untiled = malloc(LENGTH);
+    int failures = 0, checks = 0;
+
+    if (!message || !encrypted || !expected || !decrypted || !untiled) {
+        printf("\tERRO: Falha ao alocar memória.\n");
+        free(message); free(encrypted); free(expected); free(decrypted); free(untiled);
+        return;
+    }
+    for (int i = 0; i < 1000; i++) {
+        key[i] = "SEMB2025ZEBRAS"[i % 14];
+    }
+    key[1000] = '\0';
+    // Com minusculas (descartadas), os blocos codificados tem tamanhos variados.
+    const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ1234567 ,.xy";
+    unsigned int seed = 77;
+    for (size_t i = 0; i < LENGTH; i++) {
+        seed = seed * 1103515245u + 12345u;
+        message[i] = alphabet[(seed >> 16) % (sizeof(alphabet) - 1)];
+    }
+
+    for (size_t k = 0; k < sizeof(key_lengths) / sizeof(key_lengths[0]); k++) {
+        adfgvx_key_ctx key_ctx;
+        if (adfgvx_key_ctx_init(&key_ctx, key, key_lengths[k]) != 0) {
+            failures++;
+            continue;
+        }
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t n = lengths[l], encrypted_length = 0, expected_length = 0, length = 0, untiled_length = 0;
+
+            adfgvx_transpose_select_tiled(0);
+            int expected_status = cipher_adfgvx_linear_ctx(&key_ctx, message, n, expected, 2 * LENGTH, &expected_length);
+            adfgvx_transpose_select_tiled(1);
+            int status = cipher_adfgvx_linear_ctx(&key_ctx, message, n, encrypted, 2 * LENGTH, &encrypted_length);
+            failures += status != expected_status || encrypted_length != expected_length ||
+                        memcmp(encrypted, expected, encrypted_length) != 0;
+
+            status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, decrypted, LENGTH, &length);
+            adfgvx_transpose_select_tiled(0);
+            expected_status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, untiled, LENGTH, &untiled_length);
+            adfgvx_transpose_select_tiled(1);
+            failures += status != 0 || expected_status != 0 || length != untiled_length ||
+                        memcmp(decrypted, untiled, length) != 0;
+            checks += 2;
+
+            for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+                adfgvx_transpose_select_tiled(0);
+                expected_status = decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, ranges[r][0], ranges[r][1],
+                                                            untiled, LENGTH, &untiled_length);
+                adfgvx_transpose_select_tiled(1);
+                status = decipher_adfgvx_range_ctx(&key_ctx, encrypted, encrypted_length, ranges[r][0], ranges[r][1],
+                                                   decrypted, LENGTH, &length);
+                failures += status != expected_status || length != untiled_length || memcmp(decrypted, untiled, length) != 0;
+                checks++;
+            }
+
+            // Um simbolo invalido no meio: os dois caminhos param no mesmo par.
+            if (encrypted_length > 20) {
+                encrypted[encrypted_length / 2 + 3] = '7';
+                adfgvx_transpose_select_tiled(0);
+                expected_status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, untiled, LENGTH, &untiled_length);
+                adfgvx_transpose_select_tiled(1);
+                status = decipher_adfgvx_direct_ctx(&key_ctx, encrypted, encrypted_length, decrypted, LENGTH, &length);
+                failures += status != expected_status || expected_status == 0 || length != untiled_length ||
+                            memcmp(decrypted, untiled, length) != 0;
+                checks++;
+            }
+        }
+        adfgvx_key_ctx_free(&key_ctx);
+    }
+
+    // Gravacao nao temporal (colunas desalinhadas) contra a comum, e a leitura do ladrilho de volta.
+    size_t streamed_position[TILE_KEY], plain_position[TILE_KEY], gather_position[TILE_KEY];
+    for (int c = 0; c < TILE_KEY; c++) {
+        streamed_position[c] = plain_position[c] = gather_position[c] = 3 + (size_t)c * (TILE_ROWS + 1);
+    }
+    memset(expected, 0, (size_t)TILE_KEY * (TILE_ROWS + 1) + 3);
+    memset(encrypted, 0, (size_t)TILE_KEY * (TILE_ROWS + 1) + 3);
+    adfgvx_transpose_scatter_tiles(TILE_KEY, plain_position, message, TILE_ROWS, expected, 0);
+    adfgvx_transpose_scatter_tiles(TILE_KEY, streamed_position, message, TILE_ROWS, encrypted, 1);
+    failures += memcmp(encrypted, expected, (size_t)TILE_KEY * (TILE_ROWS + 1) + 3) != 0 ||
+                memcmp(streamed_position, plain_position, sizeof(plain_position)) != 0 ||
+                plain_position[0] != 3 + TILE_ROWS;
+    adfgvx_transpose_gather_tile(TILE_KEY, gather_position, expected, TILE_ROWS, TILE_KEY, decrypted);
+    failures += memcmp(decrypted, message, (size_t)TILE_KEY * TILE_ROWS) != 0 ||
+                memcmp(gather_position, plain_position, sizeof(plain_position)) != 0;
+    failures += adfgvx_transpose_tile_pitch(37) != 64 || adfgvx_transpose_tile_pitch(64) != 64 ||
+                adfgvx_transpose_tile_pitch(1024) != 1088;
+    failures += adfgvx_transpose_stream_threshold() == 0;
+    checks += 4;
+
+    if (failures == 0) {
+        printf("\tSUCESSO: %d comparações entre a transposição por ladrilhos e o laço genérico.\n", checks);
+    } else {
+        printf("\tERRO: %d falhas em %d comparações da transposição por ladrilhos.\n", failures, checks);
+    }
+    free(message);
+    free(encrypted);
+    free(expected);
+    free(decrypted);
+    free(untiled);
+}
+
+/**
+ * @brief Testa o formato compacto: adfgvx_packed_encrypt deve dar o mesmo texto cifrado
+ * que cipher_adfgvx_linear_ctx (depois de adfgvx_pack_symbols), adfgvx_packed_decrypt deve
+ * recuperar a mensagem e o cabecalho deve rejeitar arquivos truncados.
+ */
+static void test_packed_format()
+{
+    printf("\n-> Teste: Formato Compacto (3 bits por Símbolo)\n");
+    enum { LENGTH = 5000 };
+    const char *keys[] = {"A", "UM", "CHAVE", "SEMB2025", "SEMB2025SEMB2025SEMB2025SEMB2025SEMB2025X"};
+    const size_t lengths[] = {0, 1, 3, 8, 1001, LENGTH};
+    char *message = malloc(LENGTH);
+    char *ascii = malloc(2 * LENGTH);
+    char *unpacked = malloc(2 * LENGTH);
+    unsigned char *expected = malloc(ADFGVX_PACKED_HEADER_SIZE + 2 * LENGTH);
+    unsigned char *packed = malloc(ADFGVX_PACKED_HEADER_SIZE + 2 * LENGTH);
+    char *decrypted = malloc(LENGTH);
+    int failures = 0, checks = 0;
+
+    if (!message || !ascii || !unpacked || !expected || !packed || !decrypted) {
+        printf("\tERRO: Falha ao alocar memória.\n");
+        free(message); free(ascii); free(unpacked); free(expected); free(packed); free(decrypted);
+        return;
+    }
+    // Caracteres fora da matriz (minusculas e quebras de linha) sao descartados, como no ASCII.
+    for (size_t i = 0; i < LENGTH; i++) {
+        message[i] = "ATAQUE AO AMANHECER, 1234.\nfim"[i % 30];
+    }
+
+    for (size_t k = 0; k < sizeof(keys) / sizeof(keys[0]); k++) {
+        adfgvx_key_ctx key_ctx;
+        if (adfgvx_key_ctx_init(&key_ctx, keys[k], (int)strlen(keys[k])) != 0) {
+            failures++;
+            continue;
+        }
+        for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            size_t n = lengths[l], ascii_length = 0, symbol_count = 0, decrypted_length = 0, direct_length = 0;
+
+            failures += cipher_adfgvx_linear_ctx(&key_ctx, message, n, ascii, 2 * LENGTH, &ascii_length) != 0;
+            failures += adfgvx_pack_symbols(ascii, ascii_length, expected) != 0;
+            memset(packed, 0xA5, 2 * LENGTH); // A saida nao precisa vir zerada.
+            int status = adfgvx_packed_encrypt(&key_ctx, message, n, packed, 2 * LENGTH, &symbol_count);
+            size_t bytes = adfgvx_packed_size(symbol_count);
+            failures += status != 0 || symbol_count != ascii_length || memcmp(packed, expected, bytes) != 0;
+            failures += bytes != (3 * ascii_length + 7) / 8;
+            failures += adfgvx_unpack_symbols(packed, symbol_count, unpacked) != 0 || memcmp(unpacked, ascii, ascii_length) != 0;
+            status = adfgvx_packed_decrypt(&key_ctx, packed, symbol_count, decrypted, LENGTH, &decrypted_length);
+            failures += decipher_adfgvx_direct_ctx(&key_ctx, ascii, ascii_length, unpacked, LENGTH, &direct_length) != 0;
+            failures += status != 0 || decrypted_length != direct_length || memcmp(decrypted, unpacked, direct_length) != 0;
+            checks += 4;
+        }
+        adfgvx_key_ctx_free(&key_ctx);
+    }
+
+    // Erros: capacidade insuficiente, numero impar de simbolos, simbolo invalido (6 e 7) e
+    // cabecalho que nao corresponde ao tamanho do arquivo.
+    adfgvx_key_ctx key_ctx;
+    size_t symbol_count = 0, decrypted_length = 0;
+    failures += adfgvx_key_ctx_init(&key_ctx, "SEMB2025", 8) != 0;
+    failures += adfgvx_packed_encrypt(&key_ctx, message, 100, packed, 63, &symbol_count) != 2;
+    failures += adfgvx_packed_encrypt(&key_ctx, "ATAQUE", 6, packed, 5, &symbol_count) != 0 || symbol_count != 12;
+    failures += adfgvx_packed_decrypt(&key_ctx, packed, 11, decrypted, LENGTH, &decrypted_length) != 3;
+    failures += adfgvx_packed_decrypt(&key_ctx, packed, 12, decrypted, 4, &decrypted_length) != 2 || decrypted_length != 4;
+    failures += adfgvx_pack_symbols("ADFGVXAD7X", 10, packed) != 1;
+    failures += adfgvx_packed_decrypt(&key_ctx, packed, 10, decrypted, LENGTH, &decrypted_length) != 3;
+    adfgvx_packed_write_header(expected, 12);
+    failures += adfgvx_packed_read_header(expected, ADFGVX_PACKED_HEADER_SIZE + 5, &symbol_count) != 0 || symbol_count != 12;
+    failures += adfgvx_packed_read_header(expected, ADFGVX_PACKED_HEADER_SIZE + 4, &symbol_count) != 2;
+    failures += adfgvx_packed_read_header((const unsigned char *)"ADFGVXC1", 8, &symbol_count) != 1;
+    checks += 9;
+    adfgvx_key_ctx_free(&key_ctx);
+
+    if (failures == 0) {
+        printf("\tSUCESSO: %d verificações do formato compacto (3/8 do tamanho do ASCII).\n", checks);
+    } else {
+        printf("\tERRO: %d falhas em %d verificações do formato compacto.\n", failures, checks);
+    }
+    free(message);
+    free(ascii);
+    free(unpacked);
+    free(expected);
+    free(packed);
+    free(decrypted);
+}
+
+/**
+ * @brief Testa a recuperacao da chave: a busca exaustiva (comprimentos 1 a 6) e a busca
+ * por dicionario devem colocar em primeiro lugar a ordem de colunas da chave usada.
+ */
+static void test_key_recovery()
+{
+    printf("\n-> Teste: Recuperação da Chave de Transposição\n");
+    char key[] = "TROPA";
+    const char *message = "O COMANDO INFORMA QUE A TROPA DEVE SEGUIR PARA O NORTE AO AMANHECER, "
+                          "PASSANDO PELA PONTE VELHA ANTES DAS SEIS HORAS. OS SUPRIMENTOS CHEGARAO "
+                          "NA ESTACAO DO CAMPO NO SEGUNDO DIA DO MES, E NENHUM SOLDADO DEVE DEIXAR "
+                          "A POSICAO SEM UMA ORDEM ESCRITA DO OFICIAL QUE RESPONDE PELA DEFESA DA CIDADE.";
+    const char *const words[] = {"CHAVE", "PARIS", "TROPA", "SEMB2025", "UM"};
+    char encrypted[1024];
+    size_t encrypted_length = 0;
+    adfgvx_key_ctx key_ctx;
+    adfgvx_key_candidate best[5];
+    adfgvx_key_search_stats stats;
+    adfgvx_ngram_model *model = malloc(sizeof(adfgvx_ngram_model));
+    thread_pool *pool = thread_pool_create(4);
+    int failures = 0;
+
+    if (!model || !pool || adfgvx_ngram_model_build(model, adfgvx_default_corpus, strlen(adfgvx_default_corpus)) != 0) {
+        printf("\tERRO: Falha ao construir o modelo de trigramas ou criar o pool de threads.\n");
+        free(model);
+        thread_pool_destroy(pool);
+        return;
+    }
+
+    adfgvx_key_ctx_init(&key_ctx, key, strlen(key));
+    cipher_adfgvx_linear_ctx(&key_ctx, message, strlen(message), encrypted, sizeof(encrypted), &encrypted_length);
+    adfgvx_key_search search = {encrypted, encrypted_length, model, ADFGVX_KEY_SEARCH_PREFIX, ADFGVX_KEY_SEARCH_ABORT_MARGIN, pool};
+
+    size_t found = adfgvx_search_column_orders(&search, 1, 6, best, 5, &stats);
+    if (found == 0 || best[0].key_length != key_ctx.key_length ||
+        memcmp(best[0].column_order, key_ctx.column_order, sizeof(int) * key_ctx.key_length) != 0) {
+        failures++;
+    }
+    printf("\t\tBusca exaustiva: %llu candidatos (%llu descartados), melhor: %s\n",
+           stats.tested, stats.aborted, found > 0 ? best[0].key : "-");
+
+    found = adfgvx_search_wordlist(&search, words, sizeof(words) / sizeof(words[0]), best, 5, &stats);
+    if (found == 0 || strcmp(best[0].key, key) != 0) {
+        failures++;
+    }
+    printf("\t\tDicionário: %llu palavras avaliadas, melhor: %s\n", stats.tested, found > 0 ? best[0].key : "-");
+
+    if (failures == 0) {
+        printf("\tSUCESSO: Ordem das colunas da chave '%s' recuperada.\n", key);
+    } else {
+        printf("\tERRO: %d buscas não recuperaram a chave '%s'.\n", failures, key);
+    }
+
+    adfgvx_key_ctx_free(&key_ctx);
+    thread_pool_destroy(pool);
+    free(model);
+}
+
+/**
+ * @brief Testa o solucionador da matriz Polybius: cifra um texto com uma matriz embaralhada
+ * (substituicao com a matriz padrao, celulas renomeadas e transposicao feita aqui) e
+ * confere que, com a transposicao conhecida, quase todo o texto e recuperado.
+ */
+static void test_square_solver()
+{
+    printf("\n-> Teste: Solucionador da Matriz Polybius (Recozimento Simulado)\n");
+    const char *message = "QUANDO O NAVIO ENTROU NO PORTO, OS MARINHEIROS JA ESTAVAM CANSADOS DE TANTOS DIAS NO MAR. "
+                          "O CAPITAO MANDOU QUE TODOS DESCESSEM PARA A CIDADE E PROCURASSEM ALGUM LUGAR PARA DESCANSAR "
+                          "ANTES DA PROXIMA VIAGEM. NA PRACA PRINCIPAL HAVIA UMA FEIRA COM FRUTAS, PEIXES E TECIDOS DE "
+                          "MUITAS CORES, E AS CRIANCAS CORRIAM ENTRE AS BARRACAS ENQUANTO OS VENDEDORES GRITAVAM OS PRECOS. "
+                          "UM DOS MARINHEIROS, QUE ERA O MAIS NOVO DA TRIPULACAO, ENCONTROU UMA LIVRARIA ANTIGA NUMA RUA "
+                          "ESTREITA E PASSOU A TARDE INTEIRA LENDO HISTORIAS SOBRE GUERRAS E MENSAGENS SECRETAS.";
+    size_t length = strlen(message);
+    char key[] = "TROPA";
+    char *substituted = malloc(2 * length);
+    char *encrypted = malloc(2 * length);
+    adfgvx_quadgram_model *model = malloc(sizeof(adfgvx_quadgram_model));
+    thread_pool *pool = thread_pool_create(4);
+    adfgvx_key_ctx identity, key_ctx;
+    size_t symbols = 0, column_start[MAX_KEY_LENGTH];
+    int cell_of[ADFGVX_ALPHABET_SIZE];
+
+    if (!substituted || !encrypted || !model || !pool ||
+        adfgvx_quadgram_model_build(model, adfgvx_default_corpus, strlen(adfgvx_default_corpus)) != 0) {
+        printf("\tERRO: Falha ao alocar memória ou construir o modelo de quadrigramas.\n");
+        free(substituted); free(encrypted); free(model);
+        thread_pool_destroy(pool);
+        return;
+    }
+
+    // Matriz embaralhada: o caractere da celula v da matriz padrao vai para a celula cell_of[v].
+    unsigned int seed = 2025;
+    for (int v = 0; v < ADFGVX_ALPHABET_SIZE; v++) {
+        cell_of[v] = v;
+    }
+    for (int v = ADFGVX_ALPHABET_SIZE - 1; v > 0; v--) {
+        seed = seed * 1103515245u + 12345u;
+        int w = (int)((seed >> 16) % (unsigned int)(v + 1));
+        int swap = cell_of[v]; cell_of[v] = cell_of[w]; cell_of[w] = swap;
+    }
+
+    // Chave de 1 caractere = so a substituicao; depois renomeia as celulas e transpoe.
+    adfgvx_key_ctx_init(&identity, "A", 1);
+    adfgvx_key_ctx_init(&key_ctx, key, strlen(key));
+    cipher_adfgvx_linear_ctx(&identity, message, length, substituted, 2 * length, &symbols);
+    adfgvx_key_ctx_column_starts(&key_ctx, symbols, column_start);
+    for (size_t i = 0; i < symbols; i += 2) {
+        int cell = cell_of[adfgvx_symbol_value[(unsigned char)substituted[i]] * ADFGVX_SYMBOL_COUNT +
+                           adfgvx_symbol_value[(unsigned char)substituted[i + 1]]];
+        encrypted[column_start[i % key_ctx.key_length] + i / key_ctx.key_length] = adfgvx_symbols[cell / ADFGVX_SYMBOL_COUNT];
+        encrypted[column_start[(i + 1) % key_ctx.key_length] + (i + 1) / key_ctx.key_length] = adfgvx_symbols[cell % ADFGVX_SYMBOL_COUNT];
+    }
+
+    adfgvx_square_search search = {encrypted, symbols, &key_ctx, model, 8, ADFGVX_SQUARE_SEARCH_ITERATIONS,
+                                   ADFGVX_SQUARE_SEARCH_TEMPERATURE, 1, pool};
+    adfgvx_square_solution solution;
+    adfgvx_square_search_stats stats;
+    clock_t start = clock();
+    int status = adfgvx_solve_square(&search, &solution, &stats);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    // Confere o texto decifrado com a matriz encontrada.
+    size_t correct = 0;
+    for (size_t i = 0; status == 0 && i < symbols; i += 2) {
+        int cell = cell_of[adfgvx_symbol_value[(unsigned char)substituted[i]] * ADFGVX_SYMBOL_COUNT +
+                           adfgvx_symbol_value[(unsigned char)substituted[i + 1]]];
+        correct += solution.square[cell] == message[i / 2];
+    }
+
+    printf("\t\t%lu caracteres, %llu trocas em %.2f s (CPU), %lu corretos\n", (unsigned long)(symbols / 2),
+           stats.evaluations, seconds, (unsigned long)correct);
+    if (status == 0 && correct * 100 >= (symbols / 2) * 95) {
+        printf("\tSUCESSO: Matriz recuperada (pontuação %.4f).\n", solution.score);
+    } else {
+        printf("\tERRO: Matriz não recuperada (código %d, %lu de %lu caracteres corretos).\n", status,
+               (unsigned long)correct, (unsigned long)(symbols / 2));
+    }
+
+    adfgvx_key_ctx_free(&identity);
+    adfgvx_key_ctx_free(&key_ctx);
+    thread_pool_destroy(pool);
+    free(substituted); free(encrypted); free(model);
+}
+
+/**
+ * @brief Repassa um bloco lido do arquivo cifrado ao contexto de decifragem em fluxo.
+ * (Função auxiliar estática, usada com read_file_in_chunks)
+ */
+static int decipher_chunk(void *user, const char *chunk, size_t length)
+{
+    return adfgvx_decipher_stream_update((adfgvx_decipher_stream *)user, chunk, length);
+}
+
+/**
+ * @brief Decifra um arquivo de qualquer tamanho para outro arquivo, em fluxo.
+ *
+ * @return int 0 em caso de sucesso, ou o primeiro código de erro encontrado
+ * (de read_file_in_chunks, ou 10 + o código do contexto de decifragem).
+ */
+static int decipher_file_stream(const char *encrypted_path, const char *output_path, const char *key, int key_length)
+{
+    adfgvx_decipher_stream stream;
+    int status = adfgvx_decipher_stream_init(&stream, key, key_length);
+    if (status != 0) {
+        return 10 + status;
+    }
+
+    status = read_file_in_chunks(encrypted_path, ADFGVX_IO_CHUNK_SIZE, decipher_chunk, &stream, NULL);
+    if (status != 0) {
+        adfgvx_decipher_stream_final(&stream, NULL);
+        return status;
+    }
+
+    FILE *output = fopen(output_path, "wb");
+    if (output == NULL) {
+        perror("Erro ao abrir arquivo para escrita do texto plano");
+        adfgvx_decipher_stream_final(&stream, NULL);
+        return 1;
+    }
+    status = adfgvx_decipher_stream_final(&stream, output);
+    if (fclose(output) != 0 && status == 0) {
+        status = 1;
+    }
+    return status == 0 ? 0 : 10 + status;
+}
+
+/**
+ * @brief Decifra um arquivo inteiro de uma vez, entre arquivos mapeados em memoria
+ * (map_input_file / map_output_file); com mais de uma thread, o trabalho e dividido entre
+ * as threads de um pool. Quebras de linha no fim do arquivo cifrado sao ignoradas.
+ *
+ * @return int 0 em caso de sucesso, ou o código de erro de map_input_file,
+ * map_output_file / close_mapped_file (10 + código) ou decipher_adfgvx_parallel (20 + código).
+ */
+static int decipher_file_mapped(const char *encrypted_path, const char *output_path, const char *key, int key_length, int thread_count)
+{
+    adfgvx_key_ctx key_ctx;
+    mapped_file encrypted;
+    mapped_file decrypted;
+    size_t decrypted_length = 0;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0) {
+        return 21;
+    }
+    int status = map_input_file(encrypted_path, &encrypted);
+    if (status != 0) {
+        adfgvx_key_ctx_free(&key_ctx);
+        return status;
+    }
+    size_t encrypted_length = encrypted.length;
+    while (encrypted_length > 0 && (encrypted.data[encrypted_length - 1] == '\n' || encrypted.data[encrypted_length - 1] == '\r')) {
+        encrypted_length--;
+    }
+
+    status = map_output_file(output_path, encrypted_length / 2, &decrypted);
+    if (status != 0) {
+        close_mapped_file(&encrypted, 0);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 10 + status;
+    }
+
+    thread_pool *pool = thread_count > 1 ? thread_pool_create(thread_count) : NULL;
+    status = decipher_adfgvx_parallel(&key_ctx, encrypted.data ? encrypted.data : "", encrypted_length, decrypted.data, decrypted.length,
+                                      &decrypted_length, pool, ADFGVX_PARALLEL_THRESHOLD);
+    thread_pool_destroy(pool);
+    close_mapped_file(&encrypted, 0);
+    if (status != 0) {
+        close_mapped_file(&decrypted, 0);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 20 + status;
+    }
+
+    status = close_mapped_file(&decrypted, decrypted_length);
+    adfgvx_key_ctx_free(&key_ctx);
+    return status == 0 ? 0 : 10 + status;
+}
+
+/**
+ * @brief Libera os contextos das rodadas de decipher_file_rounds.
+ */
+static void free_round_keys(adfgvx_key_ctx keys[], int count)
+{
+    for (int i = 0; i < count; i++) {
+        adfgvx_key_ctx_free(&keys[i]);
+    }
+}
+
+/**
+ * @brief Decifra um arquivo cifrado com varias rodadas de transposicao (--round-key): a
+ * chave principal e as chaves das rodadas seguintes, na ordem usada na cifragem.
+ *
+ * @return int 0 em caso de sucesso, ou o código de erro de map_input_file,
+ * map_output_file / close_mapped_file (10 + código) ou decipher_adfgvx_rounds (20 + código).
+ */
+static int decipher_file_rounds(const char *encrypted_path, const char *output_path, const char *key, int key_length,
+                                const char *const round_keys[], int round_key_count)
+{
+    adfgvx_key_ctx keys[ADFGVX_MAX_ROUNDS];
+    int round_count = 0;
+    mapped_file encrypted;
+    mapped_file decrypted;
+    size_t decrypted_length = 0;
+
+    for (; round_count < 1 + round_key_count; round_count++) {
+        const char *round_key = round_count == 0 ? key : round_keys[round_count - 1];
+        if (adfgvx_key_ctx_init(&keys[round_count], round_key, round_count == 0 ? key_length : (int)strlen(round_key)) != 0) {
+            free_round_keys(keys, round_count);
+            return 21;
+        }
+    }
+    int status = map_input_file(encrypted_path, &encrypted);
+    if (status != 0) {
+        free_round_keys(keys, round_count);
+        return status;
+    }
+    size_t encrypted_length = encrypted.length;
+    while (encrypted_length > 0 && (encrypted.data[encrypted_length - 1] == '\n' || encrypted.data[encrypted_length - 1] == '\r')) {
+        encrypted_length--;
+    }
+
+    status = map_output_file(output_path, encrypted_length / 2, &decrypted);
+    if (status != 0) {
+        close_mapped_file(&encrypted, 0);
+        free_round_keys(keys, round_count);
+        return 10 + status;
+    }
+
+    printf("Transposição em %d rodadas.\n", round_count);
+    status = decipher_adfgvx_rounds(keys, round_count, encrypted.data ? encrypted.data : "", encrypted_length,
+                                    decrypted.data, decrypted.length, &decrypted_length);
+    close_mapped_file(&encrypted, 0);
+    free_round_keys(keys, round_count);
+    if (status != 0) {
+        close_mapped_file(&decrypted, 0);
+        return 20 + status;
+    }
+
+    status = close_mapped_file(&decrypted, decrypted_length);
+    return status == 0 ? 0 : 10 + status;
+}
+
+/**
+ * @brief Decifra um arquivo no formato compacto (--packed, adfgvx_packed.h): confere o
+ * cabecalho e decodifica os simbolos de 3 bits direto do arquivo mapeado.
+ *
+ * @return int 0 em caso de sucesso, ou o código de erro de map_input_file,
+ * map_output_file / close_mapped_file (10 + código), adfgvx_packed_read_header (30 + código)
+ * ou adfgvx_packed_decrypt (20 + código).
+ */
+static int decipher_file_packed(const char *encrypted_path, const char *output_path, const char *key, int key_length)
+{
+    adfgvx_key_ctx key_ctx;
+    mapped_file encrypted;
+    mapped_file decrypted;
+    size_t symbol_count = 0;
+    size_t decrypted_length = 0;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0) {
+        return 21;
+    }
+    int status = map_input_file(encrypted_path, &encrypted);
+    if (status != 0) {
+        adfgvx_key_ctx_free(&key_ctx);
+        return status;
+    }
+    const unsigned char *data = (const unsigned char *)encrypted.data;
+    status = adfgvx_packed_read_header(data, encrypted.length, &symbol_count);
+    if (status != 0) {
+        close_mapped_file(&encrypted, 0);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 30 + status;
+    }
+
+    status = map_output_file(output_path, symbol_count / 2, &decrypted);
+    if (status != 0) {
+        close_mapped_file(&encrypted, 0);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 10 + status;
+    }
+
+    printf("Formato compacto: %llu símbolos em %llu bytes.\n", (unsigned long long)symbol_count, (unsigned long long)encrypted.length);
+    status = adfgvx_packed_decrypt(&key_ctx, data + ADFGVX_PACKED_HEADER_SIZE, symbol_count, decrypted.data,
+                                   decrypted.length, &decrypted_length);
+    close_mapped_file(&encrypted, 0);
+    adfgvx_key_ctx_free(&key_ctx);
+    if (status != 0) {
+        close_mapped_file(&decrypted, 0);
+        return 20 + status;
+    }
+
+    status = close_mapped_file(&decrypted, decrypted_length);
+    return status == 0 ? 0 : 10 + status;
+}
+
+/**
+ * @brief Decifra cada linha de um arquivo como um registro independente (modo --lines),
+ * gravando uma linha de texto plano por registro, na mesma ordem.
+ *
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir algum arquivo, ou 10 + o código
+ * de adfgvx_process_records.
+ */
+static int decipher_file_records(const char *encrypted_path, const char *output_path, const char *key, int key_length, int thread_count)
+{
+    adfgvx_key_ctx key_ctx;
+    adfgvx_records_stats stats;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0) {
+        return 11;
+    }
+    FILE *input = fopen(encrypted_path, "rb");
+    if (input == NULL) {
+        adfgvx_key_ctx_free(&key_ctx);
+        return 1;
+    }
+    FILE *output = fopen(output_path, "wb");
+    if (output == NULL) {
+        perror("Erro ao abrir arquivo para escrita do texto plano");
+        fclose(input);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 1;
+    }
+
+    thread_pool *pool = thread_count > 1 ? thread_pool_create(thread_count) : NULL;
+    int status = adfgvx_process_records(input, output, &key_ctx, ADFGVX_RECORDS_DECRYPT, pool, &stats);
+    thread_pool_destroy(pool);
+    fclose(input);
+    if (fclose(output) != 0 && status == 0) {
+        status = 3;
+    }
+    if (status == 0) {
+        printf("Registros decifrados: %llu (%llu inválidos)\n", stats.records, stats.failed);
+    }
+    adfgvx_key_ctx_free(&key_ctx);
+    return status == 0 ? 0 : 10 + status;
+}
+
+/**
+ * @brief Decifra um arquivo no formato em blocos (modo --container). O cabeçalho, o índice
+ * e o rodapé são conferidos antes de decifrar qualquer bloco, o que detecta arquivos truncados.
+ *
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir algum arquivo, 10 + o código de
+ * adfgvx_container_open, ou 20 + o código de adfgvx_container_decrypt.
+ */
+static int decipher_file_container(const char *encrypted_path, const char *output_path, const char *key, int key_length,
+                                   int thread_count)
+{
+    adfgvx_key_ctx key_ctx;
+    adfgvx_container container;
+
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0) {
+        return 11;
+    }
+    FILE *input = fopen(encrypted_path, "rb");
+    if (input == NULL) {
+        adfgvx_key_ctx_free(&key_ctx);
+        return 1;
+    }
+    int status = adfgvx_container_open(&container, input);
+    if (status != 0) {
+        if (status == 3) {
+            fprintf(stderr, "'%s' não é um container (use --container também na cifragem).\n", encrypted_path);
+        } else if (status == 4) {
+            fprintf(stderr, "Container '%s' truncado ou corrompido (rodapé ou índice inconsistente).\n", encrypted_path);
+        }
+        fclose(input);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 10 + status;
+    }
+    printf("Container: %lu caracteres em %lu blocos de até %lu (chave de %d caracteres).\n",
+           (unsigned long)container.message_length, (unsigned long)container.block_count,
+           (unsigned long)container.block_size, container.key_length);
+
+    FILE *output = fopen(output_path, "wb");
+    if (output == NULL) {
+        perror("Erro ao abrir arquivo para escrita do texto plano");
+        adfgvx_container_close(&container);
+        fclose(input);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 1;
+    }
+    thread_pool *pool = thread_count > 1 ? thread_pool_create(thread_count) : NULL;
+    status = adfgvx_container_decrypt(&container, &key_ctx, output, pool);
+    thread_pool_destroy(pool);
+    adfgvx_container_close(&container);
+    fclose(input);
+    if (fclose(output) != 0 && status == 0) {
+        status = 4;
+    }
+    adfgvx_key_ctx_free(&key_ctx);
+    return status == 0 ? 0 : 20 + status;
+}
+
+/**
+ * @brief Decifra apenas o trecho offset .. offset + length - 1 da mensagem (modo --range),
+ * lendo do arquivo cifrado so os simbolos do trecho, e grava o trecho em output_path.
+ *
+ * @return int 0 em caso de sucesso, 1 se erro ao abrir algum arquivo, 2 se erro de leitura
+ * ou de memoria, ou 10 + o código de decipher_adfgvx_file_range.
+ */
+static int decipher_file_range(const char *encrypted_path, const char *output_path, const char *key, int key_length,
+                               size_t offset, size_t length)
+{
+    adfgvx_key_ctx key_ctx;
+    size_t encrypted_length = 0, decrypted_length = 0;
+    char tail[2];
+    if (adfgvx_key_ctx_init(&key_ctx, key, key_length) != 0) {
+        return 11;
+    }
+    FILE *input = fopen(encrypted_path, "rb");
+    if (input == NULL) {
+        adfgvx_key_ctx_free(&key_ctx);
+        return 1;
+    }
+    // Ignora as quebras de linha no fim do arquivo, lendo so os seus ultimos bytes.
+    if (get_file_size(input, &encrypted_length) != 0) {
+        fclose(input);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 2;
+    }
+    while (encrypted_length > 0 && read_file_at(input, encrypted_length - 1, tail, 1) == 0 &&
+           (tail[0] == '\n' || tail[0] == '\r')) {
+        encrypted_length--;
+    }
+
+    size_t available = offset < encrypted_length / 2 ? encrypted_length / 2 - offset : 0;
+    size_t capacity = length < available ? length : available;
+    char *decrypted = malloc(capacity > 0 ? capacity : 1);
+    if (decrypted == NULL) {
+        fclose(input);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 2;
+    }
+    int status = decipher_adfgvx_file_range(&key_ctx, input, encrypted_length, offset, length, decrypted, capacity, &decrypted_length);
+    fclose(input);
+    if (status != 0) {
+        free(decrypted);
+        adfgvx_key_ctx_free(&key_ctx);
+        return 10 + status;
+    }
+
+    printf("Trecho [%lu, %lu) de %lu caracteres: \"%.*s\"\n", (unsigned long)offset, (unsigned long)(offset + decrypted_length),
+           (unsigned long)(encrypted_length / 2), (int)decrypted_length, decrypted);
+    status = write_buffer_to_file(output_path, decrypted, decrypted_length);
+    free(decrypted);
+    adfgvx_key_ctx_free(&key_ctx);
+    return status == 0 ? 0 : 1;
+}
+
+/**
+ * @brief Compara o arquivo decifrado com a mensagem original, ignorando as quebras de
+ * linha dos dois arquivos (a cifragem descarta as da original; no modo --lines o
+ * arquivo decifrado tem uma por registro). Com skip > 0 (modo --range), os primeiros skip
+ * caracteres da original sao pulados e so o trecho presente no arquivo decifrado e comparado.
+ *
+ * @param partial 1 para aceitar a original mais longa que o arquivo decifrado (trecho).
+ * @return int 0 se iguais, 1 se diferentes, -1 se erro ao abrir algum dos arquivos.
+ */
+static int compare_with_original(const char *original_path, const char *decrypted_path, size_t skip, int partial)
+{
+    FILE *original = fopen(original_path, "rb");
+    FILE *decrypted = fopen(decrypted_path, "rb");
+    if (original == NULL || decrypted == NULL) {
+        if (original) fclose(original);
+        if (decrypted) fclose(decrypted);
+        return -1;
+    }
+
+    int a, b;
+    for (size_t skipped = 0; skipped < skip; ) {
+        a = getc(original);
+        if (a == EOF) {
+            break;
+        }
+        skipped += a != '\r' && a != '\n';
+    }
+    do {
+        do {
+            a = getc(original);
+        } while (a == '\r' || a == '\n');
+        do {
+            b = getc(decrypted);
+        } while (b == '\r' || b == '\n');
+    } while (a == b && a != EOF);
+
+    fclose(original);
+    fclose(decrypted);
+    return a == b || (partial && b == EOF) ? 0 : 1;
+}
+
+/**
+ * @brief Grava as medicoes da etapa principal (--stats): em texto na saída padrão ou, com
+ * --stats-json, em JSON no arquivo indicado ("-" para a saída padrão).
+ * (Função auxiliar estática)
+ */
+static void write_stats(const char *json_path)
+{
+    adfgvx_stats_disable();
+    if (json_path == NULL) {
+        adfgvx_stats_write(stdout, 0);
+        return;
+    }
+    FILE *json = strcmp(json_path, "-") == 0 ? stdout : fopen(json_path, "w");
+    if (json == NULL) {
+        fprintf(stderr, "Erro ao abrir '%s' para as estatísticas.\n", json_path);
+        return;
+    }
+    adfgvx_stats_write(json, 1);
+    if (json != stdout) {
+        fclose(json);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char key_buffer[MAX_KEY_LENGTH];
+    int key_len_actual = 0;
+    int thread_count = 1;
+    int line_mode = 0;
+    int container_mode = 0;
+    int packed_mode = 0;
+    int range_mode = 0;
+    size_t range_offset = 0, range_length = 0;
+    int stats = 0;
+    const char *stats_json_path = NULL;
+    const char *round_keys[ADFGVX_MAX_ROUNDS - 1];
+    int round_key_count = 0;
+    int status;
+
+    // Opcoes: --threads N decifra com N threads (0 = numero de processadores);
+    // --lines decifra cada linha de encrypted.txt como um registro independente;
+    // --container decifra o formato em blocos gravado por adfgvx_cipher_tool --container;
+    // --packed decifra o formato compacto gravado por adfgvx_cipher_tool --packed;
+    // --range OFFSET:TAMANHO decifra apenas esse trecho da mensagem;
+    // --stats (ou --stats-json ARQUIVO) mede os estagios da etapa principal;
+    // --round-key CHAVE (repetivel) decifra um texto cifrado com mais rodadas de transposicao.
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            thread_count = atoi(argv[++i]);
+            if (thread_count <= 0) {
+                thread_count = thread_pool_cpu_count();
+            }
+        } else if (strcmp(argv[i], "--lines") == 0) {
+            line_mode = 1;
+        } else if (strcmp(argv[i], "--container") == 0) {
+            container_mode = 1;
+        } else if (strcmp(argv[i], "--packed") == 0) {
+            packed_mode = 1;
+        } else if (strcmp(argv[i], "--range") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            range_offset = (size_t)strtoull(argv[++i], &end, 10);
+            if (*end != ':') {
+                fprintf(stderr, "Uso: --range OFFSET:TAMANHO\n");
+                return EXIT_FAILURE;
+            }
+            range_length = (size_t)strtoull(end + 1, NULL, 10);
+            range_mode = 1;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = 1;
+        } else if (strcmp(argv[i], "--stats-json") == 0 && i + 1 < argc) {
+            stats = 1;
+            stats_json_path = argv[++i];
+        } else if (strcmp(argv[i], "--round-key") == 0 && i + 1 < argc && round_key_count < ADFGVX_MAX_ROUNDS - 1 &&
+                   argv[i + 1][0] != '\0' && strlen(argv[i + 1]) < MAX_KEY_LENGTH) {
+            round_keys[round_key_count++] = argv[++i];
+        } else {
+            fprintf(stderr, "Uso: %s [--threads N] [--lines | --container | --packed | --range OFFSET:TAMANHO | --round-key CHAVE ...]\n"
+                            "          [--stats | --stats-json ARQUIVO]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+    if ((round_key_count > 0 || packed_mode) && (line_mode || container_mode || range_mode)) {
+        fprintf(stderr, "--round-key e --packed nao podem ser combinados com --lines, --container ou --range.\n");
+        return EXIT_FAILURE;
+    }
+    if (round_key_count > 0 && packed_mode) {
+        fprintf(stderr, "--round-key nao pode ser combinado com --packed.\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("--- PROGRAMA DE TESTE DE DECIFRAGEM E OUTROS TESTES ADFGVX ---\n");
+
+    // Etapa principal: Decifrar um arquivo e comparar
+    printf("\n--- ETAPA PRINCIPAL: DECIFRAR ARQUIVO E COMPARAR ---\n");
+
+    if (stats) {
+        adfgvx_stats_enable(); // Mede apenas a etapa principal, nao os testes internos.
+    }
+
+    // 1. Ler chave
+    printf("Lendo chave de '%s'...\n", DEFAULT_KEY_FILE);
+    status = read_file(DEFAULT_KEY_FILE, key_buffer, MAX_KEY_LENGTH);
+    if (status != 0) {
+        fprintf(stderr, "Erro ao ler o arquivo da chave '%s'. Código: %d. Saindo da etapa principal.\n", DEFAULT_KEY_FILE, status);
+        // Prosseguir para os testes auto-contidos
+    } else {
+        key_len_actual = strlen(key_buffer);
+        if (key_len_actual == 0 || key_len_actual >= MAX_KEY_LENGTH) {
+            fprintf(stderr, "Erro: Comprimento da chave inválido (%d) lido de '%s'. Saindo da etapa principal.\n", key_len_actual, DEFAULT_KEY_FILE);
+            // Prosseguir para os testes auto-contidos
+        } else {
+            printf("Chave: \"%s\", Comprimento: %d\n", key_buffer, key_len_actual);
+
+            // 2. Ler e decifrar o texto cifrado (mapeado em memoria ou em fluxo), sem limite de tamanho
+            printf("Lendo e decifrando texto cifrado de '%s' para '%s'...\n", DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST);
+            if (round_key_count > 0) {
+                status = decipher_file_rounds(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual,
+                                              round_keys, round_key_count);
+            } else if (packed_mode) {
+                status = decipher_file_packed(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual);
+            } else if (range_mode) {
+                status = decipher_file_range(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual,
+                                             range_offset, range_length);
+            } else if (container_mode) {
+                status = decipher_file_container(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual, thread_count);
+            } else if (line_mode) {
+                status = decipher_file_records(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual, thread_count);
+            } else if (FILE_OPERATIONS_HAVE_MMAP || thread_count > 1 || key_len_actual > ADFGVX_STREAM_MAX_KEY_LENGTH) {
+                status = decipher_file_mapped(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual, thread_count);
+            } else {
+                status = decipher_file_stream(DEFAULT_ENCRYPTED_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, key_buffer, key_len_actual);
+            }
+            if (stats) {
+                write_stats(stats_json_path);
+            }
+            if (status != 0) {
+                fprintf(stderr, "Erro ao decifrar o arquivo cifrado '%s'. Código: %d.\n", DEFAULT_ENCRYPTED_FILE, status);
+                fprintf(stderr, "Certifique-se de que este arquivo existe (gerado por uma ferramenta de cifragem).\n");
+            } else {
+                printf("Texto decifrado salvo com sucesso.\n");
+
+                // 3. Comparar com original
+                printf("Comparando com a mensagem original de '%s'...\n", DEFAULT_MESSAGE_FILE);
+                status = compare_with_original(DEFAULT_MESSAGE_FILE, DEFAULT_DECRYPTED_FILE_FOR_TEST, range_offset, range_mode);
+                if (status < 0) {
+                    fprintf(stderr, "Erro ao ler o arquivo da mensagem original '%s'. Comparação não será feita.\n", DEFAULT_MESSAGE_FILE);
+                } else if (status == 0) {
+                    printf("VERIFICAÇÃO: SUCESSO! Texto decifrado corresponde ao original de '%s'.\n", DEFAULT_MESSAGE_FILE);
+                } else {
+                    fprintf(stderr, "VERIFICAÇÃO: FALHA! Texto decifrado NÃO corresponde ao original de '%s'.\n", DEFAULT_MESSAGE_FILE);
+                }
+            }
+        }
+    }
+
+    adfgvx_stats_disable();
+
+    // --- Executar os "outros testes" (adaptados do monolítico) ---
+    printf("\n--- EXECUTANDO TESTES INTERNOS ADICIONAIS ---\n");
+
+    // Os testes usam chaves e mensagens embutidas.
+    test_decipher("Teste Interno 1", "UM", "LUCAS");
+    test_decipher("Teste Interno 2", "SEMB2025", "TESTANDO A CIFRA ADFGVX COM UMA CHAVE UM POUCO MAIOR E UMA MENSAGEM DE COMPRIMENTO MEDIO PARA VERIFICAR A CORRECAO.");
+    test_decipher("Teste Interno 3 (Msg Curta)", "CHAVE", "OI");
+    test_decipher("Teste Interno 4 (Msg Vazia)", "TESTE", "");
+
+
+    test_execution_time(); // Usa cipher_adfgvx_linear
+    test_invalid_character(); // Usa cipher_adfgvx e cipher_adfgvx_linear
+    test_stream_round_trip(); // Usa os contextos de fluxo
+    test_encode_kernels(); // Usa adfgvx_encode_symbols
+    test_key_ctx_batch(); // Usa adfgvx_key_ctx e as funcoes *_batch
+    test_parallel_round_trip(); // Usa thread_pool e as funcoes *_parallel
+    test_records_mode(); // Usa adfgvx_process_records
+    test_mapped_files(); // Usa map_input_file / map_output_file
+    test_range_decrypt(); // Usa decipher_adfgvx_range_ctx / decipher_adfgvx_file_range
+    test_long_keys(); // Usa adfgvx_key_ctx com chaves de milhares de colunas
+    test_workspace(); // Usa adfgvx_workspace com cipher_adfgvx_ws / decipher_adfgvx_ws
+    test_container(); // Usa adfgvx_container_writer_* / adfgvx_container_*
+    test_pipeline(); // Usa adfgvx_pipeline_run com adfgvx_container_reader_*
+    test_service(); // Usa adfgvx_service_* (servidor e cliente)
+    test_differential_harness(); // Usa adfgvx_fuzz_* contra adfgvx_reference_*
+    test_stage_stats(); // Usa adfgvx_stats_* com cipher_adfgvx_linear_ctx / decipher_adfgvx_direct_ctx
+    test_specialized_transpose(); // Usa adfgvx_transpose_* com cipher_adfgvx_linear_ctx / decipher_adfgvx_*_ctx
+    test_transposition_rounds(); // Usa cipher_adfgvx_rounds / decipher_adfgvx_rounds
+    test_tiled_transpose(); // Usa adfgvx_transpose_scatter_tiles / adfgvx_transpose_gather_tile
+    test_packed_format(); // Usa adfgvx_packed_* e adfgvx_pack_symbols / adfgvx_unpack_symbols
+    test_key_recovery(); // Usa adfgvx_search_column_orders / adfgvx_search_wordlist
+    test_square_solver(); // Usa adfgvx_solve_square
+
+    printf("\n--- FIM DO PROGRAMA DE TESTES ---\n");
+    return EXIT_SUCCESS;
+}
+
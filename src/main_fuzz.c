@@ -0,0 +1,267 @@
+#define _POSIX_C_SOURCE 200809L // Para clock_gettime com -std=c99
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h> // Para malloc, strtoul e atoi
+
+#include "cipher_config.h"
+#include "adfgvx_fuzz.h"
+#include "file_operations.h" // Para read_whole_file
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Programa do harness diferencial da cifra ADFGVX (adfgvx_fuzz).
+//
+// Gera casos aleatorios reprodutiveis (--seed) e compara cada implementacao da cifragem e
+// da decifragem com a referencia congelada (adfgvx_reference). O primeiro caso divergente
+// e gravado em --artifact, e --replay ARQUIVO executa de novo um caso gravado (inclusive os
+// gerados pelo libFuzzer). Compilado com -DADFGVX_LIBFUZZER, este arquivo fornece apenas
+// LLVMFuzzerTestOneInput, e o libFuzzer gera e reduz os casos:
+//
+//   clang -g -O1 -fsanitize=fuzzer,address,undefined -DADFGVX_LIBFUZZER -Iheaders src/main_fuzz.c ...
+
+#define FUZZ_DEFAULT_ITERATIONS 20000
+#define FUZZ_DEFAULT_MAX_LENGTH 4096
+#define FUZZ_DEFAULT_ARTIFACT "./adfgvx_fuzz_case.bin"
+
+// Threads do pool das versoes paralelas (com mensagens curtas, mais threads nao acrescentam casos).
+#define FUZZ_THREADS 3
+
+#ifdef ADFGVX_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    static thread_pool *pool = NULL;
+
+    if (pool == NULL)
+    {
+        pool = thread_pool_create(FUZZ_THREADS);
+    }
+    // Uma divergencia interrompe o libFuzzer, que grava o caso (crash-*).
+    if (adfgvx_fuzz_run_case(data, size, pool, stderr, NULL) == 1)
+    {
+        abort();
+    }
+    return 0;
+}
+
+#else
+
+/**
+ * @brief Opcoes da linha de comando.
+ */
+typedef struct
+{
+    unsigned long long iterations;
+    unsigned int seed;
+    size_t max_length;
+    int thread_count;
+    const char *replay_path;
+    const char *artifact_path;
+} fuzz_options;
+
+/**
+ * @brief Retorna o tempo monotonic atual, em segundos.
+ */
+static double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * @brief Le as opcoes da linha de comando.
+ *   --iterations N     Casos gerados. Padrao: FUZZ_DEFAULT_ITERATIONS.
+ *   --seed N           Semente do gerador (diferente de 0). Padrao: 1.
+ *   --max-length N     Maior mensagem gerada, em bytes. Padrao: FUZZ_DEFAULT_MAX_LENGTH.
+ *   --threads N        Threads das versoes paralelas (1 = nao as compara). Padrao: FUZZ_THREADS.
+ *   --replay ARQUIVO   Executa apenas o caso gravado no arquivo.
+ *   --artifact ARQUIVO Onde gravar o primeiro caso divergente. Padrao: FUZZ_DEFAULT_ARTIFACT.
+ *
+ * @return int 0 em caso de sucesso, 1 se alguma opcao for invalida.
+ */
+static int parse_arguments(int argc, char *argv[], fuzz_options *options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (value == NULL)
+        {
+            return 1;
+        }
+        if (strcmp(argv[i], "--iterations") == 0)
+        {
+            options->iterations = strtoull(value, NULL, 10);
+            if (options->iterations == 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            options->seed = (unsigned int)strtoul(value, NULL, 10);
+            if (options->seed == 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--max-length") == 0)
+        {
+            long length = atol(value);
+            if (length < 0)
+            {
+                return 1;
+            }
+            options->max_length = (size_t)length;
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            options->thread_count = atoi(value);
+            if (options->thread_count < 1)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--replay") == 0)
+        {
+            options->replay_path = value;
+        }
+        else if (strcmp(argv[i], "--artifact") == 0)
+        {
+            options->artifact_path = value;
+        }
+        else
+        {
+            return 1;
+        }
+        i++;
+    }
+    return 0;
+}
+
+/**
+ * @brief Executa novamente um caso gravado.
+ *
+ * @return int EXIT_SUCCESS se todas as implementacoes concordarem com a referencia.
+ */
+static int replay_case(const char *path, thread_pool *pool)
+{
+    char *data = NULL;
+    size_t size = 0;
+    adfgvx_fuzz_stats stats = {0, 0, 0};
+
+    if (read_whole_file(path, &data, &size) != 0)
+    {
+        fprintf(stderr, "Erro ao ler o caso '%s'.\n", path);
+        return EXIT_FAILURE;
+    }
+    int status = adfgvx_fuzz_run_case((const unsigned char *)data, size, pool, stdout, &stats);
+    free(data);
+    printf("Caso '%s' (%lu bytes): %llu comparacoes, %llu divergencias.\n",
+           path, (unsigned long)size, stats.comparisons, stats.mismatches);
+    if (status == 2)
+    {
+        fprintf(stderr, "Erro: memoria ou arquivos temporarios insuficientes.\n");
+    }
+    return status == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Grava os bytes de um caso num arquivo.
+ */
+static void save_case(const char *path, const unsigned char *data, size_t size)
+{
+    FILE *file = fopen(path, "wb");
+
+    if (file == NULL || fwrite(data, 1, size, file) != size)
+    {
+        fprintf(stderr, "Erro ao gravar o caso em '%s'.\n", path);
+    }
+    else
+    {
+        printf("Caso gravado em '%s' (repita com --replay).\n", path);
+    }
+    if (file != NULL)
+    {
+        fclose(file);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    fuzz_options options = {FUZZ_DEFAULT_ITERATIONS, 1, FUZZ_DEFAULT_MAX_LENGTH, FUZZ_THREADS, NULL, FUZZ_DEFAULT_ARTIFACT};
+
+    if (parse_arguments(argc, argv, &options) != 0)
+    {
+        fprintf(stderr, "Uso: %s [--iterations N] [--seed N] [--max-length N] [--threads N] [--artifact ARQUIVO]\n"
+                        "   ou: %s --replay ARQUIVO [--threads N]\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    thread_pool *pool = options.thread_count > 1 ? thread_pool_create(options.thread_count) : NULL;
+    if (options.replay_path != NULL)
+    {
+        int exit_code = replay_case(options.replay_path, pool);
+        thread_pool_destroy(pool);
+        return exit_code;
+    }
+
+    unsigned char *data = malloc(ADFGVX_FUZZ_HEADER_SIZE + MAX_KEY_LENGTH + options.max_length);
+    if (data == NULL)
+    {
+        fprintf(stderr, "Erro: memoria insuficiente.\n");
+        thread_pool_destroy(pool);
+        return EXIT_FAILURE;
+    }
+
+    printf("Harness diferencial: %llu casos, semente %u, mensagens de ate %lu bytes, %d thread(s).\n",
+           options.iterations, options.seed, (unsigned long)options.max_length, thread_pool_size(pool));
+
+    adfgvx_fuzz_stats stats = {0, 0, 0};
+    unsigned int state = options.seed;
+    int saved = 0;
+    int status = 0;
+    double start = now_seconds();
+    for (unsigned long long i = 0; i < options.iterations; i++)
+    {
+        size_t size = adfgvx_fuzz_generate(&state, options.max_length, data);
+
+        status = adfgvx_fuzz_run_case(data, size, pool, stdout, &stats);
+        if (status == 1 && !saved)
+        {
+            printf("Divergencia no caso %llu.\n", i);
+            save_case(options.artifact_path, data, size);
+            saved = 1;
+        }
+        if (status == 2)
+        {
+            fprintf(stderr, "Erro: memoria ou arquivos temporarios insuficientes no caso %llu.\n", i);
+            break;
+        }
+    }
+    double elapsed = now_seconds() - start;
+
+    printf("%llu casos, %llu comparacoes, %llu divergencias em %.2f s.\n",
+           stats.cases, stats.comparisons, stats.mismatches, elapsed);
+    free(data);
+    thread_pool_destroy(pool);
+    return stats.mismatches == 0 && status != 2 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // ADFGVX_LIBFUZZER
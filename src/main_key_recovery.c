@@ -0,0 +1,525 @@
+#define _POSIX_C_SOURCE 200809L // Para clock_gettime com -std=c99
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h> // Para malloc, strtod e atoi
+
+#include "cipher_config.h"
+#include "adfgvx_cryptanalysis.h"
+#include "adfgvx_key.h"      // Para adfgvx_key_ctx_init_order
+#include "adfgvx_decipher.h" // Para decipher_adfgvx_direct_ctx (inicio do texto de cada candidato)
+#include "adfgvx_codec.h"    // Para adfgvx_symbols e adfgvx_symbol_value (matriz encontrada)
+#include "file_operations.h" // Para read_whole_file
+#include "thread_pool.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+// Programa de recuperacao da chave de transposicao da cifra ADFGVX.
+//
+// Supoe a matriz Polybius conhecida (a do codec) e procura a ordem das colunas: por busca
+// exaustiva sobre todas as permutacoes de cada comprimento de chave ou, com --wordlist,
+// pelas palavras de um dicionario. Cada candidato e decifrado com a mesma rotina da
+// decifragem (decipher_adfgvx_direct_ctx) e pontuado por estatisticas de trigramas,
+// com corte antecipado pelo prefixo; a busca e dividida entre as threads do pool.
+//
+// Com --solve-square, a ordem das colunas e dada (--key ou --order, por exemplo a
+// encontrada pela busca) e a matriz Polybius e que e desconhecida: ela e recuperada por
+// recozimento simulado com quadrigramas (adfgvx_solve_square), com reinicios nas threads.
+
+#define RECOVERY_PREVIEW_LENGTH 48
+
+// Maior comprimento padrao da busca exaustiva (8! ordens de colunas no ultimo comprimento).
+#define RECOVERY_DEFAULT_MAX_LENGTH 8
+
+/**
+ * @brief Opcoes da linha de comando.
+ */
+typedef struct
+{
+    const char *cipher_path;
+    const char *wordlist_path;
+    const char *corpus_path;
+    int min_length;
+    int max_length;
+    int thread_count;
+    size_t top;
+    size_t prefix_pairs;
+    double abort_margin;
+    int solve_square;
+    const char *transposition_key;
+    int column_order[ADFGVX_SEARCH_MAX_KEY_LENGTH];
+    int order_length;
+    int restarts;
+    unsigned long long iterations;
+    double temperature;
+    unsigned int seed;
+} recovery_options;
+
+/**
+ * @brief Retorna o tempo monotonic atual, em segundos.
+ */
+static double now_seconds(void)
+{
+#ifdef _WIN32
+    LARGE_INTEGER counter, frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/**
+ * @brief Le as opcoes da linha de comando.
+ *   --cipher ARQUIVO     Texto cifrado. Padrao: DEFAULT_ENCRYPTED_FILE.
+ *   --min-length N       Menor comprimento de chave da busca exaustiva. Padrao: 1.
+ *   --max-length N       Maior comprimento (ate ADFGVX_SEARCH_MAX_KEY_LENGTH). Padrao: RECOVERY_DEFAULT_MAX_LENGTH.
+ *   --wordlist ARQUIVO   Busca por dicionario (uma palavra por linha) em vez da exaustiva.
+ *   --corpus ARQUIVO     Texto de treino do modelo de trigramas. Padrao: texto embutido.
+ *   --threads N          Threads da busca (0 = processadores). Padrao: processadores.
+ *   --top N              Candidatos exibidos (ate ADFGVX_MAX_CANDIDATES). Padrao: 10.
+ *   --prefix N           Caracteres pontuados antes do corte. Padrao: ADFGVX_KEY_SEARCH_PREFIX.
+ *   --abort-margin X     Margem do corte antecipado. Padrao: ADFGVX_KEY_SEARCH_ABORT_MARGIN.
+ *   --solve-square       Recupera a matriz Polybius, com a transposicao dada por:
+ *   --key CHAVE          Chave de transposicao conhecida, ou
+ *   --order C0,C1,...    Ordem das colunas (como na tabela da busca).
+ *   --restarts N         Reinicios do recozimento. Padrao: 2 por thread (no minimo 8).
+ *   --iterations N       Trocas por reinicio. Padrao: ADFGVX_SQUARE_SEARCH_ITERATIONS.
+ *   --temperature X      Temperatura inicial. Padrao: ADFGVX_SQUARE_SEARCH_TEMPERATURE.
+ *   --seed N             Semente dos reinicios. Padrao: 1.
+ *
+ * @return int 0 em caso de sucesso, 1 se alguma opcao for invalida.
+ */
+static int parse_arguments(int argc, char *argv[], recovery_options *options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+
+        if (strcmp(argv[i], "--solve-square") == 0)
+        {
+            options->solve_square = 1;
+            continue;
+        }
+        if (value == NULL)
+        {
+            return 1;
+        }
+        if (strcmp(argv[i], "--cipher") == 0)
+        {
+            options->cipher_path = value;
+        }
+        else if (strcmp(argv[i], "--wordlist") == 0)
+        {
+            options->wordlist_path = value;
+        }
+        else if (strcmp(argv[i], "--corpus") == 0)
+        {
+            options->corpus_path = value;
+        }
+        else if (strcmp(argv[i], "--min-length") == 0)
+        {
+            options->min_length = atoi(value);
+            if (options->min_length < 1 || options->min_length > ADFGVX_SEARCH_MAX_KEY_LENGTH)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--max-length") == 0)
+        {
+            options->max_length = atoi(value);
+            if (options->max_length < 1 || options->max_length > ADFGVX_SEARCH_MAX_KEY_LENGTH)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--threads") == 0)
+        {
+            options->thread_count = atoi(value);
+            if (options->thread_count <= 0)
+            {
+                options->thread_count = thread_pool_cpu_count();
+            }
+        }
+        else if (strcmp(argv[i], "--top") == 0)
+        {
+            int top = atoi(value);
+            if (top < 1 || top > ADFGVX_MAX_CANDIDATES)
+            {
+                return 1;
+            }
+            options->top = (size_t)top;
+        }
+        else if (strcmp(argv[i], "--prefix") == 0)
+        {
+            int prefix = atoi(value);
+            if (prefix < 3)
+            {
+                return 1;
+            }
+            options->prefix_pairs = (size_t)prefix;
+        }
+        else if (strcmp(argv[i], "--abort-margin") == 0)
+        {
+            options->abort_margin = strtod(value, NULL);
+        }
+        else if (strcmp(argv[i], "--key") == 0)
+        {
+            options->transposition_key = value;
+            if (strlen(value) == 0 || strlen(value) >= MAX_KEY_LENGTH)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--order") == 0)
+        {
+            const char *p = value;
+            options->order_length = 0;
+            while (*p != '\0')
+            {
+                char *end = NULL;
+                long column = strtol(p, &end, 10);
+                if (end == p || options->order_length >= ADFGVX_SEARCH_MAX_KEY_LENGTH)
+                {
+                    return 1;
+                }
+                options->column_order[options->order_length++] = (int)column;
+                p = *end == ',' ? end + 1 : end;
+            }
+        }
+        else if (strcmp(argv[i], "--restarts") == 0)
+        {
+            options->restarts = atoi(value);
+            if (options->restarts < 1)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--iterations") == 0)
+        {
+            options->iterations = strtoull(value, NULL, 10);
+            if (options->iterations == 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--temperature") == 0)
+        {
+            options->temperature = strtod(value, NULL);
+            if (options->temperature <= 0)
+            {
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--seed") == 0)
+        {
+            options->seed = (unsigned int)strtoul(value, NULL, 10);
+        }
+        else
+        {
+            return 1;
+        }
+        i++;
+    }
+    if (options->solve_square && (options->transposition_key != NULL) == (options->order_length > 0))
+    {
+        return 1; // --solve-square exige exatamente uma de --key e --order.
+    }
+    return options->min_length <= options->max_length ? 0 : 1;
+}
+
+/**
+ * @brief Separa o conteudo de um arquivo em palavras (uma por linha), no proprio buffer.
+ *
+ * @param text Conteudo do arquivo; as quebras de linha sao substituidas por '\0'.
+ * @param words Saida: vetor alocado com o inicio de cada palavra nao vazia (liberar com free).
+ * @return size_t Numero de palavras (0 tambem em caso de falta de memoria).
+ */
+static size_t split_words(char *text, size_t length, const char ***words)
+{
+    size_t count = 0;
+    size_t capacity = 1024;
+    const char **list = malloc(capacity * sizeof(const char *));
+    size_t start = 0;
+
+    if (list == NULL)
+    {
+        return 0;
+    }
+    for (size_t i = 0; i <= length; i++)
+    {
+        if (i < length && text[i] != '\n' && text[i] != '\r')
+        {
+            continue;
+        }
+        if (i > start)
+        {
+            if (count == capacity)
+            {
+                const char **grown = realloc(list, 2 * capacity * sizeof(const char *));
+                if (grown == NULL)
+                {
+                    free(list);
+                    return 0;
+                }
+                list = grown;
+                capacity *= 2;
+            }
+            list[count++] = text + start;
+        }
+        if (i < length)
+        {
+            text[i] = '\0';
+        }
+        start = i + 1;
+    }
+    *words = list;
+    return count;
+}
+
+/**
+ * @brief Executa a busca (exaustiva ou por dicionario) e exibe os melhores candidatos.
+ *
+ * @return int EXIT_SUCCESS se algum candidato foi encontrado, EXIT_FAILURE caso contrario.
+ */
+static int run_search(const recovery_options *options, const char *ciphertext, size_t ciphertext_length,
+                      const adfgvx_ngram_model *model)
+{
+    // Dicionario (opcional).
+    char *wordlist = NULL;
+    size_t wordlist_length = 0;
+    const char **words = NULL;
+    size_t word_count = 0;
+    if (options->wordlist_path != NULL)
+    {
+        if (read_whole_file(options->wordlist_path, &wordlist, &wordlist_length) != 0)
+        {
+            fprintf(stderr, "Erro ao ler o dicionario '%s'.\n", options->wordlist_path);
+            return EXIT_FAILURE;
+        }
+        word_count = split_words(wordlist, wordlist_length, &words);
+    }
+
+    thread_pool *pool = options->thread_count > 1 ? thread_pool_create(options->thread_count) : NULL;
+    adfgvx_key_search search = {ciphertext, ciphertext_length, model, options->prefix_pairs, options->abort_margin, pool};
+    adfgvx_key_candidate best[ADFGVX_MAX_CANDIDATES];
+    adfgvx_key_search_stats stats = {0, 0};
+    size_t found;
+
+    double start = now_seconds();
+    if (options->wordlist_path != NULL)
+    {
+        printf("Busca por dicionario: %lu palavras, %d thread(s).\n", (unsigned long)word_count, thread_pool_size(pool));
+        found = adfgvx_search_wordlist(&search, words, word_count, best, options->top, &stats);
+    }
+    else
+    {
+        printf("Busca exaustiva: chaves de %d a %d caracteres, %d thread(s).\n", options->min_length, options->max_length,
+               thread_pool_size(pool));
+        found = adfgvx_search_column_orders(&search, options->min_length, options->max_length, best, options->top, &stats);
+    }
+    double elapsed = now_seconds() - start;
+    thread_pool_destroy(pool);
+
+    printf("%llu candidatos avaliados (%llu descartados pelo prefixo) em %.3f s.\n\n", stats.tested, stats.aborted, elapsed);
+    printf("%-4s %9s %-3s %-18s %-9s %s\n", "#", "pontuacao", "k", "ordem", "chave", "inicio do texto");
+
+    // Exibe cada candidato com o inicio do texto decifrado.
+    for (size_t i = 0; i < found; i++)
+    {
+        char order_text[3 * ADFGVX_SEARCH_MAX_KEY_LENGTH + 1] = "";
+        char preview[RECOVERY_PREVIEW_LENGTH + 1];
+        size_t preview_length = 0;
+        size_t order_used = 0;
+        adfgvx_key_ctx key_ctx;
+
+        for (int c = 0; c < best[i].key_length; c++)
+        {
+            order_used += (size_t)sprintf(order_text + order_used, c + 1 < best[i].key_length ? "%d," : "%d",
+                                          best[i].column_order[c]);
+        }
+        if (adfgvx_key_ctx_init_order(&key_ctx, best[i].column_order, best[i].key_length) == 0)
+        {
+            decipher_adfgvx_direct_ctx(&key_ctx, ciphertext, ciphertext_length, preview, RECOVERY_PREVIEW_LENGTH, &preview_length);
+            adfgvx_key_ctx_free(&key_ctx);
+        }
+        preview[preview_length] = '\0';
+
+        printf("%-4lu %9.4f %-3d %-18s %-9s %s\n", (unsigned long)(i + 1), best[i].score, best[i].key_length,
+               order_text, best[i].key, preview);
+    }
+
+    free(words);
+    free(wordlist);
+    return found > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/**
+ * @brief Recupera a matriz Polybius com a transposicao das opcoes e exibe o resultado.
+ *
+ * @return int EXIT_SUCCESS em caso de sucesso, EXIT_FAILURE caso contrario.
+ */
+static int run_square_solver(const recovery_options *options, const char *ciphertext, size_t ciphertext_length,
+                             const adfgvx_quadgram_model *model)
+{
+    adfgvx_key_ctx key_ctx;
+    int key_status = options->transposition_key != NULL
+                         ? adfgvx_key_ctx_init(&key_ctx, options->transposition_key, (int)strlen(options->transposition_key))
+                         : adfgvx_key_ctx_init_order(&key_ctx, options->column_order, options->order_length);
+    if (key_status != 0)
+    {
+        fprintf(stderr, "Erro: transposicao invalida (--order deve ser uma permutacao de 0 .. k-1).\n");
+        return EXIT_FAILURE;
+    }
+
+    thread_pool *pool = options->thread_count > 1 ? thread_pool_create(options->thread_count) : NULL;
+    int restarts = options->restarts;
+    if (restarts == 0)
+    {
+        restarts = 2 * thread_pool_size(pool) < 8 ? 8 : 2 * thread_pool_size(pool);
+    }
+    adfgvx_square_search search = {ciphertext, ciphertext_length, &key_ctx, model, restarts,
+                                   options->iterations, options->temperature, options->seed, pool};
+    adfgvx_square_solution solution;
+    adfgvx_square_search_stats stats = {0, 0, 0};
+
+    printf("Solucionador da matriz: %d reinicios de %llu trocas, %d thread(s).\n", search.restarts, search.iterations,
+           thread_pool_size(pool));
+    double start = now_seconds();
+    int status = adfgvx_solve_square(&search, &solution, &stats);
+    double elapsed = now_seconds() - start;
+    thread_pool_destroy(pool);
+
+    if (status != 0)
+    {
+        fprintf(stderr, "Erro no solucionador (codigo %d).\n", status);
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+
+    printf("%llu trocas avaliadas (%llu aceitas) em %.3f s: %.2f milhoes por segundo.\n", stats.evaluations,
+           stats.accepted, elapsed, elapsed > 0 ? (double)stats.evaluations / elapsed / 1e6 : 0.0);
+    printf("Pontuacao: %.4f\n\n   ", solution.score);
+    for (int col = 0; col < ADFGVX_SYMBOL_COUNT; col++)
+    {
+        printf(" %c", adfgvx_symbols[col]);
+    }
+    for (int row = 0; row < ADFGVX_SYMBOL_COUNT; row++)
+    {
+        printf("\n %c ", adfgvx_symbols[row]);
+        for (int col = 0; col < ADFGVX_SYMBOL_COUNT; col++)
+        {
+            printf(" %c", solution.square[row * ADFGVX_SYMBOL_COUNT + col]);
+        }
+    }
+
+    // Inicio do texto decifrado com a matriz encontrada (o simbolo i esta em column_start[i % k] + i / k).
+    size_t stack_start[ADFGVX_KEY_STACK_COLUMNS];
+    size_t key_length = (size_t)key_ctx.key_length;
+    size_t *column_start = adfgvx_key_scratch(stack_start, ADFGVX_KEY_STACK_COLUMNS, key_length);
+    size_t pairs = ciphertext_length / 2 < RECOVERY_PREVIEW_LENGTH ? ciphertext_length / 2 : RECOVERY_PREVIEW_LENGTH;
+    if (column_start == NULL)
+    {
+        adfgvx_key_ctx_free(&key_ctx);
+        return EXIT_FAILURE;
+    }
+    adfgvx_key_ctx_column_starts(&key_ctx, ciphertext_length, column_start);
+    printf("\n\nInicio do texto: ");
+    for (size_t p = 0; p < pairs; p++)
+    {
+        size_t i = 2 * p;
+        unsigned char row = adfgvx_symbol_value[(unsigned char)ciphertext[column_start[i % key_length] + i / key_length]];
+        unsigned char col = adfgvx_symbol_value[(unsigned char)ciphertext[column_start[(i + 1) % key_length] + (i + 1) / key_length]];
+        putchar(solution.square[row * ADFGVX_SYMBOL_COUNT + col]);
+    }
+    putchar('\n');
+    adfgvx_key_scratch_free(column_start, stack_start);
+    adfgvx_key_ctx_free(&key_ctx);
+    return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+    recovery_options options = {DEFAULT_ENCRYPTED_FILE, NULL, NULL, 1, RECOVERY_DEFAULT_MAX_LENGTH, 0, 10,
+                                ADFGVX_KEY_SEARCH_PREFIX, ADFGVX_KEY_SEARCH_ABORT_MARGIN, 0, NULL, {0}, 0, 0,
+                                ADFGVX_SQUARE_SEARCH_ITERATIONS, ADFGVX_SQUARE_SEARCH_TEMPERATURE, 1};
+    char *ciphertext = NULL;
+    size_t ciphertext_length = 0;
+
+    options.thread_count = thread_pool_cpu_count();
+    if (parse_arguments(argc, argv, &options) != 0)
+    {
+        fprintf(stderr, "Uso: %s [--cipher ARQUIVO] [--min-length N] [--max-length N] [--wordlist ARQUIVO]\n"
+                        "          [--corpus ARQUIVO] [--threads N] [--top N] [--prefix N] [--abort-margin X]\n"
+                        "   ou: %s --solve-square (--key CHAVE | --order C0,C1,...) [--cipher ARQUIVO] [--corpus ARQUIVO]\n"
+                        "          [--threads N] [--restarts N] [--iterations N] [--temperature X] [--seed N]\n", argv[0], argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (read_whole_file(options.cipher_path, &ciphertext, &ciphertext_length) != 0)
+    {
+        fprintf(stderr, "Erro ao ler o texto cifrado de '%s'.\n", options.cipher_path);
+        return EXIT_FAILURE;
+    }
+    while (ciphertext_length > 0 && (ciphertext[ciphertext_length - 1] == '\n' || ciphertext[ciphertext_length - 1] == '\r'))
+    {
+        ciphertext_length--;
+    }
+    if (ciphertext_length < 6 || ciphertext_length % 2 != 0)
+    {
+        fprintf(stderr, "Erro: o texto cifrado precisa ter um numero par (>= 6) de simbolos.\n");
+        free(ciphertext);
+        return EXIT_FAILURE;
+    }
+
+    // Texto de treino dos modelos: o corpus informado ou o texto embutido.
+    char *corpus = NULL;
+    size_t corpus_length = 0;
+    if (options.corpus_path != NULL && read_whole_file(options.corpus_path, &corpus, &corpus_length) != 0)
+    {
+        fprintf(stderr, "Erro ao ler o corpus '%s'.\n", options.corpus_path);
+        free(ciphertext);
+        return EXIT_FAILURE;
+    }
+    const char *training = corpus != NULL ? corpus : adfgvx_default_corpus;
+    size_t training_length = corpus != NULL ? corpus_length : strlen(adfgvx_default_corpus);
+    int exit_code = EXIT_FAILURE;
+
+    if (options.solve_square)
+    {
+        adfgvx_quadgram_model *model = malloc(sizeof(adfgvx_quadgram_model));
+        if (model == NULL || adfgvx_quadgram_model_build(model, training, training_length) != 0)
+        {
+            fprintf(stderr, "Erro ao construir o modelo de quadrigramas.\n");
+        }
+        else
+        {
+            exit_code = run_square_solver(&options, ciphertext, ciphertext_length, model);
+        }
+        free(model);
+    }
+    else
+    {
+        adfgvx_ngram_model *model = malloc(sizeof(adfgvx_ngram_model));
+        if (model == NULL || adfgvx_ngram_model_build(model, training, training_length) != 0)
+        {
+            fprintf(stderr, "Erro ao construir o modelo de trigramas.\n");
+        }
+        else
+        {
+            exit_code = run_search(&options, ciphertext, ciphertext_length, model);
+        }
+        free(model);
+    }
+
+    free(corpus);
+    free(ciphertext);
+    return exit_code;
+}
@@ -0,0 +1,175 @@
+#define _POSIX_C_SOURCE 200809L // Para sysconf com -std=c99
+
+#include "thread_pool.h"
+#include <pthread.h>
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+struct thread_pool
+{
+    int thread_count;          // Total de threads, incluindo a chamadora.
+    pthread_t *workers;        // thread_count - 1 threads auxiliares.
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready; // Sinalizada quando ha um novo trabalho (ou no encerramento).
+    pthread_cond_t work_done;  // Sinalizada quando uma thread auxiliar sai do trabalho atual.
+    unsigned long generation;  // Incrementada a cada thread_pool_run.
+    int shutting_down;
+
+    // Trabalho atual.
+    thread_pool_task task;
+    void *user;
+    size_t task_count;
+    size_t next_task;
+    int busy_workers;          // Threads auxiliares ainda dentro do trabalho atual.
+};
+
+/**
+ * @brief Executa tarefas do trabalho atual ate que nao reste nenhuma.
+ * Deve ser chamada com o lock adquirido; retorna com o lock adquirido.
+ */
+static void run_pending_tasks(thread_pool *pool)
+{
+    while (pool->next_task < pool->task_count)
+    {
+        size_t index = pool->next_task++;
+        thread_pool_task task = pool->task;
+        void *user = pool->user;
+
+        pthread_mutex_unlock(&pool->lock);
+        task(user, index);
+        pthread_mutex_lock(&pool->lock);
+    }
+}
+
+/**
+ * @brief Laco das threads auxiliares.
+ */
+static void *worker_main(void *arg)
+{
+    thread_pool *pool = arg;
+    unsigned long seen_generation = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->shutting_down && pool->generation == seen_generation)
+        {
+            pthread_cond_wait(&pool->work_ready, &pool->lock);
+        }
+        if (pool->shutting_down)
+        {
+            break;
+        }
+        seen_generation = pool->generation;
+
+        run_pending_tasks(pool);
+
+        pool->busy_workers--;
+        pthread_cond_signal(&pool->work_done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+thread_pool *thread_pool_create(int thread_count)
+{
+    thread_pool *pool = calloc(1, sizeof(*pool));
+    if (pool == NULL)
+    {
+        return NULL;
+    }
+
+    pool->thread_count = thread_count < 1 ? 1 : thread_count;
+    pool->workers = calloc((size_t)pool->thread_count, sizeof(pthread_t));
+    if (pool->workers == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work_ready, NULL);
+    pthread_cond_init(&pool->work_done, NULL);
+
+    for (int i = 0; i < pool->thread_count - 1; i++)
+    {
+        if (pthread_create(&pool->workers[i], NULL, worker_main, pool) != 0)
+        {
+            // Mantem apenas as threads ja criadas.
+            pool->thread_count = i + 1;
+            break;
+        }
+    }
+    return pool;
+}
+
+void thread_pool_run(thread_pool *pool, size_t task_count, thread_pool_task task, void *user)
+{
+    if (task_count == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->user = user;
+    pool->task_count = task_count;
+    pool->next_task = 0;
+    pool->busy_workers = pool->thread_count - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->work_ready);
+
+    // A thread chamadora tambem executa tarefas e depois espera as auxiliares sairem.
+    run_pending_tasks(pool);
+    while (pool->busy_workers > 0)
+    {
+        pthread_cond_wait(&pool->work_done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+int thread_pool_size(const thread_pool *pool)
+{
+    return pool ? pool->thread_count : 1;
+}
+
+void thread_pool_destroy(thread_pool *pool)
+{
+    if (pool == NULL)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    pool->shutting_down = 1;
+    pthread_cond_broadcast(&pool->work_ready);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (int i = 0; i < pool->thread_count - 1; i++)
+    {
+        pthread_join(pool->workers[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->work_done);
+    pthread_cond_destroy(&pool->work_ready);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->workers);
+    free(pool);
+}
+
+int thread_pool_cpu_count(void)
+{
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}